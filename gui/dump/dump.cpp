@@ -171,9 +171,8 @@ DumpGui::init(int argc, char **argv[])
     _renderer.reset(create_Renderer_agg(_pixelformat.c_str()));
     _runResources.setRenderer(_renderer);
 
-    sound::sound_handler* mixer = _runResources.soundHandler();
     media::MediaHandler* mh = _runResources.mediaHandler();
-    _soundHandler.reset(new sound::NullSoundHandler(mh, mixer));
+    _soundHandler.reset(new sound::NullSoundHandler(mh));
     _runResources.setSoundHandler(_soundHandler);
 
     // We know what type of renderer it is.
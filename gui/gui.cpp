@@ -1155,6 +1155,16 @@ Gui::getMovieInfo() const
                     std::make_pair(lbl + typ, ss.str()));
     }
 
+    GC::CollectablesCount pauses;
+    _stage->gc().countPauses(pauses);
+    for (GC::CollectablesCount::iterator i = pauses.begin(),
+            e = pauses.end(); i != e; ++i) {
+        std::ostringstream ss;
+        ss << i->second;
+        firstLevelIter = tr->append_child(topIter,
+                    std::make_pair("GC " + i->first, ss.str()));
+    }
+
     tr->sort(firstLevelIter.begin(), firstLevelIter.end());
 
     return tr;
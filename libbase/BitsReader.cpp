@@ -35,6 +35,18 @@ unsigned BitsReader::read_uint(unsigned short bitcount)
 {
 	assert(bitcount <= 32);
 
+	// With eight bytes left, all the bits come from one load.
+	if (end - ptr >= 8) {
+		boost::uint64_t word = 0;
+		for (int i = 0; i < 8; ++i) word = (word << 8) | ptr[i];
+		const unsigned value = bitcount ?
+			(word << usedBits) >> (64 - bitcount) : 0;
+		usedBits += bitcount;
+		ptr += usedBits / 8;
+		usedBits %= 8;
+		return value;
+	}
+
 	boost::uint32_t value = 0;
 
 	unsigned short bits_needed = bitcount;
@@ -57,6 +57,12 @@ public:
     /// A disposed CachedBitmap has no data and should not be rendered.
     virtual bool disposed() const = 0;
 
+    /// Return the CachedBitmap to draw.
+    //
+    /// This is the CachedBitmap itself unless its data is only decoded
+    /// when needed. The result may be 0 if decoding fails.
+    virtual const CachedBitmap* materialize() const { return this; }
+
 };
 	
 } // namespace gnash
@@ -20,9 +20,13 @@
 #include "GC.h"
 
 #include <cstdlib>
+#include <sstream>
+#include <algorithm>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 
 #include "utility.h" // for typeName()
 #include "GnashAlgorithm.h"
+#include "rc.h"
 
 #ifdef GNASH_GC_DEBUG
 # include "log.h"
@@ -31,17 +35,44 @@
 
 namespace gnash {
 
+namespace {
+
+/// Resources handled between two checks of the clock.
+const size_t checkInterval = 256;
+
+/// Return the time in microseconds.
+boost::uint64_t
+now()
+{
+    using namespace boost::posix_time;
+    static const ptime epoch(boost::gregorian::date(1970, 1, 1));
+    return (microsec_clock::universal_time() - epoch).total_microseconds();
+}
+
+}
+
+GcResource::GrayList* GcResource::_grayList = 0;
+bool GcResource::_youngOnly = false;
+
 GC::GC(GcRoot& root)
     :
     // might raise the default ...
     _maxNewCollectablesCount(64),
     _resListSize(0),
     _root(root),
-    _lastResCount(0)
+    _lastResCount(0),
+    _incrementalBudget(0),
+    _phase(IDLE),
+    _toSweep(0),
+    _youngSize(0),
+    _nurserySize(0),
+    _promotionAge(1)
 #ifdef GNASH_GC_DEBUG 
     , _collectorRuns(0)
 #endif
 {
+    std::fill(_pauses, _pauses + pauseBuckets, 0);
+
 #ifdef GNASH_GC_DEBUG 
     log_debug("GC %p created", (void*)this);
 #endif
@@ -50,6 +81,10 @@ GC::GC(GcRoot& root)
         const size_t gap = std::strtoul(gcgap, NULL, 0);
         _maxNewCollectablesCount = gap;
     }
+
+    const RcInitFile& rc = RcInitFile::getDefaultInstance();
+    _incrementalBudget = rc.getGCIncrementalBudget();
+    setNursery(rc.getGCNurserySize(), rc.getGCPromotionAge());
 }
 
 GC::~GC()
@@ -61,6 +96,28 @@ GC::~GC()
             i != e; ++i) {
         delete *i;
     }
+    for (ResList::const_iterator i = _young.begin(), e = _young.end();
+            i != e; ++i) {
+        delete *i;
+    }
+}
+
+void
+GC::setNursery(size_t size, unsigned int age)
+{
+    _promotionAge = std::max(1u, std::min(age, 255u));
+
+    if (!size) {
+        promoteAll();
+        clearUnbarriered();
+    }
+    else if (!_nurserySize) {
+        for (ResList::const_iterator i = _resList.begin(), e = _resList.end();
+                i != e; ++i) {
+            if (!(*i)->hasWriteBarriers()) addUnbarriered(*i);
+        }
+    }
+    _nurserySize = size;
 }
 
 size_t
@@ -73,6 +130,8 @@ GC::cleanUnreachable()
 
     size_t deleted = 0;
 
+    clearUnbarriered();
+
     for (ResList::iterator i = _resList.begin(), e = _resList.end(); i != e;) {
         const GcResource* res = *i;
         if (!res->isReachable()) {
@@ -86,6 +145,9 @@ GC::cleanUnreachable()
         }
         else {
             res->clearReachable();
+            if (_nurserySize && !res->hasWriteBarriers()) {
+                addUnbarriered(res);
+            }
             ++i;
         }
     }
@@ -103,6 +165,18 @@ GC::cleanUnreachable()
 void 
 GC::runCycle()
 {
+    // Finish an incremental cycle instead, as a recursive mark would not
+    // scan the gray resources.
+    if (_phase != IDLE) {
+        const unsigned int budget = _incrementalBudget;
+        _incrementalBudget = 0;
+        step();
+        _incrementalBudget = budget;
+        return;
+    }
+
+    const boost::uint64_t start = now();
+
     //
     // Collection cycle
     //
@@ -118,6 +192,8 @@ GC::runCycle()
             _lastResCount, _resListSize);
 #endif // GNASH_GC_DEBUG
 
+    promoteAll();
+
     // Mark all resources as reachable
     markReachable();
 
@@ -126,6 +202,243 @@ GC::runCycle()
 
     _lastResCount = _resListSize;
 
+    recordPause(now() - start);
+}
+
+void
+GC::step()
+{
+    const boost::uint64_t start = now();
+    const boost::uint64_t deadline =
+        _incrementalBudget ? start + _incrementalBudget : 0;
+
+    if (_phase == IDLE) {
+#ifdef GNASH_GC_DEBUG 
+        ++_collectorRuns;
+        log_debug("GC: incremental cycle started - %d/%d new resources "
+                "allocated since last run (from %d to %d)",
+                _resListSize - _lastResCount, _maxNewCollectablesCount,
+                _lastResCount, _resListSize);
+#endif
+        promoteAll();
+        _phase = MARKING;
+        GcResource::_grayList = &_gray;
+        _root.markReachableResources();
+        GcResource::_grayList = 0;
+    }
+
+    if (_phase == MARKING) {
+        if (!markGray(deadline)) {
+            recordPause(now() - start);
+            return;
+        }
+
+        // Roots and some resources have no write barriers, so scan them
+        // again and finish the mark at once. Most of what they reference
+        // is already marked.
+        GcResource::_grayList = &_gray;
+        _root.markReachableResources();
+        for (GcResource::GrayList::const_iterator i = _rescan.begin(),
+                e = _rescan.end(); i != e; ++i) {
+            (*i)->markReachableResources();
+        }
+        GcResource::_grayList = 0;
+        markGray(0);
+        GcResource::GrayList().swap(_rescan);
+
+        _phase = SWEEPING;
+        _sweepPos = _resList.begin();
+        _toSweep = _resListSize;
+        clearUnbarriered();
+    }
+
+    if (sweep(deadline)) {
+        _phase = IDLE;
+        _lastResCount = _resListSize;
+#ifdef GNASH_GC_DEBUG 
+        log_debug("GC: incremental cycle finished - %d resources left",
+                _resListSize);
+#endif
+    }
+
+    recordPause(now() - start);
+}
+
+bool
+GC::markGray(boost::uint64_t deadline)
+{
+    GcResource::_grayList = &_gray;
+
+    size_t count = 0;
+    while (!_gray.empty()) {
+        const GcResource* res = _gray.back();
+        _gray.pop_back();
+        res->markReachableResources();
+        if (!res->hasWriteBarriers()) _rescan.push_back(res);
+
+        if (deadline && ++count % checkInterval == 0 && now() > deadline) {
+            break;
+        }
+    }
+
+    GcResource::_grayList = 0;
+    return _gray.empty();
+}
+
+bool
+GC::sweep(boost::uint64_t deadline)
+{
+    size_t count = 0;
+    while (_toSweep) {
+        const GcResource* res = *_sweepPos;
+        --_toSweep;
+        if (!res->isReachable()) {
+#if GNASH_GC_DEBUG > 1
+            log_debug("GC: recycling object %p (%s)", res, typeName(*res));
+#endif
+            delete res;
+            _sweepPos = _resList.erase(_sweepPos);
+            --_resListSize;
+        }
+        else {
+            res->clearReachable();
+            if (_nurserySize && !res->hasWriteBarriers()) {
+                addUnbarriered(res);
+            }
+            ++_sweepPos;
+        }
+
+        if (deadline && ++count % checkInterval == 0 && now() > deadline) {
+            break;
+        }
+    }
+    return !_toSweep;
+}
+
+void
+GC::minorCycle()
+{
+    const boost::uint64_t start = now();
+
+    GcResource::_youngOnly = true;
+    _root.markReachableResources();
+    scanOld(_unbarriered);
+    scanOld(_remembered);
+    GcResource::_youngOnly = false;
+
+    size_t deleted = 0;
+    size_t promoted = 0;
+
+    for (ResList::iterator i = _young.begin(), e = _young.end(); i != e;) {
+        const GcResource* res = *i;
+        if (!res->isReachable()) {
+#if GNASH_GC_DEBUG > 1
+            log_debug("GC: recycling young object %p (%s)", res,
+                    typeName(*res));
+#endif
+            ++deleted;
+            delete res;
+            i = _young.erase(i);
+            continue;
+        }
+
+        res->clearReachable();
+        if (++res->_age < _promotionAge) {
+            ++i;
+            continue;
+        }
+
+        // A promoted resource may still reference young ones.
+        res->_old = true;
+        if (!res->hasWriteBarriers()) addUnbarriered(res);
+        else {
+            _remembered.push_back(res);
+            res->_remembered = _promotionAge;
+        }
+
+        ++promoted;
+        ResList::iterator next = i;
+        ++next;
+        _resList.splice(_resList.end(), _young, i);
+        i = next;
+    }
+
+    _youngSize -= deleted + promoted;
+    _resListSize += promoted;
+
+    // Everything young that a remembered resource referenced when it
+    // was last changed is promoted after _promotionAge minor cycles.
+    // Resources that lost their write barriers are scanned every time.
+    GcResource::GrayList::iterator out = _remembered.begin();
+    for (GcResource::GrayList::iterator it = _remembered.begin(),
+            e = _remembered.end(); it != e; ++it) {
+        const GcResource* res = *it;
+        if (!res->_unbarriered && !res->hasWriteBarriers()) {
+            addUnbarriered(res);
+        }
+        if (res->_unbarriered) res->_remembered = 0;
+        else if (--res->_remembered) *out++ = res;
+    }
+    _remembered.erase(out, _remembered.end());
+
+#ifdef GNASH_GC_DEBUG 
+    log_debug("GC: minor cycle recycled %d and promoted %d resources - "
+            "%d young left", deleted, promoted, _youngSize);
+#endif
+
+    recordPause(now() - start);
+}
+
+void
+GC::scanOld(const GcResource::GrayList& resources)
+{
+    for (GcResource::GrayList::const_iterator i = resources.begin(),
+            e = resources.end(); i != e; ++i) {
+        const GcResource* res = *i;
+        res->_reachable = true;
+        res->markReachableResources();
+        res->_reachable = false;
+    }
+}
+
+void
+GC::clearUnbarriered()
+{
+    for (GcResource::GrayList::const_iterator i = _unbarriered.begin(),
+            e = _unbarriered.end(); i != e; ++i) {
+        (*i)->_unbarriered = false;
+    }
+    _unbarriered.clear();
+}
+
+void
+GC::promoteAll()
+{
+    for (ResList::const_iterator i = _young.begin(), e = _young.end();
+            i != e; ++i) {
+        (*i)->_old = true;
+    }
+    _resList.splice(_resList.end(), _young);
+    _resListSize += _youngSize;
+    _youngSize = 0;
+
+    // No old resource references a young one now.
+    for (GcResource::GrayList::const_iterator i = _remembered.begin(),
+            e = _remembered.end(); i != e; ++i) {
+        (*i)->_remembered = 0;
+    }
+    _remembered.clear();
+}
+
+void
+GC::recordPause(boost::uint64_t usecs)
+{
+    size_t bucket = 0;
+    for (boost::uint64_t ms = usecs / 1000; ms && bucket < pauseBuckets - 1;
+            ms >>= 1) {
+        ++bucket;
+    }
+    ++_pauses[bucket];
 }
 
 void
@@ -135,6 +448,21 @@ GC::countCollectables(CollectablesCount& count) const
             i!=e; ++i) {
         ++count[typeName(**i)];
     }
+    for (ResList::const_iterator i = _young.begin(), e = _young.end();
+            i != e; ++i) {
+        ++count[typeName(**i)];
+    }
+}
+
+void
+GC::countPauses(CollectablesCount& count) const
+{
+    for (size_t i = 0; i < pauseBuckets; ++i) {
+        std::ostringstream ss;
+        if (i < pauseBuckets - 1) ss << "pauses < " << (1 << i) << " ms";
+        else ss << "pauses >= " << (1 << (i - 1)) << " ms";
+        count[ss.str()] = _pauses[i];
+    }
 }
 
 } // end of namespace gnash
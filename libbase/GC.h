@@ -31,8 +31,10 @@
 
 #include <list>
 #include <map>
+#include <vector>
 #include <string>
 #include <cassert>
+#include <boost/cstdint.hpp>
 
 #include "dsodefs.h"
 #ifdef GNASH_GC_DEBUG
@@ -107,7 +109,17 @@ public:
                 typeName(*this));
 #endif
 
+        // A minor collection does not scan old resources. Those that may
+        // reference young ones are scanned separately.
+        if (_old && _youngOnly) return;
+
         _reachable = true;
+
+        // An incremental mark scans the resource later.
+        if (_grayList) {
+            _grayList->push_back(this);
+            return;
+        }
         markReachableResources();
     }
 
@@ -141,6 +153,15 @@ protected:
 #endif
     }
 
+    /// Whether all new references are reported to GC::writeBarrier().
+    //
+    /// Resources without write barriers are scanned again at the end of an
+    /// incremental mark. Override this only if every change to the
+    /// resources reachable from this one calls GC::writeBarrier().
+    virtual bool hasWriteBarriers() const {
+        return false;
+    }
+
     /// Delete this resource.
     //
     /// This is protected to allow subclassing, but ideally it
@@ -150,8 +171,30 @@ protected:
 
 private:
 
+    typedef std::vector<const GcResource*> GrayList;
+
     mutable bool _reachable;
 
+    /// Whether the resource has left the young generation.
+    mutable bool _old;
+
+    /// Number of minor collections survived while young.
+    mutable boost::uint8_t _age;
+
+    /// Number of minor collections this old resource stays in the
+    /// remembered set, 0 if it is not in it.
+    mutable boost::uint8_t _remembered;
+
+    /// Whether this old resource is scanned by every minor collection.
+    mutable bool _unbarriered;
+
+    /// Where newly reached resources are queued during an incremental
+    /// mark, or 0 when they are scanned immediately.
+    static DSOEXPORT GrayList* _grayList;
+
+    /// Whether a minor collection is marking.
+    static DSOEXPORT bool _youngOnly;
+
 };
 
 /// Garbage collector singleton
@@ -198,8 +241,23 @@ public:
         assert(!item->isReachable());
 #endif
 
+        if (_nurserySize && _phase == IDLE) {
+            _young.push_back(item); ++_youngSize;
+            return;
+        }
+
+        item->_old = true;
         _resList.push_back(item); ++_resListSize;
 
+        // Whether it has write barriers is only known once constructed.
+        if (_nurserySize) addUnbarriered(item);
+
+        // Resources created during an incremental mark survive the cycle.
+        if (_phase == MARKING) {
+            item->_reachable = true;
+            _gray.push_back(item);
+        }
+
 #if GNASH_GC_DEBUG > 1
         log_debug(_("GC: collectable %p added, num collectables: %d"), item, 
                 _resListSize);
@@ -207,8 +265,20 @@ public:
     }
 
     /// Run the collector, if worth it
+    //
+    /// In incremental mode this continues the current cycle, if there is
+    /// one, for at most the incremental budget.
     void fuzzyCollect() {
 
+        if (_phase != IDLE) {
+            step();
+            return;
+        }
+
+        // A minor collection when the nursery is full. Only survivors
+        // promoted to the old generation count towards a full cycle.
+        if (_nurserySize && _youngSize >= _nurserySize) minorCycle();
+
         // Heuristic to decide wheter or not to run the collection cycle
         //
         //
@@ -248,22 +318,73 @@ public:
             return;
         }
 
-        runCycle();
+        if (_incrementalBudget) step();
+        else runCycle();
     }
 
     /// Run the collection cycle
     //
     /// Find all reachable collectables, destroy all the others.
+    /// If an incremental cycle is in progress, it is finished instead.
     ///
     void runCycle();
 
+    /// Set the time budget for incremental collection.
+    //
+    /// The default is the GCIncrementalBudget setting of gnashrc.
+    //
+    /// @param usecs    The maximum time spent in each call to fuzzyCollect()
+    ///                 in microseconds, or 0 to run whole cycles at once.
+    void setIncrementalBudget(unsigned int usecs) {
+        _incrementalBudget = usecs;
+    }
+
+    /// Enable or disable the young generation.
+    //
+    /// New resources are kept apart until they survive a number of minor
+    /// collections, which only scan young resources, the roots and old
+    /// resources that may reference young ones. The defaults come from
+    /// the GCNurserySize and GCPromotionAge settings in gnashrc.
+    //
+    /// @param size     The number of young resources that triggers a minor
+    ///                 collection, or 0 to disable the young generation.
+    /// @param age      The number of minor collections a resource survives
+    ///                 before it is promoted.
+    void setNursery(size_t size, unsigned int age);
+
+    /// Notify the collector that a resource was given a new reference.
+    //
+    /// During an incremental mark, a resource that was already scanned
+    /// would otherwise hide the referenced resource from the collector.
+    /// Such resources are scanned again. An old resource is added to the
+    /// remembered set, as it may now reference a young one. Roots need not
+    /// call this, as they are scanned by every collection.
+    void writeBarrier(const GcResource* res) {
+        if (res->_old && _nurserySize && _phase == IDLE) {
+            if (!res->_remembered) _remembered.push_back(res);
+            res->_remembered = _promotionAge;
+        }
+        if (_phase != MARKING || !res->isReachable()) return;
+        if (!_gray.empty() && _gray.back() == res) return;
+        _gray.push_back(res);
+    }
+
     typedef std::map<std::string, unsigned int> CollectablesCount;
 
     /// Count collectables
     void countCollectables(CollectablesCount& count) const;
 
+    /// Count collector pauses by duration
+    void countPauses(CollectablesCount& count) const;
+
 private:
 
+    enum Phase {
+        IDLE,
+        MARKING,
+        SWEEPING
+    };
+
     /// List of collectables
     typedef std::list<const GcResource*> ResList;
 
@@ -280,6 +401,41 @@ private:
     /// @return number of objects deleted
     size_t cleanUnreachable();
 
+    /// Collect the young generation, promoting old enough survivors.
+    void minorCycle();
+
+    /// Move all young resources to the old generation.
+    void promoteAll();
+
+    /// Scan old resources for references to young ones.
+    void scanOld(const GcResource::GrayList& resources);
+
+    /// Scan an old resource in every minor collection.
+    void addUnbarriered(const GcResource* res) {
+        res->_unbarriered = true;
+        _unbarriered.push_back(res);
+    }
+
+    /// Forget the old resources without write barriers.
+    void clearUnbarriered();
+
+    /// Do up to _incrementalBudget of work on an incremental cycle,
+    /// starting one if needed.
+    void step();
+
+    /// Scan gray resources until there are none or the deadline passes.
+    //
+    /// @return true if there are no gray resources left.
+    bool markGray(boost::uint64_t deadline);
+
+    /// Sweep resources until the deadline passes.
+    //
+    /// @return true if the sweep is complete.
+    bool sweep(boost::uint64_t deadline);
+
+    /// Add a pause of the given duration to the histogram.
+    void recordPause(boost::uint64_t usecs);
+
     /// Number of newly registered collectable since last collection run
     /// triggering next collection.
     size_t _maxNewCollectablesCount;
@@ -297,6 +453,49 @@ private:
     /// collect() call.
     ResList::size_type _lastResCount;
 
+    /// Maximum microseconds spent per incremental step, 0 to disable.
+    unsigned int _incrementalBudget;
+
+    Phase _phase;
+
+    /// Resources found reachable but not yet scanned.
+    GcResource::GrayList _gray;
+
+    /// Scanned resources to scan again at the end of the mark.
+    GcResource::GrayList _rescan;
+
+    /// The next resource to sweep.
+    ResList::iterator _sweepPos;
+
+    /// Number of resources left to sweep.
+    //
+    /// Resources added after the mark are not swept in this cycle.
+    ResList::size_type _toSweep;
+
+    /// Resources allocated since the last collection, if the young
+    /// generation is enabled.
+    ResList _young;
+
+    ResList::size_type _youngSize;
+
+    /// Number of young resources triggering a minor collection, or 0.
+    size_t _nurserySize;
+
+    /// Minor collections survived before promotion, at least 1.
+    unsigned int _promotionAge;
+
+    /// Old resources that may reference young ones.
+    GcResource::GrayList _remembered;
+
+    /// Old resources without write barriers, scanned by every minor
+    /// collection.
+    GcResource::GrayList _unbarriered;
+
+    /// Pause histogram. Bucket i counts pauses shorter than 2^i ms,
+    /// the last one all longer pauses.
+    enum { pauseBuckets = 7 };
+    unsigned int _pauses[pauseBuckets];
+
 #ifdef GNASH_GC_DEBUG 
     /// Number of times the collector runs (stats/profiling)
     size_t _collectorRuns;
@@ -306,7 +505,11 @@ private:
 
 inline GcResource::GcResource(GC& gc)
     :
-    _reachable(false)
+    _reachable(false),
+    _old(false),
+    _age(0),
+    _remembered(0),
+    _unbarriered(false)
 {
     gc.addCollectable(this);
 }
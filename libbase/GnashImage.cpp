@@ -39,6 +39,7 @@
 #include "IOChannel.h"
 #include "log.h"
 #include "GnashNumeric.h"
+#include "PixelOps.h"
 
 namespace gnash {
 namespace image {
@@ -60,6 +61,15 @@ namespace {
 
         return maxSize > 0;
     }
+
+    /// The base class would allocate as much as for RGB.
+    GnashImage::iterator allocateYUV(size_t width, size_t height) {
+        if (!checkValidSize(width, height, numChannels(TYPE_YUV420))) {
+            throw std::bad_alloc();
+        }
+        const size_t chroma = ((width + 1) / 2) * ((height + 1) / 2);
+        return new GnashImage::value_type[width * height + 2 * chroma];
+    }
 }
 
 GnashImage::GnashImage(iterator data, size_t width, size_t height,
@@ -95,7 +105,7 @@ GnashImage::GnashImage(size_t width, size_t height, ImageType type,
 void
 GnashImage::update(const_iterator data)
 {
-    std::copy(data, data + size(), _data.get());
+    std::copy(data, data + size(), begin());
 }
 
 void
@@ -128,6 +138,16 @@ ImageRGBA::~ImageRGBA()
 {
 }
 
+ImageYUV::ImageYUV(size_t width, size_t height)
+    :
+    GnashImage(allocateYUV(width, height), width, height, TYPE_YUV420)
+{
+}
+
+ImageYUV::~ImageYUV()
+{
+}
+
 void
 ImageRGBA::setPixel(size_t x, size_t y, value_type r, value_type g,
         value_type b, value_type a)
@@ -306,14 +326,7 @@ Input::readSWFJpeg3(boost::shared_ptr<IOChannel> in)
 
     for (size_t y = 0; y < height; ++y) {
         j_in->readScanline(line.get());
-
-        GnashImage::iterator data = scanline(*im, y);
-        for (size_t x = 0; x < width; ++x) {
-            data[4*x+0] = line[3*x+0];
-            data[4*x+1] = line[3*x+1];
-            data[4*x+2] = line[3*x+2];
-            data[4*x+3] = 255;
-        }
+        expandRGB(line.get(), scanline(*im, y), width);
     }
 
     return im;
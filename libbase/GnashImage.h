@@ -49,7 +49,8 @@ enum ImageType
 {
     GNASH_IMAGE_INVALID,
     TYPE_RGB,
-    TYPE_RGBA
+    TYPE_RGBA,
+    TYPE_YUV420
 };
 
 /// The locations of images handled in Gnash.
@@ -67,6 +68,9 @@ numChannels(ImageType t)
             return 4;
         case TYPE_RGB:
             return 3;
+        case TYPE_YUV420:
+            // Y, U and V, though in separate planes.
+            return 3;
         default:
             std::abort();
     }
@@ -104,7 +108,7 @@ public:
     /// Get the size of the image buffer
     //
     /// @return     The size of the buffer in bytes
-    size_t size() const {
+    virtual size_t size() const {
         return stride() * _height;
     }
 
@@ -257,6 +261,76 @@ public:
             value_type a);
 };
 
+/// Planar YUV 4:2:0 video frame
+//
+/// The Y plane has a sample for each pixel, the U (Cb) and V (Cr) planes
+/// one for each 2x2 block. The planes follow each other in the buffer.
+/// Renderers that can draw this save converting every video frame to RGB.
+class DSOEXPORT ImageYUV : public GnashImage
+{
+public:
+
+    /// Create an image with uninitialized planes.
+    ImageYUV(size_t width, size_t height);
+
+    /// Create an ImageYUV taking ownership of the data.
+    ImageYUV(iterator data, size_t width, size_t height)
+        :
+        GnashImage(data, width, height, TYPE_YUV420)
+    {}
+
+    ~ImageYUV();
+
+    /// The size of all three planes in bytes.
+    virtual size_t size() const {
+        return planeStride(0) * _height + 2 * planeStride(1) * chromaHeight();
+    }
+
+    /// The rowstride of the Y plane.
+    virtual size_t stride() const {
+        return planeStride(0);
+    }
+
+    /// The number of samples in a row of the U and V planes.
+    size_t chromaWidth() const {
+        return (_width + 1) / 2;
+    }
+
+    /// The number of rows in the U and V planes.
+    size_t chromaHeight() const {
+        return (_height + 1) / 2;
+    }
+
+    /// The rowstride of a plane in bytes.
+    //
+    /// @param plane    0 for Y, 1 for U and 2 for V.
+    size_t planeStride(size_t plane) const {
+        return plane ? chromaWidth() : _width;
+    }
+
+    /// Access the first row of a plane.
+    //
+    /// @param plane    0 for Y, 1 for U and 2 for V.
+    iterator plane(size_t plane) {
+        return begin() + planeOffset(plane);
+    }
+
+    /// Access the first row of a plane.
+    //
+    /// @param plane    0 for Y, 1 for U and 2 for V.
+    const_iterator plane(size_t plane) const {
+        return begin() + planeOffset(plane);
+    }
+
+private:
+
+    size_t planeOffset(size_t plane) const {
+        if (!plane) return 0;
+        return planeStride(0) * _height +
+            (plane - 1) * planeStride(1) * chromaHeight();
+    }
+};
+
 /// The base class for reading image data. 
 class Input : boost::noncopyable
 {
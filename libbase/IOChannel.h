@@ -23,6 +23,7 @@
 
 #include <string>
 #include <boost/cstdint.hpp> // for boost int types
+#include <boost/shared_ptr.hpp>
 #include <iosfwd>
 
 #include "dsodefs.h" // DSOEXPORT
@@ -162,6 +163,20 @@ public:
     /// @return unreliable input size, (size_t)-1 if not known. 
     ///
     virtual size_t size() const { return static_cast<size_t>(-1); }
+
+    /// Get the whole stream if it is in memory.
+    //
+    /// This allows reading data without copying it. The byte at
+    /// position p is data().get()[p], for all positions up to size().
+    /// The memory stays valid as long as a copy of the returned pointer
+    /// exists, even after the IOChannel is deleted.
+    ///
+    /// @return the stream's data, or an empty pointer if it is not in
+    ///         memory. This is the default.
+    ///
+    virtual boost::shared_ptr<const boost::uint8_t> data() const {
+        return boost::shared_ptr<const boost::uint8_t>();
+    }
    
 };
 
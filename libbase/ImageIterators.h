@@ -152,6 +152,11 @@ struct pixel_iterator : public boost::iterator_facade<
         _p = Pixel(_it, _t);
         return *this;
     }
+
+    /// Return the underlying iterator to the first byte of the pixel.
+    iterator base() const {
+        return _it;
+    }
  
 private:
 
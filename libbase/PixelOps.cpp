@@ -0,0 +1,272 @@
+// PixelOps.cpp: operations on spans of pixels.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "PixelOps.h"
+
+#include <algorithm>
+#include <boost/thread/once.hpp>
+
+#include "GnashNumeric.h"
+
+// The vector versions are compiled for their own instruction sets with
+// function attributes, and chosen at run time.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || \
+        __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+# define GNASH_PIXELOPS_X86 1
+# include <immintrin.h>
+#endif
+
+namespace gnash {
+namespace image {
+
+namespace {
+
+/// The CPU is only examined once, whichever thread first needs it.
+boost::once_flag detected = BOOST_ONCE_INIT;
+
+/// The best level the CPU supports.
+PixelOpsLevel bestLevel = PIXELOPS_SCALAR;
+
+/// The level to use. Only setPixelOpsLevel() changes it after detection.
+PixelOpsLevel currentLevel = PIXELOPS_SCALAR;
+
+#ifdef GNASH_PIXELOPS_X86
+bool hasSSSE3 = false;
+#endif
+
+void
+detectLevel()
+{
+#ifdef GNASH_PIXELOPS_X86
+    __builtin_cpu_init();
+    hasSSSE3 = __builtin_cpu_supports("ssse3");
+    if (__builtin_cpu_supports("avx2")) bestLevel = PIXELOPS_AVX2;
+    else if (__builtin_cpu_supports("sse2")) bestLevel = PIXELOPS_SSE2;
+#endif
+    currentLevel = bestLevel;
+}
+
+inline PixelOpsLevel
+level()
+{
+    boost::call_once(detected, detectLevel);
+    return currentLevel;
+}
+
+/// Divide a product of two channels by 255, rounding to nearest.
+inline boost::uint32_t
+div255(boost::uint32_t t)
+{
+    t += 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+void
+transformScalar(boost::uint8_t* p, size_t count, const boost::int16_t* mult,
+        const boost::int16_t* add)
+{
+    for (size_t i = 0; i < count; ++i, p += 4) {
+        for (size_t c = 0; c < 4; ++c) {
+            const boost::int16_t t = (p[c] * mult[c] >> 8) + add[c];
+            p[c] = clamp<boost::int16_t>(t, 0, 255);
+        }
+    }
+}
+
+void
+expandScalar(const boost::uint8_t* rgb, boost::uint8_t* rgba, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        *rgba++ = *rgb++;
+        *rgba++ = *rgb++;
+        *rgba++ = *rgb++;
+        *rgba++ = 0xff;
+    }
+}
+
+#ifdef GNASH_PIXELOPS_X86
+
+// Colour transform: each pixel is widened to four 16-bit channels. The
+// 32-bit product of channel and multiplier, shifted right by 8, fits in
+// 16 bits, so it is put together from the high and low halves.
+
+__attribute__((target("sse2"))) inline __m128i
+transform8(__m128i px, __m128i mult, __m128i add)
+{
+    const __m128i lo = _mm_mullo_epi16(px, mult);
+    const __m128i hi = _mm_mulhi_epi16(px, mult);
+    const __m128i p = _mm_or_si128(_mm_slli_epi16(hi, 8),
+            _mm_srli_epi16(lo, 8));
+    return _mm_add_epi16(p, add);
+}
+
+__attribute__((target("sse2"))) size_t
+transformSSE2(boost::uint8_t* p, size_t count, const boost::int16_t* m,
+        const boost::int16_t* a)
+{
+    const __m128i mult = _mm_setr_epi16(m[0], m[1], m[2], m[3],
+            m[0], m[1], m[2], m[3]);
+    const __m128i add = _mm_setr_epi16(a[0], a[1], a[2], a[3],
+            a[0], a[1], a[2], a[3]);
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4, p += 16) {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<__m128i*>(p));
+        const __m128i lo = transform8(_mm_unpacklo_epi8(px, zero), mult, add);
+        const __m128i hi = transform8(_mm_unpackhi_epi8(px, zero), mult, add);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p),
+                _mm_packus_epi16(lo, hi));
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) inline __m256i
+transform16(__m256i px, __m256i mult, __m256i add)
+{
+    const __m256i lo = _mm256_mullo_epi16(px, mult);
+    const __m256i hi = _mm256_mulhi_epi16(px, mult);
+    const __m256i p = _mm256_or_si256(_mm256_slli_epi16(hi, 8),
+            _mm256_srli_epi16(lo, 8));
+    return _mm256_add_epi16(p, add);
+}
+
+__attribute__((target("avx2"))) size_t
+transformAVX2(boost::uint8_t* p, size_t count, const boost::int16_t* m,
+        const boost::int16_t* a)
+{
+    const __m256i mult = _mm256_setr_epi16(m[0], m[1], m[2], m[3],
+            m[0], m[1], m[2], m[3], m[0], m[1], m[2], m[3],
+            m[0], m[1], m[2], m[3]);
+    const __m256i add = _mm256_setr_epi16(a[0], a[1], a[2], a[3],
+            a[0], a[1], a[2], a[3], a[0], a[1], a[2], a[3],
+            a[0], a[1], a[2], a[3]);
+    const __m256i zero = _mm256_setzero_si256();
+
+    // Unpacking and packing work within 128-bit lanes, so the pixels
+    // end up where they started.
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8, p += 32) {
+        const __m256i px = _mm256_loadu_si256(reinterpret_cast<__m256i*>(p));
+        const __m256i lo = transform16(_mm256_unpacklo_epi8(px, zero),
+                mult, add);
+        const __m256i hi = transform16(_mm256_unpackhi_epi8(px, zero),
+                mult, add);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p),
+                _mm256_packus_epi16(lo, hi));
+    }
+    return i;
+}
+
+__attribute__((target("ssse3"))) size_t
+expandSSSE3(const boost::uint8_t* rgb, boost::uint8_t* rgba, size_t count)
+{
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1,
+            6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+
+    // Each load reads 16 bytes but uses 12, so stop while the last load
+    // is still inside the source.
+    size_t i = 0;
+    for (; i + 6 <= count; i += 4, rgb += 12, rgba += 16) {
+        const __m128i px =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba),
+                _mm_or_si128(_mm_shuffle_epi8(px, shuffle), alpha));
+    }
+    return i;
+}
+
+#endif
+
+} // anonymous namespace
+
+PixelOpsLevel
+pixelOpsLevel()
+{
+    return level();
+}
+
+PixelOpsLevel
+setPixelOpsLevel(PixelOpsLevel l)
+{
+    boost::call_once(detected, detectLevel);
+    currentLevel = std::min(l, bestLevel);
+    return currentLevel;
+}
+
+void
+transformRGBA(boost::uint8_t* pixels, size_t count,
+        const boost::int16_t mult[4], const boost::int16_t add[4])
+{
+    size_t done = 0;
+#ifdef GNASH_PIXELOPS_X86
+    switch (level()) {
+        case PIXELOPS_AVX2:
+            done = transformAVX2(pixels, count, mult, add);
+            break;
+        case PIXELOPS_SSE2:
+            done = transformSSE2(pixels, count, mult, add);
+            break;
+        default:
+            break;
+    }
+#endif
+    transformScalar(pixels + done * 4, count - done, mult, add);
+}
+
+void
+expandRGB(const boost::uint8_t* rgb, boost::uint8_t* rgba, size_t count)
+{
+    size_t done = 0;
+#ifdef GNASH_PIXELOPS_X86
+    if (level() != PIXELOPS_SCALAR && hasSSSE3) {
+        done = expandSSSE3(rgb, rgba, count);
+    }
+#endif
+    expandScalar(rgb + done * 3, rgba + done * 4, count - done);
+}
+
+void
+blendOverUnmultiplied(const boost::uint8_t* src, boost::uint8_t* dst,
+        size_t count)
+{
+    for (size_t i = 0; i < count; ++i, src += 4, dst += 4) {
+        const boost::uint32_t sa = src[3];
+        if (sa == 0xff) {
+            std::copy(src, src + 4, dst);
+            continue;
+        }
+        if (!sa) continue;
+
+        // The weights of source and destination and the resulting alpha,
+        // all times 255.
+        const boost::uint32_t sw = sa * 255;
+        const boost::uint32_t dw = dst[3] * (255 - sa);
+        const boost::uint32_t a = sw + dw;
+
+        for (size_t c = 0; c < 3; ++c) {
+            dst[c] = (src[c] * sw + dst[c] * dw + a / 2) / a;
+        }
+        dst[3] = div255(a);
+    }
+}
+
+} // namespace image
+} // namespace gnash
@@ -0,0 +1,92 @@
+// PixelOps.h: operations on spans of pixels.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef GNASH_PIXELOPS_H
+#define GNASH_PIXELOPS_H
+
+#include <cstddef>
+#include <boost/cstdint.hpp>
+
+#include "dsodefs.h"
+
+namespace gnash {
+namespace image {
+
+/// The instruction sets available to the pixel operations.
+//
+/// On x86 the best available set is detected once, when first needed.
+/// Other platforms always use plain C++.
+enum PixelOpsLevel
+{
+    PIXELOPS_SCALAR,
+    PIXELOPS_SSE2,
+    PIXELOPS_AVX2
+};
+
+/// Return the instruction set used by the pixel operations.
+DSOEXPORT PixelOpsLevel pixelOpsLevel();
+
+/// Use at most the given instruction set.
+//
+/// This is for testing and benchmarking. It must only be called while
+/// no other thread uses the pixel operations, for instance at startup.
+//
+/// @return     The level actually used, which may be lower than requested.
+DSOEXPORT PixelOpsLevel setPixelOpsLevel(PixelOpsLevel level);
+
+/// Apply a color transform to RGBA pixels.
+//
+/// Each channel c becomes (c * mult >> 8) + add, clamped to [0, 255].
+/// The sum wraps at 16 bits exactly as in SWFCxForm::transform().
+//
+/// @param pixels   The pixels to transform in place.
+/// @param count    The number of pixels.
+/// @param mult     The red, green, blue and alpha multipliers, 8.8 fixed
+///                 point.
+/// @param add      The red, green, blue and alpha offsets.
+DSOEXPORT void transformRGBA(boost::uint8_t* pixels, size_t count,
+        const boost::int16_t mult[4], const boost::int16_t add[4]);
+
+/// Convert RGB pixels to opaque RGBA pixels.
+//
+/// @param rgb      The source pixels, 3 bytes each.
+/// @param rgba     The destination pixels, 4 bytes each. This must not
+///                 overlap the source.
+/// @param count    The number of pixels.
+DSOEXPORT void expandRGB(const boost::uint8_t* rgb, boost::uint8_t* rgba,
+        size_t count);
+
+/// Draw unmultiplied RGBA pixels over others, as BitmapData stores them.
+//
+/// The result is the source over the destination blended in
+/// premultiplied form, unmultiplied again and rounded to nearest. Fully
+/// opaque source pixels replace the destination, fully transparent ones
+/// leave it alone.
+//
+/// @param src      The unmultiplied pixels to draw.
+/// @param dst      The unmultiplied pixels to draw over. This must not
+///                 overlap the source unless it is the same span.
+/// @param count    The number of pixels.
+DSOEXPORT void blendOverUnmultiplied(const boost::uint8_t* src,
+        boost::uint8_t* dst, size_t count);
+
+} // namespace image
+} // namespace gnash
+
+#endif
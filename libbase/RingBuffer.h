@@ -0,0 +1,152 @@
+// RingBuffer.h: a bounded queue between two threads, without locks.
+//
+//   Copyright (C) 2012 Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef GNASH_RINGBUFFER_H
+#define GNASH_RINGBUFFER_H
+
+#include <cstddef>
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
+
+namespace gnash {
+
+/// A fixed-size FIFO queue for one producer and one consumer thread.
+//
+/// Neither side ever blocks or takes a lock: push() fails when the queue
+/// is full, and front() returns 0 when it is empty. Only the producer may
+/// call push(), and only the consumer front() and pop(); everything else
+/// may be called from either thread.
+//
+/// Elements are copied in and out, so they should be small, typically
+/// pointers. They are not destroyed when popped, but overwritten by later
+/// pushes.
+template<typename T>
+class RingBuffer : boost::noncopyable
+{
+public:
+
+    /// Create a RingBuffer.
+    //
+    /// @param capacity     The minimum number of elements it can hold. This
+    ///                     is rounded up to a power of two.
+    explicit RingBuffer(size_t capacity)
+        :
+        _mask(roundUp(capacity) - 1),
+        _slots(new T[_mask + 1]),
+        _head(0),
+        _tail(0)
+    {
+    }
+
+    /// The number of elements the queue can hold.
+    size_t capacity() const { return _mask + 1; }
+
+    /// Append an element. This is for the producer only.
+    //
+    /// @return     false if the queue is full.
+    bool push(const T& t) {
+        const size_t tail = _tail.load(boost::memory_order_relaxed);
+        if (tail - _head.load(boost::memory_order_acquire) > _mask) {
+            return false;
+        }
+        _slots[tail & _mask] = t;
+        _tail.store(tail + 1, boost::memory_order_release);
+        return true;
+    }
+
+    /// The oldest element. This is for the consumer only.
+    //
+    /// @return     0 if the queue is empty. The element stays valid until
+    ///             the next call to pop().
+    const T* front() const {
+        const size_t head = _head.load(boost::memory_order_relaxed);
+        if (head == _tail.load(boost::memory_order_acquire)) return 0;
+        return &_slots[head & _mask];
+    }
+
+    /// Remove the oldest element. This is for the consumer only.
+    //
+    /// The queue must not be empty.
+    void pop() {
+        const size_t head = _head.load(boost::memory_order_relaxed);
+        _head.store(head + 1, boost::memory_order_release);
+    }
+
+    /// Copy the oldest element.
+    //
+    /// When called by the producer the element may have been popped
+    /// meanwhile, but the copy is still consistent.
+    //
+    /// @return     false if the queue is empty.
+    bool peekFront(T& t) const {
+        const size_t tail = _tail.load(boost::memory_order_acquire);
+        const size_t head = _head.load(boost::memory_order_acquire);
+        if (head == tail) return false;
+        t = _slots[head & _mask];
+        return true;
+    }
+
+    /// Copy the newest element.
+    //
+    /// @return     false if the queue is empty.
+    bool peekBack(T& t) const {
+        const size_t head = _head.load(boost::memory_order_acquire);
+        const size_t tail = _tail.load(boost::memory_order_acquire);
+        if (head == tail) return false;
+        t = _slots[(tail - 1) & _mask];
+        return true;
+    }
+
+    /// The number of elements in the queue.
+    //
+    /// This is only a snapshot when the other thread is active.
+    size_t size() const {
+        const size_t head = _head.load(boost::memory_order_acquire);
+        return _tail.load(boost::memory_order_acquire) - head;
+    }
+
+    bool empty() const { return !size(); }
+
+    bool full() const { return size() > _mask; }
+
+private:
+
+    static size_t roundUp(size_t n) {
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    const size_t _mask;
+
+    boost::scoped_array<T> _slots;
+
+    /// The number of elements ever popped, written by the consumer.
+    boost::atomic<size_t> _head;
+
+    /// Keep the two counters in separate cache lines.
+    char _padding[64];
+
+    /// The number of elements ever pushed, written by the producer.
+    boost::atomic<size_t> _tail;
+};
+
+} // namespace gnash
+
+#endif
@@ -22,6 +22,7 @@
 #include "StreamProvider.h"
 #include "URL.h"
 #include "tu_file.h"
+#include "mmap_adapter.h"
 #include "NetworkAdapter.h"
 #include "URLAccessManager.h"
 #include "log.h"
@@ -85,6 +86,12 @@ StreamProvider::getStream(const URL& url, bool namedCacheFile) const
 				          path, std::strerror(errno));
 				return stream;
 			}
+			// Map regular files, so they can be used without copying.
+			stream = mmap_adapter::make_stream(fileno(newin));
+			if (stream.get()) {
+				std::fclose(newin);
+				return stream;
+			}
 			// Close on destruction
 			stream = makeFileChannel(newin, true);
 			return stream;
@@ -150,6 +157,11 @@ StreamProvider::getStream(const URL& url, const std::string& postdata,
 				          path, std::strerror(errno));
 				return stream;
 			}
+			stream = mmap_adapter::make_stream(fileno(newin));
+			if (stream.get()) {
+				std::fclose(newin);
+				return stream;
+			}
 			stream = makeFileChannel(newin, false);
 			return stream;
 		}
@@ -0,0 +1,181 @@
+// inflate_cache.cpp: keep inflated copies of compressed SWFs on disk.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "inflate_cache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <boost/format.hpp>
+#include <boost/thread/mutex.hpp>
+
+#ifdef HAVE_ZLIB_H
+#include <zlib.h>
+#endif
+
+#include "IOChannel.h"
+#include "mmap_adapter.h"
+#include "tu_file.h"
+#include "log.h"
+#include "utility.h"
+
+namespace gnash {
+namespace inflate_cache {
+
+namespace {
+
+const size_t headerSize = 8;
+
+/// Counts uses of the cache.
+struct CacheStats
+{
+    CacheStats() : hits(0), misses(0) {}
+    boost::mutex mutex;
+    size_t hits;
+    size_t misses;
+};
+
+CacheStats cacheStats;
+
+void
+countCacheUse(const std::string& file, bool hit)
+{
+    boost::mutex::scoped_lock lock(cacheStats.mutex);
+    ++(hit ? cacheStats.hits : cacheStats.misses);
+    log_parse(_("SWF cache %1% for %2% (%3% hits, %4% misses)"),
+            hit ? "hit" : "miss", file, cacheStats.hits, cacheStats.misses);
+}
+
+/// Open the cache entry for a compressed SWF.
+//
+/// @return the inflated SWF, or NULL if there is no entry for the
+///         compressed SWF in the file.
+std::auto_ptr<IOChannel>
+openEntry(const std::string& file, boost::uint32_t length,
+        const boost::uint8_t* data, size_t size)
+{
+    std::auto_ptr<IOChannel> ret;
+
+    FILE* f = std::fopen(file.c_str(), "rb");
+    if (!f) return ret;
+
+    const long end = std::fseek(f, 0, SEEK_END) ? -1 : std::ftell(f);
+    if (end >= 0 && static_cast<size_t>(end) == length + size) {
+        ret = mmap_adapter::make_stream(fileno(f), length);
+    }
+    std::fclose(f);
+
+    // The compressed copy is compared in full: the name of the entry
+    // only comes from a checksum.
+    if (ret.get() && std::memcmp(ret->data().get() + length, data, size)) {
+        ret.reset();
+    }
+    return ret;
+}
+
+}
+
+std::string
+entryName(const std::string& dir, const boost::uint8_t* data, size_t size)
+{
+#ifdef HAVE_ZLIB_H
+    const uLong crc = crc32(crc32(0L, Z_NULL, 0), data, size);
+#else
+    const unsigned long crc = 0;
+    UNUSED(data);
+#endif
+    return (boost::format("%1%/%2$08x-%3$x.swf") % dir % crc % size).str();
+}
+
+std::auto_ptr<IOChannel>
+inflate(std::auto_ptr<IOChannel> in, boost::uint32_t header,
+        boost::uint32_t length, const boost::uint8_t* data, size_t size,
+        const std::string& dir)
+{
+    const std::string cached = dir.empty() ? std::string() :
+        entryName(dir, data, size);
+
+    if (!cached.empty()) {
+        std::auto_ptr<IOChannel> ret = openEntry(cached, length, data, size);
+        countCacheUse(cached, ret.get());
+        if (ret.get()) {
+            ret->seek(headerSize);
+            return ret;
+        }
+    }
+
+    // Write the entry under another name until it is complete.
+    const std::string partial = cached.empty() ? std::string() :
+        (boost::format("%1%.%2%") % cached % getpid()).str();
+
+    FILE* f = partial.empty() ? std::tmpfile() :
+        std::fopen(partial.c_str(), "w+b");
+    if (!f) {
+        log_debug("Could not create a file for the inflated SWF: %s",
+                std::strerror(errno));
+        return in;
+    }
+
+    header = (header & 0xffffff00) | 'F';
+    for (size_t i = 0; i < 4; ++i) std::fputc((header >> (8 * i)) & 0xff, f);
+    for (size_t i = 0; i < 4; ++i) std::fputc((length >> (8 * i)) & 0xff, f);
+
+    size_t left = length > headerSize ? length - headerSize : 0;
+    char buf[65536];
+    while (left) {
+        const std::streamsize got =
+            in->read(buf, std::min<size_t>(left, sizeof buf));
+        if (got <= 0) break;
+        std::fwrite(buf, 1, got, f);
+        left -= got;
+    }
+
+    if (!partial.empty()) {
+        if (!left) std::fwrite(data, 1, size, f);
+        const bool ok = !std::fflush(f) && !std::ferror(f);
+
+        // Truncated or unwritten SWFs are not kept.
+        if (left || !ok || std::rename(partial.c_str(), cached.c_str())) {
+            log_debug("Could not store inflated SWF %s", cached);
+        }
+        std::remove(partial.c_str());
+    }
+    else std::fflush(f);
+
+    // A truncated SWF is read as far as it goes.
+    std::auto_ptr<IOChannel> ret =
+        mmap_adapter::make_stream(fileno(f), left ? 0 : length);
+    if (ret.get()) {
+        std::fclose(f);
+    }
+    else {
+        ret = makeFileChannel(f, true);
+    }
+    ret->seek(headerSize);
+    return ret;
+}
+
+} // namespace gnash::inflate_cache
+} // namespace gnash
@@ -0,0 +1,68 @@
+// inflate_cache.h: keep inflated copies of compressed SWFs on disk.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef GNASH_INFLATE_CACHE_H
+#define GNASH_INFLATE_CACHE_H
+
+#include <memory>
+#include <string>
+#include <cstddef>
+#include <boost/cstdint.hpp>
+
+#include "dsodefs.h"
+
+namespace gnash {
+
+class IOChannel;
+
+/// Code to read compressed SWFs through an inflated copy in a file.
+//
+/// An entry in the cache directory holds the inflated SWF followed by
+/// the compressed SWF it was made from. It is named after the CRC-32 and
+/// size of the compressed SWF, and only used if the compressed copy in
+/// it is the same as the SWF being read, so a checksum collision or a
+/// damaged entry can only cost a miss.
+namespace inflate_cache {
+
+/// Inflate a whole compressed SWF into a mapped file.
+//
+/// The file starts with an uncompressed SWF header, so that positions in
+/// it match those in the inflated stream.
+//
+/// @param in       The inflated stream, positioned after the SWF header.
+/// @param header   The first four bytes of the SWF, least significant
+///                 first.
+/// @param length   The length of the inflated SWF given in its header.
+/// @param data     The compressed SWF, including its header.
+/// @param size     The size of the compressed SWF.
+/// @param dir      The cache directory, or empty to use a temporary file.
+/// @return the inflated SWF positioned after its header, or @a in if no
+///         file can be created.
+DSOEXPORT std::auto_ptr<IOChannel> inflate(std::auto_ptr<IOChannel> in,
+        boost::uint32_t header, boost::uint32_t length,
+        const boost::uint8_t* data, size_t size, const std::string& dir);
+
+/// Return the name of the cache entry for a compressed SWF.
+DSOEXPORT std::string entryName(const std::string& dir,
+        const boost::uint8_t* data, size_t size);
+
+} // namespace gnash::inflate_cache
+} // namespace gnash
+
+#endif
@@ -0,0 +1,160 @@
+// mmap_adapter.cpp: read files through a memory mapping.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "mmap_adapter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <boost/shared_ptr.hpp>
+
+#if !defined(_WIN32) && !defined(__amigaos4__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define GNASH_HAVE_MMAP 1
+#endif
+
+#include "IOChannel.h"
+#include "log.h"
+
+namespace gnash {
+namespace mmap_adapter {
+
+#ifdef GNASH_HAVE_MMAP
+
+namespace {
+
+/// Unmaps a file when the last reference to it goes.
+class Unmap
+{
+public:
+    explicit Unmap(size_t size) : _size(size) {}
+
+    void operator()(const boost::uint8_t* p) const {
+        ::munmap(const_cast<boost::uint8_t*>(p), _size);
+    }
+
+private:
+    size_t _size;
+};
+
+class MappedFile : public IOChannel
+{
+public:
+
+    MappedFile(boost::shared_ptr<const boost::uint8_t> data, size_t size)
+        :
+        _data(data),
+        _size(size),
+        _pos(0)
+    {
+    }
+
+    virtual std::streamsize read(void* dst, std::streamsize bytes) {
+        const std::streamsize left = _size - _pos;
+        bytes = std::min(bytes, left);
+        if (bytes <= 0) return 0;
+        std::memcpy(dst, _data.get() + _pos, bytes);
+        _pos += bytes;
+        return bytes;
+    }
+
+    virtual std::streampos tell() const {
+        return _pos;
+    }
+
+    virtual bool seek(std::streampos pos) {
+        if (pos < 0 || static_cast<size_t>(pos) > _size) return false;
+        _pos = pos;
+        return true;
+    }
+
+    virtual void go_to_end() {
+        _pos = _size;
+    }
+
+    virtual bool eof() const {
+        return _pos == _size;
+    }
+
+    virtual bool bad() const {
+        return false;
+    }
+
+    virtual size_t size() const {
+        return _size;
+    }
+
+    virtual boost::shared_ptr<const boost::uint8_t> data() const {
+        return _data;
+    }
+
+private:
+
+    const boost::shared_ptr<const boost::uint8_t> _data;
+    const size_t _size;
+    size_t _pos;
+};
+
+} // anonymous namespace
+
+std::auto_ptr<IOChannel>
+make_stream(int fd, size_t length)
+{
+    std::auto_ptr<IOChannel> ret;
+
+    struct stat st;
+    if (::fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        return ret;
+    }
+    if (static_cast<size_t>(st.st_size) < length) return ret;
+
+    const size_t size = st.st_size;
+    void* p = ::mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+        log_debug("Could not map file descriptor %d: %s", fd,
+                std::strerror(errno));
+        return ret;
+    }
+
+    // SWF files are mostly read from start to end.
+    ::madvise(p, size, MADV_SEQUENTIAL);
+
+    boost::shared_ptr<const boost::uint8_t> data(
+            static_cast<const boost::uint8_t*>(p), Unmap(size));
+    ret.reset(new MappedFile(data, length ? length : size));
+    return ret;
+}
+
+#else
+
+std::auto_ptr<IOChannel>
+make_stream(int /*fd*/, size_t /*length*/)
+{
+    return std::auto_ptr<IOChannel>();
+}
+
+#endif
+
+} // namespace gnash::mmap_adapter
+} // namespace gnash
@@ -0,0 +1,53 @@
+// mmap_adapter.h: read files through a memory mapping.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef GNASH_MMAP_ADAPTER_H
+#define GNASH_MMAP_ADAPTER_H
+
+#include <memory>
+#include <cstddef>
+
+#include "dsodefs.h"
+
+namespace gnash {
+
+class IOChannel;
+
+/// Code to read regular files as IOChannel objects without copying them.
+namespace mmap_adapter {
+
+/// \brief
+/// Returns a read-only IOChannel that maps the whole of a file
+/// open for reading.
+//
+/// The returned IOChannel's data() is the mapping, so its contents can
+/// be used without copying them. The file descriptor is not used after
+/// this function returns.
+///
+/// @param length  If not 0, only the first length bytes of the file are
+///                 read. The file must be at least that long.
+/// @return an IOChannel, or NULL if the file cannot be mapped, for
+///         instance because it is empty or is not a regular file.
+///
+DSOEXPORT std::auto_ptr<IOChannel> make_stream(int fd, size_t length = 0);
+
+} // namespace gnash::mmap_adapter
+} // namespace gnash
+
+#endif
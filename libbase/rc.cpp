@@ -71,6 +71,9 @@ RcInitFile::RcInitFile()
         :
     _delay(0),
     _movieLibraryLimit(8),
+    _gcIncrementalBudget(0),
+    _gcNurserySize(0),
+    _gcPromotionAge(2),
     _debug(false),
     _debugger(false),
     _verbosity(-1),
@@ -110,6 +113,10 @@ RcInitFile::RcInitFile()
     _lcshmkey(0),
     _ignoreFSCommand(true),
     _quality(-1),
+    _shapeCacheSize(4096),
+    _renderThreads(1),
+    _decodeThreads(0),
+    _bitmapCacheSize(32768),
     _saveStreamingMedia(false),
     _saveLoadedMedia(false),
     _popups(true),
@@ -466,6 +473,18 @@ RcInitFile::parseFile(const std::string& filespec)
                 _mediaCacheDir = value;
                 continue;
             }
+
+            if (noCaseCompare(variable, "swfCacheDir") ) {
+                expandPath(value);
+                _swfCacheDir = value;
+                continue;
+            }
+
+            if (noCaseCompare(variable, "flvIndexDir") ) {
+                expandPath(value);
+                _flvIndexDir = value;
+                continue;
+            }
             
             if (noCaseCompare(variable, "documentroot") ) {
                 _wwwroot = value;
@@ -583,6 +602,15 @@ RcInitFile::parseFile(const std::string& filespec)
             ||
                  extractNumber(_movieLibraryLimit, "movieLibraryLimit",
                          variable, value)
+            ||
+                 extractNumber(_gcIncrementalBudget, "GCIncrementalBudget",
+                         variable, value)
+            ||
+                 extractNumber(_gcNurserySize, "GCNurserySize",
+                         variable, value)
+            ||
+                 extractNumber(_gcPromotionAge, "GCPromotionAge",
+                         variable, value)
             ||
                  extractNumber(_delay, "delay", variable, value)
             ||
@@ -594,6 +622,18 @@ RcInitFile::parseFile(const std::string& filespec)
                          value)
             ||
                  extractNumber(_quality, "quality", variable, value)
+            ||
+                 extractNumber(_shapeCacheSize, "shapeCacheSize",
+                         variable, value)
+            ||
+                 extractNumber(_renderThreads, "renderThreads",
+                         variable, value)
+            ||
+                 extractNumber(_decodeThreads, "decodeThreads",
+                         variable, value)
+            ||
+                 extractNumber(_bitmapCacheSize, "bitmapCacheSize",
+                         variable, value)
             ||
                  extractSetting(_saveLoadedMedia, "saveLoadedMedia",
                          variable, value)
@@ -769,7 +809,14 @@ RcInitFile::updateFile(const std::string& filespec)
     cmd << "startStopped " << _startStopped << endl <<
     cmd << "streamsTimeout " << _streamsTimeout << endl <<
     cmd << "movieLibraryLimit " << _movieLibraryLimit << endl <<
+    cmd << "GCIncrementalBudget " << _gcIncrementalBudget << endl <<
+    cmd << "GCNurserySize " << _gcNurserySize << endl <<
+    cmd << "GCPromotionAge " << _gcPromotionAge << endl <<
     cmd << "quality " << _quality << endl <<    
+    cmd << "shapeCacheSize " << _shapeCacheSize << endl <<
+    cmd << "renderThreads " << _renderThreads << endl <<
+    cmd << "decodeThreads " << _decodeThreads << endl <<
+    cmd << "bitmapCacheSize " << _bitmapCacheSize << endl <<
     cmd << "delay " << _delay << endl <<
     cmd << "verbosity " << _verbosity << endl <<
     cmd << "solReadOnly " << _solreadonly << endl <<
@@ -797,6 +844,8 @@ RcInitFile::updateFile(const std::string& filespec)
     // at the next run (even though that's not the way to use it...)
 
     cmd << "mediaDir " << _mediaCacheDir << endl <<    
+    cmd << "swfCacheDir " << _swfCacheDir << endl <<    
+    cmd << "flvIndexDir " << _flvIndexDir << endl <<    
     cmd << "debuglog " << _log << endl <<
     cmd << "documentroot " << _wwwroot << endl <<
     cmd << "flashSystemOS " << _flashSystemOS << endl <<
@@ -95,6 +95,22 @@ public:
     int getMovieLibraryLimit() const { return _movieLibraryLimit; }
     void setMovieLibraryLimit(int value) { _movieLibraryLimit = value; }
 
+    /// Microseconds spent in each step of an incremental GC cycle
+    unsigned int getGCIncrementalBudget() const {
+        return _gcIncrementalBudget;
+    }
+    void setGCIncrementalBudget(unsigned int value) {
+        _gcIncrementalBudget = value;
+    }
+
+    /// Number of young GC resources triggering a minor collection
+    size_t getGCNurserySize() const { return _gcNurserySize; }
+    void setGCNurserySize(size_t value) { _gcNurserySize = value; }
+
+    /// Number of minor collections a GC resource survives before promotion
+    unsigned int getGCPromotionAge() const { return _gcPromotionAge; }
+    void setGCPromotionAge(unsigned int value) { _gcPromotionAge = value; }
+
     bool enableExtensions() const { return _extensionsEnabled; }
 
     /// Return true if user is willing to start the gui in "stop" mode
@@ -108,6 +124,23 @@ public:
     
     int qualityLevel() const { return _quality; }
     void qualityLevel(int value) { _quality = value; }
+
+    /// Kilobytes of prepared shapes kept by the renderer, 0 to disable
+    size_t getShapeCacheSize() const { return _shapeCacheSize; }
+    void setShapeCacheSize(size_t value) { _shapeCacheSize = value; }
+
+    /// Number of threads the renderer draws each frame with
+    size_t getRenderThreads() const { return _renderThreads; }
+    void setRenderThreads(size_t value) { _renderThreads = value; }
+
+    /// Number of threads decoding bitmaps while a movie loads
+    size_t getDecodeThreads() const { return _decodeThreads; }
+    void setDecodeThreads(size_t value) { _decodeThreads = value; }
+
+    /// Kilobytes of bitmaps decoded on demand kept between frames, 0 to
+    /// decode bitmaps when loading
+    size_t getBitmapCacheSize() const { return _bitmapCacheSize; }
+    void setBitmapCacheSize(size_t value) { _bitmapCacheSize = value; }
     
     int verbosityLevel() const { return _verbosity; }
     void verbosityLevel(int value) { _verbosity = value; }
@@ -306,6 +339,16 @@ public:
     void setMediaDir(const std::string& value) { _mediaCacheDir = value; }
 
     const std::string& getMediaDir() const { return _mediaCacheDir; }
+
+    /// Directory keeping inflated copies of compressed local SWFs, if any
+    void setSWFCacheDir(const std::string& value) { _swfCacheDir = value; }
+
+    const std::string& getSWFCacheDir() const { return _swfCacheDir; }
+
+    /// Directory keeping keyframe indexes of FLVs, if any
+    void setFLVIndexDir(const std::string& value) { _flvIndexDir = value; }
+
+    const std::string& getFLVIndexDir() const { return _flvIndexDir; }
 	
     void setWebcamDevice(int value) {_webcamDevice = value;}
     
@@ -447,6 +490,15 @@ protected:
     /// Max number of movie clips to store in the library      
     boost::uint32_t  _movieLibraryLimit;   
 
+    /// Time budget of incremental GC steps, 0 for whole cycles
+    boost::uint32_t _gcIncrementalBudget;
+
+    /// Size of the GC young generation, 0 to disable it
+    boost::uint32_t _gcNurserySize;
+
+    /// Minor GC cycles survived before promotion to the old generation
+    boost::uint32_t _gcPromotionAge;
+
     /// Enable debugging of this class
     bool _debug;
 
@@ -571,12 +623,30 @@ protected:
     /// The quality to display SWFs in. -1 to allow the SWF to override.
     int _quality;
 
+    /// Size of the renderer's shape cache in kilobytes
+    boost::uint32_t _shapeCacheSize;
+
+    /// Threads used to render a frame, 1 to render on the calling thread
+    boost::uint32_t _renderThreads;
+
+    /// Threads used to decode bitmaps, 0 for one per processor
+    boost::uint32_t _decodeThreads;
+
+    /// Size of the decoded bitmap cache in kilobytes
+    boost::uint32_t _bitmapCacheSize;
+
     bool _saveStreamingMedia;
     
     bool _saveLoadedMedia;
 
     std::string _mediaCacheDir;
 
+    /// Where inflated SWFs are kept between runs; empty to disable
+    std::string _swfCacheDir;
+
+    /// Where FLV keyframe indexes are kept between runs; empty to disable
+    std::string _flvIndexDir;
+
     bool _popups;
 
     ///FIXME: this should probably eventually be changed to a more readable
@@ -12,6 +12,8 @@
 #include <algorithm>
 #include <sstream>
 #include <memory>
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
 
 #include "IOChannel.h" // for inheritance
 #include "log.h"
@@ -81,6 +83,35 @@ private:
 
     static const int ZBUF_SIZE = 4096;
 
+    /// The amount of inflated data between checkpoints.
+    //
+    /// Each checkpoint keeps a copy of the inflater's window, about 40kB.
+    static const std::streamoff CHECKPOINT_INTERVAL = 1 << 20;
+
+    /// A copy of the inflater state from which inflating can restart.
+    //
+    /// zlib checks that a z_stream is not moved, so these stay put.
+    struct Checkpoint : boost::noncopyable
+    {
+        Checkpoint() : zstream() {}
+        ~Checkpoint() { inflateEnd(&zstream); }
+
+        /// The position in the inflated stream.
+        std::streampos pos;
+
+        /// The position of the next byte to inflate in the input stream.
+        std::streampos in;
+
+        z_stream zstream;
+    };
+
+    /// Checkpoints in order of position.
+    typedef boost::ptr_vector<Checkpoint> Checkpoints;
+
+    static bool before(std::streampos pos, const Checkpoint& c) {
+        return pos < c.pos;
+    }
+
     std::auto_ptr<IOChannel> m_in;
 
     // position of the input stream where we started inflating.
@@ -96,6 +127,8 @@ private:
     bool m_at_eof;
     bool m_error;
 
+    Checkpoints _checkpoints;
+
     /// Discard current results and rewind to the beginning.
     //
     //
@@ -106,6 +139,15 @@ private:
     ///
     void reset();
 
+    /// Record a checkpoint at the given position if one is due.
+    void checkpoint(std::streampos pos);
+
+    /// Discard current results and restart from a checkpoint.
+    //
+    /// might throw a ParserException if unable to seek the underlying
+    /// stream to the checkpoint.
+    void restore(Checkpoint& c);
+
     std::streamsize inflate_from_stream(void* dst, std::streamsize bytes);
 
     // If we have unused bytes in our input buffer, rewind
@@ -115,6 +157,7 @@ private:
 };
 
 const int InflaterIOChannel::ZBUF_SIZE;
+const std::streamoff InflaterIOChannel::CHECKPOINT_INTERVAL;
 
 void
 InflaterIOChannel::rewind_unused_bytes()
@@ -162,6 +205,53 @@ InflaterIOChannel::reset()
     m_logical_stream_pos = m_initial_stream_pos;
 }
 
+void
+InflaterIOChannel::checkpoint(std::streampos pos)
+{
+    const std::streampos last = _checkpoints.empty() ?
+        m_initial_stream_pos : _checkpoints.back().pos;
+    if (pos < last + CHECKPOINT_INTERVAL) return;
+
+    std::auto_ptr<Checkpoint> c(new Checkpoint);
+    c->pos = pos;
+    c->in = m_in->tell() - std::streamoff(m_zstream.avail_in);
+    if (inflateCopy(&c->zstream, &m_zstream) != Z_OK) {
+        log_debug("Could not record an inflater checkpoint at %d", pos);
+        return;
+    }
+    _checkpoints.push_back(c.release());
+}
+
+void
+InflaterIOChannel::restore(Checkpoint& c)
+{
+    inflateEnd(&m_zstream);
+    const int err = inflateCopy(&m_zstream, &c.zstream);
+    if (err != Z_OK) {
+        log_error("inflater_impl::restore() inflateCopy() returned %d", err);
+        m_error = 1;
+        return;
+    }
+
+    m_error = 0;
+    m_at_eof = 0;
+
+    m_zstream.next_in = 0;
+    m_zstream.avail_in = 0;
+
+    m_zstream.next_out = 0;
+    m_zstream.avail_out = 0;
+
+    if (!m_in->seek(c.in)) {
+        std::stringstream ss;
+        ss << "inflater_impl::restore: unable to seek underlying "
+            "stream to position " << c.in;
+        throw ParserException(ss.str());
+    }
+
+    m_logical_stream_pos = c.pos;
+}
+
 std::streamsize
 InflaterIOChannel::inflate_from_stream(void* dst, std::streamsize bytes)
 {
@@ -218,6 +308,9 @@ InflaterIOChannel::inflate_from_stream(void* dst, std::streamsize bytes)
             break;
         }
 
+        checkpoint(m_logical_stream_pos +
+                std::streamoff(bytes - m_zstream.avail_out));
+
         if (m_zstream.avail_out == 0) {
             break;
         }
@@ -261,8 +354,22 @@ InflaterIOChannel::seek(std::streampos pos)
         return false;
     }
 
-    // If we're seeking backwards, then restart from the beginning.
-    if (pos < m_logical_stream_pos) {
+    // Restart from the last checkpoint before the position if that is
+    // nearer than the current position, or if we're seeking backwards.
+    // Without one, restart from the beginning.
+    Checkpoints::iterator it = std::upper_bound(_checkpoints.begin(),
+            _checkpoints.end(), pos, before);
+
+    if (it != _checkpoints.begin()) {
+        Checkpoint& c = *(--it);
+        if (pos < m_logical_stream_pos || m_logical_stream_pos < c.pos) {
+            log_debug("inflater restarting at %d to seek from %d to %d",
+                    c.pos, m_logical_stream_pos, pos);
+            restore(c);
+            if (m_error) return false;
+        }
+    }
+    else if (pos < m_logical_stream_pos) {
 	    log_debug("inflater reset due to seek back from %d to %d",
 		      m_logical_stream_pos, pos );
         reset();
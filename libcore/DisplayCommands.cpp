@@ -0,0 +1,248 @@
+// DisplayCommands.cpp: a recorded sequence of drawing calls.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "DisplayCommands.h"
+
+#include "Renderer.h"
+#include "ShapeRecord.h"
+#include "FillStyle.h"
+
+namespace gnash {
+
+DisplayCommands::DisplayCommands()
+    :
+    _width(0),
+    _height(0),
+    _x0(0),
+    _x1(0),
+    _y0(0),
+    _y1(0)
+{
+}
+
+void
+DisplayCommands::setFrame(const rgba& background, int width, int height,
+        float x0, float x1, float y0, float y1)
+{
+    _background = background;
+    _width = width;
+    _height = height;
+    _x0 = x0;
+    _x1 = x1;
+    _y0 = y0;
+    _y1 = y1;
+}
+
+DisplayCommands::Command&
+DisplayCommands::add(Type t, const std::vector<point>& points)
+{
+    _commands.push_back(Command(t));
+    Command& c = _commands.back();
+    c.firstPoint = _points.size();
+    c.points = points.size();
+    _points.insert(_points.end(), points.begin(), points.end());
+    return c;
+}
+
+void
+DisplayCommands::drawShape(const SWF::ShapeRecord& shape,
+        const Transform& xform)
+{
+    _commands.push_back(Command(SHAPE));
+    Command& c = _commands.back();
+    c.shape = &shape;
+    c.xform = xform;
+
+    // BitmapFill looks up its bitmap on first use, which must not happen
+    // while the commands are replayed.
+    const SWF::ShapeRecord::FillStyles& fills = shape.fillStyles();
+    for (SWF::ShapeRecord::FillStyles::const_iterator i = fills.begin(),
+            e = fills.end(); i != e; ++i) {
+        if (const BitmapFill* f = boost::get<BitmapFill>(&i->fill)) {
+            f->bitmap();
+        }
+    }
+}
+
+void
+DisplayCommands::drawGlyph(const SWF::ShapeRecord& rec, const rgba& color,
+        const SWFMatrix& mat)
+{
+    _commands.push_back(Command(GLYPH));
+    Command& c = _commands.back();
+    c.shape = &rec;
+    c.color = color;
+    c.xform.matrix = mat;
+}
+
+void
+DisplayCommands::drawLine(const std::vector<point>& coords,
+        const rgba& color, const SWFMatrix& mat)
+{
+    Command& c = add(LINE, coords);
+    c.color = color;
+    c.xform.matrix = mat;
+}
+
+void
+DisplayCommands::draw_poly(const std::vector<point>& corners,
+        const rgba& fill, const rgba& outline, const SWFMatrix& mat,
+        bool masked)
+{
+    Command& c = add(POLY, corners);
+    c.color = fill;
+    c.outline = outline;
+    c.xform.matrix = mat;
+    c.flag = masked;
+}
+
+void
+DisplayCommands::drawVideoFrame(image::GnashImage* frame,
+        const Transform& xform, const SWFRect* bounds, bool smooth)
+{
+    _commands.push_back(Command(VIDEO));
+    Command& c = _commands.back();
+    c.frame = frame;
+    c.xform = xform;
+    c.bounds = *bounds;
+    c.flag = smooth;
+}
+
+void
+DisplayCommands::begin_submit_mask()
+{
+    _commands.push_back(Command(BEGIN_MASK));
+}
+
+void
+DisplayCommands::end_submit_mask()
+{
+    _commands.push_back(Command(END_MASK));
+}
+
+void
+DisplayCommands::disable_mask()
+{
+    _commands.push_back(Command(DISABLE_MASK));
+}
+
+void
+DisplayCommands::replay(Renderer& renderer) const
+{
+    std::vector<point> points;
+
+    for (std::vector<Command>::const_iterator i = _commands.begin(),
+            e = _commands.end(); i != e; ++i) {
+
+        const Command& c = *i;
+
+        if (c.type == LINE || c.type == POLY) {
+            const std::vector<point>::const_iterator first =
+                _points.begin() + c.firstPoint;
+            points.assign(first, first + c.points);
+        }
+
+        switch (c.type) {
+            case SHAPE:
+                renderer.drawShape(*c.shape, c.xform);
+                break;
+            case GLYPH:
+                renderer.drawGlyph(*c.shape, c.color, c.xform.matrix);
+                break;
+            case LINE:
+                renderer.drawLine(points, c.color, c.xform.matrix);
+                break;
+            case POLY:
+                renderer.draw_poly(points, c.color, c.outline,
+                        c.xform.matrix, c.flag);
+                break;
+            case VIDEO:
+                renderer.drawVideoFrame(c.frame, c.xform, &c.bounds, c.flag);
+                break;
+            case BEGIN_MASK:
+                renderer.begin_submit_mask();
+                break;
+            case END_MASK:
+                renderer.end_submit_mask();
+                break;
+            case DISABLE_MASK:
+                renderer.disable_mask();
+                break;
+        }
+    }
+}
+
+void
+DisplayCommands::render(Renderer& renderer) const
+{
+    if (renderer.drawRecording(*this)) return;
+
+    Renderer::External ex(renderer, _background, _width, _height,
+            _x0, _x1, _y0, _y1);
+    replay(renderer);
+}
+
+void
+DisplayCommands::clear()
+{
+    _commands.clear();
+    _points.clear();
+}
+
+CachedBitmap*
+RecordingRenderer::createCachedBitmap(
+        std::auto_ptr<image::GnashImage> /*im*/)
+{
+    // Bitmaps are only created while parsing, never while displaying.
+    return 0;
+}
+
+geometry::Range2d<int>
+RecordingRenderer::world_to_pixel(const SWFRect& worldbounds) const
+{
+    if (_target) return _target->world_to_pixel(worldbounds);
+    return worldbounds.getRange();
+}
+
+point
+RecordingRenderer::pixel_to_world(int x, int y) const
+{
+    if (_target) return _target->pixel_to_world(x, y);
+    return point(x, y);
+}
+
+bool
+RecordingRenderer::bounds_in_clipping_area(const geometry::Range2d<int>& b)
+    const
+{
+    if (_target) return _target->bounds_in_clipping_area(b);
+    return true;
+}
+
+void
+RecordingRenderer::begin_display(const rgba& background_color,
+        int viewport_width, int viewport_height,
+        float x0, float x1, float y0, float y1)
+{
+    _commands.clear();
+    _commands.setFrame(background_color, viewport_width, viewport_height,
+            x0, x1, y0, y1);
+}
+
+} // namespace gnash
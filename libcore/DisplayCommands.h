@@ -0,0 +1,266 @@
+// DisplayCommands.h: a recorded sequence of drawing calls.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef GNASH_DISPLAYCOMMANDS_H
+#define GNASH_DISPLAYCOMMANDS_H
+
+#include <vector>
+
+#include "dsodefs.h"
+#include "Renderer.h"
+#include "Point2d.h"
+#include "RGBA.h"
+#include "SWFRect.h"
+#include "Transform.h"
+
+// Forward declarations
+namespace gnash {
+    namespace SWF {
+        class ShapeRecord;
+    }
+    namespace image {
+        class GnashImage;
+    }
+}
+
+namespace gnash {
+
+/// A recorded sequence of Renderer drawing calls.
+//
+/// The drawing methods take the same arguments as the Renderer methods
+/// of the same name. Shapes, glyphs and video frames are recorded by
+/// reference, so they must not change until the commands have been
+/// replayed. Everything else is copied into flat storage.
+//
+/// The bitmaps of a shape's bitmap fills are looked up when it is
+/// recorded, so that replaying the commands only reads the shape, even
+/// from several threads at once.
+//
+/// A complete frame also records the arguments for begin_display(), so
+/// it can be drawn again, or drawn by several Renderers.
+class DSOEXPORT DisplayCommands
+{
+public:
+
+    DisplayCommands();
+
+    /// Set the arguments for Renderer::begin_display().
+    void setFrame(const rgba& background, int width, int height,
+            float x0, float x1, float y0, float y1);
+
+    void drawShape(const SWF::ShapeRecord& shape, const Transform& xform);
+
+    void drawGlyph(const SWF::ShapeRecord& rec, const rgba& color,
+            const SWFMatrix& mat);
+
+    void drawLine(const std::vector<point>& coords, const rgba& color,
+            const SWFMatrix& mat);
+
+    void draw_poly(const std::vector<point>& corners, const rgba& fill,
+            const rgba& outline, const SWFMatrix& mat, bool masked);
+
+    void drawVideoFrame(image::GnashImage* frame, const Transform& xform,
+            const SWFRect* bounds, bool smooth);
+
+    void begin_submit_mask();
+
+    void end_submit_mask();
+
+    void disable_mask();
+
+    /// Make the same calls on a Renderer, in the recorded order.
+    void replay(Renderer& renderer) const;
+
+    /// Draw the commands as a complete frame.
+    //
+    /// This calls replay() between begin_display() and end_display(),
+    /// unless the Renderer can draw the recording itself.
+    void render(Renderer& renderer) const;
+
+    /// The background colour for begin_display().
+    const rgba& background() const {
+        return _background;
+    }
+
+    /// Remove all commands, keeping the allocated storage.
+    void clear();
+
+    bool empty() const {
+        return _commands.empty();
+    }
+
+    /// Return the number of recorded calls.
+    size_t size() const {
+        return _commands.size();
+    }
+
+private:
+
+    enum Type
+    {
+        SHAPE,
+        GLYPH,
+        LINE,
+        POLY,
+        VIDEO,
+        BEGIN_MASK,
+        END_MASK,
+        DISABLE_MASK
+    };
+
+    struct Command
+    {
+        explicit Command(Type t)
+            :
+            type(t),
+            shape(0),
+            frame(0),
+            firstPoint(0),
+            points(0),
+            flag(false)
+        {}
+
+        Type type;
+        const SWF::ShapeRecord* shape;
+        image::GnashImage* frame;
+        Transform xform;
+        rgba color;
+        rgba outline;
+        SWFRect bounds;
+        size_t firstPoint;
+        size_t points;
+
+        /// smooth for video, masked for polygons.
+        bool flag;
+    };
+
+    /// Append a Command using the given points.
+    Command& add(Type t, const std::vector<point>& points);
+
+    std::vector<Command> _commands;
+
+    /// The points of all line and polygon commands.
+    std::vector<point> _points;
+
+    rgba _background;
+    int _width;
+    int _height;
+    float _x0;
+    float _x1;
+    float _y0;
+    float _y1;
+};
+
+/// A Renderer that records the calls made to it.
+//
+/// Queries are answered by a target Renderer if there is one, so that
+/// DisplayObjects outside its clipping area are left out. Without a
+/// target everything is recorded, and the commands can be drawn by any
+/// Renderer.
+class DSOEXPORT RecordingRenderer : public Renderer
+{
+public:
+
+    /// @param commands The commands to add to.
+    /// @param target   The Renderer the commands are meant for, or 0.
+    RecordingRenderer(DisplayCommands& commands, const Renderer* target = 0)
+        :
+        _commands(commands),
+        _target(target)
+    {}
+
+    virtual std::string description() const {
+        return "Recording";
+    }
+
+    virtual CachedBitmap* createCachedBitmap(
+            std::auto_ptr<image::GnashImage> im);
+
+    virtual void drawVideoFrame(image::GnashImage* frame,
+            const Transform& xform, const SWFRect* bounds, bool smooth) {
+        _commands.drawVideoFrame(frame, xform, bounds, smooth);
+    }
+
+    virtual bool drawsYUVVideo() const {
+        return _target && _target->drawsYUVVideo();
+    }
+
+    virtual void drawLine(const std::vector<point>& coords,
+            const rgba& color, const SWFMatrix& mat) {
+        _commands.drawLine(coords, color, mat);
+    }
+
+    virtual void draw_poly(const std::vector<point>& corners,
+            const rgba& fill, const rgba& outline, const SWFMatrix& mat,
+            bool masked) {
+        _commands.draw_poly(corners, fill, outline, mat, masked);
+    }
+
+    virtual void drawShape(const SWF::ShapeRecord& shape,
+            const Transform& xform) {
+        _commands.drawShape(shape, xform);
+    }
+
+    virtual void drawGlyph(const SWF::ShapeRecord& rec, const rgba& color,
+            const SWFMatrix& mat) {
+        _commands.drawGlyph(rec, color, mat);
+    }
+
+    virtual void begin_submit_mask() {
+        _commands.begin_submit_mask();
+    }
+
+    virtual void end_submit_mask() {
+        _commands.end_submit_mask();
+    }
+
+    virtual void disable_mask() {
+        _commands.disable_mask();
+    }
+
+    virtual geometry::Range2d<int> world_to_pixel(const SWFRect& worldbounds)
+        const;
+
+    virtual point pixel_to_world(int x, int y) const;
+
+    virtual bool bounds_in_clipping_area(const geometry::Range2d<int>& b)
+        const;
+
+private:
+
+    virtual void begin_display(const rgba& background_color,
+            int viewport_width, int viewport_height,
+            float x0, float x1, float y0, float y1);
+
+    virtual void end_display() {}
+
+    virtual Renderer* startInternalRender(image::GnashImage& /*buffer*/) {
+        return 0;
+    }
+
+    virtual void endInternalRender() {}
+
+    DisplayCommands& _commands;
+
+    const Renderer* const _target;
+};
+
+} // namespace gnash
+
+#endif
@@ -52,20 +52,16 @@ namespace {
     /// 65535 (-16384).
     DisplayList::iterator dlistTagsEffectiveZoneEnd(
             DisplayList::container_type& c);
+
+    /// Return the first element whose depth is not less than the given one.
+    template<typename Iterator>
+    Iterator lowerBound(Iterator begin, Iterator end, int depth);
 	
 }
 
 /// Anonymous namespace for generic algorithm functors.
 namespace {
 
-struct DepthEquals : std::binary_function<const DisplayObject*, int, bool>
-{
-    bool operator()(const DisplayObject* item, int depth) const {
-        if (!item) return false;
-        return item->get_depth() == depth;
-    }
-};
-
 struct DepthLessThan : std::binary_function<const DisplayObject*, int, bool>
 {
     bool operator()(const DisplayObject* item, int depth) const {
@@ -116,18 +112,9 @@ DisplayList::getNextHighestDepth() const
 {
     testInvariant();
 
-    int nexthighestdepth=0;
-    for (const_iterator it = _charsByDepth.begin(),
-            itEnd = _charsByDepth.end(); it != itEnd; ++it) {
-
-        DisplayObject* ch = *it;
-
-        const int chdepth = ch->get_depth();
-        if (chdepth >= nexthighestdepth) {
-            nexthighestdepth = chdepth+1;
-        }
-    }
-    return nexthighestdepth;
+    // The highest depth is always at the back.
+    if (_charsByDepth.empty()) return 0;
+    return std::max(0, _charsByDepth.back()->get_depth() + 1);
 }
 
 DisplayObject*
@@ -135,19 +122,20 @@ DisplayList::getDisplayObjectAtDepth(int depth) const
 {
     testInvariant();
 
-    for (const_iterator it = _charsByDepth.begin(), itEnd = _charsByDepth.end();
-        it != itEnd; ++it) {
+    const const_iterator itEnd = _charsByDepth.end();
+
+    for (const_iterator it = lowerBound(_charsByDepth.begin(), itEnd, depth);
+            it != itEnd; ++it) {
 
         DisplayObject* ch = *it;
 
+        // non-existent (chars are ordered by depth)
+        if (ch->get_depth() != depth) return 0;
+
         // Should not be there!
         if (ch->isDestroyed()) continue;
 
-        // found
-        if (ch->get_depth() == depth) return ch;
-
-        // non-existent (chars are ordered by depth)
-        if (ch->get_depth() > depth) return 0;
+        return ch;
     }
 
     return 0;
@@ -180,8 +168,7 @@ DisplayList::placeDisplayObject(DisplayObject* ch, int depth)
     ch->set_depth(depth);
 
     container_type::iterator it =
-        std::find_if( _charsByDepth.begin(), _charsByDepth.end(),
-                boost::bind(std::not2(DepthLessThan()), _1, depth));
+        lowerBound(_charsByDepth.begin(), _charsByDepth.end(), depth);
 
     if (it == _charsByDepth.end() || (*it)->get_depth() != depth) {
         // add the new char
@@ -217,8 +204,7 @@ DisplayList::add(DisplayObject* ch, bool replace)
     const int depth = ch->get_depth();
 
     container_type::iterator it =
-        std::find_if(_charsByDepth.begin(), _charsByDepth.end(),
-                boost::bind(std::not2(DepthLessThan()), _1, depth));
+        lowerBound(_charsByDepth.begin(), _charsByDepth.end(), depth);
 
     if (it == _charsByDepth.end() || (*it)->get_depth() != depth) {
         _charsByDepth.insert(it, ch);
@@ -241,8 +227,7 @@ DisplayList::replaceDisplayObject(DisplayObject* ch, int depth,
     ch->set_depth(depth);
 
     container_type::iterator it =
-        std::find_if(_charsByDepth.begin(), _charsByDepth.end(),
-            boost::bind(std::not2(DepthLessThan()), _1, depth));
+        lowerBound(_charsByDepth.begin(), _charsByDepth.end(), depth);
 
     if (it == _charsByDepth.end() || (*it)->get_depth() != depth) {
         _charsByDepth.insert(it, ch);
@@ -340,12 +325,10 @@ DisplayList::removeDisplayObject(int depth)
 
     // TODO: would it be legal to call removeDisplayObject with a depth
     //             in the "removed" zone ?
-    // TODO: optimize to take by-depth order into account
     container_type::iterator it = 
-        std::find_if( _charsByDepth.begin(), _charsByDepth.end(),
-            boost::bind(DepthEquals(), _1, depth));
+        lowerBound(_charsByDepth.begin(), _charsByDepth.end(), depth);
 
-    if (it != _charsByDepth.end()) {
+    if (it != _charsByDepth.end() && (*it)->get_depth() == depth) {
         // Make a copy (before erasing)
         DisplayObject* oldCh = *it;
 
@@ -391,14 +374,14 @@ DisplayList::swapDepths(DisplayObject* ch1, int newdepth)
 
     assert(srcdepth != newdepth);
 
-    // TODO: optimize this scan by taking ch1 depth into account ?
-    container_type::iterator it1 =
-        std::find(_charsByDepth.begin(), _charsByDepth.end(), ch1);
+    // The DisplayObject is among those at its own depth, if it is here.
+    container_type::iterator it1 = std::find(
+        lowerBound(_charsByDepth.begin(), _charsByDepth.end(), srcdepth),
+        _charsByDepth.end(), ch1);
 
     // upper bound ...
     container_type::iterator it2 =
-        std::find_if(_charsByDepth.begin(), _charsByDepth.end(),
-            boost::bind(std::not2(DepthLessThan()), _1, newdepth));
+        lowerBound(_charsByDepth.begin(), _charsByDepth.end(), newdepth);
 
     if (it1 == _charsByDepth.end()) {
         log_error(_("First argument to DisplayList::swapDepth() "
@@ -423,11 +406,10 @@ DisplayList::swapDepths(DisplayObject* ch1, int newdepth)
     }
     else {
         // No DisplayObject found at the given depth
-        // Move the DisplayObject to the new position
-        // NOTE: insert *before* erasing, in case the list is
-        //             the only referer of the ref-counted DisplayObject
-        _charsByDepth.insert(it2, ch1);
-        _charsByDepth.erase(it1);
+        // Move the DisplayObject to the new position, shifting those
+        // in between.
+        if (it1 < it2) std::rotate(it1, it1 + 1, it2);
+        else std::rotate(it2, it1, it1 + 1);
     }
 
     // don't change depth before the iter_swap case above, as
@@ -456,11 +438,11 @@ DisplayList::insertDisplayObject(DisplayObject* obj, int index)
 
     // Find the first index greater than or equal to the required index
     container_type::iterator it =
-        std::find_if(_charsByDepth.begin(), _charsByDepth.end(),
-            boost::bind(std::not2(DepthLessThan()), _1, index));
+        lowerBound(_charsByDepth.begin(), _charsByDepth.end(), index);
         
     // Insert the DisplayObject before that position
-    _charsByDepth.insert(it, obj);
+    it = _charsByDepth.insert(it, obj);
+    ++it;
 
     // Shift depths upwards until no depths are duplicated. No DisplayObjects
     // are removed!
@@ -484,8 +466,8 @@ DisplayList::unload()
     // the first unload handler is encountered, subsequent children should
     // not be destroyed or removed from the display list. This affects
     // children without an unload handler.
-    for (iterator it = beginNonRemoved(_charsByDepth),
-            itEnd = _charsByDepth.end(); it != itEnd; ) {
+    iterator kept = beginNonRemoved(_charsByDepth);
+    for (iterator it = kept, itEnd = _charsByDepth.end(); it != itEnd; ++it) {
         // make a copy
         DisplayObject* di = *it;
 
@@ -495,16 +477,14 @@ DisplayList::unload()
         // Destroy those with a handler anyway?
         if (di->unload()) {
             unloadHandler = true;
-            ++it;
+            *kept++ = di;
             continue;
         }
 
-        if (!unloadHandler) {
-            di->destroy();
-            it = _charsByDepth.erase(it);
-        }
-        else ++it;
+        if (!unloadHandler) di->destroy();
+        else *kept++ = di;
     }
+    _charsByDepth.erase(kept, _charsByDepth.end());
 
     testInvariant();
 
@@ -517,21 +497,21 @@ DisplayList::destroy()
 {
     testInvariant();
 
-    for (iterator it = _charsByDepth.begin(), itEnd = _charsByDepth.end();
-            it != itEnd; ) {
+    iterator kept = _charsByDepth.begin();
+    for (iterator it = kept, itEnd = _charsByDepth.end(); it != itEnd; ++it) {
 
         // make a copy
         DisplayObject* di = *it;
 
         // skip if already unloaded
         if ( di->isDestroyed() ) {
-            ++it;
+            *kept++ = di;
             continue;
         }
 
         di->destroy();
-        it = _charsByDepth.erase(it); 
     }
+    _charsByDepth.erase(kept, _charsByDepth.end());
     testInvariant();
 }
 
@@ -739,82 +719,83 @@ DisplayList::mergeDisplayList(DisplayList& newList, DisplayObject& o)
     iterator itOldEnd = dlistTagsEffectiveZoneEnd(_charsByDepth);
     iterator itNewEnd = dlistTagsEffectiveZoneEnd(newList._charsByDepth);
 
+    // The merged list is built in a new container, as inserting and
+    // erasing in place would shift the remainder of the list each time.
+    // It starts with the removed zone of the old list.
+    container_type merged(_charsByDepth.begin(), itOld);
+    merged.reserve(_charsByDepth.size() + newList._charsByDepth.size());
+
+    // Unloaded DisplayObjects to reinsert once the merge is done.
+    container_type removed;
+
     // step1. 
     // starting scanning both lists.
-    while (itOld != itOldEnd) {
+    while (itOld != itOldEnd && itNew != itNewEnd) {
 
-        iterator itOldBackup = itOld;
-        
-        DisplayObject* chOld = *itOldBackup;
+        DisplayObject* chOld = *itOld;
         const int depthOld = chOld->get_depth();
 
-        while (itNew != itNewEnd) {
-            iterator itNewBackup = itNew;
-            
-            DisplayObject* chNew = *itNewBackup;
-            const int depthNew = chNew->get_depth();
+        DisplayObject* chNew = *itNew;
+        const int depthNew = chNew->get_depth();
             
-            // depth in old list is occupied, and empty in new list.
-            if (depthOld < depthNew) {
-
-                ++itOld;
-                // unload the DisplayObject if it's in static zone(-16384,0)
-                if (depthOld < 0) {
-                    o.set_invalidated();
-                    _charsByDepth.erase(itOldBackup);
+        // depth in old list is occupied, and empty in new list.
+        if (depthOld < depthNew) {
 
-                     if (chOld->unload()) reinsertRemovedCharacter(chOld);
-                     else chOld->destroy();
-                }
+            ++itOld;
+            // unload the DisplayObject if it's in static zone(-16384,0)
+            if (depthOld < 0) {
+                o.set_invalidated();
 
-                break;
+                if (chOld->unload()) removed.push_back(chOld);
+                else chOld->destroy();
             }
-            // depth is occupied in both lists
-            
-            if (depthOld == depthNew) {
-                ++itOld;
-                ++itNew;
+            else merged.push_back(chOld);
+
+            continue;
+        }
+
+        // depth is occupied in both lists
+        if (depthOld == depthNew) {
+            ++itOld;
                 
-                const bool is_ratio_compatible = 
-                    (chOld->get_ratio() == chNew->get_ratio());
-
-                if (!is_ratio_compatible || chOld->isDynamic() ||
-                        !isReferenceable(*chOld)) {
-                    // replace the DisplayObject in old list with
-                    // corresponding DisplayObject in new list
-                    o.set_invalidated();
-                    _charsByDepth.insert(itOldBackup, *itNewBackup);
-                    _charsByDepth.erase(itOldBackup);
+            const bool is_ratio_compatible = 
+                (chOld->get_ratio() == chNew->get_ratio());
+
+            if (!is_ratio_compatible || chOld->isDynamic() ||
+                    !isReferenceable(*chOld)) {
+                // replace the DisplayObject in old list with
+                // corresponding DisplayObject in new list
+                o.set_invalidated();
+                merged.push_back(chNew);
                     
-                    // unload the old DisplayObject
-                    if (chOld->unload()) reinsertRemovedCharacter(chOld); 
-                    else chOld->destroy();
-                }
-                else {
-                    newList._charsByDepth.erase(itNewBackup);
-
-                    // replace the transformation SWFMatrix if the old
-                    // DisplayObject accepts static transformation.
-                    if (chOld->get_accept_anim_moves()) {
-                        chOld->setMatrix(getMatrix(*chNew), true); 
-                        chOld->setCxForm(getCxForm(*chNew));
-                    }
-                    chNew->unload();
-                    chNew->destroy();
+                // unload the old DisplayObject
+                if (chOld->unload()) removed.push_back(chOld);
+                else chOld->destroy();
+            }
+            else {
+                // Drop it from the new list.
+                *itNew = 0;
+                merged.push_back(chOld);
+
+                // replace the transformation SWFMatrix if the old
+                // DisplayObject accepts static transformation.
+                if (chOld->get_accept_anim_moves()) {
+                    chOld->setMatrix(getMatrix(*chNew), true); 
+                    chOld->setCxForm(getCxForm(*chNew));
                 }
-
-                break;
+                chNew->unload();
+                chNew->destroy();
             }
 
-            // depth in old list is empty, but occupied in new list.
             ++itNew;
-            // add the new DisplayObject to the old list.
-            o.set_invalidated();
-            _charsByDepth.insert(itOldBackup, *itNewBackup);
+            continue;
         }
 
-        // break if finish scanning the new list
-        if (itNew == itNewEnd) break;
+        // depth in old list is empty, but occupied in new list.
+        ++itNew;
+        // add the new DisplayObject to the old list.
+        o.set_invalidated();
+        merged.push_back(chNew);
     }
 
     // step2(only required if scanning of new list finished earlier in step1).
@@ -824,9 +805,9 @@ DisplayList::mergeDisplayList(DisplayList& newList, DisplayObject& o)
 
         DisplayObject* chOld = *itOld;
         o.set_invalidated();
-        itOld = _charsByDepth.erase(itOld);
+        ++itOld;
 
-        if (chOld->unload()) reinsertRemovedCharacter(chOld);
+        if (chOld->unload()) removed.push_back(chOld);
         else chOld->destroy();
     }
 
@@ -835,7 +816,15 @@ DisplayList::mergeDisplayList(DisplayList& newList, DisplayObject& o)
     // add remaining DisplayObjects directly.
     if (itNew != itNewEnd) {
         o.set_invalidated();
-        _charsByDepth.insert(itOld, itNew, itNewEnd);
+        merged.insert(merged.end(), itNew, itNewEnd);
+    }
+
+    // The rest of the old list is kept as it is.
+    merged.insert(merged.end(), itOld, _charsByDepth.end());
+    _charsByDepth.swap(merged);
+
+    for (iterator it = removed.begin(), e = removed.end(); it != e; ++it) {
+        reinsertRemovedCharacter(*it);
     }
 
     // step4.
@@ -844,15 +833,17 @@ DisplayList::mergeDisplayList(DisplayList& newList, DisplayObject& o)
     for (itNew = newList._charsByDepth.begin(); itNew != itNewEnd; ++itNew) {
 
         DisplayObject* chNew = *itNew;
+        if (!chNew) continue;
+
         const int depthNew = chNew->get_depth();
 
         if (chNew->unloaded()) {
             iterator it =
-                std::find_if(_charsByDepth.begin(), _charsByDepth.end(),
-                    boost::bind(std::not2(DepthLessThan()), _1, depthNew));
+                lowerBound(_charsByDepth.begin(), _charsByDepth.end(),
+                        depthNew);
             
             o.set_invalidated();
-            _charsByDepth.insert(it, *itNew);
+            _charsByDepth.insert(it, chNew);
         }
     }
 
@@ -865,7 +856,7 @@ DisplayList::mergeDisplayList(DisplayList& newList, DisplayObject& o)
             e = newList._charsByDepth.end(); i != e; ++i) {
 
         DisplayObject* ch = *i;
-        if (!ch->unloaded()) {
+        if (ch && !ch->unloaded()) {
 
             iterator found =
                 std::find(_charsByDepth.begin(), _charsByDepth.end(), ch);
@@ -901,10 +892,8 @@ DisplayList::reinsertRemovedCharacter(DisplayObject* ch)
     int newDepth = DisplayObject::removedDepthOffset - oldDepth;
     ch->set_depth(newDepth);
 
-    // TODO: optimize this by searching from the end(lowest depth).
     container_type::iterator it =
-        std::find_if(_charsByDepth.begin(), _charsByDepth.end(),
-                boost::bind(std::not2(DepthLessThan()), _1, newDepth));
+        lowerBound(_charsByDepth.begin(), _charsByDepth.end(), newDepth);
 
     _charsByDepth.insert(it, ch);
 
@@ -916,7 +905,9 @@ DisplayList::removeUnloaded()
 {
     testInvariant();
 
-    _charsByDepth.remove_if(boost::mem_fn(&DisplayObject::unloaded));
+    _charsByDepth.erase(std::remove_if(_charsByDepth.begin(),
+                _charsByDepth.end(), boost::mem_fn(&DisplayObject::unloaded)),
+            _charsByDepth.end());
 
     testInvariant();
 }
@@ -939,8 +930,7 @@ beginNonRemoved(DisplayList::container_type& c)
     const int depth = 1 + DisplayObject::removedDepthOffset -
         DisplayObject::staticDepthOffset;
     
-    return std::find_if(c.begin(), c.end(),
-            boost::bind(std::not2(DepthLessThan()), _1, depth));
+    return lowerBound(c.begin(), c.end(), depth);
 }
 
 DisplayList::const_iterator
@@ -950,16 +940,21 @@ beginNonRemoved(const DisplayList::container_type& c)
     const int depth = 1 + DisplayObject::removedDepthOffset -
         DisplayObject::staticDepthOffset;
 
-    return std::find_if(c.begin(), c.end(), 
-            boost::bind(std::not2(DepthLessThan()), _1, depth));
+    return lowerBound(c.begin(), c.end(), depth);
 }
 
 DisplayList::iterator
 dlistTagsEffectiveZoneEnd(DisplayList::container_type& c)
 {
-    return std::find_if(c.begin(), c.end(), 
-            boost::bind(DepthGreaterThan(), _1,
-                0xffff + DisplayObject::staticDepthOffset));
+    return lowerBound(c.begin(), c.end(),
+            0x10000 + DisplayObject::staticDepthOffset);
+}
+
+template<typename Iterator>
+Iterator
+lowerBound(Iterator begin, Iterator end, int depth)
+{
+    return std::lower_bound(begin, end, depth, DepthLessThan());
 }
 
 } // anonymous namespace
@@ -23,7 +23,7 @@
 #include "snappingrange.h"
 
 #include <string>
-#include <list>
+#include <vector>
 #include <iosfwd>
 #if GNASH_PARANOIA_LEVEL > 1 && !defined(NDEBUG)
 #include "DisplayObject.h"
@@ -60,12 +60,24 @@ namespace gnash {
 /// tags instructing when to add or remove DisplayObjects
 /// from the stage.
 ///
+/// DisplayObjects are kept in a vector sorted by depth, so lookups by
+/// depth are binary searches and rendering walks contiguous memory.
+/// Adding or removing a DisplayObject moves the pointers above it, so
+/// it is linear in the size of the list; lists are usually short, so
+/// this is only a few pointers.
+///
+/// Unlike with the std::list used before, any change to the list
+/// invalidates all iterators and shifts the position of the
+/// DisplayObjects after the change. Nothing may add or remove
+/// DisplayObjects while the list is being visited: the visit functions
+/// stop at the end of a changed list, but may skip or repeat entries.
+///
 class DisplayList
 {
 
 public:
 
-	typedef std::list<DisplayObject*> container_type;
+	typedef std::vector<DisplayObject*> container_type;
 	typedef container_type::iterator iterator;
 	typedef container_type::const_iterator const_iterator;
 	typedef container_type::reverse_iterator reverse_iterator;
@@ -246,6 +258,7 @@ public:
 	///
 	/// NOTE: all elements in the list are visited, even
 	///       the removed ones (unloaded)
+	/// The visitor must not change the list.
 	/// TODO: inspect if worth providing an arg to skip removed
 	template <class V> inline void visitBackward(V& visitor);
     template <class V> inline void visitBackward(V& visitor) const;
@@ -261,6 +274,7 @@ public:
 	///
 	/// NOTE: all elements in the list are visited, even
 	///       the removed ones (unloaded)
+	/// The visitor must not change the list.
 	/// TODO: inspect if worth providing an arg to skip removed
 	template <class V> inline void visitAll(V& visitor);
 	template <class V> inline void visitAll(V& visitor) const;
@@ -351,9 +365,10 @@ template <class V>
 void
 DisplayList::visitBackward(V& visitor)
 {
-	for (reverse_iterator it = _charsByDepth.rbegin(),
-			itEnd = _charsByDepth.rend(); it != itEnd; ++it) {
-		if (!visitor(*it)) break;
+	// Indices rather than iterators, which a change would invalidate.
+	for (size_t i = _charsByDepth.size(); i > 0; --i) {
+		if (i > _charsByDepth.size()) i = _charsByDepth.size();
+		if (!i || !visitor(_charsByDepth[i - 1])) break;
 	}
 }
 
@@ -371,10 +386,9 @@ template <class V>
 void
 DisplayList::visitAll(V& visitor)
 {
-	for (iterator it = _charsByDepth.begin(), itEnd = _charsByDepth.end();
-		it != itEnd; ++it) {
-
-		visitor(*it);
+	// Indices rather than iterators, which a change would invalidate.
+	for (size_t i = 0; i < _charsByDepth.size(); ++i) {
+		visitor(_charsByDepth[i]);
 	}
 }
 
@@ -74,6 +74,7 @@ DynamicShape::endFill()
 		//
 
 		_currpath->close();
+		_shape.touch();
 
 		// reset _x and _y to reflect closing point
 		_x = _currpath->ap.x;
@@ -110,6 +111,7 @@ DynamicShape::startNewPath(bool newShape)
 	{
 		// TODO: this is probably bogus
 		_currpath->close();
+		_shape.touch();
 	}
 
 	// The DrawingApiTest.swf file shows we should not
@@ -133,6 +135,7 @@ DynamicShape::finalize() const
 		assert(!_shape.paths().empty());
 		assert(_currpath == &(_shape.paths().back()));
 		_currpath->close();
+		_shape.touch();
 	}
 
 	// TODO: check consistency of fills and such !
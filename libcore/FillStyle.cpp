@@ -182,7 +182,7 @@ const CachedBitmap*
 BitmapFill::bitmap() const
 {
     if (_bitmapInfo) {
-        return  _bitmapInfo.get();
+        return  _bitmapInfo->materialize();
     }
     if (!_md) {
         return 0;
@@ -190,7 +190,7 @@ BitmapFill::bitmap() const
     _bitmapInfo = _md->getBitmap(_id);
 
     // May still be 0!
-    return _bitmapInfo.get();
+    return _bitmapInfo ? _bitmapInfo->materialize() : 0;
 }
     
 void
@@ -0,0 +1,241 @@
+// FlatPropertyContainer.cpp: compact storage for object properties.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "FlatPropertyContainer.h"
+
+#include <cassert>
+#include <new>
+
+#include "Property.h"
+#include "ObjectURI.h"
+
+namespace gnash {
+
+namespace {
+
+const boost::uint32_t emptySlot = 0xffffffff;
+
+/// Keys are mostly small sequential numbers, so mixing the bits a
+/// little is enough.
+inline size_t
+hash(string_table::key k)
+{
+    return k ^ (k >> 7);
+}
+
+}
+
+FlatPropertyContainer::FlatPropertyContainer(string_table& st)
+    :
+    _st(st),
+    _last(0),
+    _used(0)
+{
+}
+
+FlatPropertyContainer::~FlatPropertyContainer()
+{
+    clear();
+}
+
+FlatPropertyContainer::const_iterator
+FlatPropertyContainer::find(const ObjectURI& uri, bool caseless) const
+{
+    const string_table::key k = caseless ? uri.noCase(_st) : getName(uri);
+    size_t i;
+
+    if (_entries.size() <= maxLinear) {
+        for (i = 0; i < _entries.size(); ++i) {
+            if (key(i, caseless) == k) break;
+        }
+    }
+    else if (caseless) {
+        if (_noCaseIndex.empty()) indexNoCase();
+        i = lookup(_noCaseIndex, k, true);
+    }
+    else i = lookup(_index, k, false);
+
+    return const_iterator(_entries.begin() + i);
+}
+
+std::pair<FlatPropertyContainer::iterator, bool>
+FlatPropertyContainer::push_back(const Property& p)
+{
+    const string_table::key k = getName(p.uri());
+    _entries.push_back(Entry(k, construct(p)));
+
+    const size_t i = _entries.size() - 1;
+
+    if (_entries.size() == maxLinear + 1) {
+        reindex();
+    }
+    else if (!_index.empty()) {
+        // Keep the load factor at or below one half.
+        if (_entries.size() * 2 > _index.size()) reindex();
+        else {
+            insert(_index, k, i, false);
+            if (!_noCaseIndex.empty()) {
+                insert(_noCaseIndex, key(i, true), i, true);
+            }
+        }
+    }
+
+    return std::make_pair(const_iterator(_entries.begin() + i), true);
+}
+
+bool
+FlatPropertyContainer::replace(iterator it, const Property& p)
+{
+    assert(it != end());
+    Property* prop = it.base()->prop;
+
+    // The name might differ in case only.
+    if (getName(prop->uri()) != getName(p.uri())) {
+        *prop = p;
+        _entries[it.base() - _entries.begin()].name = getName(p.uri());
+        if (!_index.empty()) reindex();
+        return true;
+    }
+    *prop = p;
+    return true;
+}
+
+void
+FlatPropertyContainer::erase(iterator it)
+{
+    assert(it != end());
+    Entries::iterator e = _entries.begin() + (it.base() - _entries.begin());
+    destroy(e->prop);
+    _entries.erase(e);
+
+    if (_entries.size() > maxLinear) reindex();
+    else {
+        Index().swap(_index);
+        Index().swap(_noCaseIndex);
+    }
+}
+
+void
+FlatPropertyContainer::clear()
+{
+    for (Entries::iterator it = _entries.begin(), e = _entries.end();
+            it != e; ++it) {
+        it->prop->~Property();
+    }
+    while (_last) {
+        Block* prev = _last->prev;
+        ::operator delete(_last);
+        _last = prev;
+    }
+    Entries().swap(_entries);
+    Index().swap(_index);
+    Index().swap(_noCaseIndex);
+    std::vector<Property*>().swap(_free);
+    _used = 0;
+}
+
+Property*
+FlatPropertyContainer::construct(const Property& p)
+{
+    if (!_free.empty()) {
+        Property* slot = _free.back();
+        new (slot) Property(p);
+        _free.pop_back();
+        return slot;
+    }
+
+    if (!_last || _used == _last->size) {
+        const size_t size = _last ? _last->size * 2 : 1;
+        Block* b = static_cast<Block*>(
+                ::operator new(sizeof(Block) + size * sizeof(Property)));
+        b->prev = _last;
+        b->size = size;
+        _last = b;
+        _used = 0;
+    }
+    Property* slot = _last->slots() + _used;
+    new (slot) Property(p);
+    ++_used;
+    return slot;
+}
+
+void
+FlatPropertyContainer::destroy(Property* p)
+{
+    p->~Property();
+    _free.push_back(p);
+}
+
+string_table::key
+FlatPropertyContainer::key(size_t i, bool caseless) const
+{
+    const Entry& e = _entries[i];
+    return caseless ? e.prop->uri().noCase(_st) : e.name;
+}
+
+bool
+FlatPropertyContainer::insert(Index& idx, string_table::key k,
+        boost::uint32_t i, bool caseless) const
+{
+    const size_t mask = idx.size() - 1;
+    for (size_t h = hash(k) & mask; ; h = (h + 1) & mask) {
+        if (idx[h] == emptySlot) {
+            idx[h] = i;
+            return true;
+        }
+        if (key(idx[h], caseless) == k) return false;
+    }
+}
+
+size_t
+FlatPropertyContainer::lookup(const Index& idx, string_table::key k,
+        bool caseless) const
+{
+    const size_t mask = idx.size() - 1;
+    for (size_t h = hash(k) & mask; ; h = (h + 1) & mask) {
+        if (idx[h] == emptySlot) return _entries.size();
+        if (key(idx[h], caseless) == k) return idx[h];
+    }
+}
+
+void
+FlatPropertyContainer::reindex()
+{
+    size_t slots = 16;
+    while (slots < _entries.size() * 4) slots *= 2;
+
+    Index(slots, emptySlot).swap(_index);
+    for (size_t i = 0; i < _entries.size(); ++i) {
+        insert(_index, _entries[i].name, i, false);
+    }
+    Index().swap(_noCaseIndex);
+}
+
+void
+FlatPropertyContainer::indexNoCase() const
+{
+    Index(_index.size(), emptySlot).swap(_noCaseIndex);
+
+    // The oldest Property wins when names differ only in case.
+    for (size_t i = 0; i < _entries.size(); ++i) {
+        insert(_noCaseIndex, key(i, true), i, true);
+    }
+}
+
+} // namespace gnash
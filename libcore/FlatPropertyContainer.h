@@ -0,0 +1,202 @@
+// FlatPropertyContainer.h: compact storage for object properties.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef GNASH_FLATPROPERTYCONTAINER_H
+#define GNASH_FLATPROPERTYCONTAINER_H
+
+#include <vector>
+#include <utility>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/iterator/iterator_adaptor.hpp>
+
+#include "string_table.h"
+#include "Property.h"
+
+// Forward declarations
+namespace gnash {
+    struct ObjectURI;
+}
+
+namespace gnash {
+
+/// A property container for objects with few properties.
+//
+/// This is an alternative to the multi_index_container used by
+/// PropertyList, selected with --enable-flat-properties. Most objects
+/// have only a handful of members, and three tree indices cost several
+/// pointers per Property plus a header node for each object.
+//
+/// Properties are kept in a vector in creation order and found by
+/// linear scan. Once there are more than maxLinear of them, an
+/// open-addressing hash of the case-sensitive names is added. The
+/// case-insensitive hash is only built on the first case-insensitive
+/// lookup, which only happens for SWF6 and earlier.
+//
+/// The Properties themselves are stored by value in blocks owned by the
+/// container, the first holding one and each further one twice as many
+/// as the last. Blocks never move, so pointers to a Property stay valid
+/// until it is removed, as they must while getters and setters run. The
+/// slots of removed Properties are reused.
+class FlatPropertyContainer : boost::noncopyable
+{
+    struct Entry
+    {
+        Entry(string_table::key k, Property* p) : name(k), prop(p) {}
+        string_table::key name;
+        Property* prop;
+    };
+
+    typedef std::vector<Entry> Entries;
+
+public:
+
+    typedef Property value_type;
+
+    /// Iterator over the Properties in creation order.
+    class const_iterator : public boost::iterator_adaptor<const_iterator,
+            Entries::const_iterator, const Property,
+            boost::use_default, const Property&>
+    {
+    public:
+        const_iterator() {}
+        explicit const_iterator(Entries::const_iterator it)
+            :
+            const_iterator::iterator_adaptor_(it)
+        {}
+    private:
+        friend class boost::iterator_core_access;
+        const Property& dereference() const {
+            return *this->base()->prop;
+        }
+    };
+
+    /// Properties are only modified through their mutable members.
+    typedef const_iterator iterator;
+
+    /// The number of Properties searched without a hash index.
+    static const size_t maxLinear = 8;
+
+    explicit FlatPropertyContainer(string_table& st);
+
+    ~FlatPropertyContainer();
+
+    const_iterator begin() const {
+        return const_iterator(_entries.begin());
+    }
+
+    const_iterator end() const {
+        return const_iterator(_entries.end());
+    }
+
+    size_t size() const {
+        return _entries.size();
+    }
+
+    bool empty() const {
+        return _entries.empty();
+    }
+
+    /// Find a Property.
+    //
+    /// @param uri      The name to look for.
+    /// @param caseless Whether to ignore case (SWF6 and below). If more
+    ///                 than one Property matches, the oldest one is found.
+    /// @return         The Property or end().
+    const_iterator find(const ObjectURI& uri, bool caseless) const;
+
+    /// Append a Property.
+    //
+    /// A Property of the same name must not already exist.
+    std::pair<iterator, bool> push_back(const Property& p);
+
+    /// Replace a Property, keeping its position and address.
+    bool replace(iterator it, const Property& p);
+
+    /// Remove a Property.
+    void erase(iterator it);
+
+    /// Remove all Properties.
+    void clear();
+
+private:
+
+    typedef std::vector<boost::uint32_t> Index;
+
+    /// Insert entry i in an index.
+    //
+    /// @return false if the key was already present.
+    bool insert(Index& idx, string_table::key k, boost::uint32_t i,
+            bool caseless) const;
+
+    /// Find the entry with a key in an index, or return size().
+    size_t lookup(const Index& idx, string_table::key k, bool caseless) const;
+
+    /// The key of entry i in the given index.
+    string_table::key key(size_t i, bool caseless) const;
+
+    /// Rebuild the case-sensitive index and drop the other one.
+    void reindex();
+
+    /// Build the case-insensitive index.
+    void indexNoCase() const;
+
+    /// Copy a Property into a free slot.
+    Property* construct(const Property& p);
+
+    /// Destroy a Property and make its slot free.
+    void destroy(Property* p);
+
+    /// The start of a block of Properties, which follow it.
+    //
+    /// Blocks are chained to the previous one, so that the container
+    /// needs no allocation of its own to keep them.
+    struct Block
+    {
+        Block* prev;
+        size_t size;
+
+        Property* slots() {
+            return reinterpret_cast<Property*>(this + 1);
+        }
+    };
+
+    string_table& _st;
+
+    Entries _entries;
+
+    /// Hash of case-sensitive names to entries, if size() > maxLinear.
+    Index _index;
+
+    /// Hash of case-insensitive names to entries, built on demand.
+    mutable Index _noCaseIndex;
+
+    /// The last block of Properties, or 0 for none.
+    Block* _last;
+
+    /// The number of slots ever used in the last block.
+    size_t _used;
+
+    /// Slots whose Property was removed.
+    std::vector<Property*> _free;
+};
+
+} // namespace gnash
+
+#endif
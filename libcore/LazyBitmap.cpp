@@ -0,0 +1,208 @@
+// LazyBitmap.cpp: a bitmap decoded when it is first drawn.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "LazyBitmap.h"
+
+#include <cassert>
+#include <exception>
+#include <boost/thread/mutex.hpp>
+
+#include "Renderer.h"
+#include "GnashImage.h"
+#include "log.h"
+
+namespace gnash {
+
+namespace {
+
+/// The decoded images of all LazyBitmaps, most recently used first.
+struct Cache
+{
+    Cache() : bytes(0), evictions(0) {}
+
+    boost::mutex mutex;
+    LazyBitmap::Decoded decoded;
+    size_t bytes;
+    size_t evictions;
+};
+
+/// This is never destroyed, as LazyBitmaps may outlive static objects.
+Cache&
+cache()
+{
+    static Cache* c = new Cache;
+    return *c;
+}
+
+}
+
+LazyBitmap::LazyBitmap(const Decoder& decoder, Renderer& renderer)
+    :
+    _decoder(decoder),
+    _renderer(renderer),
+    _bytes(0),
+    _lastUsed(0),
+    _failed(false),
+    _disposed(false)
+{
+}
+
+LazyBitmap::~LazyBitmap()
+{
+    boost::mutex::scoped_lock lock(cache().mutex);
+    release();
+}
+
+image::GnashImage&
+LazyBitmap::image()
+{
+    materialize();
+    assert(_bitmap);
+    return _bitmap->image();
+}
+
+void
+LazyBitmap::dispose()
+{
+    boost::mutex::scoped_lock lock(cache().mutex);
+    release();
+    _disposed = true;
+}
+
+bool
+LazyBitmap::disposed() const
+{
+    return _disposed;
+}
+
+bool
+LazyBitmap::decoded() const
+{
+    boost::mutex::scoped_lock lock(cache().mutex);
+    return _bitmap.get();
+}
+
+const CachedBitmap*
+LazyBitmap::materialize() const
+{
+    Cache& c = cache();
+    bool done;
+    {
+        boost::mutex::scoped_lock lock(c.mutex);
+        const CachedBitmap* bm = current(done);
+        if (done) return bm;
+    }
+
+    boost::mutex::scoped_lock decodeLock(_decodeMutex);
+
+    // Another thread may have decoded it while we waited.
+    {
+        boost::mutex::scoped_lock lock(c.mutex);
+        const CachedBitmap* bm = current(done);
+        if (done) return bm;
+    }
+
+    std::auto_ptr<image::GnashImage> im;
+    try {
+        im = _decoder();
+    }
+    catch (const std::exception& e) {
+        log_error(_("Error decoding bitmap: %s"), e.what());
+    }
+
+    boost::mutex::scoped_lock lock(c.mutex);
+
+    // Disposed while decoding.
+    if (_disposed) return this;
+
+    if (!im.get()) {
+        _failed = true;
+        return 0;
+    }
+
+    _bytes = im->size();
+    _bitmap = _renderer.createCachedBitmap(im);
+    if (!_bitmap) {
+        _failed = true;
+        return 0;
+    }
+
+    c.decoded.push_front(this);
+    _entry = c.decoded.begin();
+    c.bytes += _bytes;
+    _lastUsed = c.evictions;
+
+    return _bitmap.get();
+}
+
+const CachedBitmap*
+LazyBitmap::current(bool& done) const
+{
+    done = true;
+
+    // Renderers check this themselves.
+    if (_disposed) return this;
+
+    if (_bitmap) {
+        Cache& c = cache();
+        c.decoded.splice(c.decoded.begin(), c.decoded, _entry);
+        _lastUsed = c.evictions;
+        return _bitmap.get();
+    }
+
+    if (_failed) return 0;
+
+    done = false;
+    return 0;
+}
+
+void
+LazyBitmap::release() const
+{
+    if (!_bitmap) return;
+
+    Cache& c = cache();
+    c.decoded.erase(_entry);
+    c.bytes -= _bytes;
+    _bitmap.reset();
+}
+
+void
+LazyBitmap::evict(size_t maxBytes)
+{
+    Cache& c = cache();
+    boost::mutex::scoped_lock lock(c.mutex);
+
+    while (c.bytes > maxBytes) {
+        const LazyBitmap* oldest = c.decoded.back();
+        if (oldest->_lastUsed == c.evictions) break;
+        oldest->release();
+    }
+    ++c.evictions;
+}
+
+size_t
+LazyBitmap::decodedBytes()
+{
+    Cache& c = cache();
+    boost::mutex::scoped_lock lock(c.mutex);
+    return c.bytes;
+}
+
+} // namespace gnash
@@ -0,0 +1,136 @@
+// LazyBitmap.h: a bitmap decoded when it is first drawn.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef GNASH_LAZYBITMAP_H
+#define GNASH_LAZYBITMAP_H
+
+#include <list>
+#include <memory>
+#include <boost/function.hpp>
+#include <boost/intrusive_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "dsodefs.h"
+#include "CachedBitmap.h"
+
+// Forward declarations
+namespace gnash {
+    class Renderer;
+    namespace image {
+        class GnashImage;
+    }
+}
+
+namespace gnash {
+
+/// A CachedBitmap that keeps its data encoded until it is drawn.
+//
+/// The first call to materialize() decodes the data and passes it to the
+/// renderer. The decoded bitmaps of all LazyBitmaps share a memory budget,
+/// which evict() enforces between frames by dropping those that have not
+/// been used for the longest time. They are decoded again when needed.
+class DSOEXPORT LazyBitmap : public CachedBitmap
+{
+public:
+
+    /// Decodes the image, returning 0 on failure.
+    typedef boost::function<std::auto_ptr<image::GnashImage>()> Decoder;
+
+    /// Create a LazyBitmap.
+    //
+    /// @param decoder  Decodes the image. It may be called more than once
+    ///                 and from any thread that draws.
+    /// @param renderer Creates the CachedBitmap for each decoded image. It
+    ///                 must outlive the LazyBitmap.
+    LazyBitmap(const Decoder& decoder, Renderer& renderer);
+
+    ~LazyBitmap();
+
+    /// Decode the image and return it.
+    //
+    /// The image stays valid until the next call to evict(). It must only
+    /// be called if materialize() succeeds.
+    virtual image::GnashImage& image();
+
+    virtual void dispose();
+
+    virtual bool disposed() const;
+
+    /// Return the renderer's CachedBitmap, decoding it if necessary.
+    //
+    /// This is thread-safe. Decoding doesn't hold up threads drawing other
+    /// LazyBitmaps, and threads drawing this one wait for it to finish
+    /// rather than decoding again.
+    virtual const CachedBitmap* materialize() const;
+
+    /// Whether the image is decoded now.
+    bool decoded() const;
+
+    /// Drop decoded images until at most the given amount is used.
+    //
+    /// Images drawn since the last call are kept even if they exceed the
+    /// limit. This must not be called while drawing.
+    //
+    /// @param maxBytes     The memory to keep for decoded images.
+    static void evict(size_t maxBytes);
+
+    /// The memory used by decoded images in bytes.
+    static size_t decodedBytes();
+
+    typedef std::list<const LazyBitmap*> Decoded;
+
+private:
+
+    /// Drop the decoded image. The cache must be locked.
+    void release() const;
+
+    /// Return the decoded bitmap if it needn't be decoded again.
+    //
+    /// The cache must be locked.
+    //
+    /// @param done     Set to false if the image must be decoded.
+    const CachedBitmap* current(bool& done) const;
+
+    const Decoder _decoder;
+
+    Renderer& _renderer;
+
+    mutable boost::intrusive_ptr<CachedBitmap> _bitmap;
+
+    /// The size of the decoded image.
+    mutable size_t _bytes;
+
+    /// The number of evictions before the image was last used.
+    mutable size_t _lastUsed;
+
+    /// This image's place in the list of decoded images.
+    mutable Decoded::iterator _entry;
+
+    /// Whether decoding failed. It is not tried again.
+    mutable bool _failed;
+
+    /// Held while decoding, which is done without locking the cache.
+    mutable boost::mutex _decodeMutex;
+
+    bool _disposed;
+};
+
+} // namespace gnash
+
+#endif
@@ -32,7 +32,8 @@ MorphShape::MorphShape(movie_root& mr, as_object* object,
     :
     DisplayObject(mr, object, parent),
     _def(def),
-    _shape(_def->shape1())
+    _shape(_def->morph(0)),
+    _morphedRatio(0)
 {
 }
 
@@ -53,9 +54,9 @@ MorphShape::pointInShape(boost::int32_t x, boost::int32_t y) const
     //       in DrawingApiTest (kind of a fill-leakage making
     //       the collision detection find you inside a self-crossing
     //       shape).
-    if (!_shape.getBounds().point_test(lp.x, lp.y)) return false;
+    if (!_shape->getBounds().point_test(lp.x, lp.y)) return false;
 
-    return geometry::pointTest(_shape.paths(), _shape.lineStyles(),
+    return geometry::pointTest(_shape->paths(), _shape->lineStyles(),
             lp.x, lp.y, wm);
 }
 
@@ -66,21 +67,15 @@ MorphShape::display(Renderer& renderer, const Transform& base)
 
     const Transform xform = base * transform();
 
-    _def->display(renderer, _shape, xform); 
+    _def->display(renderer, *_shape, xform); 
     clear_invalidated();
 }
 
-inline double
-MorphShape::currentRatio() const
-{
-    return get_ratio() / 65535.0;
-}
-
 SWFRect
 MorphShape::getBounds() const
 {
     // TODO: optimize this more.
-    SWFRect bounds = _shape.getBounds();
+    SWFRect bounds = _shape->getBounds();
     bounds.expand_to_rect(_def->shape2().getBounds());
     return bounds;
 }
@@ -88,7 +83,15 @@ MorphShape::getBounds() const
 void
 MorphShape::morph()
 {
-    _shape.setLerp(_def->shape1(), _def->shape2(), currentRatio());
+    // Keep the shape unchanged, so that renderers can reuse what they
+    // cached for it.
+    if (get_ratio() == _morphedRatio) return;
+    _morphedRatio = get_ratio();
+
+    // Drop the old shape first, so that it can be reused if no other
+    // instance has it.
+    _shape.reset();
+    _shape = _def->morph(_morphedRatio);
 }
 
 
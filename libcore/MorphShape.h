@@ -23,6 +23,7 @@
 #include "DisplayObject.h"
 #include "swf/DefineMorphShapeTag.h"
 #include <boost/intrusive_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 #include <cassert>
 
 namespace gnash {
@@ -60,18 +61,20 @@ public:
     virtual bool pointInShape(boost::int32_t  x, boost::int32_t  y) const;
  
     const SWF::ShapeRecord& shape() const {
-        return _shape;
+        return *_shape;
     }
 
 private:
     
     void morph();
 
-    double currentRatio() const;
-
     const boost::intrusive_ptr<const SWF::DefineMorphShapeTag> _def;
 	
-    SWF::ShapeRecord _shape;
+    /// The shape at _morphedRatio, shared with other instances.
+    boost::shared_ptr<const SWF::ShapeRecord> _shape;
+
+    /// The ratio _shape was morphed to.
+    int _morphedRatio;
 
 };
 
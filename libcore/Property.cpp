@@ -25,6 +25,7 @@
 #include "as_function.h"
 #include "as_environment.h"
 #include "fn_call.h"
+#include "movie_root.h"
 
 namespace gnash {
 
@@ -114,6 +115,8 @@ Property::getValue(const as_object& this_ptr) const
                 if (_destructive) {
                     _bound = ret;
                     _destructive = false;
+                    // The object now holds the value itself.
+                    getRoot(this_ptr).gc().writeBarrier(&this_ptr);
                 }
                 return ret;
             }
@@ -24,6 +24,7 @@
 
 #include "PropertyList.h"
 
+#include <map>
 #include <utility> 
 #include <boost/bind.hpp> 
 #include <boost/tuple/tuple.hpp>
@@ -34,8 +35,10 @@
 #include "as_function.h"
 #include "as_value.h" 
 #include "VM.h" 
+#include "movie_root.h"
 #include "string_table.h"
 #include "GnashAlgorithm.h"
+#include "namedStrings.h"
 
 // Define the following to enable printing address of each property added
 //#define DEBUG_PROPERTY_ALLOC
@@ -48,7 +51,6 @@
 
 #ifdef GNASH_STATS_PROPERTY_LOOKUPS
 # include "Stats.h"
-# include "namedStrings.h"
 #endif
 
 namespace gnash {
@@ -61,6 +63,9 @@ iterator_find(const PropertyList::container& p, const ObjectURI& uri, VM& vm)
 {
     const bool caseless = vm.getSWFVersion() < 7;
 
+#ifdef GNASH_FLAT_PROPERTIES
+    return p.find(uri, caseless);
+#else
     if (!caseless) {
         return p.project<PropertyList::CreationOrder>(
                 p.get<PropertyList::Case>().find(uri));
@@ -68,12 +73,66 @@ iterator_find(const PropertyList::container& p, const ObjectURI& uri, VM& vm)
         
     return p.project<PropertyList::CreationOrder>(
             p.get<PropertyList::NoCase>().find(uri));
+#endif
 }
 
+/// Return a stamp never returned before.
+inline boost::uint64_t
+nextStamp()
+{
+    static boost::uint64_t stamp = 0;
+    return ++stamp;
+}
+
+/// The stamp of an empty PropertyList.
+const boost::uint64_t emptyStamp = 0;
+
+/// A property added to a PropertyList with a given stamp.
+struct Transition
+{
+    bool operator<(const Transition& o) const {
+        if (from != o.from) return from < o.from;
+        if (name != o.name) return name < o.name;
+        if (flags != o.flags) return flags < o.flags;
+        return proto < o.proto;
+    }
+
+    boost::uint64_t from;
+    string_table::key name;
+    boost::uint16_t flags;
+
+    /// The object a new __proto__ refers to.
+    //
+    /// If it dies, so have all objects it was the __proto__ of, so a new
+    /// object at the same address sharing their stamp is harmless.
+    const as_object* proto;
+};
+
+typedef std::map<Transition, boost::uint64_t> Transitions;
+
+/// The stamps reached by adding properties to other stamps.
+Transitions&
+transitions()
+{
+    static Transitions t;
+    return t;
+}
+
+/// The most transitions remembered.
+const size_t maxTransitions = 16384;
+
+/// The largest PropertyList that shares its stamp.
+//
+/// Lists used as dictionaries would otherwise fill the transitions.
+const size_t maxShared = 32;
+
 }
     
 PropertyList::PropertyList(as_object& obj)
     :
+#ifdef GNASH_FLAT_PROPERTIES
+    _props(getStringTable(obj)),
+#else
     _props(boost::make_tuple(
                 boost::tuple<>(),
                 boost::make_tuple(
@@ -86,8 +145,57 @@ PropertyList::PropertyList(as_object& obj)
                 )
             )
         ),
-    _owner(obj)
+#endif
+    _owner(obj),
+    _stamp(emptyStamp),
+    _destructive(false)
+{
+}
+
+void
+PropertyList::touch()
 {
+    _stamp = nextStamp();
+}
+
+void
+PropertyList::added(const Property& p)
+{
+    if (_props.size() > maxShared) {
+        touch();
+        return;
+    }
+
+    Transition t;
+    t.from = _stamp;
+    t.name = getName(p.uri());
+    t.flags = p.getFlags().get_flags();
+    t.proto = 0;
+
+    if (t.name == NSV::PROP_uuPROTOuu) {
+        const as_value& proto = p.getCache();
+        if (!proto.is_object()) {
+            touch();
+            return;
+        }
+        t.proto = proto.get_object();
+    }
+
+    Transitions& ts = transitions();
+    Transitions::const_iterator it = ts.find(t);
+    if (it != ts.end()) {
+        _stamp = it->second;
+        return;
+    }
+
+    touch();
+    if (ts.size() < maxTransitions) ts.insert(std::make_pair(t, _stamp));
+}
+
+void
+PropertyList::writeBarrier() const
+{
+    getRoot(_owner).gc().writeBarrier(&_owner);
 }
 
 bool
@@ -101,6 +209,8 @@ PropertyList::setValue(const ObjectURI& uri, const as_value& val,
 		Property a(uri, val, flagsIfMissing);
 		// Non slot properties are negative ordering in insertion order
 		_props.push_back(a);
+        added(a);
+        writeBarrier();
 #ifdef GNASH_DEBUG_PROPERTY
         ObjectURI::Logger l(getStringTable(_owner));
         log_debug("Simple AS property %s inserted with flags %s",
@@ -110,6 +220,11 @@ PropertyList::setValue(const ObjectURI& uri, const as_value& val,
 	}
 
 	const Property& prop = *found;
+
+    // Changing __proto__ changes the inheritance chain.
+    if (getName(prop.uri()) == NSV::PROP_uuPROTOuu) touch();
+
+    writeBarrier();
 	return prop.setValue(_owner, val);
 
 }
@@ -122,6 +237,7 @@ PropertyList::setFlags(const ObjectURI& uri, int setFlags, int clearFlags)
     PropFlags f = found->getFlags();
     f.set_flags(setFlags, clearFlags);
 	found->setFlags(f);
+    touch();
 
 }
 
@@ -133,6 +249,7 @@ PropertyList::setFlagsAll(int setFlags, int clearFlags)
         f.set_flags(setFlags, clearFlags);
         it->setFlags(f);
     }
+    touch();
 }
 
 Property*
@@ -165,6 +282,7 @@ PropertyList::delProperty(const ObjectURI& uri)
 	}
 
 	_props.erase(found);
+    touch();
 	return std::make_pair(true, true);
 }
 
@@ -227,6 +345,8 @@ PropertyList::addGetterSetter(const ObjectURI& uri, as_function& getter,
 #endif
 	}
 
+    touch();
+    writeBarrier();
 	return true;
 }
 
@@ -260,6 +380,7 @@ PropertyList::addGetterSetter(const ObjectURI& uri, as_c_function_ptr getter,
 #endif
 	}
 
+    touch();
 	return true;
 }
 
@@ -280,6 +401,7 @@ PropertyList::addDestructiveGetter(const ObjectURI& uri, as_function& getter,
 	Property a(uri, &getter, 0, flagsIfMissing, true);
 
 	_props.push_back(a);
+    _destructive = true;
 
 #ifdef GNASH_DEBUG_PROPERTY
     ObjectURI::Logger l(getStringTable(_owner));
@@ -287,6 +409,8 @@ PropertyList::addDestructiveGetter(const ObjectURI& uri, as_function& getter,
             l(uri), a.getFlags());
 #endif
 
+    touch();
+    writeBarrier();
 	return true;
 }
 
@@ -300,12 +424,15 @@ PropertyList::addDestructiveGetter(const ObjectURI& uri,
 	// destructive getter doesn't need a setter
 	Property a(uri, getter, 0, flagsIfMissing, true);
 	_props.push_back(a);
+    _destructive = true;
 
 #ifdef GNASH_DEBUG_PROPERTY
     ObjectURI::Logger l(getStringTable(_owner));
     log_debug("Destructive native property %s with flags %s", l(uri),
             a.getFlags());
 #endif
+    touch();
+    writeBarrier();
 	return true;
 }
 
@@ -313,6 +440,7 @@ void
 PropertyList::clear()
 {
 	_props.clear();
+    touch();
 }
 
 } // namespace gnash
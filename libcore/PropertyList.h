@@ -19,6 +19,10 @@
 #ifndef GNASH_PROPERTYLIST_H
 #define GNASH_PROPERTYLIST_H
 
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h" // GNASH_FLAT_PROPERTIES
+#endif
+
 #include <set> 
 #include <string> // for use within map 
 #include <cassert> // for inlines
@@ -33,6 +37,7 @@
 #include <algorithm>
 
 #include "Property.h" // for templated functions
+#include "FlatPropertyContainer.h"
 
 // Forward declaration
 namespace gnash {
@@ -118,10 +123,14 @@ public:
         ObjectURI::CaseLessThan> NoCaseIndex;
 
     /// The container of the Properties.
+#ifdef GNASH_FLAT_PROPERTIES
+    typedef FlatPropertyContainer container;
+#else
     typedef boost::multi_index_container<
         value_type,
         boost::multi_index::indexed_by<SequencedIndex, CaseIndex, NoCaseIndex>
         > container;
+#endif
 
     typedef container::iterator iterator;
     typedef container::const_iterator const_iterator;
@@ -288,6 +297,33 @@ public:
     /// lexicographically by property.
     void dump();
 
+    /// Return a stamp identifying the current layout of this PropertyList
+    //
+    /// PropertyLists that had the same properties added in the same order,
+    /// with the same flags and the same __proto__ object, share a stamp,
+    /// so that lookups cached for one object serve all objects of its
+    /// class. Any other change to the properties, their flags or __proto__
+    /// gives a stamp never returned before.
+    boost::uint64_t stamp() const {
+        return _stamp;
+    }
+
+    /// Invalidate any lookups cached against this PropertyList
+    void touch();
+
+    /// Tell the collector that the owner may reference a new resource
+    //
+    /// This must be called when a value is stored in a Property without
+    /// going through this PropertyList.
+    void writeBarrier() const;
+
+    /// Whether a destructive getter was ever added
+    //
+    /// A destructive getter stores its result without a write barrier.
+    bool hadDestructiveGetters() const {
+        return _destructive;
+    }
+
     /// Mark all properties reachable
     //
     /// This can be called very frequently, so is inlined to allow the
@@ -299,10 +335,17 @@ public:
 
 private:
 
+    /// Give the stamp shared by lists that just had this property added.
+    void added(const Property& p);
+
     container _props;
 
     as_object& _owner;
 
+    boost::uint64_t _stamp;
+
+    bool _destructive;
+
 };
 
 
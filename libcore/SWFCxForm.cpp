@@ -23,6 +23,7 @@
 #include "RGBA.h" 
 #include "log.h"
 #include "GnashNumeric.h"
+#include "PixelOps.h"
 
 namespace gnash {
 
@@ -76,6 +77,14 @@ SWFCxForm::transform(boost::uint8_t& r, boost::uint8_t& g, boost::uint8_t& b,
     a = clamp<boost::int16_t>(at, 0, 255);
 }
 
+void
+SWFCxForm::transform(boost::uint8_t* rgba, size_t pixels) const
+{
+    const boost::int16_t mult[] = { ra, ga, ba, aa };
+    const boost::int16_t add[] = { rb, gb, bb, ab };
+    image::transformRGBA(rgba, pixels, mult, add);
+}
+
 std::ostream&
 operator<<(std::ostream& os, const SWFCxForm& cx) 
 {
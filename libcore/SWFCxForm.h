@@ -72,6 +72,11 @@ public:
     /// Transform the given color.
     void transform(boost::uint8_t& r, boost::uint8_t& g, boost::uint8_t& b,
             boost::uint8_t& a) const;    
+
+    /// Transform a span of RGBA pixels in place.
+    //
+    /// This gives the same results as transforming each pixel separately.
+    void transform(boost::uint8_t* rgba, size_t pixels) const;
     
 };
 
@@ -28,6 +28,7 @@
 
 #include <cstring>
 #include <climits>
+#include <algorithm>
 #include <boost/static_assert.hpp>
 
 //#define USE_TU_FILE_BYTESWAPPING 1
@@ -37,8 +38,11 @@ namespace gnash {
 SWFStream::SWFStream(IOChannel* input)
     :
     m_input(input),
-    m_current_byte(0),
-    m_unused_bits(0)
+    _data(input->data()),
+    _dataSize(_data ? input->size() : 0),
+    _bits(0),
+    _bitCount(0),
+    _bitsEnd(0)
 {
 }
 
@@ -83,129 +87,130 @@ unsigned SWFStream::read(char *buf, unsigned count)
 
     if ( ! count ) return 0;
 
-    return m_input->read(buf, count);
-}
+    // Bytes loaded for bitwise reads come first.
+    unsigned got = 0;
+    while (_bitCount && got < count) buf[got++] = takeBits(8);
+    if (got == count) return got;
 
-bool SWFStream::read_bit()
-{
-    if (!m_unused_bits)
-    {
-        m_current_byte = m_input->read_byte(); // don't want to align here
-        m_unused_bits = 7;
-        return (m_current_byte&0x80);
-    }
-    else
-    {
-        return ( m_current_byte & (1<<(--m_unused_bits)) );
-    }
+    const std::streamsize more = m_input->read(buf + got, count - got);
+    return more > 0 ? got + more : got;
 }
 
-unsigned SWFStream::read_uint(unsigned short bitcount)
+boost::shared_ptr<const boost::uint8_t>
+SWFStream::readShared(size_t& count)
 {
-    // htf_sweet.swf fails when this is set to 24. There seems to
-    // be no reason why this should be limited to 32 other than
-    // that it is higher than a movie is likely to need.
-    if (bitcount > 32)
-    {
-        // This might overflow a uint32_t or attempt to read outside
-        // the byte cache (relies on there being only 4 bytes after
-        // possible unused bits.)
-        throw ParserException("Unexpectedly long value advertised.");
-    }
-
-    // Optimization for multibyte read
-    if ( bitcount > m_unused_bits )
-    {
-        typedef unsigned char byte;
-
-        boost::uint32_t value = 0;
+    align();
 
-        if (m_unused_bits) // Consume all the unused bits.
-        {
-            int unusedMask = (1 << m_unused_bits)-1;
-            bitcount -= m_unused_bits; 
-            value |= ((m_current_byte&unusedMask) << bitcount);
-        }
+    const unsigned long pos = tell();
 
-        int bytesToRead = bitcount/8;
-        int spareBits = bitcount%8; // additional bits to read
+    // Don't read outside the current tag.
+    if (!_tagBoundsStack.empty()) {
+        const unsigned long endPos = _tagBoundsStack.back().second;
+        assert(endPos >= pos);
+        count = std::min<size_t>(count, endPos - pos);
+    }
 
-        //std::cerr << "BytesToRead: " << bytesToRead << " spareBits: " << spareBits << " unusedBits: " << (int)m_unused_bits << std::endl;
+    if (!count) return boost::shared_ptr<const boost::uint8_t>();
 
-        assert (bytesToRead <= 4);
-        byte cache[4]; // at most 4 bytes in the cache
+    const boost::shared_ptr<const boost::uint8_t> data = m_input->data();
+    if (data && pos + count <= m_input->size() && seek(pos + count)) {
+        return boost::shared_ptr<const boost::uint8_t>(data, data.get() + pos);
+    }
 
-        if ( spareBits ) m_input->read(&cache, bytesToRead+1);
-        else m_input->read(&cache, bytesToRead);
+    boost::shared_ptr<std::vector<boost::uint8_t> > copy(
+            new std::vector<boost::uint8_t>(count));
+    count = read(reinterpret_cast<char*>(&copy->front()), count);
+    if (!count) return boost::shared_ptr<const boost::uint8_t>();
+    return boost::shared_ptr<const boost::uint8_t>(copy, &copy->front());
+}
 
-        for (int i=0; i<bytesToRead; ++i)
-        {
-            bitcount -= 8;
-            value |= cache[i] << bitcount; 
-        }
+void
+SWFStream::fillBits(unsigned needed)
+{
+    const size_t pos = m_input->tell();
 
-        //assert(bitcount == spareBits);
-        if ( bitcount )
-        {
-            m_current_byte = cache[bytesToRead];
-            m_unused_bits = 8-bitcount;
-            value |= m_current_byte >> m_unused_bits;
-        }
-        else
-        {
-            m_unused_bits = 0;
-        }
+    // Anything after the bits is already in the input.
+    if (!_bitCount) _bits = 0;
 
-        return value;
-        
+    size_t bytes = (63 - _bitCount) / 8;
+    const size_t wanted = (needed - _bitCount + 7) / 8;
+    if (_tagBoundsStack.empty()) {
+        bytes = std::min(bytes, wanted);
     }
-
-    if (!m_unused_bits)
-    {
-        m_current_byte = m_input->read_byte();
-        m_unused_bits = 8;
+    else {
+        const unsigned long end = _tagBoundsStack.back().second;
+        const size_t inTag = end > pos ? end - pos : 0;
+        bytes = std::min(bytes, std::max(inTag, wanted));
     }
 
-    // TODO: optimize unusedMask creation ?
-    //       (it's 0xFF if ! m_unused_bits above)
-    int unusedMask = (1 << m_unused_bits)-1;
+    if (_data) {
+        if (pos >= _dataSize) return;
+        const boost::uint8_t* p = _data.get() + pos;
 
-    if (bitcount == m_unused_bits)
-    {
-        // Consume all the unused bits.
-        m_unused_bits = 0;
-        return (m_current_byte&unusedMask);
+        if (_dataSize - pos >= 8) {
+            // This may also set some bits of the bytes after the last one
+            // loaded. They are set again to the same value next time.
+            boost::uint64_t word = 0;
+            for (size_t i = 0; i < 8; ++i) word = (word << 8) | p[i];
+            _bits |= word >> _bitCount;
+        }
+        else {
+            bytes = std::min(bytes, _dataSize - pos);
+            for (size_t i = 0; i < bytes; ++i) {
+                _bits |= static_cast<boost::uint64_t>(p[i]) <<
+                    (56 - _bitCount - 8 * i);
+            }
+        }
+        m_input->seek(pos + bytes);
     }
-    else
-    {
-        assert(bitcount < m_unused_bits);
-        // Consume some of the unused bits.
-
-        m_unused_bits -= bitcount;
-        return ((m_current_byte&unusedMask) >> m_unused_bits);
+    else {
+        boost::uint8_t buf[8];
+        const std::streamsize got = m_input->read(buf, bytes);
+        bytes = got > 0 ? got : 0;
+        for (size_t i = 0; i < bytes; ++i) {
+            _bits |= static_cast<boost::uint64_t>(buf[i]) <<
+                (56 - _bitCount - 8 * i);
+        }
     }
 
+    _bitCount += bytes * 8;
+    _bitsEnd = pos + bytes;
 }
 
-
-int
-SWFStream::read_sint(unsigned short bitcount)
+void
+SWFStream::returnBits()
 {
-    //assert(bitcount <= 32); // already asserted in read_uint
+    if (_data) {
+        m_input->seek(_bitsEnd - _bitCount / 8);
+        _bits = 0;
+        _bitCount = 0;
+        return;
+    }
 
-    boost::int32_t value = boost::int32_t(read_uint(bitcount));
+    const unsigned spare = _bitCount % 8;
+    _bits <<= spare;
+    _bitCount -= spare;
+}
 
-    // Sign extend...
-    if (value & (1 << (bitcount - 1))) {
-        value |= -1 << bitcount;
+unsigned
+SWFStream::readBits(unsigned short bitcount)
+{
+    // htf_sweet.swf fails when this is set to 24. There seems to
+    // be no reason why this should be limited to 32 other than
+    // that it is higher than a movie is likely to need.
+    if (bitcount > 32)
+    {
+        // This might overflow a uint32_t.
+        throw ParserException("Unexpectedly long value advertised.");
     }
 
-//        IF_DEBUG(log_debug("SWFStream::read_sint(%d) == %d\n", bitcount, value)));
-
-    return value;
+    fillBits(bitcount);
+    if (bitcount > _bitCount) {
+        throw ParserException(_("Unexpected end of stream while reading"));
+    }
+    return takeBits(bitcount);
 }
 
-
 float    SWFStream::read_fixed()
 {
     // align(); // read_u32 will align 
@@ -327,6 +332,7 @@ double SWFStream::read_d64()
 boost::uint8_t    SWFStream::read_u8()
 {
     align();
+    if (_bitCount) return takeBits(8);
     return m_input->read_byte();
 }
 
@@ -341,8 +347,8 @@ boost::uint16_t SWFStream::read_u16()
 {
 #ifdef USE_TU_FILE_BYTESWAPPING 
     align();
-    return m_input->read_le16();
-#else
+    if (!_bitCount) return m_input->read_le16();
+#endif
     const unsigned short dataLength = 2;
 
     unsigned char buf[dataLength];
@@ -357,7 +363,6 @@ boost::uint16_t SWFStream::read_u16()
     result |= (buf[1] << 8);
 
     return result;
-#endif
 }
 
 boost::int16_t SWFStream::read_s16()
@@ -370,8 +375,8 @@ boost::uint32_t    SWFStream::read_u32()
 {
 #ifdef USE_TU_FILE_BYTESWAPPING 
     align();
-    return m_input->read_le32();
-#else
+    if (!_bitCount) return m_input->read_le32();
+#endif
     using boost::uint32_t;
 
     const unsigned short dataLength = 4;
@@ -390,7 +395,6 @@ boost::uint32_t    SWFStream::read_u32()
          result |= buf[3] << 24;
 
     return result;
-#endif
 }
 
 boost::int32_t    SWFStream::read_s32()
@@ -456,7 +460,8 @@ SWFStream::tell()
 {
     int pos = m_input->tell();
     // TODO: check return value? Could be negative.
-    return static_cast<unsigned long>(pos);
+    // Whole bytes read ahead for bitwise reads haven't been used yet.
+    return static_cast<unsigned long>(pos) - _bitCount / 8;
 }
 
 
@@ -487,6 +492,9 @@ SWFStream::seek(unsigned long pos)
         }
     }
 
+    // Bytes loaded for bitwise reads are dropped.
+    _bitCount = 0;
+
     // Do the seek.
     if (!m_input->seek(pos))
     {
@@ -521,7 +529,7 @@ SWFStream::open_tag()
     int tagHeader = read_u16();
     int tagType = tagHeader >> 6;
     int tagLength = tagHeader & 0x3F;
-    assert(m_unused_bits == 0);
+    assert(!(_bitCount % 8));
         
     if (tagLength == 0x3F)
     {
@@ -602,7 +610,7 @@ SWFStream::close_tag()
         throw ParserException(_("Could not seek to reported end of tag"));
     }
 
-    m_unused_bits = 0;
+    _bitCount = 0;
 }
 
 void
@@ -610,6 +618,7 @@ SWFStream::consumeInput()
 {
 	// IOChannel::go_to_end is documented
 	// to possibly throw an exception (!)
+	_bitCount = 0;
 	try {
 		m_input->go_to_end();
 	}
@@ -28,6 +28,7 @@
 #include <sstream>
 #include <vector> // for composition
 #include <boost/cstdint.hpp> // for boost::?int??_t 
+#include <boost/shared_ptr.hpp>
 
 // Define the following macro if you want to want Gnash parser
 // to assume the underlying SWF is well-formed. It would make
@@ -68,7 +69,13 @@ public:
 	//
 	/// bitwise read
 	///
-	unsigned read_uint(unsigned short bitcount);
+	unsigned read_uint(unsigned short bitcount)
+	{
+		if (bitcount <= _bitCount && bitcount <= 32) {
+			return takeBits(bitcount);
+		}
+		return readBits(bitcount);
+	}
 
 	/// \brief
 	/// Reads a single bit off the stream
@@ -76,7 +83,10 @@ public:
 	//
 	/// bitwise read
 	///
-	bool read_bit();
+	bool read_bit()
+	{
+		return read_uint(1);
+	}
 
 	/// \brief
 	/// Reads a bit-packed little-endian signed integer
@@ -85,7 +95,16 @@ public:
 	//
 	/// bitwise read
 	///
-	int	read_sint(unsigned short bitcount);
+	int	read_sint(unsigned short bitcount)
+	{
+		boost::int32_t value = read_uint(bitcount);
+
+		// Sign extend...
+		if (bitcount && bitcount < 32 && (value & (1 << (bitcount - 1)))) {
+			value |= ~0u << bitcount;
+		}
+		return value;
+	}
 
 	/// Read a 16.16 fixed point signed value
 	//
@@ -140,8 +159,7 @@ public:
 	///
 	void	align()
 	{
-		m_unused_bits=0;
-		// m_current_byte = 0; // this is not needed
+		if (_bitCount) returnBits();
 	}
 
 	/// Read <count> bytes from the source stream and copy that data to <buf>.
@@ -149,6 +167,24 @@ public:
 	/// aligned read
 	///
 	unsigned read(char *buf, unsigned count);
+
+	/// Read <count> bytes without copying them if possible.
+	//
+	/// If the input is in memory (see IOChannel::data()) the returned
+	/// pointer shares it. Otherwise the bytes are copied into a new
+	/// buffer. Either way they stay valid as long as a copy of the
+	/// pointer exists.
+	///
+	/// aligned read
+	///
+	/// @param count
+	///	The number of bytes to read. On return, the number of bytes
+	///	actually read, which is fewer at the end of the current tag
+	///	or of the input.
+	///
+	/// @return the bytes, or an empty pointer if none were read.
+	///
+	boost::shared_ptr<const boost::uint8_t> readShared(size_t& count);
 	
 	/// Read a aligned unsigned 8-bit value from the stream.		
 	//
@@ -389,8 +425,11 @@ public:
 	{
 #ifndef GNASH_TRUST_SWF_INPUT
 		if ( _tagBoundsStack.empty() ) return; // not in a tag (should we check file length ?)
+		// Bits loaded from inside the tag need no other check.
+		if (needed <= _bitCount &&
+				_bitsEnd <= _tagBoundsStack.back().second) return;
 		unsigned long int bytesLeft = get_tag_end_position() - tell();
-		unsigned long int bitsLeft = (bytesLeft*8)+m_unused_bits;
+		unsigned long int bitsLeft = (bytesLeft*8)+(_bitCount%8);
 		if ( bitsLeft < needed )
 		{
 			std::stringstream ss;
@@ -420,9 +459,55 @@ public:
 
 private:
 
+	/// Take bits from the start of _bits.
+	unsigned takeBits(unsigned bitcount)
+	{
+		const unsigned value = bitcount ? _bits >> (64 - bitcount) : 0;
+		_bits <<= bitcount;
+		_bitCount -= bitcount;
+		return value;
+	}
+
+	/// Read bits when _bits doesn't have enough.
+	unsigned readBits(unsigned short bitcount);
+
+	/// Load whole bytes from the input into _bits.
+	//
+	/// As many bytes as fit are loaded, but none after the end of the
+	/// current tag unless they are needed: the rest of the input may
+	/// not have arrived yet.
+	//
+	/// @param needed   The number of bits wanted in _bits.
+	void fillBits(unsigned needed);
+
+	/// Drop the bits left of a partly read byte.
+	//
+	/// Whole bytes left in _bits are given back to a mapped input.
+	/// Others can't go back cheaply, so the bytes are kept for the next
+	/// aligned reads.
+	void returnBits();
+
 	IOChannel*	m_input;
-	boost::uint8_t	m_current_byte;
-	boost::uint8_t	m_unused_bits;
+
+	/// The input's data, if it is in memory.
+	//
+	/// Bits are then loaded from here 64 at a time, without a call to
+	/// the input.
+	const boost::shared_ptr<const boost::uint8_t> _data;
+
+	/// The size of the input's data.
+	const size_t _dataSize;
+
+	/// Bits read ahead from the input, the next to be read highest.
+	//
+	/// The input is positioned after the last byte loaded.
+	boost::uint64_t _bits;
+
+	/// The number of bits in _bits.
+	unsigned _bitCount;
+
+	/// The input position after the last byte loaded into _bits.
+	unsigned long _bitsEnd;
 
 	typedef std::pair<unsigned long,unsigned long> TagBoundaries;
 	// position of start and end of tag
@@ -64,6 +64,9 @@ Video::Video(as_object* object,
 
     try {
 	    _decoder = mh->createVideoDecoder(*info);
+	    const Renderer* renderer = getRunResources(*object).renderer();
+	    if (renderer && renderer->drawsYUVVideo()) _decoder->allowYUV();
+	    _decoder->setBufferPool(mh->bufferPool());
 	}
 	catch (const MediaException& e) {
 	    log_error(_("Could not create Video Decoder: %s"), e.what());
@@ -600,6 +600,7 @@ setLocal(as_object& locals, const std::string& varname, const as_value& val)
 {
     Property* prop = locals.getOwnProperty(getURI(getVM(locals), varname));
     if (!prop) return false;
+    locals.writeBarrier();
     prop->setValue(locals, val);
     return true;
 }
@@ -361,6 +361,7 @@ as_object::add_property(const std::string& name, as_function& getter,
                 log_debug("Property %s deleted by trigger on create (getter-setter)", name);
                 return;
             }
+            _members.writeBarrier();
             prop->setCache(v);
         }
         return;
@@ -538,6 +539,7 @@ as_object::executeTriggers(Property* prop, const ObjectURI& uri,
     // the property.
     if (!_trigs.get() || (trigIter = _trigs->find(uri)) == _trigs->end()) {
         if (prop) {
+            _members.writeBarrier();
             prop->setValue(*this, val);
             prop->clearVisible(getSWFVersion(*this));
         }
@@ -567,6 +569,7 @@ as_object::executeTriggers(Property* prop, const ObjectURI& uri,
     prop = findUpdatableProperty(uri);
     if (!prop) return;
 
+    _members.writeBarrier();
     prop->setValue(*this, newVal); 
     prop->clearVisible(getSWFVersion(*this));
     
@@ -629,6 +632,9 @@ as_object::set_member(const ObjectURI& uri, const as_value& val, bool ifFound)
                 );
             return true;
         }
+
+        // Setting __proto__ changes the inheritance chain.
+        if (getName(prop->uri()) == NSV::PROP_uuPROTOuu) _members.touch();
             
         try {
             executeTriggers(prop, uri, val);
@@ -763,6 +769,7 @@ as_object::addInterface(as_object* obj)
     if (std::find(_interfaces.begin(), _interfaces.end(), obj) ==
         _interfaces.end()) {
         _interfaces.push_back(obj);
+        _members.writeBarrier();
     }
 }
 
@@ -977,6 +984,7 @@ as_object::watch(const ObjectURI& uri, as_function& trig,
     std::string propname = getStringTable(*this).value(getName(uri));
 
     if (!_trigs.get()) _trigs.reset(new TriggerContainer);
+    _members.writeBarrier();
 
     TriggerContainer::iterator it = _trigs->find(uri);
     if (it == _trigs->end()) {
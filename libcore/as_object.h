@@ -457,6 +457,14 @@ public:
     ///                 contain the named property.
     Property* getOwnProperty(const ObjectURI& uri);
 
+    /// Tell the collector that a value was stored in an own Property
+    //
+    /// Call this before storing a value through a pointer returned by
+    /// getOwnProperty(), or the incremental collector may miss it.
+    void writeBarrier() const {
+        _members.writeBarrier();
+    }
+
     /// Set member flags (probably used by ASSetPropFlags)
     //
     /// @param name     Name of the property. Must be all lowercase
@@ -604,6 +612,7 @@ public:
         if (p) _array = false;
         if (_relay) _relay->clean();
         _relay.reset(p);
+        _members.writeBarrier();
     }
 
     /// Access the as_object's Relay object.
@@ -666,6 +675,15 @@ protected:
     /// this function directly as the last step.
     virtual void markReachableResources() const;
 
+    /// Properties, watches and interfaces have write barriers, Relays and
+    /// destructive getters do not
+    //
+    /// Derived classes that change their references after construction
+    /// must override this.
+    virtual bool hasWriteBarriers() const {
+        return !_relay.get() && !_members.hadDestructiveGetters();
+    }
+
 private:
 
     /// Find an existing property for update
@@ -687,6 +705,9 @@ private:
     /// A utility class for processing this as_object's inheritance chain
     template<typename T> class PrototypeRecursor;
 
+    /// MemberCache validates its entries against the PropertyList stamps.
+    friend class MemberCache;
+
     /// DisplayObjects have properties not in the AS inheritance chain
     //
     /// These magic properties are invoked in get_member only if the
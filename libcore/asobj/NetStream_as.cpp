@@ -28,8 +28,10 @@
 #include <algorithm>
 #include <boost/cstdint.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/bind.hpp>
 
 #include "RunResources.h"
+#include "Renderer.h"
 #include "CharacterProxy.h"
 #include "log.h"
 #include "fn_call.h"
@@ -89,6 +91,13 @@ namespace {
 
     // TODO: see where this can be done more centrally.
     void executeTag(const SimpleBuffer& _buffer, as_object& thisPtr);
+
+    /// The number of decoded audio buffers the sound handler can have
+    /// queued. pushDecodedAudioFrames() keeps it well below this.
+    const size_t maxQueuedBuffers = 64;
+
+    /// The number of video frames decoded ahead of the playhead.
+    const size_t maxDecodedAhead = 4;
 }
 
 /// Contruct a NetStream object.
@@ -344,6 +353,7 @@ NetStream_as::close()
 
     // Drop all information about decoders and parser
     _videoInfoKnown = false;
+    _videoDecoderThread.reset();
     _videoDecoder.reset();
     _audioInfoKnown = false;
     _audioDecoder.reset();
@@ -426,6 +436,10 @@ NetStream_as::initVideoDecoder(const media::VideoInfo& info)
     try {
         _videoDecoder = _mediaHandler->createVideoDecoder(info);
         assert ( _videoDecoder.get() ); 
+        const Renderer* renderer = getRunResources(owner()).renderer();
+        if (renderer && renderer->drawsYUVVideo()) _videoDecoder->allowYUV();
+        _videoDecoder->setBufferPool(_mediaHandler->bufferPool());
+        _videoDecoderThread.reset(new VideoDecoderThread(*_videoDecoder));
         log_debug(_("NetStream_as::initVideoDecoder: hot-plugging "
                     "video consumer"));
         _playHead.setVideoConsumerAvailable();
@@ -455,6 +469,7 @@ NetStream_as::initAudioDecoder(const media::AudioInfo& info)
     try {
         _audioDecoder = _mediaHandler->createAudioDecoder(info);
         assert ( _audioDecoder.get() );
+        _audioDecoder->setBufferPool(_mediaHandler->bufferPool());
         log_debug(_("NetStream_as::initAudioDecoder: hot-plugging "
                     "audio consumer"));
         _playHead.setAudioConsumerAvailable();
@@ -547,9 +562,9 @@ NetStream_as::startPlayback()
 
 
 std::auto_ptr<image::GnashImage> 
-NetStream_as::getDecodedVideoFrame(boost::uint32_t ts)
+NetStream_as::getDecodedVideoFrame(boost::uint32_t ts, bool wait)
 {
-    assert(_videoDecoder.get());
+    assert(_videoDecoderThread.get());
     
     std::auto_ptr<image::GnashImage> video;
 
@@ -560,108 +575,34 @@ NetStream_as::getDecodedVideoFrame(boost::uint32_t ts)
         return video; 
     }
 
-#if MEDIA_CONFIG == none
-    boost::uint64_t nextTimestamp;
+    // Keep the decoding thread busy with the frames after this one.
+    while (!_videoDecoderThread->full()) {
+        std::auto_ptr<media::EncodedVideoFrame> frame =
+            _parser->nextVideoFrame();
+        if (!frame.get()) break;
+        _videoDecoderThread->push(frame);
+    }
+
+    video = _videoDecoderThread->pop(ts, wait);
+    if (video.get() || _videoDecoderThread->pending()) return video;
+
     bool parsingComplete = _parser->parsingCompleted();
-    if (!_parser->nextVideoFrameTimestamp(nextTimestamp)) {
-#endif
         
 #ifdef GNASH_DEBUG_DECODING
-        log_debug(_("getDecodedVideoFrame(%d): "
-                    "no more video frames in input "
-                    "(nextVideoFrameTimestamp returned false, "
-                    "parsingComplete=%d)"),
-            ts, parsingComplete);
+    log_debug(_("getDecodedVideoFrame(%d): "
+                "no more video frames in input "
+                "(parsingComplete=%d)"),
+        ts, parsingComplete);
 #endif 
 
-        if (parsingComplete && _parser->isBufferEmpty()) {
+    if (parsingComplete && _parser->isBufferEmpty()) {
 
-            decodingStatus(DEC_STOPPED);
+        decodingStatus(DEC_STOPPED);
 #ifdef GNASH_DEBUG_STATUS
-            log_debug(_("getDecodedVideoFrame setting playStop status "
-                    "(parsing complete and nextVideoFrameTimestamp() "
-                        "returned false)"));
+        log_debug(_("getDecodedVideoFrame setting playStop status "
+                "(parsing complete and no video frames pending)"));
 #endif
-            setStatus(playStop);
-        }
-        return video;
-    }
-
-    if (nextTimestamp > ts) {
-#ifdef GNASH_DEBUG_DECODING
-        log_debug(_("%p.getDecodedVideoFrame(%d): next video frame is in "
-                  "the future (%d)"), this, ts, nextTimestamp);
-#endif 
-        // next frame is in the future
-        return video; 
-    }
-
-    // Loop until a good frame is found
-    while (1) {
-        video = decodeNextVideoFrame();
-        if (!video.get()) {
-            log_error(_("nextVideoFrameTimestamp returned true (%d), "
-                        "but decodeNextVideoFrame returned null, "
-                        "I don't think this should ever happen"),
-                      nextTimestamp);
-            break;
-        }
-
-        if (!_parser->nextVideoFrameTimestamp(nextTimestamp)) {
-            // the one we decoded was the last one
-#ifdef GNASH_DEBUG_DECODING
-            log_debug(_("%p.getDecodedVideoFrame(%d): last video frame decoded "
-                        "(should set playback status to STOP?)"), this, ts);
-#endif 
-            break;
-        }
-        if (nextTimestamp > ts) {
-            // the next one is in the future, we'll return this one.
-#ifdef GNASH_DEBUG_DECODING
-            log_debug(_("%p.getDecodedVideoFrame(%d): "
-                "next video frame is in the future, "
-                        "we'll return this one"),
-                this, ts);
-#endif 
-            break; 
-        }
-    }
-#endif  // USE_MEDIA
-    
-    return video;
-}
-
-std::auto_ptr<image::GnashImage> 
-NetStream_as::decodeNextVideoFrame()
-{
-    std::auto_ptr<image::GnashImage> video;
-
-#ifdef USE_MEDIA
-    if (!_parser.get()) {
-        log_error(_("decodeNextVideoFrame: no parser available"));
-        return video; 
-    }
-
-    std::auto_ptr<media::EncodedVideoFrame> frame = _parser->nextVideoFrame(); 
-    if (!frame.get()) {
-#ifdef GNASH_DEBUG_DECODING
-        log_debug(_("%p.decodeNextVideoFrame(): "
-                  "no more video frames in input"),
-            this);
-#endif 
-        return video;
-    }
-
-    assert(_videoDecoder.get()); 
-    
-    // everything we push, we'll pop too..
-    assert(!_videoDecoder->peek()); 
-
-    _videoDecoder->push(*frame);
-    video = _videoDecoder->pop();
-    if (!video.get()) {
-        // TODO: tell more about the failure
-        log_error(_("Error decoding encoded video frame in NetStream input"));
+        setStatus(playStop);
     }
 #endif  // USE_MEDIA
     
@@ -685,9 +626,11 @@ NetStream_as::decodeNextAudioFrame()
                     "no more video frames in input"),
                     this);
 #endif
+        delete raw;
         return 0;
     }
 
+    raw->m_pool = _mediaHandler->bufferPool();
     raw->m_data = _audioDecoder->decode(*frame, raw->m_size);
 
     // TODO: let the sound_handler do this .. sounds cleaner
@@ -759,6 +702,9 @@ NetStream_as::seek(boost::uint32_t posSeconds)
 
         // cleanup audio queue, so won't be consumed while seeking
     _audioStreamer.cleanAudioQueue();
+
+    // Frames being decoded are from before the seek
+    if (_videoDecoderThread.get()) _videoDecoderThread->flush();
     
     // 'newpos' will always be on a keyframe (supposedly)
 #ifdef GNASH_DEBUG_PLAYHEAD
@@ -887,9 +833,6 @@ NetStream_as::pushDecodedAudioFrames(boost::uint32_t ts)
     boost::uint64_t nextTimestamp;
     while (1) {
 
-        // FIXME: use services of BufferedAudioStreamer for this
-        boost::mutex::scoped_lock lock(_audioStreamer._audioQueueMutex);
-
         // The sound_handler mixer will pull decoded
         // audio frames off the _audioQueue whenever 
         // new audio has to be played.
@@ -944,7 +887,7 @@ NetStream_as::pushDecodedAudioFrames(boost::uint32_t ts)
         double msecsPerAdvance = 10000/swfFPS;
 
         const unsigned int bufferLimit = 20;
-        unsigned int bufferSize = _audioStreamer._audioQueue.size();
+        unsigned int bufferSize = _audioStreamer.queuedBuffers();
         if (bufferSize > bufferLimit) {
 
             // we won't buffer more then 'bufferLimit' frames in the queue
@@ -968,9 +911,6 @@ NetStream_as::pushDecodedAudioFrames(boost::uint32_t ts)
 
             return;
         }
-        
-        // no need to keep the audio queue locked while decoding.
-        lock.unlock();
 
         bool parsingComplete = _parser->parsingCompleted();
         if (!_parser->nextAudioFrameTimestamp(nextTimestamp)) {
@@ -1031,7 +971,7 @@ NetStream_as::pushDecodedAudioFrames(boost::uint32_t ts)
         // this one we might avoid :) -- a less intrusive logging could
         // be take note about how many things we're pushing over
         log_debug(_("pushDecodedAudioFrames(%d) pushing %dth frame with "
-                    "timestamp %d"), ts, _audioStreamer._audioQueue.size()+1,
+                    "timestamp %d"), ts, _audioStreamer.queuedBuffers()+1,
                 nextTimestamp); 
 #endif
 
@@ -1140,8 +1080,10 @@ NetStream_as::refreshVideoFrame(bool alsoIfPaused)
             this, curPos, _playHead.getState(), bufferLen, _bufferTime);
 #endif 
 
-    // Get next decoded video frame from parser, will have the lowest timestamp
-    std::auto_ptr<image::GnashImage> video = getDecodedVideoFrame(curPos);
+    // Get the latest decoded video frame due. Only wait for the decoding
+    // thread if there would be nothing to show otherwise.
+    const bool wait = alsoIfPaused || !_imageframe.get();
+    std::auto_ptr<image::GnashImage> video = getDecodedVideoFrame(curPos, wait);
 
     // to be decoded or we're out of data
     if (!video.get())
@@ -1189,15 +1131,15 @@ NetStream_as::refreshVideoFrame(bool alsoIfPaused)
 int
 NetStream_as::videoHeight() const
 {
-    if (!_videoDecoder.get()) return 0;
-    return _videoDecoder->height();
+    if (!_videoDecoderThread.get()) return 0;
+    return _videoDecoderThread->height();
 }
 
 int
 NetStream_as::videoWidth() const
 {
-    if (!_videoDecoder.get()) return 0;
-    return _videoDecoder->width();
+    if (!_videoDecoderThread.get()) return 0;
+    return _videoDecoderThread->width();
 }
 
 
@@ -1338,10 +1280,7 @@ NetStream_as::update()
     //
     if ( ! _parser->getVideoInfo() ) 
     {
-        // FIXME: use services of BufferedAudioStreamer for this
-        boost::mutex::scoped_lock lock(_audioStreamer._audioQueueMutex);
-        bool emptyAudioQueue = _audioStreamer._audioQueue.empty();
-        lock.unlock();
+        bool emptyAudioQueue = !_audioStreamer.queuedBuffers();
 
         if ( emptyAudioQueue )
         {
@@ -1493,12 +1432,24 @@ BufferedAudioStreamer::fetchWrapper(void *owner, boost::int16_t* samples,
 BufferedAudioStreamer::BufferedAudioStreamer(sound::sound_handler* handler)
     :
     _soundHandler(handler),
-    _audioQueue(),
+    _audioQueue(maxQueuedBuffers),
+    _consumed(maxQueuedBuffers),
     _audioQueueSize(0),
+    _pushed(0),
+    _fetched(0),
+    _flushTo(0),
     _auxStreamer(0)
 {
 }
 
+BufferedAudioStreamer::~BufferedAudioStreamer()
+{
+    assert(!_auxStreamer);
+    do {
+        reclaim();
+    } while (release());
+}
+
 unsigned int
 BufferedAudioStreamer::fetch(boost::int16_t* samples, unsigned int nSamples, bool& eof)
 {
@@ -1507,23 +1458,24 @@ BufferedAudioStreamer::fetch(boost::int16_t* samples, unsigned int nSamples, boo
     boost::uint8_t* stream = reinterpret_cast<boost::uint8_t*>(samples);
     int len = nSamples*2;
 
-    boost::mutex::scoped_lock lock(_audioQueueMutex);
-
 #if 0
     log_debug("audio_streamer called, audioQueue size: %d, "
                 "requested %d bytes of fill-up",
         _audioQueue.size(), len);
 #endif
 
+    // Drop what was queued before the last cleanAudioQueue().
+    const size_t flushTo = _flushTo.load(boost::memory_order_acquire);
+    while (static_cast<std::ptrdiff_t>(flushTo - _fetched.load()) > 0) {
+        if (!release()) break;
+    }
 
     while (len)
     {
-        if ( _audioQueue.empty() )
-        {
-            break;
-        }
+        CursoredBuffer* const* front = _audioQueue.front();
+        if (!front) break;
 
-        CursoredBuffer& samples = _audioQueue.front();
+        CursoredBuffer& samples = **front;
 
         assert( ! (samples.m_size%2) ); 
         int n = std::min<int>(samples.m_size, len);
@@ -1534,12 +1486,9 @@ BufferedAudioStreamer::fetch(boost::int16_t* samples, unsigned int nSamples, boo
         samples.m_size -= n;
         len -= n;
 
-        if (samples.m_size == 0) {
-            _audioQueue.pop_front();
-        }
-
         _audioQueueSize -= n; // we consumed 'n' bytes here 
 
+        if (samples.m_size == 0 && !release()) break;
     }
 
     assert( ! (len%2) ); 
@@ -1549,29 +1498,229 @@ BufferedAudioStreamer::fetch(boost::int16_t* samples, unsigned int nSamples, boo
     return nSamples-(len/2);
 }
 
+bool
+BufferedAudioStreamer::release()
+{
+    CursoredBuffer* const* front = _audioQueue.front();
+    if (!front) return false;
+
+    // The buffer may be deleted as soon as it is in _consumed.
+    CursoredBuffer* audio = *front;
+    const size_t left = audio->m_size;
+    if (!_consumed.push(audio)) return false;
+
+    _audioQueue.pop();
+    _audioQueueSize -= left;
+    _fetched.store(_fetched.load(boost::memory_order_relaxed) + 1,
+            boost::memory_order_release);
+    return true;
+}
+
+void
+BufferedAudioStreamer::reclaim()
+{
+    while (CursoredBuffer* const* audio = _consumed.front()) {
+        delete *audio;
+        _consumed.pop();
+    }
+}
+
 void
 BufferedAudioStreamer::push(CursoredBuffer* audio)
 {
-    boost::mutex::scoped_lock lock(_audioQueueMutex);
+    reclaim();
 
-    if ( _auxStreamer )
-    {
-        _audioQueue.push_back(audio);
-        _audioQueueSize += audio->m_size;
-    }
-    else 
+    if ( ! _auxStreamer )
     {
         // Don't bother pushing audio to the queue,
         // as nobody would consume it...
         delete audio;
+        return;
+    }
+
+    // Count the bytes before the callback can consume them.
+    _audioQueueSize += audio->m_size;
+    if (!_audioQueue.push(audio)) {
+        log_debug(_("Audio queue full, dropping %d bytes of samples"),
+                audio->m_size);
+        _audioQueueSize -= audio->m_size;
+        delete audio;
+        return;
     }
+    ++_pushed;
 }
 
 void
 BufferedAudioStreamer::cleanAudioQueue()
 {
-    boost::mutex::scoped_lock lock(_audioQueueMutex);
-    _audioQueue.clear();
+    reclaim();
+
+    if (_auxStreamer) {
+        // The sound_handler callback may be reading the queue, so
+        // it drops the buffers itself.
+        _flushTo.store(_pushed, boost::memory_order_release);
+        return;
+    }
+
+    do {
+        reclaim();
+    } while (release());
+}
+
+size_t
+BufferedAudioStreamer::queuedBuffers() const
+{
+    const size_t fetched = _fetched.load(boost::memory_order_acquire);
+    const size_t flushTo = _flushTo.load(boost::memory_order_relaxed);
+    if (static_cast<std::ptrdiff_t>(flushTo - fetched) > 0) {
+        return _pushed - flushTo;
+    }
+    return _pushed - fetched;
+}
+
+VideoDecoderThread::VideoDecoderThread(media::VideoDecoder& decoder)
+    :
+    _decoder(decoder),
+    _encoded(maxDecodedAhead),
+    _decoded(maxDecodedAhead),
+    _flushed(0),
+    _epoch(0),
+    _width(decoder.width()),
+    _height(decoder.height()),
+    _stop(false),
+    _thread(boost::bind(&VideoDecoderThread::decodeLoop, this))
+{
+}
+
+VideoDecoderThread::~VideoDecoderThread()
+{
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _stop = true;
+        _changed.notify_all();
+    }
+    _thread.join();
+
+    while (const Encoded* e = _encoded.front()) {
+        delete e->frame;
+        _encoded.pop();
+    }
+    while (image::GnashImage* const* im = _decoded.front()) {
+        delete *im;
+        _decoded.pop();
+    }
+}
+
+bool
+VideoDecoderThread::full() const
+{
+    return _timestamps.size() >= maxDecodedAhead;
+}
+
+bool
+VideoDecoderThread::push(std::auto_ptr<media::EncodedVideoFrame> frame)
+{
+    if (full()) return false;
+
+    const Encoded e = { frame.get(), _epoch.load(boost::memory_order_relaxed) };
+
+    // Every pending frame has a slot in each queue.
+    const bool pushed = _encoded.push(e);
+    assert(pushed);
+    UNUSED(pushed);
+
+    _timestamps.push_back(frame->timestamp());
+    frame.release();
+    notify();
+    return true;
+}
+
+std::auto_ptr<image::GnashImage>
+VideoDecoderThread::pop(boost::uint64_t ts, bool wait)
+{
+    std::auto_ptr<image::GnashImage> video;
+
+    while (!_timestamps.empty()) {
+
+        // Flushed frames are dropped whatever their timestamp.
+        if (!_flushed && _timestamps.front() > ts) break;
+
+        image::GnashImage* const* decoded = _decoded.front();
+        if (!decoded) {
+            if (!wait) break;
+            boost::mutex::scoped_lock lock(_mutex);
+            while (!_decoded.front()) _changed.wait(lock);
+            continue;
+        }
+
+        if (_flushed) {
+            delete *decoded;
+            --_flushed;
+        }
+        else if (*decoded) {
+            // Any earlier frame is late: drop it.
+            video.reset(*decoded);
+        }
+        _decoded.pop();
+        _timestamps.pop_front();
+    }
+
+    return video;
+}
+
+void
+VideoDecoderThread::flush()
+{
+    _flushed = _timestamps.size();
+    _epoch.fetch_add(1, boost::memory_order_relaxed);
+}
+
+void
+VideoDecoderThread::notify()
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    _changed.notify_all();
+}
+
+void
+VideoDecoderThread::decodeLoop()
+{
+    for (;;) {
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            while (!_stop && !_encoded.front()) _changed.wait(lock);
+            if (_stop) return;
+        }
+
+        const Encoded e = *_encoded.front();
+        _encoded.pop();
+        std::auto_ptr<media::EncodedVideoFrame> frame(e.frame);
+
+        // Frames pushed before a flush would only be dropped.
+        std::auto_ptr<image::GnashImage> video;
+        if (e.epoch == _epoch.load(boost::memory_order_relaxed)) {
+
+            // everything we push, we'll pop too..
+            assert(!_decoder.peek());
+
+            _decoder.push(*frame);
+            video = _decoder.pop();
+            if (!video.get()) {
+                // TODO: tell more about the failure
+                log_error(_("Error decoding encoded video frame in "
+                            "NetStream input"));
+            }
+            _width.store(_decoder.width(), boost::memory_order_relaxed);
+            _height.store(_decoder.height(), boost::memory_order_relaxed);
+        }
+
+        // There is a slot for every frame taken off _encoded.
+        const bool pushed = _decoded.push(video.get());
+        assert(pushed);
+        UNUSED(pushed);
+        video.release();
+        notify();
+    }
 }
 
 namespace {
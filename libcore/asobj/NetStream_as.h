@@ -27,15 +27,24 @@
 
 #include <boost/intrusive_ptr.hpp>
 #include <string>
-#include <boost/ptr_container/ptr_deque.hpp>
+#include <deque>
+#include <memory>
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
 
 #include "MediaParser.h"
 #include "PlayHead.h" // for composition
 #include "VideoDecoder.h" // for visibility of dtor
 #include "AudioDecoder.h" // for visibility of dtor
+#include "BufferPool.h"
 #include "VirtualClock.h"
 #include "Relay.h" // for ActiveRelay inheritance
+#include "RingBuffer.h"
 
 // Forward declarations
 namespace gnash {
@@ -64,7 +73,8 @@ namespace gnash {
 ///
 /// Then you push samples to a buffer of it and can request attach/detach 
 /// operations. When attached, the sound handler will fetch samples
-/// from the buffer, in a thread-safe way.
+/// from the buffer, in a thread-safe way. Fetching never waits for
+/// the thread pushing samples.
 ///
 class BufferedAudioStreamer {
 public:
@@ -74,6 +84,9 @@ public:
     ///
     BufferedAudioStreamer(sound::sound_handler* handler);
 
+    /// The aux streamer must be detached.
+    ~BufferedAudioStreamer();
+
     /// A buffer with a cursor state
     //
     /// @todo Make private, have ::push take a simpler
@@ -91,7 +104,8 @@ public:
 
         ~CursoredBuffer()
         {
-            delete [] m_data;
+            if (m_pool) m_pool->release(m_data);
+            else delete [] m_data;
         }
 
         /// Number of samples left in buffer starting from cursor
@@ -99,31 +113,51 @@ public:
 
         /// Actual data
         //
-        /// The data must be allocated with new []
-        /// as will be delete []'d by the dtor
+        /// The data must be allocated from m_pool if it is set,
+        /// otherwise with new [], and will be freed by the dtor
         boost::uint8_t* m_data;
 
+        /// The pool the data came from, if any
+        boost::shared_ptr<media::BufferPool> m_pool;
+
         /// Cursor into the data
         boost::uint8_t* m_ptr;
     };
 
-    typedef boost::ptr_deque<CursoredBuffer> AudioQueue;
+    typedef RingBuffer<CursoredBuffer*> AudioQueue;
 
     // Delete all samples in the audio queue.
     void cleanAudioQueue();
 
+    /// The number of buffers in the audio queue
+    size_t queuedBuffers() const;
+
     sound::sound_handler* _soundHandler;
 
     /// This is where audio frames are pushed by ::advance
     /// and consumed by sound_handler callback (audio_streamer)
+    //
+    /// The callback is invoked by a separate thread, which must not
+    /// wait for ::advance, so the queue has no lock.
     AudioQueue _audioQueue;
 
-    /// Number of bytes in the audio queue, protected by _audioQueueMutex
-    size_t _audioQueueSize;
+    /// Buffers played by the sound_handler callback, for ::push to
+    /// delete.
+    AudioQueue _consumed;
 
-    /// The queue needs to be protected as sound_handler callback
-    /// is invoked by a separate thread (dunno if it makes sense actually)
-    boost::mutex _audioQueueMutex;
+    /// Number of bytes in the audio queue
+    boost::atomic<size_t> _audioQueueSize;
+
+    /// Number of buffers ever pushed to the audio queue
+    size_t _pushed;
+
+    /// Number of buffers ever taken off the audio queue
+    boost::atomic<size_t> _fetched;
+
+    /// The value of _pushed when cleanAudioQueue() was last called
+    //
+    /// The sound_handler callback drops buffers up to there.
+    boost::atomic<size_t> _flushTo;
 
     // Id of an attached audio streamer, 0 if none
     sound::InputStream* _auxStreamer;
@@ -159,6 +193,123 @@ public:
     ///
     void push(CursoredBuffer* audio);
 
+private:
+
+    /// Move the oldest buffer in the audio queue to _consumed.
+    //
+    /// @return false if the audio queue is empty or _consumed is full.
+    bool release();
+
+    /// Delete the buffers in _consumed.
+    void reclaim();
+
+};
+
+/// Decodes video frames in a separate thread, ahead of the playhead
+//
+/// The thread owning the NetStream pushes encoded frames and pops the
+/// decoded images when they are due. Frames go in and out through
+/// RingBuffers, so neither thread waits for the other unless pop() is
+/// asked to.
+///
+/// All the functions are for the thread owning the NetStream. The
+/// VideoDecoder is used by the decoding thread only, until this is
+/// destroyed, so ask this for the video size rather than the decoder.
+///
+class VideoDecoderThread : boost::noncopyable
+{
+public:
+
+    /// Start the decoding thread.
+    VideoDecoderThread(media::VideoDecoder& decoder);
+
+    /// Stop the decoding thread, dropping any pending frames.
+    ~VideoDecoderThread();
+
+    /// The number of frames pushed and not yet popped.
+    size_t pending() const { return _timestamps.size(); }
+
+    /// Whether push() would fail.
+    bool full() const;
+
+    /// Queue a frame for decoding.
+    //
+    /// @return false, dropping the frame, if the queue is full().
+    bool push(std::auto_ptr<media::EncodedVideoFrame> frame);
+
+    /// Take the latest decoded frame with timestamp <= ts.
+    //
+    /// Earlier frames are dropped, so a late stream skips to its
+    /// current position.
+    ///
+    /// @param wait
+    ///     If true, wait for any pending frames with timestamp <= ts
+    ///     to be decoded. Otherwise frames still being decoded are left
+    ///     for a later call.
+    ///
+    /// @return 0 if no frame is due.
+    std::auto_ptr<image::GnashImage> pop(boost::uint64_t ts, bool wait);
+
+    /// Drop all pending frames, for instance after a seek.
+    void flush();
+
+    /// The width of the video as of the last frame decoded.
+    int width() const { return _width.load(boost::memory_order_relaxed); }
+
+    /// The height of the video as of the last frame decoded.
+    int height() const { return _height.load(boost::memory_order_relaxed); }
+
+private:
+
+    /// A frame waiting to be decoded
+    struct Encoded
+    {
+        media::EncodedVideoFrame* frame;
+
+        /// The value of _epoch when the frame was pushed.
+        unsigned int epoch;
+    };
+
+    /// Decode frames until _stop is set.
+    void decodeLoop();
+
+    /// Wake up the decoding thread or any thread waiting in pop().
+    void notify();
+
+    media::VideoDecoder& _decoder;
+
+    /// Frames waiting to be decoded.
+    RingBuffer<Encoded> _encoded;
+
+    /// Decoded frames, one for each frame pushed, or 0 where decoding
+    /// failed or the frame was flushed.
+    RingBuffer<image::GnashImage*> _decoded;
+
+    /// The timestamps of the pending frames, oldest first.
+    std::deque<boost::uint64_t> _timestamps;
+
+    /// The number of pending frames pushed before the last flush().
+    size_t _flushed;
+
+    /// Incremented by flush(); the decoding thread skips frames pushed
+    /// before.
+    boost::atomic<unsigned int> _epoch;
+
+    /// The decoder's idea of the video size, updated by the decoding
+    /// thread after each frame.
+    boost::atomic<int> _width;
+    boost::atomic<int> _height;
+
+    /// Set to stop the decoding thread.
+    bool _stop;
+
+    /// Protects _stop and the waits for the queues to change.
+    boost::mutex _mutex;
+
+    /// Notified when either queue changes.
+    boost::condition _changed;
+
+    boost::thread _thread;
 };
 
 // -----------------------------------------------------------------
@@ -419,12 +570,6 @@ private:
     /// and up to current timestamp
     void refreshAudioBuffer();
 
-    /// Decode next video frame fetching it MediaParser cursor
-    //
-    /// @return 0 on EOF or error, a decoded video otherwise
-    ///
-    std::auto_ptr<image::GnashImage> decodeNextVideoFrame();
-
     /// Decode next audio frame fetching it MediaParser cursor
     //
     /// @return 0 on EOF or error, a decoded audio frame otherwise
@@ -436,17 +581,22 @@ private:
     /// and push them to the output audio queue
     void pushDecodedAudioFrames(boost::uint32_t ts);
 
-    /// Decode input frames up to the one with timestamp <= ts.
+    /// Get the latest decoded frame with timestamp <= ts.
     //
-    /// Decoding starts from "next" element in the parser cursor.
+    /// Input frames from the parser cursor are handed to the decoding
+    /// thread first, so it keeps a few frames ahead of the playhead.
     ///
     /// Return 0 if:
     /// 1. there's no parser active.
     /// 2. parser cursor is already on last frame.
-    /// 3. next element in cursor has timestamp > tx
+    /// 3. no decoded frame is due at ts yet
     /// 4. there was an error decoding
     ///
-    std::auto_ptr<image::GnashImage> getDecodedVideoFrame(boost::uint32_t ts);
+    /// @param wait
+    ///     If true, wait for the frames due at ts to be decoded.
+    ///
+    std::auto_ptr<image::GnashImage> getDecodedVideoFrame(boost::uint32_t ts,
+            bool wait);
 
     DecodingState decodingStatus(DecodingState newstate = DEC_NONE);
 
@@ -527,6 +677,9 @@ private:
     /// Video decoder
     std::auto_ptr<media::VideoDecoder> _videoDecoder;
 
+    /// Runs _videoDecoder, so must be destroyed before it.
+    boost::scoped_ptr<VideoDecoderThread> _videoDecoderThread;
+
     /// True if video info are known
     bool _videoInfoKnown;
 
@@ -50,6 +50,8 @@
 #include "NativeFunction.h"
 #include "GnashNumeric.h"
 #include "Array_as.h"
+#include "SWFCxForm.h"
+#include "PixelOps.h"
 
 namespace gnash {
 
@@ -114,6 +116,12 @@ namespace {
 
     boost::uint32_t getPixel(const BitmapData_as& bd, size_t x, size_t y);
 
+    /// Apply a color transform to a rectangle of a BitmapData.
+    //
+    /// The rectangle is adjusted to fit the bitmap.
+    void colorTransform(const BitmapData_as& bd, int x, int y, int w, int h,
+            const SWFCxForm& cx);
+
     /// Get the overlapping part of a rectangle and a Bitmap
     //
     /// The values are adjusted so that the rectangle is wholly inside the
@@ -751,12 +759,38 @@ bitmapdata_clone(const fn_call& fn)
     return as_value(ret);
 }
 
+// colorTransform(rect: Rectangle, colorTransform: ColorTransform)
 as_value
 bitmapdata_colorTransform(const fn_call& fn)
 {
     BitmapData_as* ptr = ensure<ThisIsNative<BitmapData_as> >(fn);
-    UNUSED(ptr);
-    LOG_ONCE(log_unimpl(__FUNCTION__) );
+
+    if (ptr->disposed()) return as_value();
+
+    as_object* rect = fn.nargs > 0 ? toObject(fn.arg(0), getVM(fn)) : 0;
+    as_object* obj = fn.nargs > 1 ? toObject(fn.arg(1), getVM(fn)) : 0;
+
+    ColorTransform_as* tr;
+    if (!rect || !isNativeType(obj, tr)) {
+        IF_VERBOSE_ASCODING_ERRORS(
+            std::ostringstream ss;
+            fn.dump_args(ss);
+            log_aserror(_("BitmapData.colorTransform(%s): needs a "
+                          "rectangle and a ColorTransform"), ss.str());
+        );
+        return as_value();
+    }
+
+    as_value x, y, w, h;
+    
+    rect->get_member(NSV::PROP_X, &x);
+    rect->get_member(NSV::PROP_Y, &y);
+    rect->get_member(NSV::PROP_WIDTH, &w);
+    rect->get_member(NSV::PROP_HEIGHT, &h);    
+
+    colorTransform(*ptr, toInt(x, getVM(fn)), toInt(y, getVM(fn)),
+            toInt(w, getVM(fn)), toInt(h, getVM(fn)), toCxForm(*tr));
+
     return as_value();
 }
 
@@ -910,9 +944,9 @@ bitmapdata_copyPixels(const fn_call& fn)
         // Require three arguments? (TODO: check).
         return as_value();
     }
-    if (fn.nargs > 3) {
-        LOG_ONCE(log_unimpl(_("BitmapData.copyPixels(): arguments after "
-                              "the first three are discarded")));
+    if (fn.nargs > 3 && fn.arg(3).is_object()) {
+        LOG_ONCE(log_unimpl(_("BitmapData.copyPixels(): alphaBitmap and "
+                              "alphaPoint are discarded")));
     }
 
     as_object* o = toObject(fn.arg(0), getVM(fn));
@@ -941,7 +975,7 @@ bitmapdata_copyPixels(const fn_call& fn)
     destpoint->get_member(NSV::PROP_X, &px);
     destpoint->get_member(NSV::PROP_Y, &py);
 
-    // TODO: remaining arguments.
+    const bool mergeAlpha = fn.nargs > 5 && toBool(fn.arg(5), getVM(fn));
 
     // Find true source rect and true dest rect.
     int sourceX = toInt(x, getVM(fn));
@@ -999,6 +1033,25 @@ bitmapdata_copyPixels(const fn_call& fn)
     const size_t ourwidth = ptr->width();
     const size_t srcwidth = source->width();
 
+    // Whole rows of different images can be handled on the bytes.
+    if (!sameImage && ptr->transparent()) {
+        const bool blend = mergeAlpha && source->transparent();
+        const bool expand = !source->transparent();
+        if (blend || expand) {
+            for (int i = 0; i < destH; ++i) {
+                if (blend) {
+                    image::blendOverUnmultiplied(src.base(), targ.base(),
+                            destW);
+                }
+                else image::expandRGB(src.base(), targ.base(), destW);
+                targ += ourwidth;
+                src += srcwidth;
+            }
+            ptr->updateObjects();
+            return as_value();
+        }
+    }
+
     // Copy for the width and height of the *dest* image.
     // We have already ensured that the copied area
     // is inside both bitmapdatas.
@@ -1602,7 +1655,7 @@ bitmapdata_loadBitmap(const fn_call& fn)
     const boost::uint16_t id = def->exportID(linkage);
     CachedBitmap* bit = def->getBitmap(id);
 
-    if (!bit) return as_value();
+    if (!bit || !bit->materialize()) return as_value();
 
     image::GnashImage& im = bit->image();
     const size_t width = im.width();
@@ -1776,6 +1829,33 @@ setPixel32(const BitmapData_as& bd, size_t x, size_t y, boost::uint32_t color)
     *it = color;
 }
 
+void
+colorTransform(const BitmapData_as& bd, int x, int y, int w, int h,
+        const SWFCxForm& cx)
+{
+    adjustRect(x, y, w, h, bd);
+    if (w == 0 || h == 0) return;
+
+    const size_t width = bd.width();
+    const bool transparent = bd.transparent();
+
+    BitmapData_as::iterator row = pixelAt(bd, x, y);
+
+    for (int i = 0; i < h; ++i, row += width) {
+        if (transparent) {
+            cx.transform(row.base(), w);
+            continue;
+        }
+        // There is no alpha channel to transform.
+        for (BitmapData_as::iterator it = row, e = row + w; it != e; ++it) {
+            image::GnashImage::iterator p = it.base();
+            boost::uint8_t a = 0xff;
+            cx.transform(p[0], p[1], p[2], a);
+        }
+    }
+    bd.updateObjects();
+}
+
 void
 fillRect(const BitmapData_as& bd, int x, int y, int w, int h,
         boost::uint32_t color)
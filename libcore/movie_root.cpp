@@ -51,6 +51,7 @@
 #include "IOChannel.h"
 #include "RunResources.h"
 #include "Renderer.h"
+#include "LazyBitmap.h"
 #include "ExternalInterface.h"
 #include "TextField.h"
 #include "Button.h"
@@ -301,6 +302,9 @@ movie_root::handleActionLimitHit(const std::string& msg)
 void
 movie_root::cleanupAndCollect()
 {
+    // The last frame may refer to what is about to be destroyed.
+    _lastFrame.clear();
+
     // Cleanup the stack.
     _vm.getStack().clear();
 
@@ -854,6 +858,9 @@ movie_root::advance()
 
     bool advanced = false;
 
+    // Shapes and video frames may change.
+    _lastFrame.clear();
+
 #ifdef USE_SOUND
     try {
         
@@ -1001,6 +1008,28 @@ movie_root::display()
 
     clearInvalidated();
 
+    Renderer* renderer = _runResources.renderer();
+    if (!renderer) return;
+
+    if (!record(_lastFrame, renderer)) return;
+
+    for (Levels::iterator i=_movies.begin(), e=_movies.end(); i!=e; ++i) {
+        i->second->clear_invalidated();
+    }
+
+    _lastFrame.render(*renderer);
+
+    // Drop bitmaps that were not drawn for a while if over the limit.
+    const size_t bitmapCache =
+        RcInitFile::getDefaultInstance().getBitmapCacheSize();
+    if (bitmapCache) LazyBitmap::evict(bitmapCache * 1024);
+}
+
+bool
+movie_root::record(DisplayCommands& commands, const Renderer* target)
+{
+    commands.clear();
+
     // TODO: should we consider the union of all levels bounds ?
     const SWFRect& frame_size = _rootMovie->get_frame_size();
     if ( frame_size.is_null() )
@@ -1008,13 +1037,12 @@ movie_root::display()
         // TODO: check what we should do if other levels
         //       have valid bounds
         log_debug("original root movie had null bounds, not displaying");
-        return;
+        return false;
     }
 
-    Renderer* renderer = _runResources.renderer();
-    if (!renderer) return;
+    RecordingRenderer recorder(commands, target);
 
-    Renderer::External ex(*renderer, m_background_color,
+    Renderer::External ex(recorder, m_background_color,
             _stageWidth, _stageHeight,
             frame_size.get_x_min(), frame_size.get_x_max(),
             frame_size.get_y_min(), frame_size.get_y_max());
@@ -1022,8 +1050,6 @@ movie_root::display()
     for (Levels::iterator i=_movies.begin(), e=_movies.end(); i!=e; ++i) {
         MovieClip* movie = i->second;
 
-        movie->clear_invalidated();
-
         if (movie->visible() == false) continue;
 
         // null frame size ? don't display !
@@ -1034,8 +1060,9 @@ movie_root::display()
             continue;
         }
 
-        movie->display(*renderer, Transform());
+        movie->display(recorder, Transform());
     }
+    return true;
 }
 
 bool
@@ -89,6 +89,7 @@
 #include "MovieClip.h"
 #include "SimpleBuffer.h" // for LoadCallback
 #include "MovieLoader.h"
+#include "DisplayCommands.h"
 #include "ExternalInterface.h"
 #include "GC.h"
 #include "VM.h"
@@ -384,8 +385,34 @@ public:
     ///   - Run the GC collector
     void advanceMovie();
 
+    /// Draw the current frame on the configured Renderer.
+    //
+    /// The frame is recorded first, and the recording is kept. See
+    /// lastFrame().
     void display();
 
+    /// Record the drawing calls for the current frame.
+    //
+    /// The commands can be drawn with DisplayCommands::render() by any
+    /// number of Renderers, as long as the stage does not change.
+    //
+    /// @param commands The commands to replace.
+    /// @param target   If not 0, DisplayObjects outside the clipping area
+    ///                 of this Renderer are left out.
+    /// @return         false if the frame has nothing to display.
+    bool record(DisplayCommands& commands, const Renderer* target = 0);
+
+    /// The commands drawn by the last call to display().
+    //
+    /// If nothing has been invalidated since, these can be drawn again
+    /// instead of displaying the stage. They refer to shapes and video
+    /// frames without owning them, so they are only valid until the
+    /// movie next advances or unloaded DisplayObjects are destroyed.
+    /// Both clear them.
+    const DisplayCommands& lastFrame() const {
+        return _lastFrame;
+    }
+
     /// Get a unique number for unnamed instances.
     size_t nextUnnamedInstance() {
         return ++_unnamedInstance;
@@ -988,6 +1015,9 @@ private:
     rgba m_background_color;
     bool m_background_color_set;
 
+    /// The commands for the last displayed frame.
+    DisplayCommands _lastFrame;
+
     boost::int32_t _mouseX;
     boost::int32_t _mouseY;
 
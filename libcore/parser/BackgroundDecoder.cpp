@@ -0,0 +1,136 @@
+// BackgroundDecoder.cpp: decode definition tags on worker threads.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "BackgroundDecoder.h"
+
+#include <exception>
+#include <boost/bind.hpp>
+
+#include "log.h"
+
+namespace gnash {
+
+BackgroundDecoder::BackgroundDecoder(size_t threads)
+    :
+    _next(0),
+    _stop(false)
+{
+    for (size_t i = 0; i < threads; ++i) {
+        _threads.create_thread(boost::bind(&BackgroundDecoder::work, this));
+    }
+}
+
+BackgroundDecoder::~BackgroundDecoder()
+{
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    _threads.join_all();
+}
+
+void
+BackgroundDecoder::add(const Job& job)
+{
+    if (!_threads.size()) {
+        boost::mutex::scoped_lock lock(_mutex);
+        _slots.push_back(Slot(Job()));
+        _slots.back().result = run(job);
+        _slots.back().done = true;
+        ++_next;
+        return;
+    }
+
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _slots.push_back(Slot(job));
+    }
+    _wake.notify_one();
+}
+
+void
+BackgroundDecoder::publish()
+{
+    Slots slots;
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+
+        // Slots finish out of order, so check them all.
+        for (Slots::const_iterator i = _slots.begin(), e = _slots.end();
+                i != e; ++i) {
+            while (!i->done) _done.wait(lock);
+        }
+        slots.swap(_slots);
+        _next = 0;
+    }
+
+    for (Slots::const_iterator i = slots.begin(), e = slots.end();
+            i != e; ++i) {
+        if (i->result) i->result();
+    }
+}
+
+size_t
+BackgroundDecoder::pending() const
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    return _slots.size();
+}
+
+void
+BackgroundDecoder::work()
+{
+    boost::mutex::scoped_lock lock(_mutex);
+
+    while (!_stop) {
+        if (_next == _slots.size()) {
+            _wake.wait(lock);
+            continue;
+        }
+
+        // Deque elements stay put when others are added at the end, and
+        // the slot is not removed until it is done.
+        Slot& slot = _slots[_next++];
+        const Job job = slot.job;
+
+        lock.unlock();
+        const Publisher result = run(job);
+        lock.lock();
+
+        slot.result = result;
+        slot.job.clear();
+        slot.done = true;
+        _done.notify_all();
+    }
+}
+
+BackgroundDecoder::Publisher
+BackgroundDecoder::run(const Job& job)
+{
+    try {
+        return job();
+    }
+    catch (const std::exception& e) {
+        log_error(_("Error decoding definition: %s"), e.what());
+    }
+    return Publisher();
+}
+
+} // namespace gnash
@@ -0,0 +1,106 @@
+// BackgroundDecoder.h: decode definition tags on worker threads.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef GNASH_BACKGROUNDDECODER_H
+#define GNASH_BACKGROUNDDECODER_H
+
+#include <deque>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace gnash {
+
+/// Decodes independent definition tags while the loader reads on.
+//
+/// A job does the expensive part of loading a tag, such as decompressing
+/// an image, on a worker thread. It returns a publisher, which adds the
+/// result to the movie definition. Publishers are only called from
+/// publish(), on the loading thread, in the order their jobs were added,
+/// so the movie sees the same definitions in the same order as with
+/// serial loading.
+class BackgroundDecoder : boost::noncopyable
+{
+public:
+
+    /// Adds a decoded definition to the movie. May be empty.
+    typedef boost::function<void()> Publisher;
+
+    /// Decodes a definition, returning a Publisher for the result.
+    typedef boost::function<Publisher()> Job;
+
+    /// Create a BackgroundDecoder.
+    //
+    /// @param threads  The number of worker threads. With none, jobs are
+    ///                 run by add().
+    explicit BackgroundDecoder(size_t threads);
+
+    /// Wait for running jobs, discarding all results.
+    ~BackgroundDecoder();
+
+    /// Add a job.
+    void add(const Job& job);
+
+    /// Wait for all jobs added so far and call their publishers.
+    void publish();
+
+    /// The number of jobs added but not yet published.
+    size_t pending() const;
+
+private:
+
+    struct Slot
+    {
+        explicit Slot(const Job& j) : job(j), done(false) {}
+        Job job;
+        Publisher result;
+        bool done;
+    };
+
+    typedef std::deque<Slot> Slots;
+
+    void work();
+
+    /// Run a job, catching anything it throws.
+    static Publisher run(const Job& job);
+
+    mutable boost::mutex _mutex;
+
+    /// Signalled when a job is added or the workers should stop.
+    boost::condition_variable _wake;
+
+    /// Signalled when a job is done.
+    boost::condition_variable _done;
+
+    /// Jobs in the order they were added.
+    Slots _slots;
+
+    /// The first slot not yet taken by a worker.
+    size_t _next;
+
+    bool _stop;
+
+    boost::thread_group _threads;
+};
+
+} // namespace gnash
+
+#endif
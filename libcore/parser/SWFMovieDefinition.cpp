@@ -31,10 +31,15 @@
 #include <memory>
 #include <string>
 #include <algorithm> 
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 
 #include "GnashSleep.h"
 #include "movie_definition.h" 
 #include "zlib_adapter.h"
+#include "inflate_cache.h"
+#include "tu_file.h"
 #include "IOChannel.h"
 #include "SWFStream.h"
 #include "RunResources.h"
@@ -53,6 +58,7 @@
 #include "CachedBitmap.h"
 #include "TypesParser.h"
 #include "GnashImageJpeg.h"
+#include "rc.h"
 
 // Debug frames load
 #undef DEBUG_FRAMES_LOAD
@@ -236,6 +242,17 @@ SWFMovieDefinition::addBitmap(int id, boost::intrusive_ptr<CachedBitmap> im)
     _bitmaps.insert(std::make_pair(id, im));
 }
 
+void
+SWFMovieDefinition::addDecodeJob(const BackgroundDecoder::Job& job)
+{
+    if (!_decoder) {
+        size_t threads = RcInitFile::getDefaultInstance().getDecodeThreads();
+        if (!threads) threads = boost::thread::hardware_concurrency();
+        _decoder.reset(new BackgroundDecoder(threads));
+    }
+    _decoder->add(job);
+}
+
 sound_sample*
 SWFMovieDefinition::get_sound_sample(int id) const
 {
@@ -301,8 +318,19 @@ SWFMovieDefinition::readHeader(std::auto_ptr<IOChannel> in,
             log_parse(_("file is compressed"));
         );
 
+        // A local file is inflated at once, so that the tags can be used
+        // from memory. Others are inflated as they are read.
+        const boost::shared_ptr<const boost::uint8_t> data = _in->data();
+        const size_t size = _in->size();
+
         // Uncompress the input as we read it.
         _in = zlib_adapter::make_inflater(_in);
+
+        if (data && !file_start_pos) {
+            _in = inflate_cache::inflate(_in, header, m_file_length,
+                    data.get(), size,
+                    RcInitFile::getDefaultInstance().getSWFCacheDir());
+        }
 #endif
     }
 
@@ -490,6 +518,9 @@ SWFMovieDefinition::read_all_swf()
         log_error(_("Error while parsing SWF stream."));
     }
 
+    // Definitions after the last SHOWFRAME.
+    if (_decoder) _decoder->publish();
+
     // Set bytesLoaded to the current stream position unless it's greater
     // than the reported length. TODO: should we be trying to continue
     // parsing after an exception?
@@ -528,6 +559,9 @@ SWFMovieDefinition::get_loading_frame() const
 void
 SWFMovieDefinition::incrementLoadedFrames()
 {
+    // Everything defined so far must be available with the frame.
+    if (_decoder) _decoder->publish();
+
     boost::mutex::scoped_lock lock(_frames_loaded_mutex);
 
     ++_frames_loaded;
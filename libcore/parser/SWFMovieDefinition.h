@@ -33,6 +33,7 @@
 #include "SWFRect.h"
 #include "GnashNumeric.h"
 #include "GnashAlgorithm.h"
+#include "BackgroundDecoder.h"
 
 #include <boost/intrusive_ptr.hpp>
 #include <vector>
@@ -296,6 +297,11 @@ public:
     /// images (JPEG images without the table info).
     void set_jpeg_loader(std::auto_ptr<image::JpegInput> j_in);
 
+    /// Queue a job on the background decoder
+    //
+    /// Publishers are called when the next frame is loaded.
+    void addDecodeJob(const BackgroundDecoder::Job& job);
+
     // See dox in movie_definition.h
     image::JpegInput* get_jpeg_loader() const {
         return m_jpeg_in.get();
@@ -497,6 +503,11 @@ private:
     /// swf end position (as read from header)
     size_t _swf_end_pos;
 
+    /// Decodes definitions for the loader, created on first use.
+    //
+    /// This must be destroyed after the loader thread has finished.
+    boost::scoped_ptr<BackgroundDecoder> _decoder;
+
     /// asyncronous SWF loader and parser
     SWFMovieLoader _loader;
 
@@ -22,6 +22,7 @@
 
 #include <string>
 #include <cstring> // for memcpy
+#include <algorithm>
 #include <boost/static_assert.hpp>
 
 #include "log.h"
@@ -38,9 +39,16 @@ namespace {
     double convert_double_wacky(const void *p);
 }
 
+const boost::uint32_t action_buffer::noIndex;
+
 action_buffer::action_buffer(const movie_definition& md)
     :
+    m_buffer(0),
+    _size(0),
     _pools(),
+    _instructions(),
+    _decoded(false),
+    _memberCaches(),
     _src(md)
 {
 }
@@ -60,17 +68,10 @@ action_buffer::read(SWFStream& in, unsigned long endPos)
         return;
     }
 
-    // Allocate the buffer
-    // 
-    // NOTE: a .reserve would be fine here, except GLIBCPP_DEBUG will complain...
-    //
-    m_buffer.resize(size);
-    unsigned char* buf = &m_buffer.front();
-
-    // Read all the bytes in the buffer
+    // Share the bytes with the input if it is in memory, or copy them.
     //
     // NOTE:
-    // we might be reading more data then we'll actually
+    // we might be keeping more data then we'll actually
     // use here if the SWF contains Action blocks padded
     // with data after the terminating END.
     // This has a cost in memory use, but for the normal
@@ -78,30 +79,248 @@ action_buffer::read(SWFStream& in, unsigned long endPos)
     // tag should give significant speedup in parsing
     // large action-based movies.
     //
-    in.read(reinterpret_cast<char*>(buf), size);
+    size_t got = size;
+    _code = in.readShared(got);
+
+    // A short read leaves the rest of the buffer zeroed.
+    if (got < size || _code.get()[got - 1] != SWF::ACTION_END) {
+
+        // Consistency checks here
+        //
+        // NOTE: it is common to find such movies, swfmill is known to write
+        //       DoAction w/out the terminating END tag
+        //
+        if (got == size) {
+            IF_VERBOSE_MALFORMED_SWF(
+                log_swferror(_("Action buffer starting at offset %lu doesn't "
+                        "end with an END tag"), startPos);
+            );
+        }
 
-    // Consistency checks here
-    //
-    // NOTE: it is common to find such movies, swfmill is known to write
-    //       DoAction w/out the terminating END tag
-    //
-    if (m_buffer.back() != SWF::ACTION_END) {
         // Add a null terminator so read_string won't read off
         // the end of the buffer.
-        m_buffer.push_back(0x00);
+        boost::shared_ptr<std::vector<boost::uint8_t> > copy(
+                new std::vector<boost::uint8_t>(size + 1));
+        if (got) std::copy(_code.get(), _code.get() + got, copy->begin());
+        _code.reset(copy, &copy->front());
+        ++size;
+    }
 
-        IF_VERBOSE_MALFORMED_SWF(
-            log_swferror(_("Action buffer starting at offset %lu doesn't "
-                    "end with an END tag"), startPos);
-        );
+    m_buffer = _code.get();
+    _size = size;
+
+    // Any previously decoded stream is now stale.
+    _instructions.clear();
+    _memberCaches.clear();
+    _pushOperands.clear();
+    _decoded = false;
+}
+
+namespace {
+
+/// Whether buffers are decoded, see action_buffer::setDecoding().
+bool decoding = true;
+
+/// Compare instructions by offset, for binary searches.
+struct InstructionBefore
+{
+    bool operator()(const action_buffer::Instruction& i, size_t pc) const {
+        return i.pc < pc;
     }
-    
+};
+
+}
+
+void
+action_buffer::setDecoding(bool decode)
+{
+    decoding = decode;
+}
+
+const action_buffer::Instructions&
+action_buffer::instructions() const
+{
+    if (_decoded) return _instructions;
+    _decoded = true;
+    if (!decoding) return _instructions;
+
+    const size_t end = _size;
+
+    size_t pc = 0;
+    while (pc < end) {
+
+        Instruction i;
+        i.pc = pc;
+        i.id = m_buffer[pc];
+        i.target = noIndex;
+        i.cache = noIndex;
+        i.operands = noIndex;
+        i.operandCount = 0;
+
+        if ((i.id & 0x80) == 0) {
+            i.nextPC = pc + 1;
+        }
+        else {
+            // Leave the rest to the slow path, which knows how to
+            // complain about it.
+            if (pc + 2 >= end) break;
+            const boost::uint16_t length = read_uint16(pc + 1);
+            if (pc + 3 + length > end) break;
+            i.nextPC = pc + 3 + length;
+        }
+
+        if (i.id == SWF::ACTION_GETMEMBER || i.id == SWF::ACTION_SETMEMBER) {
+            i.cache = _memberCaches.size();
+            _memberCaches.push_back(MemberCache());
+        }
+
+        if (i.id == SWF::ACTION_PUSHDATA) decodePush(i);
+
+        _instructions.push_back(i);
+        pc = i.nextPC;
+    }
+
+    // Resolve branch targets now that all offsets are known. Jumps into
+    // the middle of an action (obfuscated code) are left unresolved.
+    for (Instructions::iterator it = _instructions.begin(),
+            e = _instructions.end(); it != e; ++it) {
+
+        if (it->id != SWF::ACTION_BRANCHALWAYS &&
+                it->id != SWF::ACTION_BRANCHIFTRUE) continue;
+
+        if (it->nextPC - it->pc < 5) continue;
+
+        const long dest = static_cast<long>(it->nextPC) +
+            read_int16(it->pc + 3);
+        if (dest < 0) continue;
+
+        const size_t idx = findInstruction(dest);
+        if (idx != _instructions.size()) it->target = idx;
+    }
+
+    return _instructions;
+}
+
+bool
+action_buffer::decodePush(Instruction& insn) const
+{
+    // The operand types, as in ActionPushData.
+    enum {
+        pushString,
+        pushFloat,
+        pushNull,
+        pushUndefined,
+        pushRegister,
+        pushBool,
+        pushDouble,
+        pushInt32,
+        pushDict8,
+        pushDict16
+    };
+
+    const size_t first = _pushOperands.size();
+    const size_t end = insn.nextPC;
+
+    size_t i = insn.pc + 3;
+    while (i < end) {
+
+        PushOperand op;
+        op.kind = PushOperand::VALUE;
+        op.index = 0;
+
+        const boost::uint8_t type = m_buffer[i++];
+
+        // The size of the operand, which must fit in the action.
+        size_t size;
+        switch (type) {
+            case pushNull:
+            case pushUndefined:
+                size = 0;
+                break;
+            case pushRegister:
+            case pushBool:
+            case pushDict8:
+                size = 1;
+                break;
+            case pushDict16:
+                size = 2;
+                break;
+            case pushFloat:
+            case pushInt32:
+                size = 4;
+                break;
+            case pushDouble:
+                size = 8;
+                break;
+            case pushString:
+                size = std::find(m_buffer + i, m_buffer + end, 0) -
+                    (m_buffer + i) + 1;
+                break;
+            default:
+                size = end;
+        }
+
+        if (i + size > end) {
+            _pushOperands.resize(first);
+            return false;
+        }
+
+        switch (type) {
+            case pushString:
+                op.value = std::string(read_string(i));
+                break;
+            case pushFloat:
+                op.value = read_float_little(i);
+                break;
+            case pushNull:
+                op.value.set_null();
+                break;
+            case pushRegister:
+                op.kind = PushOperand::REGISTER;
+                op.index = m_buffer[i];
+                break;
+            case pushBool:
+                op.value = static_cast<bool>(m_buffer[i]);
+                break;
+            case pushDouble:
+                op.value = read_double_wacky(i);
+                break;
+            case pushInt32:
+                op.value = read_int32(i);
+                break;
+            case pushDict8:
+                op.kind = PushOperand::CONSTANT;
+                op.index = m_buffer[i];
+                break;
+            case pushDict16:
+                op.kind = PushOperand::CONSTANT;
+                op.index = read_uint16(i);
+                break;
+        }
+
+        _pushOperands.push_back(op);
+        i += size;
+    }
+
+    insn.operands = first;
+    insn.operandCount = _pushOperands.size() - first;
+    return true;
+}
+
+size_t
+action_buffer::findInstruction(size_t pc) const
+{
+    const Instructions& insns = instructions();
+    Instructions::const_iterator it = std::lower_bound(insns.begin(),
+            insns.end(), pc, InstructionBefore());
+    if (it == insns.end() || it->pc != pc) return insns.size();
+    return it - insns.begin();
 }
 
 const ConstantPool&
 action_buffer::readConstantPool(size_t start_pc, size_t stop_pc) const
 {
-    assert(stop_pc <= m_buffer.size()); // TODO: drop, be safe instead
+    assert(stop_pc <= _size); // TODO: drop, be safe instead
 
     // Return a previously parsed pool at the same position, if any
     PoolsMap::iterator pi = _pools.find(start_pc);
@@ -454,7 +673,7 @@ disasm_instruction(const unsigned char* instruction_data,
 std::string
 action_buffer::disasm(size_t pc) const
 {
-    const size_t maxBufferLength = m_buffer.size() - pc;
+    const size_t maxBufferLength = _size - pc;
     return disasm_instruction(&m_buffer[pc], maxBufferLength);
 }
 
@@ -24,14 +24,16 @@
 #include <map> 
 #include <boost/noncopyable.hpp>
 #include <boost/cstdint.hpp> 
+#include <boost/shared_ptr.hpp>
 
 #include "GnashException.h"
 #include "ConstantPool.h"
+#include "MemberCache.h"
+#include "as_value.h"
 #include "log.h"
 
 // Forward declarations
 namespace gnash {
-	class as_value;
 	class movie_definition;
 	class SWFStream; // for read signature
 }
@@ -62,17 +64,117 @@ public:
 	///
 	void read(SWFStream& in, unsigned long endPos);
 
-	size_t size() const { return m_buffer.size(); }
+	size_t size() const { return _size; }
 
 	boost::uint8_t operator[] (size_t off) const
 	{
-		if (off >= m_buffer.size()) {
+		if (off >= _size) {
 		    throw ActionParserException (_("Attempt to read outside "
 		    		    "action buffer"));
 		}
 		return m_buffer[off];
 	}
 
+	/// A pre-decoded action tag
+	//
+	/// See instructions().
+	struct Instruction
+	{
+		/// Offset of the action tag in the buffer
+		boost::uint32_t pc;
+
+		/// Offset of the action tag following this one
+		boost::uint32_t nextPC;
+
+		/// Index of the instruction a branch jumps to, or noIndex
+		boost::uint32_t target;
+
+		/// Index of the member cache of GetMember and SetMember, or noIndex
+		boost::uint32_t cache;
+
+		/// Index of the first operand of a Push, or noIndex
+		//
+		/// Pushes with malformed operands are not decoded, and have
+		/// to be parsed from the raw buffer.
+		boost::uint32_t operands;
+
+		/// The number of operands of a decoded Push
+		boost::uint32_t operandCount;
+
+		/// The action id
+		boost::uint8_t id;
+	};
+
+	typedef std::vector<Instruction> Instructions;
+
+	/// A pre-decoded operand of a Push action
+	struct PushOperand
+	{
+		enum Kind
+		{
+			/// Push value.
+			VALUE,
+
+			/// Push the register numbered index.
+			REGISTER,
+
+			/// Push entry index of the ConstantPool in effect, which
+			/// is only known when the action is executed.
+			CONSTANT
+		};
+
+		Kind kind;
+
+		/// The register or constant number
+		boost::uint16_t index;
+
+		/// The value of a literal operand
+		as_value value;
+	};
+
+	/// Value of Instruction indices that don't apply
+	static const boost::uint32_t noIndex = 0xffffffff;
+
+	/// Return the decoded action stream
+	//
+	/// The buffer is decoded once, on first request, so that executing
+	/// the same code many times does not need to parse every action
+	/// header again. Decoding stops at the first malformed action;
+	/// offsets past that point are not in the returned table and
+	/// have to be parsed from the raw buffer.
+	const Instructions& instructions() const;
+
+	/// Set whether buffers are decoded before they are executed
+	//
+	/// Without decoding, every action is parsed from the raw buffer each
+	/// time it runs, as the interpreter did before decoding was added.
+	/// This is only meant for comparing the two, and must be set before
+	/// any buffer is executed.
+	static void setDecoding(bool decode);
+
+	/// Return the index of the instruction starting at the given offset
+	//
+	/// @return     the index in instructions(), or instructions().size()
+	///             if no decoded action starts at pc.
+	size_t findInstruction(size_t pc) const;
+
+	/// Return the inline cache of a GetMember or SetMember instruction
+	//
+	/// @param i    The Instruction::cache index, which must be valid.
+	MemberCache& memberCache(size_t i) const {
+		assert(i < _memberCaches.size());
+		return _memberCaches[i];
+	}
+
+	/// Return an operand of a decoded Push instruction
+	//
+	/// @param i    An index from Instruction::operands to
+	///             operands + operandCount.
+	const PushOperand& pushOperand(size_t i) const {
+		assert(i < _pushOperands.size());
+		return _pushOperands[i];
+	}
+
 	/// Disassemble instruction at given offset and return as a string
 	std::string disasm(size_t pc) const;
 
@@ -82,8 +184,8 @@ public:
 	///
 	const char* read_string(size_t pc) const
 	{
-		assert(pc <= m_buffer.size() );
-        if (pc == m_buffer.size())
+		assert(pc <= _size );
+        if (pc == _size)
         {
             throw ActionParserException(_("Asked to read string when only "
                 "1 byte remains in the buffer"));
@@ -94,8 +196,8 @@ public:
     /// Get a pointer to the current instruction within the code
 	const unsigned char* getFramePointer(size_t pc) const
 	{
-	    assert (pc < m_buffer.size());
-		return reinterpret_cast<const unsigned char*>(&m_buffer.at(pc));
+	    assert (pc < _size);
+		return reinterpret_cast<const unsigned char*>(&m_buffer[pc]);
 	}
 
 	/// Get a signed integer value from given offset
@@ -104,7 +206,7 @@ public:
 	///
 	boost::int16_t read_int16(size_t pc) const
 	{
-	    if (pc + 1 >= m_buffer.size()) {
+	    if (pc + 1 >= _size) {
 	        throw ActionParserException(_("Attempt to read outside action buffer limits"));
 	    }
 		boost::int16_t ret = (m_buffer[pc] | (m_buffer[pc + 1] << 8));
@@ -124,7 +226,7 @@ public:
 	///
 	boost::int32_t read_int32(size_t pc) const
 	{
-		if (pc + 3 >= m_buffer.size()) {
+		if (pc + 3 >= _size) {
 	        throw ActionParserException(_("Attempt to read outside action buffer limits"));
 	    }
 	    
@@ -189,12 +291,36 @@ public:
 private:
 
 	/// the code itself, as read from the SWF
-	std::vector<boost::uint8_t> m_buffer;
+	//
+	/// This may be part of the SWF input, which _code keeps alive.
+	const boost::uint8_t* m_buffer;
+
+	/// The size of the code
+	size_t _size;
+
+	boost::shared_ptr<const boost::uint8_t> _code;
 
 	/// The set of ConstantPools found in this action_buffer
 	typedef std::map<size_t, ConstantPool> PoolsMap;
 	mutable PoolsMap _pools;
 
+	/// The decoded action stream, built by instructions()
+	mutable Instructions _instructions;
+
+	/// Whether _instructions has been built
+	mutable bool _decoded;
+
+	/// Inline caches of the member access instructions
+	mutable std::vector<MemberCache> _memberCaches;
+
+	/// Decode the operands of a Push into _pushOperands.
+	//
+	/// @return false, adding nothing, if they are malformed.
+	bool decodePush(Instruction& i) const;
+
+	/// The operands of all decoded Push instructions
+	mutable std::vector<PushOperand> _pushOperands;
+
 	/// The movie_definition containing this action buffer
 	//
 	/// This pointer will be used to determine domain-based
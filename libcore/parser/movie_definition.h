@@ -59,6 +59,7 @@
 #include <boost/cstdint.hpp>
 
 #include "DefinitionTag.h"
+#include "BackgroundDecoder.h"
 #include "log.h"
 
 // Forward declarations
@@ -341,6 +342,20 @@ public:
 	{
 	}
 
+	/// Decode a definition, possibly on another thread.
+	//
+	/// The job's publisher is called on the loading thread before the
+	/// frame being loaded is made available.
+	///
+	/// The default implementation runs the job and its publisher
+	/// immediately.
+	///
+	virtual void addDecodeJob(const BackgroundDecoder::Job& job)
+	{
+		const BackgroundDecoder::Publisher publish = job();
+		if (publish) publish();
+	}
+
 	/// Get the sound sample with given ID.
 	//
 	/// @return NULL if the given DisplayObject ID isn't found in the
@@ -26,8 +26,10 @@
 
 #include <limits>
 #include <cassert>
+#include <algorithm>
 #include <boost/static_assert.hpp>
 #include <boost/scoped_array.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include "IOChannel.h"
 #include "utility.h"
@@ -43,6 +45,9 @@
 #include "CachedBitmap.h"
 #include "GnashImage.h"
 #include "GnashImageJpeg.h"
+#include "BackgroundDecoder.h"
+#include "LazyBitmap.h"
+#include "rc.h"
 
 #ifdef HAVE_ZLIB_H
 #include <zlib.h>
@@ -61,6 +66,8 @@ namespace {
     /// DefineBitsJpeg3, also DefineBitsJpeg4!
     std::auto_ptr<image::GnashImage> readDefineBitsJpeg3(SWFStream& in, TagType tag);
     std::auto_ptr<image::GnashImage> readLossless(SWFStream& in, TagType tag);
+    void addImage(movie_definition& m, const RunResources& r,
+            boost::uint16_t id, std::auto_ptr<image::GnashImage> im);
 
 }
 
@@ -140,6 +147,200 @@ public:
     }
 };
 
+/// Provide an IOChannel interface to a tag body kept in memory.
+//
+/// A long tag header is read first, so that the tag can be opened
+/// with SWFStream::open_tag().
+class TagChannel : public IOChannel
+{
+public:
+
+    TagChannel(TagType tag, boost::shared_ptr<const boost::uint8_t> body,
+            size_t size)
+        :
+        _body(body),
+        _size(size),
+        _pos(0)
+    {
+        const boost::uint16_t code = (tag << 6) | 0x3f;
+        _header[0] = code & 0xff;
+        _header[1] = code >> 8;
+        for (size_t i = 0; i < 4; ++i) {
+            _header[2 + i] = (size >> (8 * i)) & 0xff;
+        }
+    }
+
+    virtual std::streamsize read(void* dst, std::streamsize bytes) {
+        boost::uint8_t* out = static_cast<boost::uint8_t*>(dst);
+        std::streamsize got = 0;
+        while (got < bytes && _pos < headerSize + _size) {
+            const bool inHeader = _pos < headerSize;
+            const boost::uint8_t* from = inHeader ?
+                _header + _pos : _body.get() + _pos - headerSize;
+            const size_t left = inHeader ?
+                headerSize - _pos : headerSize + _size - _pos;
+            const size_t n = std::min<size_t>(left, bytes - got);
+            std::copy(from, from + n, out + got);
+            got += n;
+            _pos += n;
+        }
+        return got;
+    }
+
+    virtual void go_to_end() {
+        _pos = headerSize + _size;
+    }
+
+    virtual bool eof() const {
+        return _pos == headerSize + _size;
+    }
+
+    virtual bool seek(std::streampos pos) {
+        if (pos < 0 || static_cast<size_t>(pos) > headerSize + _size) {
+            return false;
+        }
+        _pos = pos;
+        return true;
+    }
+
+    virtual size_t size() const {
+        return headerSize + _size;
+    }
+
+    virtual std::streampos tell() const {
+        return _pos;
+    }
+
+    virtual bool bad() const {
+        return false;
+    }
+
+private:
+    static const size_t headerSize = 6;
+    boost::uint8_t _header[headerSize];
+    const boost::shared_ptr<const boost::uint8_t> _body;
+    const size_t _size;
+    size_t _pos;
+};
+
+/// Add a decoded bitmap to the movie on the loading thread.
+class PublishBitmap
+{
+public:
+    PublishBitmap(movie_definition& m, const RunResources& r,
+            boost::uint16_t id, std::auto_ptr<image::GnashImage> im)
+        :
+        _m(&m),
+        _r(&r),
+        _id(id),
+        _image(new std::auto_ptr<image::GnashImage>(im))
+    {
+    }
+
+    void operator()() const {
+        // Another tag with the same id may have been added meanwhile.
+        if (_m->getBitmap(_id)) {
+            IF_VERBOSE_MALFORMED_SWF(
+                log_swferror(_("DEFINEBITS: Duplicate id (%d) for bitmap "
+                        "DisplayObject - discarding it"), _id);
+            );
+            return;
+        }
+        addImage(*_m, *_r, _id, *_image);
+    }
+
+private:
+    movie_definition* _m;
+    const RunResources* _r;
+    boost::uint16_t _id;
+    boost::shared_ptr<std::auto_ptr<image::GnashImage> > _image;
+};
+
+/// Decode a bitmap tag from memory, so that it can be done on any thread.
+//
+/// The tag body is shared with the SWF input if that is in memory, and
+/// copied otherwise. DEFINEBITS tags cannot be read like this, as they
+/// need the movie's JPEG tables.
+class ReadBitmap
+{
+public:
+    ReadBitmap(SWFStream& in, TagType tag, boost::uint16_t id)
+        :
+        _tag(tag),
+        _id(id),
+        _size(in.get_tag_end_position() - in.tell())
+    {
+        assert(tag != SWF::DEFINEBITS);
+        _body = in.readShared(_size);
+    }
+
+    std::auto_ptr<image::GnashImage> operator()() const {
+        TagChannel ch(_tag, _body, _size);
+        SWFStream in(&ch);
+        in.open_tag();
+
+        std::auto_ptr<image::GnashImage> im;
+        switch (_tag) {
+            case SWF::DEFINEBITSJPEG2:
+                im = readDefineBitsJpeg2(in);
+                break;
+            case SWF::DEFINEBITSJPEG3:
+            case SWF::DEFINEBITSJPEG4:
+                im = readDefineBitsJpeg3(in, _tag);
+                break;
+            case SWF::DEFINELOSSLESS:
+            case SWF::DEFINELOSSLESS2:
+                im = readLossless(in, _tag);
+                break;
+            default:
+                std::abort();
+        }
+
+        if (!im.get()) {
+            IF_VERBOSE_MALFORMED_SWF(
+                log_swferror(_("Failed to parse bitmap for character %1%"),
+                    _id);
+            );
+        }
+        return im;
+    }
+
+    boost::uint16_t id() const {
+        return _id;
+    }
+
+private:
+    TagType _tag;
+    boost::uint16_t _id;
+    size_t _size;
+    boost::shared_ptr<const boost::uint8_t> _body;
+};
+
+/// Decode a bitmap on the movie's background decoder.
+class DecodeBitmap
+{
+public:
+    DecodeBitmap(const ReadBitmap& read, movie_definition& m,
+            const RunResources& r)
+        :
+        _read(read),
+        _m(&m),
+        _r(&r)
+    {
+    }
+
+    BackgroundDecoder::Publisher operator()() const {
+        std::auto_ptr<image::GnashImage> im = _read();
+        if (!im.get()) return BackgroundDecoder::Publisher();
+        return PublishBitmap(*_m, *_r, _read.id(), im);
+    }
+
+private:
+    ReadBitmap _read;
+    movie_definition* _m;
+    const RunResources* _r;
+};
+
 } // anonymous namespace
 
 // Load JPEG compression tables that can be used to load
@@ -209,27 +410,28 @@ DefineBitsTag::loader(SWFStream& in, TagType tag, movie_definition& m,
         return;
     }
 
-    std::auto_ptr<image::GnashImage> im;
+    // DEFINEBITS reads from the movie's shared JPEGTABLES loader, so it
+    // must be decoded here. The other bitmap tags are self-contained.
+    if (tag != SWF::DEFINEBITS) {
+        const ReadBitmap read(in, tag, id);
+
+        // Keep only the tag data until the bitmap is drawn.
+        Renderer* renderer = r.renderer();
+        if (renderer &&
+                RcInitFile::getDefaultInstance().getBitmapCacheSize()) {
+            IF_VERBOSE_PARSE(
+                log_parse(_("Adding bitmap id %1%"), id);
+            );
+            m.addBitmap(id, new LazyBitmap(read, *renderer));
+            return;
+        }
 
-    switch (tag) {
-        case SWF::DEFINEBITS:
-            im = readDefineBitsJpeg(in, m);
-            break;
-        case SWF::DEFINEBITSJPEG2:
-            im = readDefineBitsJpeg2(in);
-            break;
-        case SWF::DEFINEBITSJPEG3:
-        case SWF::DEFINEBITSJPEG4:
-            im = readDefineBitsJpeg3(in, tag);
-            break;
-        case SWF::DEFINELOSSLESS:
-        case SWF::DEFINELOSSLESS2:
-            im = readLossless(in, tag);
-            break;
-        default:
-            std::abort();
+        m.addDecodeJob(DecodeBitmap(read, m, r));
+        return;
     }
 
+    std::auto_ptr<image::GnashImage> im = readDefineBitsJpeg(in, m);
+
     if (!im.get()) {
         IF_VERBOSE_MALFORMED_SWF(
             log_swferror(_("Failed to parse bitmap for character %1%"), id);
@@ -237,6 +439,15 @@ DefineBitsTag::loader(SWFStream& in, TagType tag, movie_definition& m,
         return;
     }
 
+    addImage(m, r, id, im);
+}
+
+namespace {
+
+void
+addImage(movie_definition& m, const RunResources& r, boost::uint16_t id,
+        std::auto_ptr<image::GnashImage> im)
+{
     Renderer* renderer = r.renderer();
     if (!renderer) {
         IF_VERBOSE_PARSE(
@@ -253,8 +464,6 @@ DefineBitsTag::loader(SWFStream& in, TagType tag, movie_definition& m,
     m.addBitmap(id, bi);
 }
 
-namespace {
-
 // A JPEG image without included tables; those should be in an
 // existing image::JpegInput object stored in the movie.
 std::auto_ptr<image::GnashImage>
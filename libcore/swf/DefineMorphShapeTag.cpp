@@ -72,6 +72,29 @@ DefineMorphShapeTag::createDisplayObject(Global_as& gl,
     return new MorphShape(getRoot(gl), 0, this, parent);
 }
 
+boost::shared_ptr<const ShapeRecord>
+DefineMorphShapeTag::morph(boost::uint16_t ratio) const
+{
+    typedef std::vector<Morph> Morphs;
+
+    Morphs::iterator spare = _morphs.end();
+    for (Morphs::iterator it = _morphs.begin(), e = _morphs.end();
+            it != e; ++it) {
+        if (it->first == ratio) return it->second;
+        if (spare == e && it->second.unique()) spare = it;
+    }
+
+    if (spare == _morphs.end()) {
+        const boost::shared_ptr<ShapeRecord> s(new ShapeRecord(_shape1));
+        _morphs.push_back(Morph(ratio, s));
+        spare = _morphs.end() - 1;
+    }
+
+    spare->first = ratio;
+    spare->second->setLerp(_shape1, _shape2, ratio / 65535.0);
+    return spare->second;
+}
+
 void
 DefineMorphShapeTag::display(Renderer& renderer, const ShapeRecord& shape,
         const Transform& xform) const
@@ -23,6 +23,10 @@
 #ifndef GNASH_SWF_MORPH_SHAPE_H
 #define GNASH_SWF_MORPH_SHAPE_H
 
+#include <vector>
+#include <utility>
+#include <boost/shared_ptr.hpp>
+
 #include "SWF.h"
 #include "ShapeRecord.h"
 #include "DefinitionTag.h"
@@ -65,6 +69,15 @@ public:
         return _shape2;
     }
 
+    /// Return the shape at a ratio.
+    //
+    /// Instances at the same ratio share the shape. A shape that only
+    /// this tag still holds is lerped again in place for the next ratio
+    /// asked for, so instances should drop theirs before asking.
+    //
+    /// @param ratio    The ratio from 0 (shape1) to 65535 (shape2).
+    boost::shared_ptr<const ShapeRecord> morph(boost::uint16_t ratio) const;
+
 private:
 
     DefineMorphShapeTag(SWFStream& in, SWF::TagType tag, movie_definition& md,
@@ -95,6 +108,12 @@ private:
     
     SWFRect _bounds;
 
+    /// A morphed shape and its ratio.
+    typedef std::pair<boost::uint16_t, boost::shared_ptr<ShapeRecord> > Morph;
+
+    /// The shapes morphed for instances.
+    mutable std::vector<Morph> _morphs;
+
 };
 
 } // namespace SWF
@@ -20,6 +20,14 @@
 #include "ShapeRecord.h"
 
 #include <vector>
+#include <algorithm>
+#include <boost/static_assert.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
 
 #include "TypesParser.h"
 #include "utility.h"
@@ -47,6 +55,32 @@ namespace {
 // Functors for path and style manipulation.
 namespace {
 
+/// The last stamp handed out.
+//
+/// Shapes are parsed by the loader thread and changed (by the drawing
+/// API or morphing) in the main thread, so this must be atomic.
+//
+/// Where 64-bit atomics are not lock-free, boost::atomic would need
+/// libboost_atomic, so a mutex is used instead. 32 bits could wrap.
+#if BOOST_ATOMIC_LLONG_LOCK_FREE == 2
+boost::atomic<boost::uint64_t> lastStamp(0);
+#else
+boost::mutex stampMutex;
+boost::uint64_t lastStamp = 0;
+#endif
+
+/// Return a stamp never returned before.
+inline boost::uint64_t
+nextStamp()
+{
+#if BOOST_ATOMIC_LLONG_LOCK_FREE == 2
+    return lastStamp.fetch_add(1, boost::memory_order_relaxed) + 1;
+#else
+    boost::mutex::scoped_lock lock(stampMutex);
+    return ++lastStamp;
+#endif
+}
+
 template<typename T>
 class Lerp
 {
@@ -71,6 +105,39 @@ private:
     const double _ratio;
 };
 
+/// Set edges to the lerp of two others, as lerp<float> would.
+//
+/// The coordinates of all the edges are handled as one array.
+void
+lerpEdges(Edge* out, const Edge* a, const Edge* b, size_t count,
+        float ratio)
+{
+    BOOST_STATIC_ASSERT(sizeof(Edge) == 4 * sizeof(boost::int32_t));
+
+    boost::int32_t* o = &out->cp.x;
+    const boost::int32_t* p = &a->cp.x;
+    const boost::int32_t* q = &b->cp.x;
+    const size_t n = count * 4;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128 r = _mm_set1_ps(ratio);
+    for (; i + 4 <= n; i += 4) {
+        const __m128 x = _mm_cvtepi32_ps(_mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(p + i)));
+        const __m128 y = _mm_cvtepi32_ps(_mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(q + i)));
+        const __m128 v = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(y, x), r), x);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(o + i),
+                _mm_cvttps_epi32(v));
+    }
+#endif
+
+    for (; i < n; ++i) {
+        o[i] = static_cast<boost::int32_t>(lerp<float>(p[i], q[i], ratio));
+    }
+}
+
 // Facilities for working with list of paths.
 class PathList
 {
@@ -141,11 +208,15 @@ private:
 
 ShapeRecord::ShapeRecord(SWFStream& in, SWF::TagType tag, movie_definition& m,
         const RunResources& r)
+    :
+    _stamp(nextStamp())
 {
     read(in, tag, m, r);
 }
 
 ShapeRecord::ShapeRecord()
+    :
+    _stamp(nextStamp())
 {
 }
 
@@ -158,7 +229,8 @@ ShapeRecord::ShapeRecord(const ShapeRecord& other)
     _fillStyles(other._fillStyles),
     _lineStyles(other._lineStyles),
     _paths(other._paths),
-    _bounds(other._bounds)
+    _bounds(other._bounds),
+    _stamp(other._stamp)
 {
 }
     
@@ -169,12 +241,20 @@ ShapeRecord::operator=(const ShapeRecord& other)
     _lineStyles = other._lineStyles;
     _paths = other._paths;
     _bounds = other._bounds;
+    _stamp = other._stamp;
     return *this;
 }
 
+void
+ShapeRecord::touch()
+{
+    _stamp = nextStamp();
+}
+
 void
 ShapeRecord::clear()
 {
+    touch();
     _fillStyles.clear();
     _lineStyles.clear();
     _paths.clear();
@@ -184,6 +264,7 @@ ShapeRecord::clear()
 void
 ShapeRecord::addFillStyle(const FillStyle& fs)
 {
+    touch();
     _fillStyles.push_back(fs);
 }
 
@@ -191,6 +272,7 @@ void
 ShapeRecord::setLerp(const ShapeRecord& a, const ShapeRecord& b,
         const double ratio)
 {
+    touch();
 
     // Update current bounds.
     _bounds.set_lerp(a.getBounds(), b.getBounds(), ratio);
@@ -233,17 +315,21 @@ ShapeRecord::setLerp(const ShapeRecord& a, const ShapeRecord& b,
         const size_t len = p1.size();
         p.m_edges.resize(len);
 
-        for (size_t j=0; j < p.size(); j++) {
-            Edge& e = p[j];
-            const Edge& e1 = j < p1.size() ? p1[j] : empty_edge;
-
-            const Edge& e2 = k < p2.size() ? p2[k] : empty_edge;
+        // The edges of the second shape are taken in turn regardless of
+        // paths, wrapping round at the end of p2. Each run of edges that
+        // are consecutive in both shapes is lerped at once.
+        for (size_t j = 0; j < len; ) {
+            if (p2.m_edges.empty()) {
+                for (; j < len; ++j, ++n) {
+                    lerpEdges(&p[j], &p1[j], &empty_edge, 1, ratio);
+                }
+                break;
+            }
 
-            e.cp.x = static_cast<int>(lerp<float>(e1.cp.x, e2.cp.x, ratio));
-            e.cp.y = static_cast<int>(lerp<float>(e1.cp.y, e2.cp.y, ratio));
-            e.ap.x = static_cast<int>(lerp<float>(e1.ap.x, e2.ap.x, ratio));
-            e.ap.y = static_cast<int>(lerp<float>(e1.ap.y, e2.ap.y, ratio));
-            ++k;
+            const size_t run = std::min(len - j, p2.size() - k);
+            lerpEdges(&p[j], &p1[j], &p2[k], run, ratio);
+            j += run;
+            k += run;
 
             if (p2.size() <= k) {
                 k = 0;
@@ -258,6 +344,7 @@ void
 ShapeRecord::read(SWFStream& in, SWF::TagType tag, movie_definition& m,
         const RunResources& r)
 {
+    touch();
 
     /// TODO: is this correct?
     const bool styleInfo = (tag == SWF::DEFINESHAPE ||
@@ -25,6 +25,7 @@
 #include "SWFRect.h"
 
 #include <vector>
+#include <boost/cstdint.hpp>
 
 
 namespace gnash {
@@ -102,11 +103,27 @@ public:
         return _bounds;
     }
 
+    /// Return a stamp identifying the current contents of this ShapeRecord
+    //
+    /// The stamp changes whenever the shape is modified. Stamps are never
+    /// reused, except by copies with the same contents, so renderers can
+    /// use them to validate data cached for a shape.
+    boost::uint64_t stamp() const {
+        return _stamp;
+    }
+
+    /// Invalidate anything cached against this ShapeRecord
+    //
+    /// This must be called after modifying the Path returned by
+    /// currentPath().
+    void touch();
+
     /// For DynamicShape
     //
     /// TODO: rewrite DynamicShape to push paths when they're
     /// finished and drop this.
     Path& currentPath() {
+        touch();
         return _paths.back();
     }
 
@@ -122,14 +139,17 @@ public:
     void addFillStyle(const FillStyle& fs);
 
     void addPath(const Path& path) {
+        touch();
         _paths.push_back(path);
     }
 
     void addLineStyle(const LineStyle& ls) {
+        touch();
         _lineStyles.push_back(ls);
     }
 
     void setBounds(const SWFRect& bounds) {
+        touch();
         _bounds = bounds;
     }
 
@@ -150,6 +170,8 @@ private:
     Paths _paths;
     SWFRect _bounds;
 
+    boost::uint64_t _stamp;
+
 };
 
 std::ostream& operator<<(std::ostream& o, const ShapeRecord& sh);
@@ -59,6 +59,7 @@
 #include "as_value.h"
 #include "RunResources.h"
 #include "ObjectURI.h"
+#include "MemberCache.h"
 
 // GNASH_PARANOIA_LEVEL:
 // 0 : no assertions
@@ -1742,11 +1743,60 @@ pushConstant(ActionExec& thread, unsigned int id)
     env.push( (*pool)[id] );
 }
 
+/// Push the operands of a Push decoded by action_buffer.
+void
+pushDecoded(ActionExec& thread, const action_buffer::Instruction& insn)
+{
+    as_environment& env = thread.env;
+    const action_buffer& code = thread.code;
+
+    for (size_t i = 0; i < insn.operandCount; ++i) {
+
+        const action_buffer::PushOperand& op =
+            code.pushOperand(insn.operands + i);
+
+        switch (op.kind)
+        {
+            case action_buffer::PushOperand::VALUE:
+                env.push(op.value);
+                break;
+
+            case action_buffer::PushOperand::REGISTER:
+            {
+                const as_value* v = getVM(env).getRegister(op.index);
+                if (!v) {
+                    IF_VERBOSE_MALFORMED_SWF(
+                        log_swferror(_("Invalid register %d in ActionPush"),
+                            op.index);
+                    );
+                    env.push(as_value());
+                }
+                else env.push(*v);
+                break;
+            }
+
+            case action_buffer::PushOperand::CONSTANT:
+                pushConstant(thread, op.index);
+                break;
+        }
+
+        IF_VERBOSE_ACTION(
+            log_action(_("\t%d) value=%s"), i, env.top(0));
+        );
+    }
+}
+
 void
 ActionPushData(ActionExec& thread)
 {
     as_environment& env = thread.env;
 
+    const action_buffer::Instruction* insn = thread.instruction();
+    if (insn && insn->operands != action_buffer::noIndex) {
+        pushDecoded(thread, *insn);
+        return;
+    }
+
     enum {
         pushString,  
         pushFloat,
@@ -1875,7 +1925,7 @@ ActionPushData(ActionExec& thread)
 
             case pushDict16: // 9
             {
-                const boost::uint16_t id = code.read_int16(i + 3);
+                const boost::uint16_t id = code.read_uint16(i + 3);
                 i += 2;
                 pushConstant(thread, id);    
                 break;
@@ -1894,6 +1944,12 @@ ActionPushData(ActionExec& thread)
 void
 ActionBranchAlways(ActionExec& thread)
 {
+    const action_buffer::Instruction* insn = thread.instruction();
+    if (insn && insn->target != action_buffer::noIndex) {
+        thread.setNextPC(thread.code.instructions()[insn->target].pc);
+        return;
+    }
+
     boost::int16_t offset = thread.code.read_int16(thread.getCurrentPC()+3);
     thread.adjustNextPC(offset);
     // @@ TODO range checks
@@ -1937,10 +1993,15 @@ ActionBranchIfTrue(ActionExec& thread)
     assert(thread.atActionTag(SWF::ACTION_BRANCHIFTRUE));
 #endif
 
-    boost::int16_t offset = code.read_int16(pc+3);
-
     const bool test = toBool(env.pop(), getVM(env));
     if (test) {
+        const action_buffer::Instruction* insn = thread.instruction();
+        if (insn && insn->target != action_buffer::noIndex) {
+            thread.setNextPC(code.instructions()[insn->target].pc);
+            return;
+        }
+
+        const boost::int16_t offset = code.read_int16(pc + 3);
         thread.adjustNextPC(offset);
 
         if (nextPC > stopPC)
@@ -2593,7 +2654,11 @@ ActionGetMember(ActionExec& thread)
 
     const ObjectURI& k = getURI(getVM(env), member_name.to_string());
 
-    if (!obj->get_member(k, &env.top(1))) {
+    MemberCache* cache = thread.memberCache();
+    const bool found = cache ? cache->get(*obj, k, &env.top(1)) :
+                               obj->get_member(k, &env.top(1));
+
+    if (!found) {
         IF_VERBOSE_ASCODING_ERRORS(
             log_aserror("Reference to undefined member %s of object %s",
                 member_name, target);
@@ -2627,7 +2692,10 @@ ActionSetMember(ActionExec& thread)
         );
     }
     else if (obj) {
-        obj->set_member(getURI(getVM(env), member_name), member_value);
+        const ObjectURI& k = getURI(getVM(env), member_name);
+        MemberCache* cache = thread.memberCache();
+        if (cache) cache->set(*obj, k, member_value);
+        else obj->set_member(k, member_value);
 
         IF_VERBOSE_ACTION (
             log_action(_("-- set_member %s.%s=%s"),
@@ -76,7 +76,9 @@ ActionExec::ActionExec(const Function& func, as_environment& newEnv,
     _abortOnUnload(false),
     pc(func.getStartPC()),
     next_pc(pc),
-    stop_pc(pc + func.getLength())
+    stop_pc(pc + func.getLength()),
+    _memberCache(0),
+    _instruction(0)
 {
     assert(stop_pc < code.size());
 
@@ -119,7 +121,9 @@ ActionExec::ActionExec(const action_buffer& abuf, as_environment& newEnv,
     _abortOnUnload(abortOnUnloaded),
     pc(0),
     next_pc(0),
-    stop_pc(abuf.size())
+    stop_pc(abuf.size()),
+    _memberCache(0),
+    _instruction(0)
 {
 }
 
@@ -168,6 +172,12 @@ ActionExec::operator()()
     const size_t maxTime = getRoot(vm).getTimeoutLimit() * 1000;
     SystemClock clock; // TODO: should we use a CPUClock here ?
 
+    // The pre-decoded action stream. The index of the current action
+    // is predicted after each step and checked against pc, so that
+    // handlers and try blocks are free to move pc anywhere.
+    const action_buffer::Instructions& insns = code.instructions();
+    size_t idx = code.findInstruction(pc);
+
     try {
 
         // We might not stop at stop_pc, if we are trying.
@@ -215,8 +225,19 @@ ActionExec::operator()()
                 _scopeStack.pop_back();
             }
 
+            if (idx >= insns.size() || insns[idx].pc != pc) {
+                idx = code.findInstruction(pc);
+            }
+
+            const action_buffer::Instruction* insn =
+                idx < insns.size() ? &insns[idx] : 0;
+
+            _instruction = insn;
+            _memberCache = (insn && insn->cache != action_buffer::noIndex) ?
+                &code.memberCache(insn->cache) : 0;
+
             // Get the opcode.
-            boost::uint8_t action_id = code[pc];
+            const boost::uint8_t action_id = insn ? insn->id : code[pc];
 
             IF_VERBOSE_ACTION (
                 log_action(_("PC:%d - EX: %s"), pc, code.disasm(pc));
@@ -224,7 +245,11 @@ ActionExec::operator()()
 
             // Set default next_pc offset, control flow action handlers
             // will be able to reset it.
-            if ((action_id & 0x80) == 0) {
+            if (insn && insn->nextPC <= stop_pc) {
+                // Already decoded and checked.
+                next_pc = insn->nextPC;
+            }
+            else if ((action_id & 0x80) == 0) {
                 // action with no extra data
                 next_pc = pc+1;
             }
@@ -318,6 +343,16 @@ ActionExec::operator()()
                 // TODO: Run garbage collector ? If stack isn't too big ?
             }
 
+            // Predict the next instruction: either the following one
+            // or a resolved branch target.
+            if (insn) {
+                if (next_pc == insn->nextPC) ++idx;
+                else if (insn->target != action_buffer::noIndex &&
+                        next_pc == insns[insn->target].pc) {
+                    idx = insn->target;
+                }
+            }
+
             // Control flow actions will change the PC (next_pc)
             pc = next_pc;
         }
@@ -570,6 +605,12 @@ ActionExec::skip_actions(size_t offset)
             return;
         }
 
+        const size_t idx = code.findInstruction(next_pc);
+        if (idx < code.instructions().size()) {
+            next_pc = code.instructions()[idx].nextPC;
+            continue;
+        }
+
         // Get the opcode.
         const boost::uint8_t action_id = code[next_pc];
 
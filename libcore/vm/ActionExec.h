@@ -33,6 +33,7 @@ namespace gnash {
 	class as_value;
 	class Function;
 	class ActionExec;
+	class MemberCache;
 }
 
 namespace gnash {
@@ -234,6 +235,14 @@ public:
 	void setNextPC(size_t pc) { next_pc = pc; }
 	
 	size_t getStopPC() const { return stop_pc; }
+
+	/// The inline cache of the current action, if it has one.
+	MemberCache* memberCache() const { return _memberCache; }
+
+	/// The decoded form of the current action, if it has one.
+	const action_buffer::Instruction* instruction() const {
+		return _instruction;
+	}
 	
 private: 
 
@@ -326,6 +335,12 @@ private:
 	/// Used for try/throw/catch blocks.
 	size_t stop_pc;
 
+	/// Inline cache of the current action, or null
+	MemberCache* _memberCache;
+
+	/// Decoded form of the current action, or null
+	const action_buffer::Instruction* _instruction;
+
 };
 
 } // namespace gnash
@@ -85,6 +85,7 @@ setLocal(CallFrame& c, const ObjectURI& name, const as_value& val)
     // unlikely that it is an optimization.
     Property* prop = locals.getOwnProperty(name);
     if (prop) {
+        locals.writeBarrier();
         prop->setValue(locals, val);
         return;
     }
@@ -0,0 +1,225 @@
+// MemberCache.cpp:  inline caches for member lookups, for Gnash.
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+//
+
+#include "MemberCache.h"
+
+#include <algorithm>
+
+#include "as_object.h"
+#include "as_value.h"
+#include "Property.h"
+#include "PropertyList.h"
+#include "ObjectURI.h"
+#include "namedStrings.h"
+#include "GnashException.h"
+#include "log.h"
+
+namespace gnash {
+
+namespace {
+
+/// Whether lookups on this object follow the ordinary rules.
+inline bool
+cacheable(const as_object& o)
+{
+    return !o.displayObject() && !o.array() && !o.isSuper();
+}
+
+}
+
+MemberCache::MemberCache()
+    :
+    _next(0),
+    _misses(0)
+{
+}
+
+Property*
+MemberCache::Entry::find(as_object& obj, const ObjectURI& uri,
+        string_table::key key, int swfVersion) const
+{
+    if (!depth || name != key || version != swfVersion) return 0;
+    if (obj._members.stamp() != stamps[0] || !cacheable(obj)) return 0;
+
+    const as_object* owner = &obj;
+    for (size_t i = 1; i < depth; ++i) {
+        owner = protos[i - 1];
+        if (owner->_members.stamp() != stamps[i]) return 0;
+        if (!cacheable(*owner)) return 0;
+    }
+
+    // Flags may have been changed through the Property itself.
+    Property* prop = owner->_members.getProperty(uri);
+    if (!prop || !visible(*prop, swfVersion)) return 0;
+    return prop;
+}
+
+bool
+MemberCache::get(as_object& obj, const ObjectURI& uri, as_value* val)
+{
+    const int swfVersion = getSWFVersion(obj);
+    const string_table::key key = getName(uri);
+
+    Property* prop = 0;
+    for (size_t i = 0; i < ways && !prop; ++i) {
+        prop = _entries[i].find(obj, uri, key, swfVersion);
+    }
+
+    if (!prop) {
+        if (_misses == maxMisses) return obj.get_member(uri, val);
+        ++_misses;
+
+        Entry found;
+        prop = lookup(obj, uri, swfVersion, found);
+        if (!prop) return obj.get_member(uri, val);
+        nextEntry() = found;
+    }
+
+    try {
+        *val = prop->getValue(obj);
+        return true;
+    }
+    catch (const ActionTypeError& exc) {
+        IF_VERBOSE_ASCODING_ERRORS(
+            log_aserror(_("Caught exception: %s"), exc.what());
+        );
+        return false;
+    }
+}
+
+void
+MemberCache::set(as_object& obj, const ObjectURI& uri, const as_value& val)
+{
+    const int swfVersion = getSWFVersion(obj);
+    const string_table::key key = getName(uri);
+
+    for (size_t i = 0; i < ways; ++i) {
+        const Entry& e = _entries[i];
+        if (e.depth != 1) continue;
+
+        Property* prop = e.find(obj, uri, key, swfVersion);
+        if (!prop) continue;
+
+        // Watches are handled by as_object.
+        if (obj._trigs.get() && !obj._trigs->empty()) break;
+
+        if (readOnly(*prop)) {
+            IF_VERBOSE_ASCODING_ERRORS(
+                ObjectURI::Logger l(getStringTable(obj));
+                log_aserror(_("Attempt to set read-only property '%s'"),
+                            l(uri));
+            );
+            return;
+        }
+
+        try {
+            obj._members.writeBarrier();
+            prop->setValue(obj, val);
+            prop->clearVisible(swfVersion);
+        }
+        catch (const ActionTypeError& exc) {
+            IF_VERBOSE_ASCODING_ERRORS(
+                log_aserror(_("%s: %s"), getStringTable(obj).value(key),
+                    exc.what());
+            );
+        }
+        return;
+    }
+
+    obj.set_member(uri, val);
+
+    if (_misses == maxMisses) return;
+    ++_misses;
+    fillSet(obj, uri, swfVersion);
+}
+
+MemberCache::Entry&
+MemberCache::nextEntry()
+{
+    Entry& e = _entries[_next];
+    _next = (_next + 1) % ways;
+    return e;
+}
+
+Property*
+MemberCache::lookup(as_object& obj, const ObjectURI& uri, int swfVersion,
+        Entry& e) const
+{
+    as_object* o = &obj;
+
+    for (e.depth = 0; e.depth < maxDepth; ++e.depth) {
+
+        if (!cacheable(*o)) return 0;
+
+        // Cycles are left to as_object.
+        if (e.depth) {
+            if (o == &obj) return 0;
+            const as_object** end = e.protos + e.depth - 1;
+            if (std::find(e.protos, end, o) != end) return 0;
+            *end = o;
+        }
+        e.stamps[e.depth] = o->_members.stamp();
+
+        Property* prop = o->_members.getProperty(uri);
+        if (prop) {
+            // An invisible member would be skipped by the lookup, but
+            // changing its flags would not change the stamp.
+            if (!visible(*prop, swfVersion)) return 0;
+            ++e.depth;
+            e.name = getName(uri);
+            e.version = swfVersion;
+            return prop;
+        }
+
+        // The inheritance chain must be fixed for the stamps to be
+        // meaningful.
+        Property* proto = o->_members.getProperty(NSV::PROP_uuPROTOuu);
+        if (!proto || proto->isGetterSetter()) return 0;
+        if (!visible(*proto, swfVersion)) return 0;
+
+        const as_value& p = proto->getCache();
+        if (!p.is_object() || p.is_sprite()) return 0;
+        o = p.get_object();
+    }
+    return 0;
+}
+
+void
+MemberCache::fillSet(as_object& obj, const ObjectURI& uri, int swfVersion)
+{
+    if (!cacheable(obj)) return;
+
+    const string_table::key key = getName(uri);
+
+    // Setting __proto__ must go through as_object.
+    if (key == NSV::PROP_uuPROTOuu) return;
+
+    Property* prop = obj._members.getProperty(uri);
+    if (!prop || !visible(*prop, swfVersion)) return;
+    if (getName(prop->uri()) != key) return;
+
+    Entry& e = nextEntry();
+    e.stamps[0] = obj._members.stamp();
+    e.depth = 1;
+    e.name = key;
+    e.version = swfVersion;
+}
+
+} // namespace gnash
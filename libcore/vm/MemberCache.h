@@ -0,0 +1,125 @@
+// 
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+// 
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef GNASH_VM_MEMBER_CACHE_H
+#define GNASH_VM_MEMBER_CACHE_H
+
+#include <boost/cstdint.hpp>
+
+#include "string_table.h"
+
+// Forward declarations
+namespace gnash {
+    class as_object;
+    class as_value;
+    class Property;
+    struct ObjectURI;
+}
+
+namespace gnash {
+
+/// An inline cache for the member lookups of a single action.
+//
+/// A GetMember or SetMember action usually sees objects of the same
+/// class and the same member names every time it runs. The cache
+/// remembers the PropertyList stamps of every object on the way to the
+/// Property a lookup ended at. Objects that had the same members added
+/// in the same order share a stamp, so an entry serves every instance
+/// of a class, and a repeated lookup only has to find the Property on
+/// the object that has it.
+//
+/// DisplayObjects, arrays and super objects have their own lookup rules
+/// and are never cached. Lookups that end at __resolve are not cached
+/// either. A site that keeps missing is left to as_object.
+class MemberCache
+{
+public:
+
+    MemberCache();
+
+    /// Get a member of an object
+    //
+    /// This behaves exactly like as_object::get_member().
+    bool get(as_object& obj, const ObjectURI& uri, as_value* val);
+
+    /// Set a member of an object
+    //
+    /// This behaves exactly like as_object::set_member().
+    void set(as_object& obj, const ObjectURI& uri, const as_value& val);
+
+private:
+
+    /// The longest inheritance chain remembered.
+    static const size_t maxDepth = 4;
+
+    /// The number of shapes remembered.
+    static const size_t ways = 2;
+
+    /// The misses after which lookups are no longer cached.
+    static const size_t maxMisses = 32;
+
+    struct Entry
+    {
+        Entry() : depth(0), name(0), version(0) {}
+
+        /// Find the Property the entry leads to, if it still applies.
+        Property* find(as_object& obj, const ObjectURI& uri,
+                string_table::key key, int swfVersion) const;
+
+        /// The prototypes visited after the target object.
+        //
+        /// A stamp determines the __proto__ of the objects having it, so
+        /// as long as the stamps before them match, these are the
+        /// prototypes of the object looked up, and alive.
+        const as_object* protos[maxDepth - 1];
+
+        /// The stamps of the objects visited, starting at the target.
+        boost::uint64_t stamps[maxDepth];
+
+        /// The number of objects visited.
+        size_t depth;
+
+        string_table::key name;
+        int version;
+    };
+
+    /// Return the entry to use for a new lookup.
+    Entry& nextEntry();
+
+    /// Walk the inheritance chain as as_object::get_member() does.
+    //
+    /// @return     The Property found, or 0 if the lookup can't be cached,
+    ///             in which case as_object must do it.
+    Property* lookup(as_object& obj, const ObjectURI& uri, int swfVersion,
+            Entry& e) const;
+
+    /// Record an own property that was just set.
+    void fillSet(as_object& obj, const ObjectURI& uri, int swfVersion);
+
+    Entry _entries[ways];
+
+    /// The entry to replace next.
+    size_t _next;
+
+    /// The lookups that were not found in the cache.
+    size_t _misses;
+};
+
+} // namespace gnash
+
+#endif
@@ -0,0 +1,234 @@
+// ADPCMDecoder.cpp -- decoder for the ADPCM variant used in SWF and FLV
+// 
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+// 
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "ADPCMDecoder.h"
+
+#include <algorithm>
+
+#include "GnashNumeric.h" // for clamp
+#include "log.h"
+
+namespace gnash {
+namespace media {
+
+namespace {
+
+/// The samples in each block for each channel, including the first.
+const size_t blockSamples = 4096;
+
+// Data from Jansen.  http://homepages.cwi.nl/~jack/
+// Check out his Dutch retro punk songs, heh heh :)
+const int stepSizes = 89;
+const int stepSize[stepSizes] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+	19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+	130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+	337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+	876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+	2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+	5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+// Data from Alexis' SWF reference
+const int indexUpdate2[2] = { -1,  2 };
+const int indexUpdate3[4] = { -1, -1,  2,  4 };
+const int indexUpdate4[8] = { -1, -1, -1, -1,  2,  4,  6,  8 };
+const int indexUpdate5[16] = { -1, -1, -1, -1, -1, -1, -1, -1,
+	1,  2,  4,  6,  8, 10, 13, 16 };
+
+const int* const indexUpdate[4] = {
+	indexUpdate2, indexUpdate3, indexUpdate4, indexUpdate5
+};
+
+/// Reads the data most significant bit first.
+//
+/// The caller checks that there are enough bits before reading.
+class Bits
+{
+public:
+
+	Bits(const boost::uint8_t* data, size_t size)
+		:
+		_data(data),
+		_left(size * 8),
+		_bits(0),
+		_count(0)
+	{}
+
+	/// The number of bits not yet read.
+	size_t left() const { return _left; }
+
+	/// Read up to 24 bits.
+	unsigned int read(unsigned int n)
+	{
+		while (_count < n) {
+			_bits = (_bits << 8) | *_data++;
+			_count += 8;
+		}
+		_count -= n;
+		_left -= n;
+		return (_bits >> _count) & ((1u << n) - 1);
+	}
+
+private:
+
+	const boost::uint8_t* _data;
+	size_t _left;
+	boost::uint32_t _bits;
+	unsigned int _count;
+};
+
+/// The state of one channel.
+struct Channel
+{
+	int sample;
+	int index;
+};
+
+/// The change to the sample and the next step index for every code at
+/// every step index.
+template<unsigned int N>
+struct Steps
+{
+	static const unsigned int codes = 1 << N;
+
+	Steps()
+	{
+		const unsigned int hiBit = 1 << (N - 1);
+		for (int i = 0; i < stepSizes; ++i) {
+			for (unsigned int code = 0; code < codes; ++code) {
+
+				/* Core of ADPCM. */
+				const unsigned int mag = code & (hiBit - 1);
+
+				/* Shift in LSB (they do this so that pos & neg zero
+				 * are different). The delta is something like
+				 * stepsize * (code * 2 + 1) >> code_bits */
+				int d = (stepSize[i] * ((mag << 1) + 1)) >> (N - 1);
+				if (code & hiBit) d = -d;
+				delta[i][code] = d;
+
+				next[i][code] = clamp<int>(i + indexUpdate[N - 2][mag], 0,
+						stepSizes - 1);
+			}
+		}
+	}
+
+	boost::int32_t delta[stepSizes][codes];
+	boost::uint8_t next[stepSizes][codes];
+};
+
+/// Decodes samples of N bit codes for C channels.
+template<unsigned int N, unsigned int C>
+struct Block
+{
+	/// Decode the codes of as much of a block as there is.
+	//
+	/// @return     The number of samples written for each channel.
+	static size_t decode(Bits& in, Channel* ch, boost::int16_t* out)
+	{
+		static const Steps<N> steps;
+
+		const size_t codes = std::min(blockSamples - 1, in.left() / (N * C));
+
+		for (size_t i = 0; i < codes; ++i) {
+			for (unsigned int c = 0; c < C; ++c) {
+				const unsigned int code = in.read(N);
+				const int index = ch[c].index;
+				ch[c].sample = clamp<int>(ch[c].sample +
+						steps.delta[index][code], -32768, 32767);
+				ch[c].index = steps.next[index][code];
+				*out++ = ch[c].sample;
+			}
+		}
+		return codes;
+	}
+};
+
+/// Decode all the blocks of N bit codes for C channels.
+template<unsigned int N, unsigned int C>
+size_t
+decodeBlocks(Bits& in, boost::int16_t* out)
+{
+	size_t samples = 0;
+	Channel ch[C];
+
+	while (in.left() >= 22 * C) {
+
+		// The first sample and step index of each channel.
+		for (unsigned int c = 0; c < C; ++c) {
+			ch[c].sample = static_cast<boost::int16_t>(in.read(16));
+			ch[c].index = in.read(6);
+			*out++ = ch[c].sample;
+		}
+
+		const size_t codes = Block<N, C>::decode(in, ch, out);
+		out += codes * C;
+		samples += codes + 1;
+	}
+	return samples;
+}
+
+} // anonymous namespace
+
+size_t
+ADPCMDecoder::maxSamples(size_t size)
+{
+	// Each sample takes at least 2 bits.
+	return size * 4;
+}
+
+size_t
+ADPCMDecoder::decode(const boost::uint8_t* in, size_t size, bool stereo,
+		boost::int16_t* out)
+{
+	Bits bits(in, size);
+
+	if (bits.left() < 2) {
+		IF_VERBOSE_MALFORMED_SWF(
+			log_swferror(_("corrupted ADPCM header"));
+		);
+		return 0;
+	}
+
+	switch (bits.read(2) + 2) {
+		case 2:
+			return stereo ? decodeBlocks<2, 2>(bits, out) :
+				decodeBlocks<2, 1>(bits, out);
+		case 3:
+			return stereo ? decodeBlocks<3, 2>(bits, out) :
+				decodeBlocks<3, 1>(bits, out);
+		case 4:
+			return stereo ? decodeBlocks<4, 2>(bits, out) :
+				decodeBlocks<4, 1>(bits, out);
+		default:
+			return stereo ? decodeBlocks<5, 2>(bits, out) :
+				decodeBlocks<5, 1>(bits, out);
+	}
+}
+
+} // namespace media
+} // namespace gnash 
+
+// Local Variables:
+// mode: C++
+// indent-tabs-mode: t
+// End:
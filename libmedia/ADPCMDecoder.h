@@ -0,0 +1,77 @@
+// ADPCMDecoder.h -- decoder for the ADPCM variant used in SWF and FLV
+// 
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+// 
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef GNASH_ADPCMDECODER_H
+#define GNASH_ADPCMDECODER_H
+
+#include <cstddef>
+#include <boost/cstdint.hpp> // for boost::int16_t
+
+#include "dsodefs.h"
+
+namespace gnash {
+namespace media {
+
+/// Decoder for SWF ADPCM.
+//
+/// The data starts with the number of bits per code, 2 to 5. It is
+/// followed by blocks of up to 4096 samples for each channel: the
+/// first sample and step index of each channel, then a code for each
+/// further sample, alternating between channels.
+//
+/// Algo from http://www.circuitcellar.com/pastissues/articles/richey110/text.htm
+/// And also Jansen.
+/// Here's another reference: http://www.geocities.com/SiliconValley/8682/aud3.txt
+/// Original IMA spec doesn't seem to be on the web :(
+class DSOEXPORT ADPCMDecoder
+{
+public:
+
+	/// The most samples, for all channels, that some data decodes to.
+	//
+	/// @param size     The size of the data in bytes.
+	static size_t maxSamples(size_t size);
+
+	/// Decode ADPCM data.
+	//
+	/// Only whole samples are decoded; bits left over at the end are
+	/// ignored.
+	//
+	/// @param in       The data.
+	/// @param size     The size of the data in bytes.
+	/// @param stereo   Whether the data has two channels.
+	/// @param out      Where to write the samples, interleaved for stereo.
+	///                 There must be room for maxSamples(size).
+	/// @return         The number of samples written for each channel.
+	static size_t decode(const boost::uint8_t* in, size_t size, bool stereo,
+			boost::int16_t* out);
+};
+
+} // namespace media
+} // namespace gnash
+
+#endif // GNASH_ADPCMDECODER_H
+
+
+// Local Variables:
+// mode: C++
+// c-basic-offset: 8 
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
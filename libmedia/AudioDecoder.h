@@ -21,6 +21,9 @@
 #define GNASH_AUDIODECODER_H
 
 #include <boost/cstdint.hpp> // for C99 int types
+#include <boost/shared_ptr.hpp>
+
+#include "BufferPool.h"
 
 // Forward declarations
 namespace gnash {
@@ -42,6 +45,14 @@ public:
 	// virtual classes need a virtual destructor !
 	virtual ~AudioDecoder() {}
 
+	/// Take decoded data from a BufferPool instead of the heap.
+	//
+	/// The caller must then give the decoded data back with
+	/// BufferPool::release() rather than delete [].
+	void setBufferPool(boost::shared_ptr<BufferPool> pool) {
+		_bufferPool = pool;
+	}
+
 	/// Decodes a frame and returns a pointer to the data
 	//
 	/// @param input
@@ -58,7 +69,8 @@ public:
 	///		is passed by reference.
 	///
 	/// @return a pointer to the decoded data, or NULL if decoding fails.
-	///     The caller owns the decoded data, which was allocated with new [].
+	///     The caller owns the decoded data, which was allocated with new []
+	///     or from the BufferPool, if one was set.
 	///
 	/// @todo return a SimpleBuffer by auto_ptr
 	///
@@ -75,13 +87,45 @@ public:
 	/// 	The output size of the video data, is passed by reference.
 	///
 	/// @return a pointer to the decoded data, or NULL if decoding fails.
-	///     The caller owns the decoded data, which was allocated with new [].
+	///     The caller owns the decoded data, which was allocated with new []
+	///     or from the BufferPool, if one was set.
 	///
 	/// @todo return a SimpleBuffer by auto_ptr
 	///
 	virtual boost::uint8_t* decode(const EncodedAudioFrame& input,
 	                               boost::uint32_t& outputSize);
 
+	/// Return the decoded data held back at the end of the input
+	//
+	/// Some decoders delay their output, for instance to resample it.
+	/// This should be called when the input ends. Decoding after it
+	/// starts a new sound.
+	//
+	/// @param outputSize
+	/// 	Set to the size of the returned data.
+	///
+	/// @return a pointer to the decoded data, or NULL if there is none.
+	///     The caller owns it as for decode().
+	virtual boost::uint8_t* flush(boost::uint32_t& outputSize);
+
+protected:
+
+	/// Allocate a buffer for decoded data as the caller expects.
+	boost::uint8_t* allocateOutput(size_t size) {
+		if (_bufferPool) return _bufferPool->allocate(size);
+		return new boost::uint8_t[size];
+	}
+
+	/// Free a buffer from allocateOutput() that is not returned.
+	void releaseOutput(boost::uint8_t* buf) {
+		if (_bufferPool) _bufferPool->release(buf);
+		else delete [] buf;
+	}
+
+private:
+
+	boost::shared_ptr<BufferPool> _bufferPool;
+
 };
 
 inline boost::uint8_t*
@@ -96,6 +140,13 @@ AudioDecoder::decode(const EncodedAudioFrame&, boost::uint32_t&)
 {
     return 0;
 }
+
+inline boost::uint8_t*
+AudioDecoder::flush(boost::uint32_t& outputSize)
+{
+    outputSize = 0;
+    return 0;
+}
 	
 } // gnash.media namespace 
 } // gnash namespace
@@ -21,261 +21,55 @@
 
 #include "AudioDecoderSimple.h"
 #include "AudioResampler.h"
-#include "BitsReader.h"
+#include "ADPCMDecoder.h"
 #include "SoundInfo.h"
 #include "MediaParser.h" // for AudioInfo definition..
-#include "GnashNumeric.h" // for clamp
 
 #include "log.h"
 
 #include <boost/scoped_array.hpp>
 #include <algorithm> // for std::swap
 
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
 namespace gnash {
 namespace media {
 
-// ----------------------------------------------------------------------------
-// ADPCMDecoder class
-// ----------------------------------------------------------------------------
-
-/// ADPCM decoder utilities
-//
-/// Algo from http://www.circuitcellar.com/pastissues/articles/richey110/text.htm
-/// And also Jansen.
-/// Here's another reference: http://www.geocities.com/SiliconValley/8682/aud3.txt
-/// Original IMA spec doesn't seem to be on the web :(
-///
-/// TODO: move in it's own file
-///
-class ADPCMDecoder {
-
-private:
-
-	// Data from Alexis' SWF reference
-	static int _index_update_table_2bits[2];
-	static int _index_update_table_3bits[4];
-	static int _index_update_table_4bits[8];
-	static int _index_update_table_5bits[16];
-
-	static int* s_index_update_tables[4];
-
-	// Data from Jansen.  http://homepages.cwi.nl/~jack/
-	// Check out his Dutch retro punk songs, heh heh :)
-	static const int STEPSIZE_CT = 89;
-	static int s_stepsize[STEPSIZE_CT];
-
-
-	static void doSample(int n_bits, int& sample, int& stepsize_index, int raw_code)
-	{
-		assert(raw_code >= 0 && raw_code < (1 << n_bits));
-
-		static const int	HI_BIT = (1 << (n_bits - 1));
-		int*	index_update_table = s_index_update_tables[n_bits - 2];
-
-		/* Core of ADPCM. */
-
-		int	code_mag = raw_code & (HI_BIT - 1);
-		bool	code_sign_bit = (raw_code & HI_BIT) ? 1 : 0;
-		int	mag = (code_mag << 1) + 1;	/* shift in LSB (they do this so that pos & neg zero are different)*/
-
-		int	stepsize = s_stepsize[stepsize_index];
-
-		/* Compute the new sample.  It's the predicted value			*/
-		/* (i.e. the previous value), plus a delta.  The delta			*/
-		/* comes from the code times the stepsize.  going for			*/
-		/* something like: delta = stepsize * (code * 2 + 1) >> code_bits	*/
-		int	delta = (stepsize * mag) >> (n_bits - 1);
-		if (code_sign_bit) delta = -delta;
-
-		sample += delta;
-		sample = clamp<int>(sample, -32768, 32767);
-
-		/* Update our stepsize index.  Use a lookup table. */
-		stepsize_index += index_update_table[code_mag];
-		stepsize_index = clamp<int>(stepsize_index, 0, STEPSIZE_CT - 1);
-	}
-
-	/* Uncompress 4096 mono samples of ADPCM. */
-	static boost::uint32_t doMonoBlock(boost::int16_t** out_data, int n_bits, BitsReader& in, int sample, int stepsize_index)
-	{
-		/* First sample doesn't need to be decompressed. */
-		boost::uint32_t sample_count = 1;
-		*(*out_data)++ = (boost::int16_t) sample;
-
-		while (sample_count < 4096 && in.gotBits(n_bits))
-		{
-			int	raw_code = in.read_uint(n_bits);
-			doSample(n_bits, sample, stepsize_index, raw_code);	/* sample & stepsize_index are in/out params */
-			*(*out_data)++ = (boost::int16_t) sample;
-
-			sample_count++;
-		}	
-		return sample_count;
-	}
-
-
-	/* Uncompress 4096 stereo sample pairs of ADPCM. */
-	static int doStereoBlock(
-			boost::int16_t** out_data,	// in/out param
-			int n_bits,
-			BitsReader& in,
-			int left_sample,
-			int left_stepsize_index,
-			int right_sample,
-			int right_stepsize_index
-			)
-	{
-		/* First samples don't need to be decompressed. */
-		boost::uint32_t sample_count = 2;
-		*(*out_data)++ = (boost::int16_t) left_sample;
-		*(*out_data)++ = (boost::int16_t) right_sample;
-
-		unsigned bitsNeeded = n_bits*2;
-		while (sample_count < 4096 && in.gotBits(bitsNeeded))
-		{														
-			int	left_raw_code = in.read_uint(n_bits);
-			doSample(n_bits, left_sample, left_stepsize_index, left_raw_code);
-			*(*out_data)++ = (boost::int16_t) left_sample;
-
-			int	right_raw_code = in.read_uint(n_bits);
-			doSample(n_bits, right_sample, right_stepsize_index, right_raw_code);
-			*(*out_data)++ = (boost::int16_t) right_sample;
-
-			sample_count++;
-		}
-		return sample_count;
-	}
-
-public:
-
-	// Utility function: uncompress ADPCM data from in BitReader to
-	// out_data[]. Returns the output samplecount.
-	static boost::uint32_t adpcm_expand(
-		unsigned char* &data,
-		BitsReader& in,
-		unsigned int insize,
-		bool stereo)
-	{
-		// Read header.
-		if ( ! in.gotBits(2) )
-		{
-			IF_VERBOSE_MALFORMED_SWF(
-			log_swferror(_("corrupted ADPCM header"));
-			);
-			return 0;
-		}
-		unsigned int n_bits = in.read_uint(2) + 2; // 2 to 5 bits 
-
-		// The compression ratio is 4:1, so this should be enough...
-		boost::int16_t* out_data = new boost::int16_t[insize * 5];
-		data = reinterpret_cast<unsigned char *>(out_data);
-
-		boost::uint32_t sample_count = 0;
-
-		while ( in.gotBits(22) )
-		{
-			// Read initial sample & index values.
-
-			int	sample = in.read_sint(16);
-
-			int	stepsize_index = in.read_uint(6);
-			assert(STEPSIZE_CT >= (1 << 6));	// ensure we don't need to clamp.
-
-			if (stereo == false)
-			{
-
-				if (n_bits == 0) {
-					abort();
-				} else if (n_bits == 2) {
-					sample_count += doMonoBlock(&out_data, 2, in, sample, stepsize_index);
-				} else if (n_bits == 3) {
-					sample_count += doMonoBlock(&out_data, 3, in, sample, stepsize_index);
-				} else if (n_bits == 4) {
-					sample_count += doMonoBlock(&out_data, 4, in, sample, stepsize_index);
-				} else if (n_bits == 5) {
-					sample_count += doMonoBlock(&out_data, 5, in, sample, stepsize_index);
-				}
-			}
-			else
-			{
-				// Stereo.
-
-				// Got values for left channel; now get initial sample
-				// & index for right channel.
-				int	right_sample = in.read_sint(16);
-
-				int	right_stepsize_index = in.read_uint(6);
-				assert(STEPSIZE_CT >= (1 << 6));	// ensure we don't need to clamp.
-
-				if (n_bits == 0) {
-					abort();
-				} else if (n_bits == 2) {
-					sample_count += doStereoBlock(&out_data, 2, in, sample, stepsize_index, right_sample, right_stepsize_index);
-				} else if (n_bits == 3) {
-					sample_count += doStereoBlock(&out_data, 3, in, sample, stepsize_index, right_sample, right_stepsize_index);
-				} else if (n_bits == 4) {
-					sample_count += doStereoBlock(&out_data, 4, in, sample, stepsize_index, right_sample, right_stepsize_index);
-				} else if (n_bits == 5) {
-					sample_count += doStereoBlock(&out_data, 5, in, sample, stepsize_index, right_sample, right_stepsize_index);
-				}
-
-			}
-		}
-		return sample_count;
-
-	}
-
-};
-
-int ADPCMDecoder::_index_update_table_2bits[2] = { -1,  2 };
-int ADPCMDecoder::_index_update_table_3bits[4] = { -1, -1,  2,  4 };
-int ADPCMDecoder::_index_update_table_4bits[8] = { -1, -1, -1, -1,  2,  4,  6,  8 };
-int ADPCMDecoder::_index_update_table_5bits[16] = { -1, -1, -1, -1, -1, -1, -1, -1, 1,  2,  4,  6,  8, 10, 13, 16 };
-
-int* ADPCMDecoder::s_index_update_tables[4] = {
-	ADPCMDecoder::_index_update_table_2bits,
-	ADPCMDecoder::_index_update_table_3bits,
-	ADPCMDecoder::_index_update_table_4bits,
-	ADPCMDecoder::_index_update_table_5bits
-};
-
-int ADPCMDecoder::s_stepsize[STEPSIZE_CT] = {
-	7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
-	19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
-	50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
-	130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
-	337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
-	876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
-	2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
-	5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
-	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
-};
-
-// ----------------------------------------------------------------------------
-// END OF ADPCMDecoder class
-// ----------------------------------------------------------------------------
-
 //
 // Unsigned 8-bit expansion (128 is silence)
 //
-// u8_expand allocates the memory for its "data" pointer.
+// out_data must have room for input_size samples.
 //
 
 static void
-u8_expand(unsigned char * &data,
+u8_expand(boost::int16_t* out_data,
 	const unsigned char* input,
 	boost::uint32_t input_size) // This is also the number of u8bit samples
 {
-	boost::int16_t	*out_data = new boost::int16_t[input_size];
-
-	// Convert 8-bit to 16
+	// Convert 8-bit to 16: flipping the top bit makes the sample signed,
+	// and it becomes the high byte.
 	const boost::uint8_t *inp = input;
 	boost::int16_t *outp = out_data;
-	for (unsigned int i = input_size; i>0; i--) {
-		*outp++ = ((boost::int16_t)(*inp++) - 128) * 256;
+	unsigned int i = 0;
+
+#if defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i sign = _mm_set1_epi8(static_cast<char>(0x80));
+	for (; i + 16 <= input_size; i += 16) {
+		const __m128i s = _mm_xor_si128(sign,
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(inp + i)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(outp + i),
+			_mm_unpacklo_epi8(zero, s));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(outp + i + 8),
+			_mm_unpackhi_epi8(zero, s));
+	}
+#endif
+
+	for (; i < input_size; ++i) {
+		outp[i] = static_cast<boost::int16_t>((inp[i] - 128) * 256);
 	}
-	
-	data = (unsigned char *)out_data;
 }
 
 
@@ -375,23 +169,28 @@ AudioDecoderSimple::decode(const boost::uint8_t* input, boost::uint32_t inputSiz
     switch (_codec) {
 	case AUDIO_CODEC_ADPCM:
 		{
-		//boost::uint32_t sample_count = inputSize * ( _stereo ? 1 : 2 ); //(_sampleCount == 0 ? inputSize / ( _stereo ? 4 : 2 ) : _sampleCount);
-		BitsReader br(input, inputSize);
-		boost::uint32_t sample_count = ADPCMDecoder::adpcm_expand(decodedData, br, inputSize, _stereo);
+		decodedData = allocateOutput(
+				ADPCMDecoder::maxSamples(inputSize) * 2);
+		boost::int16_t* samples =
+			reinterpret_cast<boost::int16_t*>(decodedData);
+		const size_t sample_count = ADPCMDecoder::decode(input, inputSize,
+				_stereo, samples);
 		outsize = sample_count * (_stereo ? 4 : 2);
 		}
 		break;
 	case AUDIO_CODEC_RAW:
 		if (_is16bit) {
 			// FORMAT_RAW 16-bit is exactly what we want!
-			decodedData = new unsigned char[inputSize];
+			decodedData = allocateOutput(inputSize);
 			memcpy(decodedData, input, inputSize);
 			outsize = inputSize;
 		} else {
 			// Convert 8-bit signed to 16-bit range
 			// Allocate as many shorts as there are samples
-			u8_expand(decodedData, input, inputSize);
-			outsize = inputSize * (_stereo ? 4 : 2);
+			decodedData = allocateOutput(inputSize * 2);
+			u8_expand(reinterpret_cast<boost::int16_t*>(decodedData),
+					input, inputSize);
+			outsize = inputSize * 2;
 		}
 		break;
 	case AUDIO_CODEC_UNCOMPRESSED:
@@ -401,13 +200,15 @@ AudioDecoderSimple::decode(const boost::uint8_t* input, boost::uint32_t inputSiz
 		{
 			// Convert 8-bit signed to 16-bit range
 			// Allocate as many shorts as there are 8-bit samples
-			u8_expand(decodedData, input, inputSize);
-			outsize = inputSize * (_stereo ? 4 : 2);
+			decodedData = allocateOutput(inputSize * 2);
+			u8_expand(reinterpret_cast<boost::int16_t*>(decodedData),
+					input, inputSize);
+			outsize = inputSize * 2;
 
 		} else {
 			// Allocate a destination buffer
 			// Read 16-bit data into buffer
-			decodedData = new unsigned char[inputSize];
+			decodedData = allocateOutput(inputSize);
 			outsize = inputSize;
 			
 			// Convert 16-bit little-endian data to host-endian.
@@ -457,38 +258,28 @@ AudioDecoderSimple::decode(const boost::uint8_t* input, boost::uint32_t inputSiz
 	}
 
 	boost::uint8_t* tmp_raw_buffer = decodedData;
-	boost::uint32_t tmp_raw_buffer_size = 0;
+	boost::uint32_t tmp_raw_buffer_size = outsize;
 
 	// If we need to convert samplerate or/and from mono to stereo...
 	if (outsize > 0 && (_sampleRate != 44100 || !_stereo)) {
 
-		boost::int16_t* adjusted_data = 0;
-		int	adjusted_size = 0;
-		int sample_count = outsize / (_stereo ? 4 : 2); // samples are of size 2
-
-		// Convert to needed samplerate - this converter only support standard flash samplerates
-		AudioResampler::convert_raw_data(&adjusted_data, &adjusted_size,
-                tmp_raw_buffer,
-                sample_count, 2,  // input sample size is 2 !
-				_sampleRate, _stereo,
-				44100,  true /* stereo */);
-
-		// Hopefully this wont happen
-		if (!adjusted_data) {
-			log_error(_("Error in sound sample conversion"));
-			delete[] tmp_raw_buffer;
-			outputSize = 0;
-			decodedBytes = 0;
-			return NULL;
+		if (!_resampler) {
+			_resampler.reset(new AudioResampler(_sampleRate,
+						_stereo ? 2 : 1));
 		}
 
+		const size_t frames = outsize / (_stereo ? 4 : 2); // samples are of size 2
+		boost::int16_t* adjusted_data = reinterpret_cast<boost::int16_t*>(
+				allocateOutput(_resampler->maxOutput(frames) * 4));
+
+		const size_t written = _resampler->process(
+				reinterpret_cast<boost::int16_t*>(tmp_raw_buffer),
+				frames, adjusted_data);
+
 		// Move the new data to the sound-struct
-		delete[] tmp_raw_buffer;
+		releaseOutput(tmp_raw_buffer);
 		tmp_raw_buffer = reinterpret_cast<boost::uint8_t*>(adjusted_data);
-		tmp_raw_buffer_size = adjusted_size;
-
-	} else {
-		tmp_raw_buffer_size = outsize;
+		tmp_raw_buffer_size = written * 4;
 	}
 
 	outputSize = tmp_raw_buffer_size;
@@ -497,5 +288,28 @@ AudioDecoderSimple::decode(const boost::uint8_t* input, boost::uint32_t inputSiz
 	return tmp_raw_buffer;
 }
 
+boost::uint8_t*
+AudioDecoderSimple::flush(boost::uint32_t& outputSize)
+{
+	outputSize = 0;
+	if (!_resampler) return 0;
+
+	const size_t size = _resampler->maxOutput(AudioResampler::taps / 2) * 4;
+	boost::uint8_t* data = size ? allocateOutput(size) : 0;
+	if (data) {
+		outputSize = _resampler->flush(
+				reinterpret_cast<boost::int16_t*>(data)) * 4;
+	}
+
+	// The next input starts from silence again.
+	_resampler.reset();
+
+	if (!outputSize) {
+		if (data) releaseOutput(data);
+		return 0;
+	}
+	return data;
+}
+
 } // gnash.media namespace 
 } // gnash namespace
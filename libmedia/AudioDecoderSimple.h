@@ -21,8 +21,11 @@
 #ifndef GNASH_AUDIODECODERSIMPLE_H
 #define GNASH_AUDIODECODERSIMPLE_H
 
+#include <boost/scoped_ptr.hpp>
+
 #include "AudioDecoder.h" // for inheritance
 #include "MediaParser.h" // for audioCodecType enum (composition)
+#include "AudioResampler.h" // for composition
 
 // Forward declarations
 namespace gnash {
@@ -63,6 +66,9 @@ public:
     // See dox in AudioDecoder.h
 	boost::uint8_t* decode(const boost::uint8_t* input, boost::uint32_t inputSize, boost::uint32_t& outputSize, boost::uint32_t& decodedBytes);
 
+	/// Return the last resampled samples of a sound.
+	boost::uint8_t* flush(boost::uint32_t& outputSize);
+
 private:
 
     // throws MediaException on failure
@@ -86,6 +92,9 @@ private:
 	// samplesize: 8 or 16 bit
 	bool _is16bit;
 
+	/// Converts to 44100 Hz stereo, if the sound isn't already.
+	boost::scoped_ptr<AudioResampler> _resampler;
+
 
 	// 
 };
@@ -16,7 +16,6 @@
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "AudioDecoderSpeex.h"
-#include "AudioResampler.h"
 #include "GnashException.h" // for MediaException
 #include "MediaParser.h" // for EncodedAudioFrame
 #include "log.h"
@@ -35,7 +34,10 @@ namespace gnash {
 namespace media {
 
 AudioDecoderSpeex::AudioDecoderSpeex()
-    : _speex_dec_state(speex_decoder_init(&speex_wb_mode)) 
+    : _speex_dec_state(speex_decoder_init(&speex_wb_mode))
+#ifndef RESAMPLING_SPEEX
+    , _resampler(16000, 1)
+#endif
 {
     if (!_speex_dec_state) {
         throw MediaException(_("AudioDecoderSpeex: state initialization failed."));
@@ -146,12 +148,12 @@ AudioDecoderSpeex::decode(const EncodedAudioFrame& input,
         // Our interface requires returning the audio size in bytes.
         conv_size *= sizeof(boost::int16_t);
 #else
-        int outsize = 0;
-        AudioResampler::convert_raw_data(&conv_data, &outsize, output.get(), 
-            _speex_framesize /* sample count*/, 2 /* sample size */,
-            16000, false /* stereo */, 44100 /* new rate */,
-            true /* convert to stereo */);
-        boost::uint32_t conv_size = outsize;
+        conv_data = new boost::int16_t[
+            _resampler.maxOutput(_speex_framesize) * 2];
+
+        // Our interface requires returning the audio size in bytes.
+        boost::uint32_t conv_size = _resampler.process(output.get(),
+            _speex_framesize, conv_data) * 2 * sizeof(boost::int16_t);
 #endif
         total_size += conv_size;
 
@@ -162,7 +164,7 @@ AudioDecoderSpeex::decode(const EncodedAudioFrame& input,
 
     // We have to jump through hoops because decode() requires as much
     // data to be returned as possible.
-    boost::uint8_t* rv = new boost::uint8_t[total_size];
+    boost::uint8_t* rv = allocateOutput(total_size);
     boost::uint8_t* ptr = rv;
 
     for (std::vector<DecodedFrame*>::iterator it = decoded_frames.begin(),
@@ -25,6 +25,8 @@
 
 #ifdef RESAMPLING_SPEEX
 # include <speex/speex_resampler.h>
+#else
+# include "AudioResampler.h"
 #endif
 
 #ifndef GNASH_MEDIA_DECODER_SPEEX
@@ -35,7 +37,8 @@ namespace media {
 
 /// Audio decoder for the speex codec 
 //
-/// This class will use the speex resampler if available
+/// This class will use the speex resampler if available, or
+/// AudioResampler if not.
 ///
 class AudioDecoderSpeex : public AudioDecoder
 {
@@ -56,6 +59,8 @@ private:
     SpeexResamplerState* _resampler;
     /// Number of samples in a resampled 44kHz stereo frame.
     boost::uint32_t _target_frame_size;
+#else
+    AudioResampler _resampler;
 #endif
 };
 
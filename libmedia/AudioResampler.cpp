@@ -19,139 +19,283 @@
 
 #include "AudioResampler.h"
 
-#include <cstring>
+#include <map>
+#include <cmath>
 #include <cassert>
+#include <algorithm>
+#include <boost/thread/mutex.hpp>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+#include "GnashNumeric.h"
 
 namespace gnash {
 namespace media {
 
-void 
-AudioResampler::convert_raw_data(
-    boost::int16_t** adjusted_data,
-    int* adjusted_size,
-    void* data,
-    int sample_count,	// A stereo pair counts as one
-    int sample_size,	// Should now always == 2
-    // sample_rate and stereo are those of the incoming sample
-    int sample_rate, 
-    bool stereo,
-    // m_sample_rate, m_stereo are the format we must convert to.
-    int m_sample_rate,
-    bool m_stereo)
+namespace {
+
+/// The most positions between input samples that filters are made for.
+//
+/// Rates whose ratio needs more are changed very slightly to fit.
+const unsigned int maxPhases = 512;
+
+/// The Kaiser window shape, for about 90 dB of stopband attenuation.
+const double kaiserBeta = 8.6;
+
+/// The passband as a fraction of the lower of the two Nyquist rates.
+const double passband = 0.9;
+
+typedef boost::shared_ptr<const AudioResampler::Bank> BankPtr;
+
+/// The filter banks made so far, keyed by phases and step.
+struct Banks
 {
+	boost::mutex mutex;
+	std::map<std::pair<unsigned int, unsigned int>, BankPtr> banks;
+};
+
+/// This is never destroyed, as resamplers may outlive static objects.
+Banks&
+banks()
+{
+	static Banks* b = new Banks;
+	return *b;
+}
 
-    assert(sample_size == 2); // at least it seems the code relies on this...
-
-    // simple hack to handle dup'ing mono to stereo
-    if ( !stereo && m_stereo)
-    {
-	sample_rate >>= 1;
-    }
-
-    // simple hack to lose half the samples to get mono from stereo
-    if ( stereo && !m_stereo)
-    {
-	sample_rate <<= 1;
-    }
-
-    // Brain-dead sample-rate conversion: duplicate or
-    // skip input samples an integral number of times.
-    int	inc = 1;	// increment
-    int	dup = 1;	// duplicate
-    if (sample_rate > m_sample_rate)
-    {
-	inc = sample_rate / m_sample_rate;
-    }
-    else if (sample_rate < m_sample_rate)
-    {
-	dup = m_sample_rate / sample_rate;
-    }
-
-    int	output_sample_count = (sample_count * dup * (stereo ? 2 : 1)) / inc;
-    boost::int16_t*	out_data = new boost::int16_t[output_sample_count];
-    *adjusted_data = out_data;
-    *adjusted_size = output_sample_count * sizeof(boost::int16_t); // in bytes
-
-    // Either inc > 1 (decimate the audio)
-    // or dup > 1 (repeat samples)
-    // or both == 1 (no transformation required)
-    if (inc == 1 && dup == 1)
-    {
-	    // No tranformation required
-	    std::memcpy(out_data, data, output_sample_count * sizeof(boost::int16_t));
-    }
-    else if (inc > 1)
-    {
-	// Downsample by skipping samples from the input
-	boost::int16_t*	in = (boost::int16_t*) data;
-	for (int i = output_sample_count; i > 0; i--)
-	{
-	    *out_data++ = *in;
-	    in += inc;
+unsigned int
+gcd(unsigned int a, unsigned int b)
+{
+	while (b) {
+		const unsigned int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/// Modified Bessel function of the first kind, order 0.
+double
+besselI0(double x)
+{
+	double sum = 1;
+	double term = 1;
+	for (int k = 1; k < 64; ++k) {
+		const double t = x / (2 * k);
+		term *= t * t;
+		sum += term;
+		if (term < sum * 1e-15) break;
 	}
-    }
-    else if (dup > 1)
-    {
-	// Upsample by duplicating input samples in the output.
-
-	// The straight sample-replication code handles mono-to-stereo (sort of)
-	// and upsampling of mono but would make a botch of stereo-to-stereo
-	// upsampling, giving the left sample in both channels
-	// then the right sample in both channels alternately.
-	// So for stereo-stereo transforms we have a stereo routine.
-
-	boost::int16_t*	in = (boost::int16_t*) data;
-
-	if (stereo && m_stereo) {
-	    // Stereo-to-stereo upsampling: Replicate pairs of samples
-	    for (int i = output_sample_count / dup / 2; i > 0; i--)
-	    {
-		for (int j = dup; j > 0; j--)
-		{
-			out_data[0] = in[0];
-			out_data[1] = in[1];
-			out_data += 2;
+	return sum;
+}
+
+/// Make the filters for each position between input samples.
+BankPtr
+makeBank(unsigned int phases, unsigned int step)
+{
+	const unsigned int taps = AudioResampler::taps;
+	const int half = taps / 2;
+
+	// The cutoff in cycles per input sample.
+	const double ratio = static_cast<double>(phases) / step;
+	const double cutoff = 0.5 * passband * std::min(1.0, ratio);
+
+	AudioResampler::Bank* bank = new AudioResampler::Bank(phases * taps);
+	std::vector<double> h(taps);
+
+	for (unsigned int p = 0; p < phases; ++p) {
+
+		// Tap j is this far from the output sample, in input samples.
+		double sum = 0;
+		for (unsigned int j = 0; j < taps; ++j) {
+			const double x = static_cast<int>(j) - (half - 1) -
+				static_cast<double>(p) / phases;
+			const double r = x / half;
+			const double window = r * r < 1 ?
+				besselI0(kaiserBeta * std::sqrt(1 - r * r)) : 0;
+			const double arg = M_PI * 2 * cutoff * x;
+			const double sinc = x == 0 ? 1 : std::sin(arg) / arg;
+			h[j] = sinc * window;
+			sum += h[j];
+		}
+
+		// Each filter passes a constant input unchanged.
+		boost::int16_t* f = &(*bank)[p * taps];
+		int total = 0;
+		unsigned int peak = 0;
+		for (unsigned int j = 0; j < taps; ++j) {
+			f[j] = static_cast<boost::int16_t>(
+					std::floor(h[j] / sum * (1 << 15) + 0.5));
+			total += f[j];
+			if (f[j] > f[peak]) peak = j;
 		}
-		in += 2;
-	    }
-	} else {
-
-	    // Linear upsampling, either to increase a sample rate
-	    // or to convert a mono file to stereo or both:
-	    // replicate each sample several times.
-	    switch (dup)
-	    {
-	    case 2:
-		for (int i = output_sample_count / dup; i > 0; i--)
-		{
-		    *out_data++ = *in;
-		    *out_data++ = *in;
-		    in++;
+		f[peak] += (1 << 15) - total;
+	}
+
+	return BankPtr(bank);
+}
+
+BankPtr
+getBank(unsigned int phases, unsigned int step)
+{
+	Banks& b = banks();
+	boost::mutex::scoped_lock lock(b.mutex);
+
+	BankPtr& bank = b.banks[std::make_pair(phases, step)];
+	if (!bank) bank = makeBank(phases, step);
+	return bank;
+}
+
+/// Filter the input samples from in on.
+inline boost::int16_t
+filter(const boost::int16_t* in, const boost::int16_t* f)
+{
+	boost::int32_t sum;
+
+#if defined(__SSE2__)
+	__m128i acc = _mm_setzero_si128();
+	for (unsigned int i = 0; i < AudioResampler::taps; i += 8) {
+		const __m128i s =
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+		const __m128i c =
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(f + i));
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(s, c));
+	}
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+	sum = _mm_cvtsi128_si32(acc);
+#else
+	sum = 0;
+	for (unsigned int i = 0; i < AudioResampler::taps; ++i) {
+		sum += in[i] * f[i];
+	}
+#endif
+
+	return clamp<boost::int32_t>((sum + (1 << 14)) >> 15, -32768, 32767);
+}
+
+} // anonymous namespace
+
+AudioResampler::AudioResampler(unsigned int inRate, unsigned int inChannels,
+		unsigned int outRate)
+	:
+	_channels(inChannels),
+	_phases(1),
+	_step(1),
+	_sameRate(inRate == outRate),
+	_index(0),
+	_phase(0)
+{
+	assert(inChannels == 1 || inChannels == 2);
+	assert(inRate && outRate);
+
+	if (_sameRate) return;
+
+	const unsigned int g = gcd(inRate, outRate);
+	_phases = outRate / g;
+	_step = inRate / g;
+
+	if (_phases > maxPhases) {
+		_step = std::max(1.0,
+			std::floor(static_cast<double>(maxPhases) * inRate / outRate + 0.5));
+		_phases = maxPhases;
+	}
+
+	_bank = getBank(_phases, _step);
+
+	// The first output is at the first input sample.
+	for (unsigned int c = 0; c < _channels; ++c) {
+		_history[c].assign(taps / 2 - 1, 0);
+	}
+}
+
+size_t
+AudioResampler::maxOutput(size_t frames) const
+{
+	if (_sameRate) return frames;
+
+	const size_t available = _history[0].size() - _index + frames;
+	if (available < taps) return 0;
+	return (static_cast<boost::uint64_t>(available - taps + 1) * _phases) /
+		_step + 1;
+}
+
+size_t
+AudioResampler::process(const boost::int16_t* in, size_t frames,
+		boost::int16_t* out)
+{
+	if (_sameRate) {
+		if (_channels == 2) {
+			std::copy(in, in + frames * 2, out);
 		}
-		break;
-	    case 4:
-		for (int i = output_sample_count / dup; i > 0; i--)
-		{
-		    *out_data++ = *in;
-		    *out_data++ = *in;
-		    *out_data++ = *in;
-		    *out_data++ = *in;
-		    in++;
+		else {
+			for (size_t i = 0; i < frames; ++i) {
+				out[i * 2] = out[i * 2 + 1] = in[i];
+			}
 		}
-		break;
-	    default:
-		for (int i = output_sample_count / dup; i > 0; i--)
-		{
-		    for (int j = dup; j > 0; j--)
-		    {
-			    *out_data++ = *in;
-		    }
-		    in++;
+		return frames;
+	}
+
+	const size_t old = _history[0].size();
+	for (unsigned int c = 0; c < _channels; ++c) {
+		_history[c].resize(old + frames);
+	}
+
+	if (_channels == 1) {
+		std::copy(in, in + frames, _history[0].begin() + old);
+	}
+	else {
+		boost::int16_t* left = &_history[0][old];
+		boost::int16_t* right = &_history[1][old];
+		for (size_t i = 0; i < frames; ++i) {
+			left[i] = in[i * 2];
+			right[i] = in[i * 2 + 1];
 		}
-		break;
-	    }
 	}
-    }
+
+	return resample(out);
+}
+
+size_t
+AudioResampler::flush(boost::int16_t* out)
+{
+	if (_sameRate) return 0;
+
+	const std::vector<boost::int16_t> silence(taps / 2 * _channels, 0);
+	return process(&silence.front(), taps / 2, out);
+}
+
+size_t
+AudioResampler::resample(boost::int16_t* out)
+{
+	const size_t size = _history[0].size();
+	const boost::int16_t* bank = &_bank->front();
+	const boost::int16_t* left = size ? &_history[0].front() : 0;
+	const boost::int16_t* right = _channels == 2 && size ?
+		&_history[1].front() : left;
+
+	size_t written = 0;
+	while (_index + taps <= size) {
+		const boost::int16_t* f = bank + _phase * taps;
+		out[0] = filter(left + _index, f);
+		out[1] = _channels == 2 ? filter(right + _index, f) : out[0];
+		out += 2;
+		++written;
+
+		_phase += _step;
+		_index += _phase / _phases;
+		_phase %= _phases;
+	}
+
+	// Drop the input that is no longer needed.
+	const size_t used = std::min(_index, size);
+	for (unsigned int c = 0; c < _channels; ++c) {
+		_history[c].erase(_history[c].begin(), _history[c].begin() + used);
+	}
+	_index -= used;
+
+	return written;
 }
 
 } // namespace media
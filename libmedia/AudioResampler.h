@@ -17,63 +17,100 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
+#ifndef GNASH_AUDIORESAMPLER_H
+#define GNASH_AUDIORESAMPLER_H
 
-#ifndef __GNASH_UTIL_H
-#define __GNASH_UTIL_H
-
+#include <vector>
 #include <boost/cstdint.hpp> // for boost::int16_t
+#include <boost/shared_ptr.hpp>
+
+#include "dsodefs.h"
 
 namespace gnash {
 namespace media {
 
+/// Windowed-sinc resampler to stereo output.
+//
+/// Each output sample is filtered from the input samples around it with
+/// one of a bank of filters, chosen by where it falls between two input
+/// samples. The banks are computed once for each pair of rates.
+//
+/// Input can be given in chunks of any size; the result is the same as
+/// for one chunk. Output is held back until the input it depends on has
+/// been given, which is half the filter length. Rates that are the same
+/// are only converted to stereo.
+class DSOEXPORT AudioResampler
+{
+public:
 
-/// VERY crude audio resampler
-class AudioResampler {
+	/// The number of input samples each output sample is filtered from.
+	static const unsigned int taps = 64;
 
-public:
+	/// Create a resampler.
+	//
+	/// @param inRate       The sample rate of the input.
+	/// @param inChannels   The number of channels of the input, 1 or 2.
+	/// @param outRate      The sample rate of the output.
+	AudioResampler(unsigned int inRate, unsigned int inChannels,
+			unsigned int outRate = 44100);
 
-	/// VERY crude sample-rate and stereo conversion.
+	/// The most stereo samples process() can write for some input.
 	//
-	/// Converts input data to output format.
+	/// @param frames       The number of input samples for each channel.
+	size_t maxOutput(size_t frames) const;
+
+	/// Resample a chunk of input.
 	//
-	/// @param adjusted_data
-	/// Where the converted data is placed (output). WARNING: even though
-	/// the type of the output data is int16, the adjusted_size output
-	/// parameter is in bytes.
-	///
-	/// @param adjusted_size
-	/// The size of the converted data (output) in bytes.
-	///
-	/// @param data
-	/// Data that needs to be converted (input).
-	///
-	/// @param sample_count
-	/// The datas current sample count (input).
-	/// 
-	/// @param sample_size
-	/// The datas current sample size (input) in bytes.
-	///
-	/// @param sample_rate
-	/// The datas current sample rate (input).
-	///
-	/// @param stereo
-	/// Whether the current data is in stereo (input).
-	///
-	/// @param m_sample_rate
-	/// The samplerate we which to convert to (output).
-	///
-	/// @param m_stereo
-	/// Do we want the output data to be in stereo (output)?
-	static void convert_raw_data(boost::int16_t** adjusted_data,
-		  int* adjusted_size, void* data, int sample_count,
-		  int sample_size, int sample_rate, bool stereo,
-		  int m_sample_rate, bool m_stereo);
+	/// @param in       Interleaved 16-bit samples, frames for each channel.
+	/// @param frames   The number of input samples for each channel.
+	/// @param out      Where to write interleaved stereo samples. There
+	///                 must be room for maxOutput(frames) of them.
+	/// @return         The number of stereo samples written.
+	size_t process(const boost::int16_t* in, size_t frames,
+			boost::int16_t* out);
+
+	/// Write the output held back, as if the input ended with silence.
+	//
+	/// @param out      Where to write interleaved stereo samples. There
+	///                 must be room for maxOutput(taps / 2) of them.
+	/// @return         The number of stereo samples written.
+	size_t flush(boost::int16_t* out);
+
+	/// A bank of filters, one for each position between input samples.
+	typedef std::vector<boost::int16_t> Bank;
+
+private:
+
+	size_t resample(boost::int16_t* out);
+
+	const unsigned int _channels;
+
+	/// The number of positions between input samples.
+	unsigned int _phases;
+
+	/// The input advanced for each output sample, in 1/_phases samples.
+	unsigned int _step;
+
+	/// Whether input and output rates are the same.
+	bool _sameRate;
+
+	/// Filters of taps coefficients each, with 15 fractional bits.
+	boost::shared_ptr<const Bank> _bank;
+
+	/// The input not yet used up, one buffer for each channel.
+	std::vector<boost::int16_t> _history[2];
+
+	/// The input sample the next filter starts at.
+	size_t _index;
+
+	/// The position of the next output between input samples.
+	unsigned int _phase;
 };
 
 } // namespace media
 } // namespace gnash
 
-#endif // __GNASH_UTIL_H
+#endif // GNASH_AUDIORESAMPLER_H
 
 
 // Local Variables:
@@ -0,0 +1,111 @@
+// BufferPool.cpp: recycled buffers for decoded media.
+//
+//   Copyright (C) 2012 Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "BufferPool.h"
+
+#include <cassert>
+
+namespace gnash {
+namespace media {
+
+namespace {
+
+/// Each buffer is preceded by its size class. This keeps the data
+/// aligned as new [] would.
+const size_t headerSize = 16;
+
+}
+
+BufferPool::BufferPool()
+{
+    for (size_t i = 0; i < classes; ++i) _free[i].reserve(maxPooled);
+
+    _stats.allocations = 0;
+    _stats.reuses = 0;
+    _stats.outstanding = 0;
+    _stats.pooledBytes = 0;
+}
+
+BufferPool::~BufferPool()
+{
+    for (size_t i = 0; i < classes; ++i) {
+        for (size_t j = 0; j < _free[i].size(); ++j) {
+            delete [] (_free[i][j] - headerSize);
+        }
+    }
+}
+
+boost::uint8_t*
+BufferPool::allocate(size_t size)
+{
+    size_t cls = 0;
+    while (cls < classes && (size_t(1) << (cls + minShift)) < size) ++cls;
+
+    boost::mutex::scoped_lock lock(_mutex);
+    ++_stats.outstanding;
+
+    if (cls < classes && !_free[cls].empty()) {
+        boost::uint8_t* buf = _free[cls].back();
+        _free[cls].pop_back();
+        _stats.pooledBytes -= size_t(1) << (cls + minShift);
+        ++_stats.reuses;
+        return buf;
+    }
+    ++_stats.allocations;
+    lock.unlock();
+
+    // Larger buffers are not pooled, and need only be as large as asked.
+    const size_t capacity = cls < classes ?
+        size_t(1) << (cls + minShift) : size;
+
+    boost::uint8_t* raw = new boost::uint8_t[capacity + headerSize];
+    *reinterpret_cast<size_t*>(raw) = cls;
+    return raw + headerSize;
+}
+
+void
+BufferPool::release(boost::uint8_t* buf)
+{
+    if (!buf) return;
+
+    const size_t cls = *reinterpret_cast<size_t*>(buf - headerSize);
+    assert(cls <= classes);
+
+    boost::mutex::scoped_lock lock(_mutex);
+    assert(_stats.outstanding);
+    --_stats.outstanding;
+
+    if (cls < classes && _free[cls].size() < maxPooled) {
+        _free[cls].push_back(buf);
+        _stats.pooledBytes += size_t(1) << (cls + minShift);
+        return;
+    }
+    lock.unlock();
+
+    delete [] (buf - headerSize);
+}
+
+BufferPool::Stats
+BufferPool::stats() const
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    return _stats;
+}
+
+} // namespace media
+} // namespace gnash
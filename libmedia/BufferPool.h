@@ -0,0 +1,149 @@
+// BufferPool.h: recycled buffers for decoded media.
+//
+//   Copyright (C) 2012 Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef GNASH_MEDIA_BUFFERPOOL_H
+#define GNASH_MEDIA_BUFFERPOOL_H
+
+#include <cstddef>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "dsodefs.h"
+#include "GnashImage.h"
+
+namespace gnash {
+namespace media {
+
+/// A pool of buffers for decoded frames
+//
+/// Decoders allocate a buffer for every frame, which is freed soon after
+/// by whoever consumed it. Buffers released to the pool are handed out
+/// again for later frames of a similar size, so steady playback does not
+/// allocate.
+//
+/// Sizes are rounded up to a power of two. A limited number of buffers
+/// of each size is kept; more, or larger ones, are freed on release.
+///
+/// Buffers may be allocated and released from any thread.
+class DSOEXPORT BufferPool : boost::noncopyable
+{
+public:
+
+    /// Counters for checking how well buffers are reused
+    struct Stats
+    {
+        /// The number of buffers allocated from the heap.
+        size_t allocations;
+
+        /// The number of buffers handed out again from the pool.
+        size_t reuses;
+
+        /// The number of buffers handed out and not yet released.
+        size_t outstanding;
+
+        /// The number of bytes held for reuse.
+        size_t pooledBytes;
+    };
+
+    BufferPool();
+
+    /// Free all the buffers held for reuse.
+    //
+    /// Buffers still outstanding must not be released afterwards.
+    ~BufferPool();
+
+    /// Get a buffer of at least the given size.
+    //
+    /// The contents are undefined.
+    boost::uint8_t* allocate(size_t size);
+
+    /// Return a buffer obtained from allocate().
+    //
+    /// @param buf  The buffer, or 0 to do nothing.
+    void release(boost::uint8_t* buf);
+
+    /// Get the current counters.
+    Stats stats() const;
+
+private:
+
+    /// The size classes are 2^minShift to 2^maxShift bytes.
+    static const size_t minShift = 8;
+    static const size_t maxShift = 26;
+    static const size_t classes = maxShift - minShift + 1;
+
+    /// The number of buffers of each size kept for reuse.
+    static const size_t maxPooled = 16;
+
+    mutable boost::mutex _mutex;
+
+    std::vector<boost::uint8_t*> _free[classes];
+
+    Stats _stats;
+};
+
+/// An image whose data is taken from a BufferPool
+//
+/// The data goes back to the pool when the image is destroyed, so any
+/// consumer of decoded frames returns them without knowing about the
+/// pool.
+//
+/// @param Image    The image::GnashImage type to hold, which must have a
+///                 constructor taking (data, width, height).
+template<typename Image>
+class PooledImage : public Image
+{
+public:
+
+    typedef typename Image::iterator iterator;
+    typedef typename Image::const_iterator const_iterator;
+
+    PooledImage(boost::shared_ptr<BufferPool> pool, size_t width,
+            size_t height)
+        :
+        Image(0, width, height),
+        _pool(pool),
+        _buffer(_pool->allocate(this->size()))
+    {}
+
+    ~PooledImage() {
+        _pool->release(_buffer);
+    }
+
+    virtual iterator begin() {
+        return _buffer;
+    }
+
+    virtual const_iterator begin() const {
+        return _buffer;
+    }
+
+private:
+
+    const boost::shared_ptr<BufferPool> _pool;
+
+    boost::uint8_t* const _buffer;
+};
+
+} // namespace media
+} // namespace gnash
+
+#endif
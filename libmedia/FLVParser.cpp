@@ -26,9 +26,16 @@
 #include "IOChannel.h"
 #include "SimpleBuffer.h"
 #include "GnashAlgorithm.h"
+#include "AMF.h"
+#include "rc.h"
 
 #include <string>
+#include <vector>
+#include <cstdio>
 #include <iosfwd>
+#include <unistd.h>
+#include <boost/crc.hpp>
+#include <boost/format.hpp>
 
 // Define the following macro the have seek() operations printed
 //#define GNASH_DEBUG_SEEK 1
@@ -41,6 +48,171 @@ const size_t FLVParser::paddingBytes;
 const boost::uint16_t FLVParser::FLVAudioTag::flv_audio_rates [] = 
     { 5500, 11000, 22050, 44100 };
 
+namespace {
+
+/// The position of the first tag, before its previous tag size.
+const boost::uint64_t firstTagPos = 9;
+
+/// The most tags indexed at a time while the parser has nothing to do.
+const size_t indexBatch = 256;
+
+/// The start of the FLV that names its index cache file.
+const size_t indexKeySize = 65536;
+
+/// The largest onMetaData tag read for keyframes.
+const boost::uint32_t maxMetaSize = 16 * 1024 * 1024;
+
+/// Skip an AMF0 value of any type.
+void
+skipValue(const boost::uint8_t*& pos, const boost::uint8_t* end)
+{
+	if (pos == end) {
+		throw amf::AMFException("Read past end of buffer for type");
+	}
+
+	switch (*pos++) {
+		case amf::NUMBER_AMF0:
+			amf::readNumber(pos, end);
+			break;
+		case amf::BOOLEAN_AMF0:
+			amf::readBoolean(pos, end);
+			break;
+		case amf::STRING_AMF0:
+			amf::readString(pos, end);
+			break;
+		case amf::LONG_STRING_AMF0:
+		case amf::XML_OBJECT_AMF0:
+			amf::readLongString(pos, end);
+			break;
+		case amf::NULL_AMF0:
+		case amf::UNDEFINED_AMF0:
+			break;
+		case amf::REFERENCE_AMF0:
+			if (end - pos < 2) {
+				throw amf::AMFException("Read past end of buffer for "
+						"reference");
+			}
+			pos += 2;
+			break;
+		case amf::DATE_AMF0:
+			amf::readNumber(pos, end);
+			if (end - pos < 2) {
+				throw amf::AMFException("Read past end of buffer for date");
+			}
+			pos += 2;
+			break;
+		case amf::ECMA_ARRAY_AMF0:
+			if (end - pos < 4) {
+				throw amf::AMFException("Read past end of buffer for array");
+			}
+			pos += 4;
+			// Fall through: the rest is like an object.
+		case amf::OBJECT_AMF0:
+			for (;;) {
+				const std::string name = amf::readString(pos, end);
+				if (name.empty() && pos != end &&
+						*pos == amf::OBJECT_END_AMF0) {
+					++pos;
+					break;
+				}
+				skipValue(pos, end);
+			}
+			break;
+		case amf::STRICT_ARRAY_AMF0:
+		{
+			if (end - pos < 4) {
+				throw amf::AMFException("Read past end of buffer for array");
+			}
+			const boost::uint32_t count = amf::readNetworkLong(pos);
+			pos += 4;
+			for (boost::uint32_t i = 0; i < count; ++i) {
+				skipValue(pos, end);
+			}
+			break;
+		}
+		default:
+			throw amf::AMFException("Unsupported AMF0 type");
+	}
+}
+
+/// Read an AMF0 strict array of numbers.
+void
+readNumbers(const boost::uint8_t*& pos, const boost::uint8_t* end,
+		std::vector<double>& numbers)
+{
+	if (end - pos < 5 || *pos != amf::STRICT_ARRAY_AMF0) {
+		skipValue(pos, end);
+		return;
+	}
+	++pos;
+	const boost::uint32_t count = amf::readNetworkLong(pos);
+	pos += 4;
+
+	// Each number takes 9 bytes.
+	if (static_cast<boost::uint32_t>(end - pos) / 9 < count) {
+		throw amf::AMFException("Read past end of buffer for array");
+	}
+
+	numbers.reserve(count);
+	for (boost::uint32_t i = 0; i < count; ++i) {
+		if (*pos++ != amf::NUMBER_AMF0) {
+			throw amf::AMFException("Keyframe array contains a non-number");
+		}
+		numbers.push_back(amf::readNumber(pos, end));
+	}
+}
+
+/// Read the times and positions of keyframes from an onMetaData tag.
+//
+/// These are in a "keyframes" object with "times" in seconds and
+/// "filepositions" in bytes, as most FLV tools write them.
+//
+/// @return false if there is no such object.
+bool
+readKeyframes(const boost::uint8_t* pos, const boost::uint8_t* end,
+		std::vector<double>& times, std::vector<double>& positions)
+{
+	if (pos == end || *pos++ != amf::STRING_AMF0) return false;
+	if (amf::readString(pos, end) != "onMetaData") return false;
+	if (pos == end) return false;
+
+	const boost::uint8_t type = *pos++;
+	if (type == amf::ECMA_ARRAY_AMF0) {
+		if (end - pos < 4) return false;
+		pos += 4;
+	}
+	else if (type != amf::OBJECT_AMF0) return false;
+
+	for (;;) {
+		const std::string name = amf::readString(pos, end);
+		if (name.empty() && pos != end && *pos == amf::OBJECT_END_AMF0) {
+			return false;
+		}
+		if (name != "keyframes" || pos == end ||
+				*pos != amf::OBJECT_AMF0) {
+			skipValue(pos, end);
+			continue;
+		}
+
+		++pos;
+		for (;;) {
+			const std::string prop = amf::readString(pos, end);
+			if (prop.empty() && pos != end &&
+					*pos == amf::OBJECT_END_AMF0) {
+				break;
+			}
+			if (prop == "times") readNumbers(pos, end, times);
+			else if (prop == "filepositions") {
+				readNumbers(pos, end, positions);
+			}
+			else skipValue(pos, end);
+		}
+		return !times.empty() && times.size() == positions.size();
+	}
+}
+
+}
+
 FLVParser::FLVParser(std::auto_ptr<IOChannel> lt)
 	:
 	MediaParser(lt),
@@ -51,7 +223,9 @@ FLVParser::FLVParser(std::auto_ptr<IOChannel> lt)
 	_audio(false),
 	_video(false),
 	_cuePoints(),
-	_indexingCompleted(false)
+	_indexingCompleted(false),
+	_indexLoaded(false),
+	_indexFromFile(false)
 {
 	if (!parseHeader()) {
 		throw MediaException("FLVParser couldn't parse header from input");
@@ -82,13 +256,33 @@ FLVParser::seek(boost::uint32_t& time)
 	// while the parser was pushing to queue
 	_seekRequest = true;
 
+	if (!_indexLoaded) loadIndex();
+
+	CuePointsMap::const_iterator it = findCuePoint(time);
+
+	// Keyframes from the file are checked before they are used, and are
+	// all found again from the tags if they are wrong.
+	if (it != _cuePoints.end() && _indexFromFile &&
+			!tagAt(it->second, it->first)) {
+		log_error(_("Keyframe %1% at %2% not found in FLV; indexing it "
+					"again"), it->first, it->second);
+		if (!_indexFile.empty()) {
+			std::remove(_indexFile.c_str());
+			_indexFile.clear();
+		}
+		_cuePoints.clear();
+		_indexFromFile = false;
+		_indexingCompleted = false;
+		_nextPosToIndex = firstTagPos;
+		it = findCuePoint(time);
+	}
+
 	if ( _cuePoints.empty() )
 	{
 		log_debug("No known cue points yet, can't seek");
 		return false;
 	}
 
-	CuePointsMap::iterator it = _cuePoints.lower_bound(time);
 	if ( it == _cuePoints.end() )
 	{
 		log_debug("No cue points greater or equal requested time %d", time);
@@ -108,8 +302,8 @@ FLVParser::seek(boost::uint32_t& time)
 	// WARNING: a race condition might be pending here:
 	// If we handled to do all the seek work in the *small*
 	// time that the parser runs w/out mutex locked (ie:
-	// after it unlocked the stream mutex and before it locked
-	// the queue mutex), it will still push an old encoded frame
+	// after it unlocked the stream mutex and before it pushed
+	// the frame), it will still push an old encoded frame
 	// to the queue; if the pushed frame alone makes it block
 	// again (bufferFull) we'll have a problem.
 	// Note though, that a single frame can't reach a bufferFull
@@ -124,8 +318,210 @@ FLVParser::seek(boost::uint32_t& time)
 bool
 FLVParser::parseNextChunk()
 {
-	bool indexOnly = bufferFull(); // won't lock, but our caller locked...
-	return parseNextTag(indexOnly);
+	bool indexOnly = bufferFull(); // doesn't lock
+
+	{
+		boost::mutex::scoped_lock streamLock(_streamMutex);
+
+		if (!_indexLoaded) loadIndex();
+
+		// Index ahead while there is nothing to parse.
+		if (!_seekRequest && (indexOnly || _parsingComplete)) {
+			for (size_t i = 0; i < indexBatch; ++i) {
+				if (!indexNextTag()) return false;
+			}
+			return true;
+		}
+	}
+
+	return parseNextTag();
+}
+
+// would be called by parser thread or main thread (on seek)
+bool
+FLVParser::indexNextTag()
+{
+	if (_indexingCompleted) return false;
+
+	const boost::uint64_t thisTagPos = _nextPosToIndex;
+
+	// Only the header is read; the body is skipped.
+	boost::uint8_t chunk[12];
+	if (!_stream->seek(thisTagPos + 4) || _stream->read(chunk, 12) < 12) {
+		_indexingCompleted = true;
+
+		// A short read may also come from a truncated FLV, so only an
+		// index that reaches the end of the file is stored.
+		const std::streamsize size = _stream->size();
+		if (!_indexFromFile && size > 0 &&
+				thisTagPos + 4 == static_cast<boost::uint64_t>(size)) {
+			writeIndexFile();
+		}
+		return false;
+	}
+
+	FLVTag flvtag(chunk);
+	_nextPosToIndex += 15 + flvtag.body_size;
+
+	// check for empty tag
+	if (flvtag.body_size == 0) return true;
+
+	if (flvtag.type == FLV_AUDIO_TAG) {
+		indexAudioTag(flvtag, thisTagPos);
+	}
+	else if (flvtag.type == FLV_VIDEO_TAG) {
+		indexVideoTag(flvtag, FLVVideoTag(chunk[11]), thisTagPos);
+	}
+	return true;
+}
+
+FLVParser::CuePointsMap::const_iterator
+FLVParser::findCuePoint(boost::uint32_t time)
+{
+	while (!_indexingCompleted &&
+			(_cuePoints.empty() || _cuePoints.rbegin()->first < time)) {
+		indexNextTag();
+	}
+	return _cuePoints.lower_bound(time);
+}
+
+bool
+FLVParser::tagAt(long position, boost::uint64_t timestamp)
+{
+	boost::uint8_t chunk[12];
+	if (!_stream->seek(position + 4) || _stream->read(chunk, 12) < 12) {
+		return false;
+	}
+
+	FLVTag flvtag(chunk);
+	if (flvtag.type != FLV_VIDEO_TAG && flvtag.type != FLV_AUDIO_TAG) {
+		return false;
+	}
+
+	// Metadata times are rounded.
+	return flvtag.timestamp + 1 >= timestamp &&
+		flvtag.timestamp <= timestamp + 1;
+}
+
+void
+FLVParser::loadIndex()
+{
+	_indexLoaded = true;
+
+	if (readMetaKeyframes() || readIndexFile()) {
+		_indexFromFile = true;
+		_indexingCompleted = true;
+	}
+}
+
+bool
+FLVParser::readMetaKeyframes()
+{
+	boost::uint8_t chunk[11];
+	if (!_stream->seek(firstTagPos + 4) || _stream->read(chunk, 11) < 11) {
+		return false;
+	}
+
+	FLVTag flvtag(chunk);
+	if (flvtag.type != FLV_META_TAG || flvtag.body_size > maxMetaSize) {
+		return false;
+	}
+
+	std::vector<boost::uint8_t> body(flvtag.body_size);
+	if (body.empty() || _stream->read(&body.front(), body.size()) <
+			static_cast<std::streamsize>(body.size())) {
+		return false;
+	}
+
+	std::vector<double> times;
+	std::vector<double> positions;
+	try {
+		if (!readKeyframes(&body.front(), &body.front() + body.size(),
+					times, positions)) {
+			return false;
+		}
+	}
+	catch (const amf::AMFException& e) {
+		log_debug("Could not read keyframes from onMetaData: %s", e.what());
+		return false;
+	}
+
+	for (size_t i = 0; i < times.size(); ++i) {
+		// The positions are of the tags, not their previous tag sizes.
+		if (!(times[i] >= 0) || !(positions[i] >= firstTagPos + 4)) {
+			continue;
+		}
+		_cuePoints[static_cast<boost::uint64_t>(times[i] * 1000 + 0.5)] =
+			static_cast<long>(positions[i]) - 4;
+	}
+
+	log_debug("Read %d keyframes from onMetaData", _cuePoints.size());
+	return !_cuePoints.empty();
+}
+
+bool
+FLVParser::readIndexFile()
+{
+	const std::string& dir = RcInitFile::getDefaultInstance().getFLVIndexDir();
+	if (dir.empty()) return false;
+
+	// The file is named after a checksum of the start of the FLV.
+	std::vector<char> start(indexKeySize);
+	if (!_stream->seek(0)) return false;
+	const std::streamsize got = _stream->read(&start.front(), start.size());
+	if (got <= 0) return false;
+
+	boost::crc_32_type crc;
+	crc.process_bytes(&start.front(), got);
+
+	_indexFile = (boost::format("%1%/%2$08x-%3$x.idx") % dir %
+			crc.checksum() % _stream->size()).str();
+
+	FILE* f = std::fopen(_indexFile.c_str(), "r");
+	if (!f) return false;
+
+	unsigned int version = 0;
+	unsigned long long timestamp;
+	long position;
+	if (std::fscanf(f, "FLVIndex %u\n", &version) == 1 && version == 1) {
+		while (std::fscanf(f, "%llu %ld\n", &timestamp, &position) == 2) {
+			_cuePoints[timestamp] = position;
+		}
+	}
+	std::fclose(f);
+
+	log_debug("Read %d keyframes from %s", _cuePoints.size(), _indexFile);
+	return !_cuePoints.empty();
+}
+
+void
+FLVParser::writeIndexFile() const
+{
+	if (_indexFile.empty() || _cuePoints.empty()) return;
+
+	// Write the index under another name until it is complete.
+	const std::string partial =
+		(boost::format("%1%.%2%") % _indexFile % getpid()).str();
+
+	FILE* f = std::fopen(partial.c_str(), "w");
+	if (!f) {
+		log_debug("Could not create FLV index %s", _indexFile);
+		return;
+	}
+
+	std::fprintf(f, "FLVIndex 1\n");
+	for (CuePointsMap::const_iterator it = _cuePoints.begin(),
+			e = _cuePoints.end(); it != e; ++it) {
+		std::fprintf(f, "%llu %ld\n",
+				static_cast<unsigned long long>(it->first), it->second);
+	}
+
+	const bool ok = !std::ferror(f);
+	if (std::fclose(f) || !ok ||
+			std::rename(partial.c_str(), _indexFile.c_str())) {
+		log_debug("Could not store FLV index %s", _indexFile);
+		std::remove(partial.c_str());
+	}
 }
 
 // would be called by parser thread
@@ -293,13 +689,12 @@ FLVParser::parseVideoTag(const FLVTag& flvtag, const FLVVideoTag& videotag, boos
 
 // would be called by parser thread
 bool
-FLVParser::parseNextTag(bool index_only)
+FLVParser::parseNextTag()
 {
 	// lock the stream while reading from it, so actionscript
 	// won't mess with the parser on seek  or on getBytesLoaded
 	boost::mutex::scoped_lock streamLock(_streamMutex);
 
-	if ( index_only && _indexingCompleted ) return false; 
 	if ( _parsingComplete ) return false;
 
 	if ( _seekRequest )
@@ -308,10 +703,10 @@ FLVParser::parseNextTag(bool index_only)
 		_seekRequest = false;
 	}
 
-	boost::uint64_t& position = index_only ? _nextPosToIndex : _lastParsedPosition;
-	bool& completed = index_only ? _indexingCompleted : _parsingComplete;
+	boost::uint64_t& position = _lastParsedPosition;
+	bool& completed = _parsingComplete;
 
-	//log_debug("parseNextTag: _lastParsedPosition:%d, _nextPosToIndex:%d, index_only:%d", _lastParsedPosition, _nextPosToIndex, index_only);
+	//log_debug("parseNextTag: _lastParsedPosition:%d, _nextPosToIndex:%d", _lastParsedPosition, _nextPosToIndex);
 
 	unsigned long thisTagPos = position;
 
@@ -347,10 +742,9 @@ FLVParser::parseNextTag(bool index_only)
 
 	FLVTag flvtag(chunk);
 
-    // May be _lastParsedPosition OR _nextPosToIndex
     position += 15 + flvtag.body_size; 
 
-	bool doIndex = (_lastParsedPosition+4 > _nextPosToIndex) || index_only;
+	bool doIndex = (_lastParsedPosition+4 > _nextPosToIndex);
 	if ( _lastParsedPosition > _nextPosToIndex )
 	{
 		//log_debug("::parseNextTag setting _nextPosToIndex=%d", _lastParsedPosition+4);
@@ -371,9 +765,6 @@ FLVParser::parseNextTag(bool index_only)
 
 		if (doIndex) {
 			indexAudioTag(flvtag, thisTagPos);
-			if (index_only) {
-				return true;
-			}
 		}
 
 
@@ -385,7 +776,6 @@ FLVParser::parseNextTag(bool index_only)
 		// Release the stream lock 
 		// *before* pushing the frame as that 
 		// might block us waiting for buffers flush
-		// the _qMutex...
 		// We've done using the stream for this tag parsing anyway
 		streamLock.unlock();
 		pushEncodedAudioFrame(frame);
@@ -396,9 +786,6 @@ FLVParser::parseNextTag(bool index_only)
 
 		if (doIndex) {
 			indexVideoTag(flvtag, videotag, thisTagPos);
-			if (index_only) {
-				return true;
-			}
 		}
 
 		std::auto_ptr<EncodedVideoFrame> frame = 
@@ -410,7 +797,6 @@ FLVParser::parseNextTag(bool index_only)
 		// Release the stream lock 
 		// *before* pushing the frame as that 
 		// might block us waiting for buffers flush
-		// the _qMutex...
 		streamLock.unlock();
 		pushEncodedVideoFrame(frame);
 
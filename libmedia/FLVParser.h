@@ -31,6 +31,7 @@
 #include <set>
 #include <memory>
 #include <map>
+#include <string>
 
 #include <boost/thread/mutex.hpp>
 
@@ -158,6 +159,11 @@ public:
 
 private:
 
+	/// Position in input stream for each cue point
+	/// first: timestamp
+	/// second: position in input stream
+	typedef std::map<boost::uint64_t, long> CuePointsMap;
+
 	enum tagType
 	{
 		FLV_AUDIO_TAG = 0x08,
@@ -233,7 +239,42 @@ private:
 	/// Returns true if something was parsed, false otherwise.
 	/// Sets _parsingComplete=true on end of file.
 	///
-	bool parseNextTag(bool index_only);
+	bool parseNextTag();
+
+	/// Index the tag at _nextPosToIndex from its header alone.
+	//
+	/// The stream must be locked.
+	//
+	/// @return false if there are no more tags to index.
+	bool indexNextTag();
+
+	/// Find the first cue point at or after a time.
+	//
+	/// Tags are indexed up to the time if they are not yet. The stream
+	/// must be locked.
+	CuePointsMap::const_iterator findCuePoint(boost::uint32_t time);
+
+	/// Read the keyframe index from onMetaData or the index cache.
+	//
+	/// This is done once, before seeking or indexing. The stream must be
+	/// locked.
+	void loadIndex();
+
+	/// Read the keyframes listed by an onMetaData tag at the start.
+	bool readMetaKeyframes();
+
+	/// Read the keyframe index from the index cache.
+	bool readIndexFile();
+
+	/// Write the keyframe index to the index cache.
+	//
+	/// This is only done once the tags of the whole FLV are indexed.
+	void writeIndexFile() const;
+
+	/// Whether a tag starts at a position with about the given time.
+	//
+	/// This checks keyframes that were not found by reading the tags.
+	bool tagAt(long position, boost::uint64_t timestamp);
 
 	std::auto_ptr<EncodedAudioFrame> parseAudioTag(const FLVTag& flvtag,
             const FLVAudioTag& audiotag, boost::uint32_t thisTagPos);
@@ -287,14 +328,20 @@ private:
 	std::auto_ptr<EncodedVideoFrame>
         readVideoFrame(boost::uint32_t dataSize, boost::uint32_t timestamp);
 
-	/// Position in input stream for each cue point
-	/// first: timestamp
-	/// second: position in input stream
-	typedef std::map<boost::uint64_t, long> CuePointsMap;
 	CuePointsMap _cuePoints;
 
 	bool _indexingCompleted;
 
+	/// Whether loadIndex() has been called.
+	bool _indexLoaded;
+
+	/// Whether the cue points came from onMetaData or the index cache
+	/// rather than from the tags.
+	bool _indexFromFile;
+
+	/// The name of the index cache file for this FLV, if any.
+	std::string _indexFile;
+
     MetaTags _metaTags;
 
     boost::mutex _metaTagsMutex;
@@ -25,11 +25,13 @@
 #include "dsodefs.h" // DSOEXPORT
 #include "VideoConverter.h"
 #include "GnashFactory.h"
+#include "BufferPool.h"
 
 #include <vector>
 #include <memory>
 #include <map>
 #include <string>
+#include <boost/shared_ptr.hpp>
 
 // Forward declarations
 namespace gnash {
@@ -140,12 +142,22 @@ public:
     /// and this should be used to allocate a large enough input buffer.
     virtual size_t getInputPaddingSize() const { return 0; }
 
+    /// Return the pool for buffers of decoded frames.
+    //
+    /// Consumers of decoders created here may ask them to use it with
+    /// AudioDecoder::setBufferPool() or VideoDecoder::setBufferPool().
+    /// The counters in BufferPool::stats() then show whether playback
+    /// allocates.
+    boost::shared_ptr<BufferPool> bufferPool() const {
+        return _bufferPool;
+    }
+
 protected:
 
     /// Base constructor
     //
     /// This is an abstract base class, so not instantiable anyway.
-    MediaHandler() {}
+    MediaHandler() : _bufferPool(new BufferPool) {}
 
     /// Create an AudioDecoder for CODEC_TYPE_FLASH codecs 
     //
@@ -167,6 +179,10 @@ protected:
     /// If this cannot read the necessary 3 bytes, it throws an IOException.
     bool isFLV(IOChannel& stream);
 
+private:
+
+    const boost::shared_ptr<BufferPool> _bufferPool;
+
 };
 
 
@@ -21,6 +21,7 @@
 
 #include "MediaParser.h"
 
+#include <algorithm>
 #include <boost/bind.hpp>
 
 #include "log.h"
@@ -33,6 +34,15 @@
 namespace gnash {
 namespace media {
 
+namespace {
+
+/// The number of frames each queue can hold.
+//
+/// The buffer time normally limits the queues long before this.
+const size_t maxQueuedFrames = 1024;
+
+}
+
 MediaParser::MediaParser(std::auto_ptr<IOChannel> stream)
 	:
 	_parsingComplete(false),
@@ -42,7 +52,12 @@ MediaParser::MediaParser(std::auto_ptr<IOChannel> stream)
 	_parserThread(0),
 	_parserThreadStartBarrier(2),
 	_parserThreadKillRequested(false),
-	_seekRequest(false)
+	_seekRequest(false),
+	_videoFrames(maxQueuedFrames),
+	_audioFrames(maxQueuedFrames),
+	_epoch(0),
+	_parserSleeping(false),
+	_wakeupSignalled(false)
 {
 }
 
@@ -61,20 +76,27 @@ MediaParser::startParserThread()
 boost::uint64_t
 MediaParser::getBufferLength() const
 {
-#ifdef LOAD_MEDIA_IN_A_SEPARATE_THREAD
-	boost::mutex::scoped_lock lock(_qMutex);
-#endif
-	return getBufferLengthNoLock();
+	bool hasVideo = _videoInfo.get();
+	bool hasAudio = _audioInfo.get();
+
+	boost::uint64_t length = 0;
+	if (hasVideo && hasAudio) {
+		length = std::min(audioBufferLength(), videoBufferLength());
+	}
+	else if (hasVideo) length = videoBufferLength();
+	else if (hasAudio) length = audioBufferLength();
+
+	// Nothing more will be parsed until frames are consumed.
+	if (queueFull()) return std::max(length, getBufferTime());
+
+	return length;
 }
 
 /* public */
 bool
 MediaParser::isBufferEmpty() const
 {
-#ifdef LOAD_MEDIA_IN_A_SEPARATE_THREAD
-	boost::mutex::scoped_lock lock(_qMutex);
-#endif
-	return _videoFrames.empty() && _audioFrames.empty();
+	return !nextFrame(_videoFrames) && !nextFrame(_audioFrames);
 }
 
 boost::optional<Id3Info>
@@ -84,112 +106,99 @@ MediaParser::getId3Info() const
     return boost::optional<Id3Info>();
 }
 
+template<typename Frame>
 boost::uint64_t
-MediaParser::getBufferLengthNoLock() const
+MediaParser::bufferLength(const RingBuffer<QueuedFrame<Frame> >& frames) const
 {
-	bool hasVideo = _videoInfo.get();
-	bool hasAudio = _audioInfo.get();
+	QueuedFrame<Frame> first, last;
+	if (!frames.peekFront(first) || !frames.peekBack(last)) return 0;
 
-	//log_debug("MediaParser::getBufferLength: %d video %d audio frames", _videoFrames.size(), _audioFrames.size());
+	// Frames from before a seek don't count.
+	if (first.epoch != _epoch.load()) return 0;
 
-	if (hasVideo && hasAudio) {
-		return std::min(audioBufferLength(), videoBufferLength());
-	}
-	
-    if (hasVideo) return videoBufferLength();
-	
-    if (hasAudio) return audioBufferLength();
-	
-    return 0;
+	if (last.timestamp < first.timestamp) return 0;
+	return last.timestamp - first.timestamp; 
 }
 
 boost::uint64_t
 MediaParser::videoBufferLength() const
 {
-	if (_videoFrames.empty()) return 0;
-#if 0 // debugging
-	log_debug("videoBufferLength: %d - %d == %d",
-		_videoFrames.back()->timestamp(), _videoFrames.front()->timestamp(),
-		_videoFrames.back()->timestamp() - _videoFrames.front()->timestamp());
-#endif
-	return _videoFrames.back()->timestamp() - _videoFrames.front()->timestamp(); 
+	return bufferLength(_videoFrames);
 }
 
 boost::uint64_t
 MediaParser::audioBufferLength() const
 {
-	if (_audioFrames.empty()) return 0;
-#if 0 // debugging
-	log_debug("audioBufferLength: %d - %d == %d",
-		_audioFrames.back()->timestamp, _audioFrames.front()->timestamp,
-		_audioFrames.back()->timestamp - _audioFrames.front()->timestamp);
-#endif
-	return _audioFrames.back()->timestamp - _audioFrames.front()->timestamp; 
+	return bufferLength(_audioFrames);
+}
+
+bool
+MediaParser::queueFull() const
+{
+	return _videoFrames.full() || _audioFrames.full();
+}
+
+template<typename Frame>
+const MediaParser::QueuedFrame<Frame>*
+MediaParser::nextFrame(RingBuffer<QueuedFrame<Frame> >& frames) const
+{
+	const unsigned int epoch = _epoch.load();
+
+	const QueuedFrame<Frame>* q = frames.front();
+	if (!q || q->epoch == epoch) return q;
+
+	// Drop what was queued before the buffers were cleared.
+	do {
+		delete q->frame;
+		frames.pop();
+		q = frames.front();
+	} while (q && q->epoch != epoch);
+
+	wakeupParserThread();
+	return q;
 }
 
 /*private*/
 const EncodedVideoFrame*
 MediaParser::peekNextVideoFrame() const
 {
-#ifdef LOAD_MEDIA_IN_A_SEPARATE_THREAD
-    // TODO: assert _qMutex is locked by this thread
-#else // ndef LOAD_MEDIA_IN_A_SEPARATE_THREAD
-	while (!parsingCompleted() && _videoInfo.get() && _videoFrames.empty())
+#ifndef LOAD_MEDIA_IN_A_SEPARATE_THREAD
+	while (!parsingCompleted() && _videoInfo.get() && !nextFrame(_videoFrames))
 	{
 		const_cast<MediaParser*>(this)->parseNextChunk();
 	}
 #endif
 
-	if (!_videoInfo.get() || _videoFrames.empty()) return 0;
-	return _videoFrames.front();
+	if (!_videoInfo.get()) return 0;
+	const QueuedFrame<EncodedVideoFrame>* q = nextFrame(_videoFrames);
+	return q ? q->frame : 0;
 }
 
 bool
 MediaParser::nextFrameTimestamp(boost::uint64_t& ts) const
 {
-#ifdef LOAD_MEDIA_IN_A_SEPARATE_THREAD
-    boost::mutex::scoped_lock lock(_qMutex);
-#else // ndef LOAD_MEDIA_IN_A_SEPARATE_THREAD
-    while (!parsingCompleted() && _videoInfo.get() && _videoFrames.empty())
+#ifndef LOAD_MEDIA_IN_A_SEPARATE_THREAD
+    while (!parsingCompleted() && _videoInfo.get() && !nextFrame(_videoFrames))
     {
         const_cast<MediaParser*>(this)->parseNextChunk();
     }
 #endif
 
-    if (_videoFrames.empty())
-    {
-        if (_audioFrames.empty())
-        {
-            return false;
-        }
-        else
-        {
-            ts = _audioFrames.front()->timestamp;
-            return true;
-        }
-    }
-    else
-    {
-        if (_audioFrames.empty())
-        {
-            ts = _videoFrames.front()->timestamp();
-            return true;
-        }
-        else
-        {
-            ts = std::min(_videoFrames.front()->timestamp(),
-                          _audioFrames.front()->timestamp);
-            return true;
-        }
-    }
+    const QueuedFrame<EncodedVideoFrame>* video = nextFrame(_videoFrames);
+    const QueuedFrame<EncodedAudioFrame>* audio = nextFrame(_audioFrames);
+
+    if (!video && !audio) return false;
+
+    if (!audio) ts = video->timestamp;
+    else if (!video) ts = audio->timestamp;
+    else ts = std::min(video->timestamp, audio->timestamp);
+
+    return true;
 }
 
 bool
 MediaParser::nextVideoFrameTimestamp(boost::uint64_t& ts) const
 {
-#ifdef LOAD_MEDIA_IN_A_SEPARATE_THREAD
-	boost::mutex::scoped_lock lock(_qMutex);
-#endif // def LOAD_MEDIA_IN_A_SEPARATE_THREAD
 	const EncodedVideoFrame* ef = peekNextVideoFrame();
 	if ( ! ef ) return false;
 	ts = ef->timestamp();
@@ -199,55 +208,50 @@ MediaParser::nextVideoFrameTimestamp(boost::uint64_t& ts) const
 std::auto_ptr<EncodedVideoFrame>
 MediaParser::nextVideoFrame()
 {
-#ifdef LOAD_MEDIA_IN_A_SEPARATE_THREAD
-	boost::mutex::scoped_lock lock(_qMutex);
-#else // ndef LOAD_MEDIA_IN_A_SEPARATE_THREAD
-	while (!parsingCompleted() && _videoInfo.get() && _videoFrames.empty())
+#ifndef LOAD_MEDIA_IN_A_SEPARATE_THREAD
+	while (!parsingCompleted() && _videoInfo.get() && !nextFrame(_videoFrames))
 	{
-		const_cast<MediaParser*>(this)->parseNextChunk();
+		parseNextChunk();
 	}
 #endif
 
 	std::auto_ptr<EncodedVideoFrame> ret;
-	if (_videoFrames.empty()) return ret;
-	ret.reset(_videoFrames.front());
-	_videoFrames.pop_front();
+	const QueuedFrame<EncodedVideoFrame>* q = nextFrame(_videoFrames);
+	if (!q) return ret;
+	ret.reset(q->frame);
+	_videoFrames.pop();
 #ifdef GNASH_DEBUG_MEDIAPARSER
 	log_debug("nextVideoFrame: waking up parser (in case it was sleeping)");
 #endif // GNASH_DEBUG_MEDIAPARSER
-	_parserThreadWakeup.notify_all(); // wake it up, to refill the buffer, SHOULDN'T WE HOLD A LoCK HERE?
+	wakeupParserThread(); // wake it up, to refill the buffer
 	return ret;
 }
 
 std::auto_ptr<EncodedAudioFrame>
 MediaParser::nextAudioFrame()
 {
-#ifdef LOAD_MEDIA_IN_A_SEPARATE_THREAD
-	boost::mutex::scoped_lock lock(_qMutex);
-#else // ndef LOAD_MEDIA_IN_A_SEPARATE_THREAD
-	while (!parsingCompleted() && _audioInfo.get() && _audioFrames.empty())
+#ifndef LOAD_MEDIA_IN_A_SEPARATE_THREAD
+	while (!parsingCompleted() && _audioInfo.get() && !nextFrame(_audioFrames))
 	{
-		const_cast<MediaParser*>(this)->parseNextChunk();
+		parseNextChunk();
 	}
 #endif
 
 	std::auto_ptr<EncodedAudioFrame> ret;
-	if (_audioFrames.empty()) return ret;
-	ret.reset(_audioFrames.front());
-	_audioFrames.pop_front();
+	const QueuedFrame<EncodedAudioFrame>* q = nextFrame(_audioFrames);
+	if (!q) return ret;
+	ret.reset(q->frame);
+	_audioFrames.pop();
 #ifdef GNASH_DEBUG_MEDIAPARSER
 	log_debug("nextAudioFrame: waking up parser (in case it was sleeping)");
 #endif // GNASH_DEBUG_MEDIAPARSER
-	_parserThreadWakeup.notify_all(); // wake it up, to refill the buffer, SHOULDN'T WE HOLD A LoCK HERE?
+	wakeupParserThread(); // wake it up, to refill the buffer
 	return ret;
 }
 
 bool
 MediaParser::nextAudioFrameTimestamp(boost::uint64_t& ts) const
 {
-#ifdef LOAD_MEDIA_IN_A_SEPARATE_THREAD
-	boost::mutex::scoped_lock lock(_qMutex);
-#endif // def LOAD_MEDIA_IN_A_SEPARATE_THREAD
 	const EncodedAudioFrame* ef = peekNextAudioFrame();
 	if ( ! ef ) return false;
 	ts = ef->timestamp;
@@ -258,16 +262,15 @@ MediaParser::nextAudioFrameTimestamp(boost::uint64_t& ts) const
 const EncodedAudioFrame*
 MediaParser::peekNextAudioFrame() const
 {
-#ifdef LOAD_MEDIA_IN_A_SEPARATE_THREAD
-    // TODO: assert _qMutex is locked by this thread
-#else // ndef LOAD_MEDIA_IN_A_SEPARATE_THREAD
-	while (!parsingCompleted() && _audioInfo.get() && _audioFrames.empty())
+#ifndef LOAD_MEDIA_IN_A_SEPARATE_THREAD
+	while (!parsingCompleted() && _audioInfo.get() && !nextFrame(_audioFrames))
 	{
 		const_cast<MediaParser*>(this)->parseNextChunk();
 	}
 #endif
-	if (!_audioInfo.get() || _audioFrames.empty()) return 0;
-	return _audioFrames.front();
+	if (!_audioInfo.get()) return 0;
+	const QueuedFrame<EncodedAudioFrame>* q = nextFrame(_audioFrames);
+	return q ? q->frame : 0;
 }
 
 void
@@ -285,151 +288,133 @@ MediaParser::~MediaParser()
 {
 	stopParserThread();
 
-	for (VideoFrames::iterator i=_videoFrames.begin(),
-		e=_videoFrames.end(); i!=e; ++i)
-	{
-		delete (*i);
+	while (const QueuedFrame<EncodedVideoFrame>* q = _videoFrames.front()) {
+		delete q->frame;
+		_videoFrames.pop();
 	}
 
-	for (AudioFrames::iterator i=_audioFrames.begin(),
-		e=_audioFrames.end(); i!=e; ++i)
-	{
-		delete (*i);
+	while (const QueuedFrame<EncodedAudioFrame>* q = _audioFrames.front()) {
+		delete q->frame;
+		_audioFrames.pop();
 	}
 }
 
 void
 MediaParser::clearBuffers()
 {
-#ifdef LOAD_MEDIA_IN_A_SEPARATE_THREAD
-	boost::mutex::scoped_lock lock(_qMutex);
-#endif
-
-	for (VideoFrames::iterator i=_videoFrames.begin(),
-		e=_videoFrames.end(); i!=e; ++i)
-	{
-		delete (*i);
-	}
+	// The queued frames may only be popped by the main thread, so they
+	// are only marked as old here. The next look at the queues drops
+	// them.
+	++_epoch;
 
-	for (AudioFrames::iterator i=_audioFrames.begin(),
-		e=_audioFrames.end(); i!=e; ++i)
-	{
-		delete (*i);
-	}
-
-	_audioFrames.clear();
-	_videoFrames.clear();
-
-	_parserThreadWakeup.notify_all(); // wake it up, to refill the buffer
+	wakeupParserThread(); // wake it up, to refill the buffer
 }
 
+template<typename Frame>
 void
-MediaParser::pushEncodedAudioFrame(std::auto_ptr<EncodedAudioFrame> frame)
+MediaParser::pushFrame(RingBuffer<QueuedFrame<Frame> >& frames,
+		std::auto_ptr<Frame> frame, boost::uint64_t timestamp,
+		const char* type)
 {
-#ifdef LOAD_MEDIA_IN_A_SEPARATE_THREAD
-	boost::mutex::scoped_lock lock(_qMutex);
-#endif
-	
-    // Find location to insert this new frame to, so that
-    // timestamps are sorted
-    //
-    AudioFrames::iterator loc = _audioFrames.end();
-    if ( ! _audioFrames.empty() ) {
-        size_t gap=0;
-        AudioFrames::reverse_iterator i=_audioFrames.rbegin();
-        for (AudioFrames::reverse_iterator e=_audioFrames.rend(); i!=e; ++i)
-        {
-            if ( (*i)->timestamp <= frame->timestamp ) break;
-            ++gap;
-        }
-
-        loc = i.base();
-
-        if ( gap ) {
-            log_debug("Timestamp of last %d/%d audio frames in queue "
-                "greater then timestamp in the frame being "
-                "inserted to it (%d).", gap, _audioFrames.size(),
-                frame->timestamp);
-        }
-    }
-
-	//log_debug("Inserting audio frame with timestamp %d", frame->timestamp);
-	_audioFrames.insert(loc, frame.release());
+	const QueuedFrame<Frame> q = { frame.get(), timestamp, _epoch.load() };
+
+	// Frames are queued in the order they are parsed.
+	QueuedFrame<Frame> last;
+	if (frames.peekBack(last) && last.epoch == q.epoch &&
+			last.timestamp > timestamp) {
+		log_debug("Timestamp of last %s frame in queue (%d) greater "
+			"than timestamp of the frame being pushed (%d).",
+			type, last.timestamp, timestamp);
+	}
 
 #ifdef LOAD_MEDIA_IN_A_SEPARATE_THREAD
+	while (!frames.push(q)) {
+		// The frame is deleted when we give up.
+		if (parserThreadKillRequested()) return;
+		waitIfNeeded();
+	}
+	frame.release();
+
 	// if the push reaches a "buffer full" condition, or if we find the parsing
 	// to be completed, wait to be waken up
-	waitIfNeeded(lock);
+	waitIfNeeded();
+#else
+	if (!frames.push(q)) {
+		log_error(_("MediaParser: %s frame queue full, dropping frame"),
+			type);
+		return;
+	}
+	frame.release();
 #endif
 }
 
 void
-MediaParser::pushEncodedVideoFrame(std::auto_ptr<EncodedVideoFrame> frame)
+MediaParser::pushEncodedAudioFrame(std::auto_ptr<EncodedAudioFrame> frame)
 {
-#ifdef LOAD_MEDIA_IN_A_SEPARATE_THREAD
-	boost::mutex::scoped_lock lock(_qMutex);
-#endif
-
-    // Find location to insert this new frame to, so that
-    // timestamps are sorted
-    //
-    VideoFrames::iterator loc = _videoFrames.end();
-    if ( ! _videoFrames.empty() ) {
-        size_t gap=0;
-        VideoFrames::reverse_iterator i=_videoFrames.rbegin();
-        for (VideoFrames::reverse_iterator e=_videoFrames.rend(); i!=e; ++i)
-        {
-            if ( (*i)->timestamp() <= frame->timestamp() ) break;
-            ++gap;
-        }
-
-        loc = i.base();
-
-        if ( gap ) {
-            log_debug("Timestamp of last %d/%d video frames in queue "
-                "greater then timestamp() in the frame being "
-                "inserted to it (%d).", gap, _videoFrames.size(),
-                frame->timestamp());
-        }
-    }
-
-	//log_debug("Pushing video frame with timestamp %d", frame->timestamp());
-	_videoFrames.insert(loc, frame.release());
+	const boost::uint64_t timestamp = frame->timestamp;
+	pushFrame(_audioFrames, frame, timestamp, "audio");
+}
 
-#ifdef LOAD_MEDIA_IN_A_SEPARATE_THREAD
-	waitIfNeeded(lock); // if the push reaches a "buffer full" condition, wait to be waken up
-#endif
+void
+MediaParser::pushEncodedVideoFrame(std::auto_ptr<EncodedVideoFrame> frame)
+{
+	const boost::uint64_t timestamp = frame->timestamp();
+	pushFrame(_videoFrames, frame, timestamp, "video");
 }
 
 void
-MediaParser::waitIfNeeded(boost::mutex::scoped_lock& lock) 
+MediaParser::waitIfNeeded() 
 {
-	//  We hold a lock on the queue here...
+	boost::mutex::scoped_lock lock(_wakeupMutex);
+
+	// Say we are going to sleep before checking whether to, so that
+	// the main thread either changes things before we check them or
+	// sees the flag and wakes us up. This pairs with the fence in
+	// wakeupParserThread().
+	_parserSleeping.store(true);
+	boost::atomic_thread_fence(boost::memory_order_seq_cst);
+
 	bool pc=parsingCompleted();
 	bool ic=indexingCompleted();
 	bool bf=bufferFull();
-	if (( pc || (bf && ic)) && !parserThreadKillRequested()) // TODO: or seekRequested ?
+	if (( pc || queueFull() || (bf && ic)) && !parserThreadKillRequested()) // TODO: or seekRequested ?
 	{
 #ifdef GNASH_DEBUG_MEDIAPARSER
 		log_debug("Parser thread waiting on wakeup lock, parsingComplete=%d, bufferFull=%d", pc, bf);
 #endif // GNASH_DEBUG_MEDIAPARSER
-		_parserThreadWakeup.wait(lock);
+		while (!_wakeupSignalled) _parserThreadWakeup.wait(lock);
 #ifdef GNASH_DEBUG_MEDIAPARSER
 		log_debug("Parser thread finished waiting on wakeup lock");
 #endif // GNASH_DEBUG_MEDIAPARSER
 	}
+
+	_wakeupSignalled = false;
+	_parserSleeping.store(false);
+}
+
+void
+MediaParser::wakeupParserThread() const
+{
+	// Most of the time the parser thread is busy, and then this
+	// costs no more than the fence.
+	boost::atomic_thread_fence(boost::memory_order_seq_cst);
+	if (!_parserSleeping.load(boost::memory_order_relaxed)) return;
+
+	boost::mutex::scoped_lock lock(_wakeupMutex);
+	if (!_parserSleeping.load(boost::memory_order_relaxed)) return;
+	_wakeupSignalled = true;
+	_parserThreadWakeup.notify_all();
 }
 
 bool
 MediaParser::bufferFull() const
 {
-	// Callers are expected to hold a lock on _qMutex
-	int bl = getBufferLengthNoLock();
-	int bt = getBufferTime();
+	boost::uint64_t bl = getBufferLength();
+	boost::uint64_t bt = getBufferTime();
 #ifdef GNASH_DEBUG_MEDIAPARSER
 	log_debug("MediaParser::bufferFull: %d/%d", bl, bt);
 #endif // GNASH_DEBUG_MEDIAPARSER
-	return bl > bt;
+	return queueFull() || bl > bt;
 }
 
 void
@@ -445,8 +430,7 @@ MediaParser::parserLoop()
 		// TODO: have a setParsingComplete() function
 		//       exposed in base class for taking care
 		//       of this on appropriate time.
-		boost::mutex::scoped_lock lock(_qMutex);
-		waitIfNeeded(lock);
+		waitIfNeeded();
 	}
 }
 
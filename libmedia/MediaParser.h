@@ -25,14 +25,17 @@
 #include <boost/thread/thread.hpp>
 #include <boost/thread/condition.hpp>
 #include <boost/thread/barrier.hpp>
+#include <boost/atomic.hpp>
 #include <memory>
-#include <deque>
 #include <map>
 #include <vector>
+#include <limits>
+#include <algorithm>
 #include <iosfwd> // for output operator forward declarations
 #include <boost/optional.hpp>
 
 #include "IOChannel.h" // for inlines
+#include "RingBuffer.h"
 #include "dsodefs.h" // DSOEXPORT
 
 // Undefine this to load/parse media files in main thread
@@ -474,18 +477,18 @@ public:
 	/// frames and let NetSTream::bufferLength() use that with playhead
 	/// time to find out...
 	///
+	/// If a queue is full this is at least getBufferTime(), as nothing
+	/// more can be parsed until some frames are consumed.
+	///
 	DSOEXPORT boost::uint64_t getBufferLength() const;
 
 	/// Return true if both audio and video buffers are empty
-	//
-	/// NOTE: locks _qMutex
 	DSOEXPORT bool isBufferEmpty() const;
 
 	/// Return the time we want the parser thread to maintain in the buffer
 	DSOEXPORT boost::uint64_t getBufferTime() const
 	{
-		boost::mutex::scoped_lock lock(_bufferTimeMutex);
-		return _bufferTime;
+		return _bufferTime.load(boost::memory_order_relaxed);
 	}
 
 	/// Set the time we want the parser thread to maintain in the buffer
@@ -495,8 +498,10 @@ public:
 	///
 	DSOEXPORT void setBufferTime(boost::uint64_t t)
 	{
-		boost::mutex::scoped_lock lock(_bufferTimeMutex);
-		_bufferTime=t;
+		_bufferTime.store(std::min<boost::uint64_t>(t,
+				std::numeric_limits<boost::uint32_t>::max()),
+				boost::memory_order_relaxed);
+		wakeupParserThread();
 	}
 
 	/// Get timestamp of the next frame available, if any
@@ -504,8 +509,6 @@ public:
 	/// @param ts will be set to timestamp of next available frame
 	/// @return false if no frame is available yet
 	///
-	/// NOTE: locks _qMutex
-	///
 	DSOEXPORT bool nextFrameTimestamp(boost::uint64_t& ts) const;
 
 	/// Get timestamp of the video frame which would be returned on nextVideoFrame
@@ -513,8 +516,6 @@ public:
 	/// @return false if there no video frame left
 	///         (either none or no more)
 	///
-	/// NOTE: locks _qMutex
-	///
 	DSOEXPORT bool nextVideoFrameTimestamp(boost::uint64_t& ts) const;
 
 	/// Returns the next video frame in the parsed buffer, advancing video cursor.
@@ -531,8 +532,6 @@ public:
 	/// @return false if there no video frame left
 	///         (either none or no more)
 	///
-	/// NOTE: locks _qMutex
-	///
 	DSOEXPORT bool nextAudioFrameTimestamp(boost::uint64_t& ts) const;
 
 	/// Returns the next audio frame in the parsed buffer, advancing audio cursor.
@@ -644,17 +643,23 @@ protected:
 	void stopParserThread();
 
 	/// Clear the a/v buffers
+	//
+	/// This may be called by either thread. The frames are dropped by
+	/// the main thread the next time it looks at the queues.
+	///
 	void clearBuffers();
 
 	/// Push an encoded audio frame to buffer.
 	//
-	/// Will wait on a condition if buffer is full or parsing was completed
+	/// Will wait for the main thread if buffer is full or parsing was
+	/// completed
 	///
 	void pushEncodedAudioFrame(std::auto_ptr<EncodedAudioFrame> frame);
 
 	/// Push an encoded video frame to buffer.
 	//
-	/// Will wait on a condition if buffer is full or parsing was completed
+	/// Will wait for the main thread if buffer is full or parsing was
+	/// completed
 	///
 	void pushEncodedVideoFrame(std::auto_ptr<EncodedVideoFrame> frame);
 
@@ -679,40 +684,42 @@ protected:
 
 	bool parserThreadKillRequested() const
 	{
-		boost::mutex::scoped_lock lock(_parserThreadKillRequestMutex);
-		return _parserThreadKillRequested;
+		return _parserThreadKillRequested.load();
 	}
 
-	boost::uint64_t _bufferTime;
-	mutable boost::mutex _bufferTimeMutex;
+	/// The buffer time in milliseconds.
+	//
+	/// 64-bit atomics are not lock-free on every 32-bit target, and would
+	/// then need libboost_atomic.
+	boost::atomic<boost::uint32_t> _bufferTime;
 
 	std::auto_ptr<boost::thread> _parserThread;
 	boost::barrier _parserThreadStartBarrier;
-	mutable boost::mutex _parserThreadKillRequestMutex;
-	bool _parserThreadKillRequested;
-	boost::condition _parserThreadWakeup;
+	boost::atomic<bool> _parserThreadKillRequested;
 
-	/// Wait on the _parserThreadWakeup condition if buffer is full
+	/// Put the parser thread to sleep if buffer is full
 	/// or parsing was completed.
-	/// 
-	/// Callers *must* pass a locked lock on _qMutex
 	///
-	void waitIfNeeded(boost::mutex::scoped_lock& qMutexLock);
-
-	void wakeupParserThread();
+	/// It sleeps until wakeupParserThread() is called.
+	///
+	void waitIfNeeded();
 
-	/// mutex protecting access to the a/v encoded frames queues
-	mutable boost::mutex _qMutex;
+	/// Wake the parser thread up if it is sleeping.
+	//
+	/// This is cheap when it is not, so it can be called whenever
+	/// the queues or the parsing conditions change.
+	///
+	void wakeupParserThread() const;
 
 	/// Mutex protecting _bytesLoaded (read by main, set by parser)
 	mutable boost::mutex _bytesLoadedMutex;
 
-	/// Method to check if buffer is full w/out locking the _qMutex
+	/// Method to check if buffer is full
 	//
 	///
-	/// This is intended for being called by waitIfNeeded, which 
-	/// is passed a locked lock on _qMutex, and by parseNextChunk
-	/// to determine whether to index-only or also push on queue.
+	/// This is intended for being called by waitIfNeeded, 
+	/// and by parseNextChunk to determine whether to index-only
+	/// or also push on queue.
 	///
 	bool bufferFull() const;
 
@@ -723,14 +730,29 @@ protected:
 
 private:
 
-	typedef std::deque<EncodedVideoFrame*> VideoFrames;
-	typedef std::deque<EncodedAudioFrame*> AudioFrames;
+	/// A queued frame with what the parser thread needs to know of it.
+	//
+	/// The parser thread must not look at the frame itself, as the
+	/// main thread may delete it at any time once it is queued.
+	///
+	template<typename Frame>
+	struct QueuedFrame
+	{
+		Frame* frame;
+		boost::uint64_t timestamp;
+
+		/// The value of _epoch when the frame was pushed
+		unsigned int epoch;
+	};
+
+	typedef RingBuffer<QueuedFrame<EncodedVideoFrame> > VideoFrames;
+	typedef RingBuffer<QueuedFrame<EncodedAudioFrame> > AudioFrames;
 
 	/// Return pointer to next encoded video frame in buffer
 	//
 	/// If no video is present, or queue is empty, 0 is returned
 	/// 
-	/// NOTE: Caller is expected to hold a lock on _qMutex
+	/// NOTE: only to be called by the main thread
 	/// 
 	const EncodedVideoFrame* peekNextVideoFrame() const;
 
@@ -738,28 +760,63 @@ private:
 	//
 	/// If no video is present, or queue is empty, 0 is returned
 	/// 
-	/// NOTE: Caller is expected to hold a lock on _qMutex
+	/// NOTE: only to be called by the main thread
 	///
 	const EncodedAudioFrame* peekNextAudioFrame() const;
 
+	/// Queue a frame, waiting for room if the queue is full.
+	template<typename Frame>
+	void pushFrame(RingBuffer<QueuedFrame<Frame> >& frames,
+			std::auto_ptr<Frame> frame, boost::uint64_t timestamp,
+			const char* type);
+
+	/// Return the next frame queued since the last clearBuffers()
+	//
+	/// Older frames are deleted. This is for the main thread only.
+	///
+	template<typename Frame>
+	const QueuedFrame<Frame>* nextFrame(
+			RingBuffer<QueuedFrame<Frame> >& frames) const;
+
+	/// Return diff between timestamp of last and first frame
+	template<typename Frame>
+	boost::uint64_t bufferLength(
+			const RingBuffer<QueuedFrame<Frame> >& frames) const;
 
 	/// Queue of video frames (the video buffer)
 	//
-	/// Elements owned by this class.
+	/// Elements owned by this class. The parser thread pushes and
+	/// the main thread pops.
 	///
-	VideoFrames _videoFrames;
+	mutable VideoFrames _videoFrames;
 
 	/// Queue of audio frames (the audio buffer)
 	//
-	/// Elements owned by this class.
+	/// Elements owned by this class. The parser thread pushes and
+	/// the main thread pops.
+	///
+	mutable AudioFrames _audioFrames;
+
+	/// The number of calls to clearBuffers()
+	//
+	/// Queued frames from before the last call are dropped.
 	///
-	AudioFrames _audioFrames;
+	boost::atomic<unsigned int> _epoch;
+
+	/// Whether the parser thread is in waitIfNeeded()
+	boost::atomic<bool> _parserSleeping;
+
+	/// Whether wakeupParserThread() was called since the parser
+	/// thread went to sleep, protected by _wakeupMutex
+	mutable bool _wakeupSignalled;
+
+	mutable boost::mutex _wakeupMutex;
+	mutable boost::condition _parserThreadWakeup;
 
 	void requestParserThreadKill()
 	{
-		boost::mutex::scoped_lock lock(_parserThreadKillRequestMutex);
-		_parserThreadKillRequested=true;
-		_parserThreadWakeup.notify_all();
+		_parserThreadKillRequested.store(true);
+		wakeupParserThread();
 	}
 
 	/// Return diff between timestamp of last and first audio frame
@@ -768,8 +825,8 @@ private:
 	/// Return diff between timestamp of last and first video frame
 	boost::uint64_t videoBufferLength() const;
 
-	/// A getBufferLength method not locking the _qMutex (expected to be locked by caller already).
-	boost::uint64_t getBufferLengthNoLock() const;
+	/// Whether a queue is too full to take another frame.
+	bool queueFull() const;
 	
 };
 
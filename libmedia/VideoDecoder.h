@@ -22,8 +22,10 @@
 #define GNASH_VIDEODECODER_H
 
 #include "GnashImage.h"
+#include "BufferPool.h"
 
 #include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
 
 // Forward declarations
 namespace gnash {
@@ -71,6 +73,20 @@ public:
   ///
   virtual bool peek() = 0;
 
+  /// Allow pop() to return planar YUV frames.
+  //
+  /// This saves converting every frame to RGB when the Renderer can draw
+  /// image::ImageYUV. Decoders that can't provide it ignore this.
+  ///
+  virtual void allowYUV() {}
+
+  /// Take the data of decoded frames from a BufferPool.
+  //
+  /// Frames return their data to the pool when destroyed, so callers
+  /// need do nothing different. Decoders that can't use it ignore this.
+  ///
+  virtual void setBufferPool(boost::shared_ptr<BufferPool> /*pool*/) {}
+
   /// Get the width in pixels of the Video
   //
   /// @return   The width of a video frame, or 0 until this is known.
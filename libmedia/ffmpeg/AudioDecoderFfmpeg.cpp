@@ -45,7 +45,8 @@ AudioDecoderFfmpeg::AudioDecoderFfmpeg(const AudioInfo& info)
     _audioCodec(NULL),
     _audioCodecCtx(NULL),
     _parser(NULL),
-    _needsParsing(false)
+    _needsParsing(false),
+    _scratch(NULL)
 {
     setup(info);
 
@@ -64,7 +65,8 @@ AudioDecoderFfmpeg::AudioDecoderFfmpeg(SoundInfo& info)
     :
     _audioCodec(NULL),
     _audioCodecCtx(NULL),
-    _parser(NULL)
+    _parser(NULL),
+    _scratch(NULL)
 {
     setup(info);
 
@@ -80,6 +82,7 @@ AudioDecoderFfmpeg::~AudioDecoderFfmpeg()
         av_free(_audioCodecCtx);
     }
     if (_parser) av_parser_close(_parser);
+    av_free(_scratch);
 }
 
 void AudioDecoderFfmpeg::setup(SoundInfo& info)
@@ -348,7 +351,7 @@ AudioDecoderFfmpeg::decode(const boost::uint8_t* input,
     //GNASH_REPORT_FUNCTION;
 
     size_t retCapacity = AVCODEC_MAX_AUDIO_FRAME_SIZE;
-    boost::uint8_t* retBuf = new boost::uint8_t[retCapacity];
+    boost::uint8_t* retBuf = allocateOutput(retCapacity);
     int retBufSize = 0;
 
 #ifdef GNASH_DEBUG_AUDIO_DECODING
@@ -432,8 +435,7 @@ AudioDecoderFfmpeg::decode(const boost::uint8_t* input,
         // Now, decode the frame. We use the ::decodeFrame specialized function
         // here so resampling is done appropriately
         boost::uint32_t outSize = 0;
-        boost::scoped_array<boost::uint8_t> outBuf(
-                decodeFrame(frame, framesize, outSize));
+        boost::uint8_t* outBuf = decodeFrame(frame, framesize, outSize);
 
         if (!outBuf)
         {
@@ -472,12 +474,13 @@ AudioDecoderFfmpeg::decode(const boost::uint8_t* input,
                     retCapacity);
 #endif // GNASH_DEBUG_AUDIO_DECODING
 
-            retBuf = new boost::uint8_t[retCapacity];
+            retBuf = allocateOutput(retCapacity);
             if ( retBufSize ) std::copy(tmp, tmp+retBufSize, retBuf);
-            delete [] tmp;
+            releaseOutput(tmp);
         }
-        std::copy(outBuf.get(), outBuf.get()+outSize, retBuf+retBufSize);
+        std::copy(outBuf, outBuf+outSize, retBuf+retBufSize);
         retBufSize += static_cast<unsigned int>(outSize);
+        releaseOutput(outBuf);
     }
 
     
@@ -503,15 +506,15 @@ AudioDecoderFfmpeg::decodeFrame(const boost::uint8_t* input,
 
     const size_t bufsize = AVCODEC_MAX_AUDIO_FRAME_SIZE;
 
-    // TODO: make this a private member, to reuse (see NetStreamFfmpeg in 0.8.3)
-    boost::uint8_t* output;
-
-    output = reinterpret_cast<boost::uint8_t*>(av_malloc(bufsize));
-    if (!output) {
-        log_error(_("failed to allocate audio buffer."));
-        outputSize = 0;
-        return NULL;
+    if (!_scratch) {
+        _scratch = reinterpret_cast<boost::uint8_t*>(av_malloc(bufsize));
+        if (!_scratch) {
+            log_error(_("failed to allocate audio buffer."));
+            outputSize = 0;
+            return NULL;
+        }
     }
+    boost::uint8_t* output = _scratch;
 
     boost::int16_t* outPtr = reinterpret_cast<boost::int16_t*>(output);
 
@@ -549,8 +552,6 @@ AudioDecoderFfmpeg::decodeFrame(const boost::uint8_t* input,
         log_error(_("avcodec_decode_audio returned %d. Upgrading "
                     "ffmpeg/libavcodec might fix this issue."), tmp);
         outputSize = 0;
-
-        av_free(output);
         return NULL;
     }
 
@@ -559,8 +560,6 @@ AudioDecoderFfmpeg::decodeFrame(const boost::uint8_t* input,
                     "data. Upgrading ffmpeg/libavcodec might fix this issue."),
                     outputSize, inputSize);
         outputSize = 0;
-
-        av_free(output);
         return NULL;
     }
 
@@ -580,7 +579,7 @@ AudioDecoderFfmpeg::decodeFrame(const boost::uint8_t* input,
         int resampledFrameSize = expectedMaxOutSamples*2*2;
 
         // Allocate just the required amount of bytes
-        boost::uint8_t* resampledOutput = new boost::uint8_t[resampledFrameSize]; 
+        boost::uint8_t* resampledOutput = allocateOutput(resampledFrameSize);
 
 #ifdef GNASH_DEBUG_AUDIO_DECODING
         log_debug("Calling the resampler; resampleFactor:%d; "
@@ -602,8 +601,6 @@ AudioDecoderFfmpeg::decodeFrame(const boost::uint8_t* input,
         // make sure to set outPtr *after* we use it as input to the resampler
         outPtr = reinterpret_cast<boost::int16_t*>(resampledOutput);
 
-        av_free(output);
-
         if (expectedMaxOutSamples < outSamples) {
             log_error(_(" --- Computation of resampled samples (%d) < then the actual returned samples (%d)"),
                 expectedMaxOutSamples, outSamples);
@@ -628,10 +625,9 @@ AudioDecoderFfmpeg::decodeFrame(const boost::uint8_t* input,
 
     }
     else {
-        boost::uint8_t* newOutput = new boost::uint8_t[outSize];
+        boost::uint8_t* newOutput = allocateOutput(outSize);
         std::memcpy(newOutput, output, outSize);
         outPtr = reinterpret_cast<boost::int16_t*>(newOutput);
-        av_free(output);
     }
 
     outputSize = outSize;
@@ -81,6 +81,11 @@ private:
     /// True if a parser is required to decode the format
     bool _needsParsing;
 
+    /// Where frames are decoded before resampling or copying out.
+    //
+    /// This is allocated with av_malloc on first use, and reused.
+    boost::uint8_t* _scratch;
+
     /// Parse input
     //
     /// @param input
@@ -132,8 +132,8 @@ MediaParserFfmpeg::seek(boost::uint32_t& pos)
     // WARNING: a race condition might be pending here:
     // If we handled to do all the seek work in the *small*
     // time that the parser runs w/out mutex locked (ie:
-    // after it unlocked the stream mutex and before it locked
-    // the queue mutex), it will still push an old encoded frame
+    // after it unlocked the stream mutex and before it pushed
+    // the frame), it will still push an old encoded frame
     // to the queue; if the pushed frame alone makes it block
     // again (bufferFull) we'll have a problem.
     // Note though, that a single frame can't reach a bufferFull
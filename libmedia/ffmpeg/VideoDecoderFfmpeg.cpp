@@ -56,6 +56,10 @@ namespace {
     int get_buffer(AVCodecContext* avctx, AVFrame* pic);
     int reget_buffer(AVCodecContext* avctx, AVFrame* pic);
     void release_buffer(AVCodecContext *avctx, AVFrame *pic);
+
+    template<typename Image> Image* createImage(
+            const boost::shared_ptr<BufferPool>& pool, size_t width,
+            size_t height);
 }
 
 #ifdef HAVE_SWSCALE_H
@@ -114,7 +118,8 @@ private:
 
 VideoDecoderFfmpeg::VideoDecoderFfmpeg(videoCodecType format, int width, int height)
     :
-    _videoCodec(NULL)
+    _videoCodec(NULL),
+    _allowYUV(false)
 {
 
     CodecID codec_id = flashToFfmpegCodec(format);
@@ -124,7 +129,8 @@ VideoDecoderFfmpeg::VideoDecoderFfmpeg(videoCodecType format, int width, int hei
 
 VideoDecoderFfmpeg::VideoDecoderFfmpeg(const VideoInfo& info)
     :
-    _videoCodec(NULL)
+    _videoCodec(NULL),
+    _allowYUV(false)
 {
 
     CodecID codec_id = CODEC_ID_NONE;
@@ -279,6 +285,12 @@ VideoDecoderFfmpeg::frameToImage(AVCodecContext* srcCtx,
     }
 #endif
 
+    // The renderer converts these itself while drawing.
+    if (_allowYUV && srcPixFmt == PIX_FMT_YUV420P &&
+            pixFmt == PIX_FMT_RGB24) {
+        return copyPlanes(srcFrameRef, width, height);
+    }
+
 #ifdef HAVE_SWSCALE_H
     // Check whether the context wrapper exists
     // already.
@@ -308,10 +320,12 @@ VideoDecoderFfmpeg::frameToImage(AVCodecContext* srcCtx,
     switch (pixFmt)
     {
         case PIX_FMT_RGBA:
-            im.reset(new image::ImageRGBA(width, height));
+            im.reset(createImage<image::ImageRGBA>(_bufferPool, width,
+                        height));
             break;
         case PIX_FMT_RGB24:
-            im.reset(new image::ImageRGB(width, height));
+            im.reset(createImage<image::ImageRGB>(_bufferPool, width,
+                        height));
             break;
         default:
             log_error(_("Pixel format not handled"));
@@ -350,6 +364,29 @@ VideoDecoderFfmpeg::frameToImage(AVCodecContext* srcCtx,
 
 }
 
+std::auto_ptr<image::GnashImage>
+VideoDecoderFfmpeg::copyPlanes(const AVFrame& srcFrame, int width, int height)
+{
+    std::auto_ptr<image::ImageYUV> im(
+            createImage<image::ImageYUV>(_bufferPool, width, height));
+
+    for (size_t plane = 0; plane < 3; ++plane) {
+        const size_t w = plane ? im->chromaWidth() : im->width();
+        const size_t h = plane ? im->chromaHeight() : im->height();
+        const size_t stride = im->planeStride(plane);
+
+        const boost::uint8_t* src = srcFrame.data[plane];
+        image::GnashImage::iterator dst = im->plane(plane);
+        for (size_t row = 0; row < h; ++row) {
+            std::copy(src, src + w, dst);
+            src += srcFrame.linesize[plane];
+            dst += stride;
+        }
+    }
+
+    return std::auto_ptr<image::GnashImage>(im.release());
+}
+
 std::auto_ptr<image::GnashImage>
 VideoDecoderFfmpeg::decode(const boost::uint8_t* input,
         boost::uint32_t input_size)
@@ -415,6 +452,18 @@ VideoDecoderFfmpeg::pop()
     return ret;
 }
     
+void
+VideoDecoderFfmpeg::allowYUV()
+{
+    _allowYUV = true;
+}
+
+void
+VideoDecoderFfmpeg::setBufferPool(boost::shared_ptr<BufferPool> pool)
+{
+    _bufferPool = pool;
+}
+
 bool
 VideoDecoderFfmpeg::peek()
 {
@@ -583,6 +632,16 @@ release_buffer(AVCodecContext *avctx, AVFrame *pic)
 #endif
 }
 
+/// Create an image with uninitialized data, from the pool if there is one.
+template<typename Image>
+Image*
+createImage(const boost::shared_ptr<BufferPool>& pool, size_t width,
+        size_t height)
+{
+    if (pool) return new PooledImage<Image>(pool, width, height);
+    return new Image(width, height);
+}
+
 }
 
 } // gnash.media.ffmpeg namespace 
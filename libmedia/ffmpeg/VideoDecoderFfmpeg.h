@@ -60,6 +60,10 @@ public:
     
     bool peek();
 
+    void allowYUV();
+
+    void setBufferPool(boost::shared_ptr<BufferPool> pool);
+
     int width() const;
 
     int height() const;
@@ -84,6 +88,13 @@ private:
     std::auto_ptr<image::GnashImage> frameToImage(AVCodecContext* srcCtx,
             const AVFrame& srcFrame);
 
+    /// Copy the planes of a YUV420P frame.
+    //
+    /// The codec reuses its buffers for later frames, so they are copied
+    /// once, but not converted.
+    std::auto_ptr<image::GnashImage> copyPlanes(const AVFrame& srcFrame,
+            int width, int height);
+
     void init(enum CodecID format, int width, int height,
             boost::uint8_t* extradata=0, int extradataSize=0);
 
@@ -109,6 +120,12 @@ private:
 #endif
 
     std::vector<const EncodedVideoFrame*> _video_frames;
+
+    /// Whether YUV420P frames can be returned without converting them.
+    bool _allowYUV;
+
+    /// Where the data of decoded frames comes from, if set.
+    boost::shared_ptr<BufferPool> _bufferPool;
 };
     
 } // gnash.media.ffmpeg namespace 
@@ -228,7 +228,7 @@ AudioDecoderGst::pullBuffers(boost::uint32_t&  outputSize)
         return 0;   
     }
     
-    boost::uint8_t* rbuf = new boost::uint8_t[outputSize];
+    boost::uint8_t* rbuf = allocateOutput(outputSize);
     
     boost::uint8_t* ptr = rbuf;
     
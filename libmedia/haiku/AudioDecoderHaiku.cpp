@@ -59,7 +59,7 @@ AudioDecoderHaiku::decode(const boost::uint8_t* input, boost::uint32_t inputSize
     boost::uint8_t *t;
     outputSize = 2048;
     decodedBytes = inputSize;
-    t = new boost::uint8_t[outputSize];
+    t = allocateOutput(outputSize);
 
     boost::uint16_t *data =
         reinterpret_cast<boost::uint16_t*>(t);
@@ -160,6 +160,7 @@
 namespace gnash {
     class IOChannel;
     class CachedBitmap;
+    class DisplayCommands;
     class rgba;
     class Transform;
     class SWFMatrix;
@@ -252,6 +253,12 @@ public:
     virtual void drawVideoFrame(image::GnashImage* frame,
             const Transform& xform, const SWFRect* bounds, bool smooth) = 0;
 
+    /// Whether drawVideoFrame() can draw planar YUV frames.
+    //
+    /// If so, video decoders are allowed to return image::ImageYUV
+    /// frames rather than converting them to RGB.
+    virtual bool drawsYUVVideo() const { return false; }
+
     /// Draw a line-strip directly, using a thin, solid line.
     //
     /// Can be used to draw empty boxes and cursors.
@@ -343,6 +350,18 @@ public:
     {        
     }
 
+    /// Draw a recorded frame without having it replayed first.
+    //
+    /// Renderers that record a frame themselves before drawing it, for
+    /// instance to draw it in several threads, can use the recording
+    /// directly instead. It does not change until this returns.
+    //
+    /// @return     false if the frame should be replayed between
+    ///             begin_display() and end_display() instead.
+    virtual bool drawRecording(const DisplayCommands& /*frame*/) {
+        return false;
+    }
+
     /// ==================================================================
     /// Machinery for delayed images rendering (e.g. Xv with YV12 or VAAPI)
     /// ==================================================================
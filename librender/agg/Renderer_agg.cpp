@@ -111,11 +111,21 @@ AGG resources
 #include "Renderer_agg.h" 
 
 #include <vector>
+#include <list>
+#include <map>
+#include <algorithm>
 #include <cmath>
 #include <math.h> // We use round()!
 #include <climits>
 #include <boost/scoped_array.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/bind.hpp>
+#include <boost/ref.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <agg_rendering_buffer.h>
 #include <agg_renderer_base.h>
 #include <agg_pixfmt_gray.h>
@@ -140,6 +150,7 @@ AGG resources
 #include <agg_alpha_mask_u8.h>
 
 #include "Renderer_agg_style.h"
+#include "Renderer_agg_yuv.h"
 
 #include "GnashEnums.h"
 #include "CachedBitmap.h"
@@ -152,6 +163,8 @@ AGG resources
 #include "SWFCxForm.h"
 #include "FillStyle.h"
 #include "Transform.h"
+#include "DisplayCommands.h"
+#include "rc.h"
 
 #ifdef HAVE_VA_VA_H
 #include "GnashVaapiImage.h"
@@ -386,6 +399,275 @@ private:
     
 };
 
+/// Paths and fill styles of a shape, converted for drawing.
+struct PreparedShape
+{
+    PreparedShape()
+        :
+        haveShape(false),
+        haveOutline(false),
+        haveStyles(false),
+        subshapes(0)
+    {}
+
+    bool haveShape;
+    bool haveOutline;
+
+    /// Whether styles can be used for drawing.
+    //
+    /// Bitmap fills are not kept, as the bitmap may not be loaded yet.
+    bool haveStyles;
+
+    unsigned int subshapes;
+
+    /// The paths transformed to the stage, in TWIPS.
+    GnashPaths paths;
+    AggPaths aggPaths;
+    AggPaths aggPathsRounded;
+    StyleHandler styles;
+};
+
+/// Identifies a shape drawn with a particular transform.
+class ShapeKey
+{
+public:
+
+    ShapeKey(boost::uint64_t stamp, const SWFMatrix& stage,
+            const SWFMatrix& mat, const SWFCxForm& cx, int quality)
+        :
+        _stamp(stamp)
+    {
+        boost::int32_t* v = _values;
+        *v++ = stage.a(); *v++ = stage.b(); *v++ = stage.c();
+        *v++ = stage.d(); *v++ = stage.tx(); *v++ = stage.ty();
+        *v++ = mat.a(); *v++ = mat.b(); *v++ = mat.c();
+        *v++ = mat.d(); *v++ = mat.tx(); *v++ = mat.ty();
+        *v++ = cx.ra; *v++ = cx.ga; *v++ = cx.ba; *v++ = cx.aa;
+        *v++ = cx.rb; *v++ = cx.gb; *v++ = cx.bb; *v++ = cx.ab;
+        *v++ = quality;
+        assert(v == _values + size);
+    }
+
+    bool operator<(const ShapeKey& other) const {
+        if (_stamp != other._stamp) return _stamp < other._stamp;
+        return std::lexicographical_compare(_values, _values + size,
+                other._values, other._values + size);
+    }
+
+private:
+    static const size_t size = 21;
+    boost::uint64_t _stamp;
+    boost::int32_t _values[size];
+};
+
+/// Keeps the most recently drawn PreparedShapes up to a memory limit.
+//
+/// Shapes are identified by the ShapeRecord stamp, so a changed shape
+/// is simply not found again. Its entry is dropped when it is the least
+/// recently used.
+class ShapeCache : boost::noncopyable
+{
+public:
+
+    explicit ShapeCache(size_t maxBytes)
+        :
+        _maxBytes(maxBytes),
+        _bytes(0)
+    {}
+
+    bool enabled() const {
+        return _maxBytes != 0;
+    }
+
+    size_t limit() const {
+        return _maxBytes;
+    }
+
+    /// Change the memory limit, evicting shapes to fit in it.
+    void setLimit(size_t maxBytes) {
+        _maxBytes = maxBytes;
+        evict(0);
+    }
+
+    /// Find a PreparedShape and mark it as recently used.
+    //
+    /// @return     The shape or 0 if it is not cached.
+    PreparedShape* get(const ShapeKey& key) {
+        Index::iterator it = _index.find(key);
+        if (it == _index.end()) return 0;
+        _entries.splice(_entries.begin(), _entries, it->second);
+        return _entries.front().shape.get();
+    }
+
+    /// Store a PreparedShape, evicting the least recently used ones.
+    //
+    /// The new shape stays cached until the next call even if it exceeds
+    /// the limit by itself.
+    PreparedShape& add(const ShapeKey& key,
+            std::auto_ptr<PreparedShape> shape) {
+
+        const size_t bytes = estimateSize(*shape);
+        evict(bytes);
+
+        _entries.push_front(Entry(key, shape.release(), bytes));
+        _index.insert(std::make_pair(key, _entries.begin()));
+        _bytes += bytes;
+        return *_entries.front().shape;
+    }
+
+private:
+
+    struct Entry
+    {
+        Entry(const ShapeKey& k, PreparedShape* s, size_t b)
+            :
+            key(k),
+            shape(s),
+            bytes(b)
+        {}
+        ShapeKey key;
+        boost::shared_ptr<PreparedShape> shape;
+        size_t bytes;
+    };
+
+    typedef std::list<Entry> Entries;
+    typedef std::map<ShapeKey, Entries::iterator> Index;
+
+    /// Drop the least recently used shapes until another of the given
+    /// size fits.
+    void evict(size_t bytes) {
+        while (!_entries.empty() && _bytes + bytes > _maxBytes) {
+            _bytes -= _entries.back().bytes;
+            _index.erase(_entries.back().key);
+            _entries.pop_back();
+        }
+    }
+
+    static size_t estimateSize(const PreparedShape& shape) {
+
+        // Gradients keep a table of 256 colors.
+        const size_t styleBytes = 1024;
+
+        size_t bytes = sizeof(PreparedShape) + sizeof(Entry) +
+            shape.styles._styles.size() * styleBytes;
+
+        for (GnashPaths::const_iterator i = shape.paths.begin(),
+                e = shape.paths.end(); i != e; ++i) {
+            bytes += sizeof(Path) + i->m_edges.size() * sizeof(Edge);
+        }
+        bytes += estimateSize(shape.aggPaths);
+        bytes += estimateSize(shape.aggPathsRounded);
+        return bytes;
+    }
+
+    static size_t estimateSize(const AggPaths& paths) {
+        size_t bytes = 0;
+        for (AggPaths::const_iterator i = paths.begin(), e = paths.end();
+                i != e; ++i) {
+            bytes += sizeof(agg::path_storage) +
+                i->total_vertices() * (2 * sizeof(double) + 1);
+        }
+        return bytes;
+    }
+
+    size_t _maxBytes;
+    size_t _bytes;
+    Entries _entries;
+    Index _index;
+};
+
+/// Return true if any of the FillStyles is a bitmap fill.
+bool
+hasBitmapFills(const std::vector<FillStyle>& fills)
+{
+    for (std::vector<FillStyle>::const_iterator i = fills.begin(),
+            e = fills.end(); i != e; ++i) {
+        if (boost::get<BitmapFill>(&i->fill)) return true;
+    }
+    return false;
+}
+
+/// A fixed set of threads running jobs for a numbered set of tiles.
+class WorkerPool : boost::noncopyable
+{
+public:
+
+    typedef boost::function<void(size_t)> Job;
+
+    /// Start the threads.
+    //
+    /// @param threads  The number of threads to start. The thread calling
+    ///                 run() also runs jobs.
+    explicit WorkerPool(size_t threads)
+        :
+        _next(0),
+        _count(0),
+        _pending(0),
+        _stop(false)
+    {
+        for (size_t i = 0; i < threads; ++i) {
+            _threads.create_thread(boost::bind(&WorkerPool::work, this));
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            _stop = true;
+        }
+        _wake.notify_all();
+        _threads.join_all();
+    }
+
+    /// Call job(i) for each i in [0, count) and wait for all of them.
+    void run(const Job& job, size_t count) {
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            _job = job;
+            _next = 0;
+            _count = count;
+            _pending = count;
+        }
+        _wake.notify_all();
+
+        boost::mutex::scoped_lock lock(_mutex);
+        runJobs(lock);
+        while (_pending) _done.wait(lock);
+        _job.clear();
+    }
+
+private:
+
+    void work() {
+        boost::mutex::scoped_lock lock(_mutex);
+        while (!_stop) {
+            runJobs(lock);
+            _wake.wait(lock);
+        }
+    }
+
+    /// Run jobs until none are left. The lock is released while running.
+    void runJobs(boost::mutex::scoped_lock& lock) {
+        while (_next < _count) {
+            const size_t i = _next++;
+            lock.unlock();
+            _job(i);
+            lock.lock();
+            if (!--_pending) _done.notify_all();
+        }
+    }
+
+    boost::mutex _mutex;
+    boost::condition_variable _wake;
+    boost::condition_variable _done;
+    Job _job;
+    size_t _next;
+    size_t _count;
+    size_t _pending;
+    bool _stop;
+    boost::thread_group _threads;
+};
+
 /// Class for rendering lines.
 template<typename PixelFormat>
 class LineRenderer
@@ -657,6 +939,80 @@ private:
     /// Whether smoothing is required.
     bool _smoothing;
 };    
+
+/// Class for rendering planar YUV video frames.
+//
+/// The frame is converted, scaled and color transformed by a
+/// YUVSpanGenerator as it is drawn, so there is no RGB copy of it.
+//
+/// @param PixelFormat      The format to render to.
+template <typename PixelFormat>
+class YUVVideoRenderer
+{
+
+public:
+
+    typedef typename agg::renderer_base<PixelFormat> Renderer;
+    typedef agg::span_interpolator_linear<> Interpolator;
+    typedef agg::span_allocator<agg::rgba8> SpanAllocator;
+    typedef agg::rasterizer_scanline_aa<> Rasterizer;
+    typedef YUVSpanGenerator<Interpolator> SpanGenerator;
+    typedef agg::trans_affine Matrix;
+
+    YUVVideoRenderer(const ClipBounds& clipbounds,
+            const image::ImageYUV& frame, Matrix& mat, const SWFCxForm& cx,
+            Quality quality, bool smooth)
+        :
+        _interpolator(mat),
+        // Smoothing is only done in high quality, as for RGB video.
+        _sg(frame, _interpolator, cx,
+                smooth && (quality == QUALITY_HIGH || quality == QUALITY_BEST)),
+        _clipbounds(clipbounds)
+    {}
+
+    void render(agg::path_storage& path, Renderer& rbase,
+            const AlphaMasks& masks)
+    {
+        if (masks.empty()) {
+            // No mask active
+            agg::scanline_u8 sl;
+            renderScanlines(path, rbase, sl);
+        }
+        else {
+            // Untested.
+            typedef agg::scanline_u8_am<agg::alpha_mask_gray8> Scanline;
+            Scanline sl(masks.back().getMask());
+            renderScanlines(path, rbase, sl);
+        }
+    }
+
+private:
+
+    template<typename Scanline>
+    void renderScanlines(agg::path_storage& path, Renderer& rbase,
+            Scanline& sl)
+    {
+        Rasterizer ras;
+        for (ClipBounds::const_iterator i = _clipbounds.begin(),
+            e = _clipbounds.end(); i != e; ++i)
+        {
+            const ClipBounds::value_type& cb = *i;
+            applyClipBox<Rasterizer>(ras, cb);
+
+            ras.add_path(path);
+
+            agg::render_scanlines_aa(ras, sl, rbase, _sa, _sg);
+        }
+    }
+
+    Interpolator _interpolator;
+
+    SpanGenerator _sg;
+
+    SpanAllocator _sa;
+
+    const ClipBounds& _clipbounds;
+};
   
 
             
@@ -717,6 +1073,10 @@ public:
         vr.render(path, rbase, _alphaMasks);
     }
 
+    bool drawsYUVVideo() const {
+        return true;
+    }
+
     void renderEmptyVideo(agg::path_storage path)
     {
         // renderer base for the stage buffer (not the frame image!)
@@ -729,8 +1089,12 @@ public:
     void drawVideoFrame(image::GnashImage* frame, const Transform& xform,
         const SWFRect* bounds, bool smooth)
     {
+        if (_recording) {
+            _commands.drawVideoFrame(frame, xform, bounds, smooth);
+            return;
+        }
     
-        // NOTE: Assuming that the source image is RGB 8:8:8
+        // NOTE: Assuming that the source image is RGB 8:8:8 or YUV 4:2:0
         // TODO: keep heavy instances alive accross frames for performance!
         // TODO: Maybe implement specialization for 1:1 scaled videos
         SWFMatrix mat = stage_matrix;
@@ -790,6 +1154,14 @@ public:
             case image::TYPE_RGB:
                 renderVideo<agg::pixfmt_rgb24_pre>(*frame, mtx, path, smooth);
                 break;
+            case image::TYPE_YUV420:
+            {
+                YUVVideoRenderer<PixelFormat> vr(_clipbounds,
+                        static_cast<const image::ImageYUV&>(*frame), mtx,
+                        xform.colorTransform, _quality, smooth);
+                vr.render(path, *m_rbase, _alphaMasks);
+                break;
+            }
             default:
                 log_error(_("Can't render this type of frame"));
                 break;
@@ -804,7 +1176,10 @@ public:
       yres(1),
       bpp(bits_per_pixel),
       scale_set(false),
-      m_drawing_mask(false)
+      m_drawing_mask(false),
+      _shapeCache(RcInitFile::getDefaultInstance().getShapeCacheSize() * 1024),
+      _threads(RcInitFile::getDefaultInstance().getRenderThreads()),
+      _recording(false)
   {
     // TODO: we really don't want to set the scale here as the core should
     // tell us the right values before rendering anything. However this is
@@ -833,6 +1208,9 @@ public:
     // allocate pixel format accessor and renderer_base
     m_pixf.reset(new PixelFormat(m_rbuf));
     m_rbase.reset(new renderer_base(*m_pixf));  
+
+    // Tile renderers are attached to the new buffer when next used.
+    _tiles.clear();
     
     // by default allow drawing everywhere
     set_invalidated_region_world();
@@ -851,6 +1229,14 @@ public:
     // them for display after ::end_display()
     _render_images.clear();
 
+    // Record the frame, to render it in tiles in end_display().
+    if (_threads > 1 && !_clipbounds.empty()) {
+        _background = bg;
+        _commands.clear();
+        _recording = true;
+        return;
+    }
+
     // clear the stage using the background color
     if ( ! _clipbounds.empty() )
     {
@@ -925,6 +1311,11 @@ public:
     // Clean up after rendering a frame. 
     void end_display()
     {
+        if (_recording) {
+            _recording = false;
+            renderTiles(_commands);
+        }
+
         if (m_drawing_mask) {
             log_debug("Warning: rendering ended while drawing a mask");
         }
@@ -936,10 +1327,96 @@ public:
         }
     }
 
+    /// Draw a frame recorded by movie_root in bands without recording it
+    /// again.
+    virtual bool drawRecording(const DisplayCommands& frame)
+    {
+        if (_threads < 2 || _clipbounds.empty()) return false;
+
+        assert(m_pixf.get());
+        assert(scale_set);
+
+        _render_images.clear();
+        _background = frame.background();
+        renderTiles(frame);
+        return true;
+    }
+
+    /// Render a recorded frame in horizontal bands, one per thread.
+    //
+    /// Each band is drawn by a separate Renderer_agg sharing our buffer,
+    /// with its own clipping bounds, masks, scanlines and shape cache.
+    /// The shape caches can't be shared, as AGG paths keep their read
+    /// position while they are drawn. Instead they split our cache's
+    /// memory limit, so the bands together use no more than one
+    /// renderer would. A shape in several bands is kept by each of them.
+    void renderTiles(const DisplayCommands& frame)
+    {
+        using gnash::geometry::Range2d;
+
+        const size_t bands = std::min<size_t>(_threads, yres);
+
+        if (!_pool.get()) _pool.reset(new WorkerPool(bands - 1));
+
+        while (_tiles.size() < bands) {
+            std::auto_ptr<Renderer_agg> tile(new Renderer_agg(bpp));
+            tile->_threads = 1;
+            tile->init_buffer(m_rbuf.buf(), 0, xres, yres, m_rbuf.stride());
+            _tiles.push_back(tile.release());
+        }
+
+        for (size_t i = 0; i < bands; ++i) {
+            Renderer_agg& tile = _tiles[i];
+            tile.stage_matrix = stage_matrix;
+            tile.setQuality(_quality);
+            tile._shapeCache.setLimit(_shapeCache.limit() / bands);
+
+            const Range2d<int> band(0, yres * i / bands,
+                    xres - 1, yres * (i + 1) / bands - 1);
+
+            tile._clipbounds.clear();
+            tile._clipbounds_selected.clear();
+            for (ClipBounds::const_iterator it = _clipbounds.begin(),
+                    e = _clipbounds.end(); it != e; ++it) {
+                const Range2d<int> r = Intersection(*it, band);
+                if (!r.isNull()) tile._clipbounds.push_back(r);
+            }
+        }
+
+        _pool->run(boost::bind(&Renderer_agg::renderTile, this,
+                    boost::cref(frame), _1), bands);
+
+        // Every band that was drawn records the same video images.
+        _render_images.clear();
+        for (size_t i = 0; i < bands; ++i) {
+            if (!_tiles[i]._clipbounds.empty()) {
+                _render_images = _tiles[i]._render_images;
+                break;
+            }
+        }
+    }
+
+    void renderTile(const DisplayCommands& frame, size_t i)
+    {
+        Renderer_agg& tile = _tiles[i];
+
+        // Images from an earlier frame must not be handed out again.
+        tile._render_images.clear();
+        if (tile._clipbounds.empty()) return;
+
+        tile.begin_display(_background, 0, 0, 0, 0, 0, 0);
+        frame.replay(tile);
+        tile.end_display();
+    }
+
     // Draw the line strip formed by the sequence of points.
     void drawLine(const std::vector<point>& coords, const rgba& color,
             const SWFMatrix& line_mat)
     {
+        if (_recording) {
+            _commands.drawLine(coords, color, line_mat);
+            return;
+        }
 
         assert(m_pixf.get());
         
@@ -994,6 +1471,11 @@ public:
 
     void begin_submit_mask()
     {
+        if (_recording) {
+            _commands.begin_submit_mask();
+            return;
+        }
+
         // Set flag so that rendering of shapes is simplified (only solid fill) 
         m_drawing_mask = true;
 
@@ -1009,11 +1491,19 @@ public:
 
     void end_submit_mask()
     {
+        if (_recording) {
+            _commands.end_submit_mask();
+            return;
+        }
         m_drawing_mask = false;
     }
 
     void disable_mask()
     {
+        if (_recording) {
+            _commands.disable_mask();
+            return;
+        }
         assert(!_alphaMasks.empty());
         _alphaMasks.pop_back();
     }
@@ -1022,6 +1512,10 @@ public:
   void drawGlyph(const SWF::ShapeRecord& shape, const rgba& color,
           const SWFMatrix& mat) 
   {
+    if (_recording) {
+        _commands.drawGlyph(shape, color, mat);
+        return;
+    }
     
     // select relevant clipping bounds
     if (shape.getBounds().is_null()) {
@@ -1110,6 +1604,11 @@ public:
 
     void drawShape(const SWF::ShapeRecord& shape, const Transform& xform)
     {
+        if (_recording) {
+            _commands.drawShape(shape, xform);
+            return;
+        }
+
         // check if the character needs to be rendered at all
         SWFRect cur_bounds;
 
@@ -1127,8 +1626,26 @@ public:
         // select ranges
         select_clipbounds(shape.getBounds(), xform.matrix);
 
+        // Masks only use the transformed paths, which are cheap to get.
+        if (m_drawing_mask || !_shapeCache.enabled()) {
+            drawShape(fillStyles, lineStyles, paths, xform.matrix,
+                    xform.colorTransform);
+            return;
+        }
+
+        const ShapeKey key(shape.stamp(), stage_matrix, xform.matrix,
+                xform.colorTransform, _quality);
+
+        PreparedShape* prepared = _shapeCache.get(key);
+        if (!prepared) {
+            std::auto_ptr<PreparedShape> p(new PreparedShape);
+            prepareShape(*p, fillStyles, lineStyles, paths, xform.matrix,
+                    xform.colorTransform, !hasBitmapFills(fillStyles));
+            prepared = &_shapeCache.add(key, p);
+        }
+
         // render the DisplayObject's shape.
-        drawShape(fillStyles, lineStyles, paths, xform.matrix,
+        drawPreparedShape(*prepared, fillStyles, lineStyles, xform.matrix,
                 xform.colorTransform);
     }
 
@@ -1137,42 +1654,71 @@ public:
         const std::vector<Path>& objpaths, const SWFMatrix& mat,
         const SWFCxForm& cx)
     {
+        PreparedShape shape;
+        prepareShape(shape, FillStyles, line_styles, objpaths, mat, cx, true);
+        drawPreparedShape(shape, FillStyles, line_styles, mat, cx);
+    }
 
-        bool have_shape, have_outline;
-
-        analyzePaths(objpaths, have_shape, have_outline);
+    /// Convert a shape's paths and styles for drawing.
+    //
+    /// When drawing a mask, only the transformed paths are needed.
+    ///
+    /// @param keepStyles   Whether to build the fill styles.
+    void prepareShape(PreparedShape& shape,
+        const std::vector<FillStyle>& FillStyles,
+        const std::vector<LineStyle>& line_styles,
+        const std::vector<Path>& objpaths, const SWFMatrix& mat,
+        const SWFCxForm& cx, bool keepStyles)
+    {
+        analyzePaths(objpaths, shape.haveShape, shape.haveOutline);
 
-        if (!have_shape && !have_outline) {
+        if (!shape.haveShape && !shape.haveOutline) {
             // Early return for invisible character.
             return; 
         }        
 
-        GnashPaths paths;
-        apply_matrix_to_path(objpaths, paths, mat);
+        apply_matrix_to_path(objpaths, shape.paths, mat);
 
         // Masks apparently do not use agg_paths, so return
         // early
-        if (m_drawing_mask) {
+        if (m_drawing_mask) return;
 
-            // Shape is drawn inside a mask, skip sub-shapes handling and
-            // outlines
-            draw_mask_shape(paths, false); 
-            return;
+        // Flash only aligns outlines. Probably this is done at rendering
+        // level.
+        if (shape.haveOutline) {
+            buildPaths_rounded(shape.aggPathsRounded, shape.paths,
+                    line_styles);     
         }
 
-        AggPaths agg_paths;    
-        AggPaths agg_paths_rounded;    
+        if (shape.haveShape) {
+            buildPaths(shape.aggPaths, shape.paths);
 
-        // Flash only aligns outlines. Probably this is done at rendering
-        // level.
-        if (have_outline) {
-            buildPaths_rounded(agg_paths_rounded, paths, line_styles);     
+            // prepare fill styles
+            if (keepStyles) {
+                build_agg_styles(shape.styles, FillStyles, mat, cx);
+                shape.haveStyles = true;
+            }
         }
 
-        if (have_shape) {
-            buildPaths(agg_paths, paths);
+        // We need to separate sub-shapes during rendering. 
+        shape.subshapes = count_sub_shapes(shape.paths);
+    }
+
+    /// Draw a shape prepared with the same styles and transform.
+    void drawPreparedShape(PreparedShape& shape,
+        const std::vector<FillStyle>& FillStyles,
+        const std::vector<LineStyle>& line_styles, const SWFMatrix& mat,
+        const SWFCxForm& cx)
+    {
+        if (!shape.haveShape && !shape.haveOutline) return;
+
+        if (m_drawing_mask) {
+
+            // Shape is drawn inside a mask, skip sub-shapes handling and
+            // outlines
+            draw_mask_shape(shape.paths, false); 
+            return;
         }
-        
 
         if (_clipbounds_selected.empty()) {
 #ifdef GNASH_WARN_WHOLE_CHARACTER_SKIP
@@ -1181,20 +1727,20 @@ public:
             return; 
         }
 
-        // prepare fill styles
-        StyleHandler sh;
-        if (have_shape) build_agg_styles(sh, FillStyles, mat, cx);
-
-        // We need to separate sub-shapes during rendering. 
-        const unsigned int subshape_count = count_sub_shapes(paths);
+        StyleHandler bitmapStyles;
+        StyleHandler* sh = &shape.styles;
+        if (shape.haveShape && !shape.haveStyles) {
+            build_agg_styles(bitmapStyles, FillStyles, mat, cx);
+            sh = &bitmapStyles;
+        }
 
-        for (unsigned int subshape=0; subshape<subshape_count; ++subshape)
+        for (unsigned int subshape=0; subshape<shape.subshapes; ++subshape)
         {
-            if (have_shape) {
-                draw_shape(subshape, paths, agg_paths, sh, true);        
+            if (shape.haveShape) {
+                draw_shape(subshape, shape.paths, shape.aggPaths, *sh, true);
             }
-            if (have_outline)            {
-                draw_outlines(subshape, paths, agg_paths_rounded,
+            if (shape.haveOutline)            {
+                draw_outlines(subshape, shape.paths, shape.aggPathsRounded,
                         line_styles, cx, mat);
             }
         }
@@ -1889,6 +2435,11 @@ public:
   void draw_poly(const std::vector<point>& corners, const rgba& fill, 
     const rgba& outline, const SWFMatrix& mat, bool masked) {
     
+    if (_recording) {
+      _commands.draw_poly(corners, fill, outline, mat, masked);
+      return;
+    }
+
     if (masked && !_alphaMasks.empty()) {
     
       // apply mask
@@ -2067,6 +2618,26 @@ private:  // private variables
 
     // Alpha mask stack
     AlphaMasks _alphaMasks;
+
+    /// Shapes already converted for drawing
+    ShapeCache _shapeCache;
+
+    /// Number of threads rendering a frame
+    size_t _threads;
+
+    /// Whether drawing calls are recorded for rendering in tiles
+    bool _recording;
+
+    /// The drawing calls of the current frame
+    DisplayCommands _commands;
+
+    /// Background color of the current frame
+    rgba _background;
+
+    /// Renderers for each band of the stage
+    boost::ptr_vector<Renderer_agg> _tiles;
+
+    boost::scoped_ptr<WorkerPool> _pool;
     
     /// Cached fill style list with just one entry used for font rendering
     std::vector<FillStyle> m_single_FillStyles;
@@ -367,6 +367,7 @@ public:
     :
     AggStyle(false),
     m_cx(cx),
+    _transform(cx != SWFCxForm()),
     m_rbuf(data, width, height, rowlen),  
     m_pixf(m_rbuf),
     m_img_src(m_pixf),
@@ -384,20 +385,23 @@ public:
     {
         m_sg.generate(span, x, y, len);
 
-        const bool transform = (m_cx != SWFCxForm());
+        agg::rgba8* const end = span + len;
 
-        for (size_t i = 0; i < len; ++i) {
+        for (agg::rgba8* p = span; p != end; ++p) {
             // We must always do this because dynamic bitmaps (BitmapData)
             // can have any values. Loaded bitmaps are handled when loaded.
-            span->r = std::min(span->r, span->a);
-            span->g = std::min(span->g, span->a);
-            span->b = std::min(span->b, span->a);
-            if (transform) {
-                m_cx.transform(span->r, span->g, span->b, span->a);
-                span->premultiply();
-            }
-            ++span;
+            p->r = std::min(p->r, p->a);
+            p->g = std::min(p->g, p->a);
+            p->b = std::min(p->b, p->a);
         }  
+
+        if (!_transform) return;
+
+        // The span is a packed array of RGBA bytes.
+        m_cx.transform(&span->r, len);
+        for (agg::rgba8* p = span; p != end; ++p) {
+            p->premultiply();
+        }
     }
   
 private:
@@ -405,6 +409,9 @@ private:
     // Color transform
     SWFCxForm m_cx;
 
+    // Whether the color transform changes anything
+    const bool _transform;
+
     // Pixel access
     agg::rendering_buffer m_rbuf;
     PixelFormat m_pixf;
@@ -0,0 +1,164 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifndef BACKEND_RENDER_HANDLER_AGG_YUV_H
+#define BACKEND_RENDER_HANDLER_AGG_YUV_H
+
+#include <algorithm>
+#include <boost/cstdint.hpp>
+#include <agg_basics.h>
+#include <agg_color_rgba.h>
+#include <agg_image_filters.h>
+
+#include "GnashImage.h"
+#include "SWFCxForm.h"
+
+namespace gnash {
+
+/// Span generator drawing a planar YUV 4:2:0 video frame
+//
+/// Each pixel is sampled from the planes, converted to RGB and color
+/// transformed in one pass, so the frame is never converted to RGB as a
+/// whole. Samples outside the frame repeat its edges, as
+/// agg::image_accessor_clone does.
+//
+/// @param Interpolator     Maps span coordinates to frame coordinates,
+///                         for instance agg::span_interpolator_linear.
+template<typename Interpolator>
+class YUVSpanGenerator
+{
+public:
+
+    typedef agg::rgba8 color_type;
+
+    /// @param bilinear     Whether to interpolate between samples rather
+    ///                     than take the nearest.
+    YUVSpanGenerator(const image::ImageYUV& frame, Interpolator& interpolator,
+            const SWFCxForm& cx, bool bilinear)
+        :
+        _frame(frame),
+        _interpolator(interpolator),
+        _cx(cx),
+        _transform(cx != SWFCxForm()),
+        _bilinear(bilinear)
+    {}
+
+    void prepare() {}
+
+    void generate(color_type* span, int x, int y, unsigned len)
+    {
+        _interpolator.begin(x + 0.5, y + 0.5, len);
+
+        color_type* const end = span + len;
+        for (color_type* p = span; p != end; ++p, ++_interpolator) {
+
+            int sx, sy;
+            _interpolator.coordinates(&sx, &sy);
+
+            // Chroma samples cover 2x2 pixels.
+            int lx = sx, ly = sy, cx = sx >> 1, cy = sy >> 1;
+            if (_bilinear) {
+                lx -= agg::image_subpixel_scale / 2;
+                ly -= agg::image_subpixel_scale / 2;
+                cx -= agg::image_subpixel_scale / 2;
+                cy -= agg::image_subpixel_scale / 2;
+            }
+
+            convert(sample(0, lx, ly), sample(1, cx, cy), sample(2, cx, cy),
+                    *p);
+        }
+
+        if (!_transform) return;
+
+        // The span is a packed array of RGBA bytes.
+        _cx.transform(&span->r, len);
+        for (color_type* p = span; p != end; ++p) {
+            p->premultiply();
+        }
+    }
+
+private:
+
+    /// Sample a plane at subpixel coordinates.
+    int sample(size_t plane, int x, int y) const
+    {
+        const int w = plane ? _frame.chromaWidth() : _frame.width();
+        const int h = plane ? _frame.chromaHeight() : _frame.height();
+        const size_t stride = _frame.planeStride(plane);
+        const boost::uint8_t* data = _frame.plane(plane);
+
+        const int x0 = x >> agg::image_subpixel_shift;
+        const int y0 = y >> agg::image_subpixel_shift;
+
+        if (!_bilinear) {
+            return data[clamp(y0, h) * stride + clamp(x0, w)];
+        }
+
+        const int fx = x & agg::image_subpixel_mask;
+        const int fy = y & agg::image_subpixel_mask;
+
+        const boost::uint8_t* row0 = data + clamp(y0, h) * stride;
+        const boost::uint8_t* row1 = data + clamp(y0 + 1, h) * stride;
+        const int c0 = clamp(x0, w);
+        const int c1 = clamp(x0 + 1, w);
+
+        const int top = row0[c0] * (agg::image_subpixel_scale - fx) +
+            row0[c1] * fx;
+        const int bottom = row1[c0] * (agg::image_subpixel_scale - fx) +
+            row1[c1] * fx;
+
+        return (top * (agg::image_subpixel_scale - fy) + bottom * fy +
+                (1 << (2 * agg::image_subpixel_shift - 1))) >>
+            (2 * agg::image_subpixel_shift);
+    }
+
+    static int clamp(int i, int size) {
+        return std::max(0, std::min(i, size - 1));
+    }
+
+    /// Convert limited range BT.601 YUV, as decoded from FLV video.
+    static void convert(int y, int u, int v, color_type& rgb)
+    {
+        const int c = 298 * (y - 16) + 128;
+        const int d = u - 128;
+        const int e = v - 128;
+
+        rgb.r = clip((c + 409 * e) >> 8);
+        rgb.g = clip((c - 100 * d - 208 * e) >> 8);
+        rgb.b = clip((c + 516 * d) >> 8);
+        rgb.a = 255;
+    }
+
+    static boost::uint8_t clip(int i) {
+        return std::max(0, std::min(i, 255));
+    }
+
+    const image::ImageYUV& _frame;
+
+    Interpolator& _interpolator;
+
+    const SWFCxForm _cx;
+
+    const bool _transform;
+
+    const bool _bilinear;
+};
+
+} // namespace gnash
+
+#endif
@@ -52,7 +52,6 @@ EmbedSoundInst::EmbedSoundInst(EmbedSound& soundData,
                    std::numeric_limits<unsigned long>::max()
                    : outPoint * 4),
         envelopes(env),
-        current_env(0),
         _soundDef(soundData)
 {
 }
@@ -109,100 +108,42 @@ EmbedSoundInst::decodeNextBlock()
 
     assert(!(decodedDataSize%2));
 
-    // @todo I hope there are no alignment issues in this cast from int8_t* to int16_t* !
-    boost::int16_t* samples = reinterpret_cast<boost::int16_t*>(decodedData);
-    unsigned int nSamples = decodedDataSize/2;
-
-#ifdef GNASH_DEBUG_MIXING
-    log_debug("  applying volume/envelope to %d bytes (%d samples)"
-            "of decoded data", decodedDataSize, nSamples);
-#endif
-
-    // Adjust volume
-    if (_soundDef.volume != 100) {
-        adjustVolume(samples, samples + nSamples, _soundDef.volume/100.0);
-    }
-
-    /// @todo is use of envelopes really mutually exclusive with
-    ///       setting the volume ??
-    else if (envelopes) {
-        unsigned int firstSample = playbackPosition() / 2;
-        applyEnvelopes(samples, nSamples, firstSample, *envelopes);
-    }
-
 #ifdef GNASH_DEBUG_MIXING
     log_debug("  appending %d bytes to decoded buffer", decodedDataSize);
 #endif
 
-
     // decodedData ownership transferred here
     appendDecodedData(decodedData, decodedDataSize);
+
+    // The whole sound is decoded once, even if it loops.
+    if (decodingCompleted()) flushDecoder();
 }
 
-void
-EmbedSoundInst::applyEnvelopes(boost::int16_t* samples, unsigned int nSamples,
-        unsigned int firstSampleOffset, const SoundEnvelopes& env)
+size_t
+EmbedSoundInst::volume(size_t pos, float& left, float& right) const
 {
+    left = right = _soundDef.volume / 100.0;
 
-    // Number of envelopes defined
-    size_t numEnvs = env.size();
-
-    // Nothing to do if we applied all envelopes already
-    if (numEnvs <= current_env) {
-        return;
+    if (!envelopes || envelopes->empty()) {
+        return std::numeric_limits<size_t>::max();
     }
 
-    // Not yet time to use the current envelope
-    if (env[current_env].m_mark44 >= firstSampleOffset+nSamples) {
-        return;
-    }
+    // Envelope positions count stereo samples at 44100 Hz, which is what
+    // the decoded data holds at 4 bytes each.
+    const SoundEnvelopes& env = *envelopes;
+    const boost::uint32_t sample = pos / 4;
 
-    assert(env[current_env].m_mark44 < firstSampleOffset+nSamples);
+    size_t next = 0;
+    while (next < env.size() && env[next].m_mark44 <= sample) ++next;
 
-    // Get next envelope position (absolute samples offset)
-    boost::uint32_t next_env_pos = 0;
-    if (current_env == (env.size() - 1)) {
-        // If there is no "next envelope" then set the next envelope
-        // start point to be unreachable
-        next_env_pos = env[current_env].m_mark44 + nSamples + 1;
-    }
-    else {
-        next_env_pos = env[current_env + 1].m_mark44;
+    // The sound is at full volume until the first envelope.
+    if (next) {
+        left *= env[next - 1].m_level0 / 32768.0;
+        right *= env[next - 1].m_level1 / 32768.0;
     }
 
-    // Scan all samples in the block, applying the envelope
-    // which is in effect in each subportion
-    for (unsigned int i = 0; i < nSamples / 2; i += 2) {
-
-        // @todo cache these left/right floats (in the SoundEnvelope class?)
-        float left = env[current_env].m_level0 / 32768.0;
-        float right = env[current_env].m_level1 / 32768.0;
-
-        samples[i] = samples[i] * left; // Left
-        samples[i + 1] = samples[i + 1] * right; // Right
-
-        // TODO: continue from here (what is the code below doing ??
-
-        // if we encounter the offset of next envelope,
-        // switch to it !
-        if ((firstSampleOffset+nSamples-i) >= next_env_pos)
-        {
-            if (numEnvs <= ++current_env) {
-                // no more envelopes to apply
-                return;
-            }
-
-            // Get next envelope position (absolute samples offset)
-            if (current_env == (env.size() - 1)) {
-                // If there is no "next envelope" then set the next
-                // envelope start point to be unreachable
-                next_env_pos = env[current_env].m_mark44 + nSamples + 1;
-            }
-            else {
-                next_env_pos = env[current_env + 1].m_mark44;
-            }
-        }
-    }
+    if (next == env.size()) return std::numeric_limits<size_t>::max();
+    return (env[next].m_mark44 - sample) * 4;
 }
 
 bool
@@ -88,26 +88,10 @@ private:
 
     virtual bool moreData();
 
-    /// Apply envelope-volume adjustments
+    /// Get the volume set for the sound and its envelopes.
     //
-    /// Modified envelopes cursor (current_env)
-    ///
-    /// @param samples
-    ///     The samples to apply envelopes to
-    ///
-    /// @param nSamples
-    ///     Number of samples in the samples array.
-    ///     (nSamples*2 bytes).
-    ///
-    /// @param firstSampleNum
-    ///     Logical position of first sample in the array.
-    ///     This number gives the sample position referred to
-    ///     by SoundEnvelope objects.
-    ///
-    /// @param env
-    ///     SoundEnvelopes to apply.
-    void applyEnvelopes(boost::int16_t* samples, unsigned int nSamples,
-            unsigned int firstSampleNum, const SoundEnvelopes& env);
+    /// See dox in LiveSound.h
+    virtual size_t volume(size_t pos, float& left, float& right) const;
 
     bool reachedCustomEnd() const;
 
@@ -136,9 +120,6 @@ private:
     /// from a given position. Only used with event sounds.
     const SoundEnvelopes* envelopes;
 
-    /// Index of current envelope.
-    boost::uint32_t current_env;
-
     /// The encoded data
     //
     /// It is non-const because we deregister ourselves
@@ -23,6 +23,8 @@
 
 #include <boost/cstdint.hpp> // For C99 int types
 
+#include "SoundUtils.h" // for mixStereo
+
 namespace gnash {
 namespace sound {
 
@@ -70,6 +72,34 @@ public:
     ///
     virtual unsigned int fetchSamples(boost::int16_t* to, unsigned int nSamples)=0;
 
+    /// Fetch the given amount of samples and add them to a mix.
+    //
+    /// This is what the mixer calls, so it must not allocate memory
+    /// if it can be avoided. The default fetches the samples into the
+    /// scratch buffer and adds them at the given volume.
+    //
+    /// @param mix
+    ///     The mix to add the samples to, nSamples values long.
+    ///
+    /// @param scratch
+    ///     A buffer of nSamples values that may be used for fetching.
+    ///
+    /// @param nSamples
+    ///     Number of samples to fetch, as for fetchSamples().
+    ///
+    /// @param volume
+    ///     The volume to mix the samples at, as a fraction (0..1).
+    ///
+    /// @return number of samples actually added to the mix.
+    ///
+    virtual unsigned int mixSamples(boost::int32_t* mix,
+            boost::int16_t* scratch, unsigned int nSamples, float volume)
+    {
+        const unsigned int wrote = fetchSamples(scratch, nSamples);
+        mixStereo(mix, scratch, wrote, volume, volume);
+        return wrote;
+    }
+
     /// Return number of samples fetched from this stream
     //
     /// It is expected for the return to be always a multiple
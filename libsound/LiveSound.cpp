@@ -52,6 +52,20 @@ LiveSound::createDecoder(media::MediaHandler& mh, const media::SoundInfo& si)
 
 unsigned int 
 LiveSound::fetchSamples(boost::int16_t* to, unsigned int nSamples)
+{
+    return fetch(to, 0, nSamples, 1);
+}
+
+unsigned int 
+LiveSound::mixSamples(boost::int32_t* mix, boost::int16_t* /*scratch*/,
+        unsigned int nSamples, float volume)
+{
+    return fetch(0, mix, nSamples, volume);
+}
+
+unsigned int 
+LiveSound::fetch(boost::int16_t* to, boost::int32_t* mix,
+        unsigned int nSamples, float volume)
 {
     unsigned int fetchedSamples = 0;
 
@@ -59,27 +73,17 @@ LiveSound::fetchSamples(boost::int16_t* to, unsigned int nSamples)
         unsigned int availableSamples = decodedSamplesAhead();
 
         if (availableSamples) {
-            const boost::int16_t* data = getDecodedData(_playbackPosition);
 
             if (availableSamples >= nSamples) {
-                std::copy(data, data + nSamples, to);
+                output(to, mix, nSamples, volume);
                 fetchedSamples += nSamples;
-
-                // Update playback position (samples are 16bit)
-                _playbackPosition += nSamples * 2;
-
                 break; // fetched all
             }
             else {
                 // not enough decoded samples available:
                 // copy what we have and go on
-                std::copy(data, data + availableSamples, to);
+                output(to, mix, availableSamples, volume);
                 fetchedSamples += availableSamples;
-
-                // Update playback position (samples are 16bit)
-                _playbackPosition += availableSamples * 2;
-
-                to += availableSamples;
                 nSamples -= availableSamples;
                 assert(nSamples);
             }
@@ -100,6 +104,44 @@ LiveSound::fetchSamples(boost::int16_t* to, unsigned int nSamples)
     return fetchedSamples;
 }
 
+void
+LiveSound::output(boost::int16_t*& to, boost::int32_t*& mix,
+        unsigned int nSamples, float volume)
+{
+    const boost::int16_t* data = getDecodedData(_playbackPosition);
+
+    // Each range of samples with the same volume is copied or mixed
+    // in one go.
+    for (unsigned int done = 0; done < nSamples; ) {
+        float left, right;
+        const size_t bytes = this->volume(_playbackPosition, left, right);
+        const unsigned int n = std::min<size_t>(nSamples - done, bytes / 2);
+        assert(n);
+
+        if (mix) {
+            mixStereo(mix + done, data + done, n, left * volume,
+                    right * volume);
+        }
+        else {
+            std::copy(data + done, data + done + n, to + done);
+            if (left != 1 || right != 1) {
+                for (unsigned int i = done; i + 1 < done + n; i += 2) {
+                    to[i] = static_cast<boost::int16_t>(to[i] * left);
+                    to[i + 1] = static_cast<boost::int16_t>(to[i + 1] * right);
+                }
+            }
+        }
+
+        done += n;
+
+        // Update playback position (samples are 16bit)
+        _playbackPosition += n * 2;
+    }
+
+    if (mix) mix += nSamples;
+    else to += nSamples;
+}
+
 
 } // sound namespace 
 } // namespace gnash
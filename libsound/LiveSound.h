@@ -22,6 +22,7 @@
 
 #include <boost/scoped_ptr.hpp>
 #include <cassert>
+#include <limits>
 #include <boost/cstdint.hpp> // For C99 int types
 
 #include "InputStream.h" 
@@ -101,6 +102,17 @@ protected:
         delete [] data;
     }
 
+    /// Append what the decoder holds back at the end of the input.
+    //
+    /// @return     false if there was nothing.
+    bool flushDecoder() {
+        boost::uint32_t size = 0;
+        boost::uint8_t* data = _decoder->flush(size);
+        if (!data) return false;
+        appendDecodedData(data, size);
+        return size;
+    }
+
     /// Return number of already-decoded samples available
     /// from playback position on
     unsigned int decodedSamplesAhead() const {
@@ -127,9 +139,36 @@ private:
         return left;
     }
 
+    /// Get the volume of the decoded data from a position on.
+    //
+    /// It is applied when samples are fetched, so that changes are heard
+    /// straight away.
+    //
+    /// @param pos      The position in the decoded data.
+    /// @param left     Set to the volume of the left channel (0..1).
+    /// @param right    Set to the volume of the right channel (0..1).
+    /// @return         The number of bytes from pos on that have this
+    ///                 volume. This is at least one stereo sample.
+    virtual size_t volume(size_t /*pos*/, float& left, float& right) const {
+        left = right = 1;
+        return std::numeric_limits<size_t>::max();
+    }
+
     // See dox in sound_handler.h (InputStream)
     unsigned int fetchSamples(boost::int16_t* to, unsigned int nSamples);
 
+    // See dox in InputStream.h
+    unsigned int mixSamples(boost::int32_t* mix, boost::int16_t* scratch,
+            unsigned int nSamples, float volume);
+
+    /// Fetch samples into either a buffer or a mix.
+    unsigned int fetch(boost::int16_t* to, boost::int32_t* mix,
+            unsigned int nSamples, float volume);
+
+    /// Write decoded samples from the playback position on.
+    void output(boost::int16_t*& to, boost::int32_t*& mix,
+            unsigned int nSamples, float volume);
+
     void createDecoder(media::MediaHandler& mediaHandler,
             const media::SoundInfo& info);
 
@@ -37,27 +37,11 @@ class DSOEXPORT NullSoundHandler : public sound_handler
 {
 public:
 
-    sound_handler* _mixer;
-
-    NullSoundHandler(media::MediaHandler* m, sound_handler* mixer=0)
+    NullSoundHandler(media::MediaHandler* m)
         :
-        sound_handler(m),
-        _mixer(mixer)
+        sound_handler(m)
     {}
 
-    // If a _mixer was given, let it do the mixing!
-    void mix(boost::int16_t* outSamples, boost::int16_t* inSamples,
-                unsigned int nSamples, float volume)
-    {
-        if ( _mixer ) _mixer->mix(outSamples, inSamples, nSamples, volume);
-        else {
-            // cheating, just copy input to output, which in NO WAY
-            // can be considered "mixing"
-            std::copy(outSamples, outSamples+nSamples, inSamples);
-        }
-    }
-
-
 };
 	
 } // gnash.sound namespace 
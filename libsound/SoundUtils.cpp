@@ -0,0 +1,105 @@
+// SoundUtils.cpp: mixing helpers, for gnash
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#include "SoundUtils.h"
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+#include "GnashNumeric.h"
+
+namespace gnash {
+namespace sound {
+
+namespace {
+
+/// Volumes are applied as fixed point numbers with this many bits after
+/// the point, so that a 16-bit sample times a volume fits in 32 bits.
+const int volumeShift = 14;
+
+boost::int32_t
+fixedVolume(float volume)
+{
+    const boost::int32_t v =
+        static_cast<boost::int32_t>(volume * (1 << volumeShift) + 0.5f);
+    return clamp<boost::int32_t>(v, 0, 32767);
+}
+
+}
+
+void
+mixStereo(boost::int32_t* mix, const boost::int16_t* in,
+        unsigned int nSamples, float left, float right)
+{
+    const boost::int32_t l = fixedVolume(left);
+    const boost::int32_t r = fixedVolume(right);
+    if (!l && !r) return;
+
+    unsigned int i = 0;
+
+#if defined(__SSE2__)
+    // Each sample is paired with a zero, so that a multiply-add of the
+    // pairs gives the sample times its channel's volume in 32 bits.
+    const __m128i vol = _mm_set_epi16(0, r, 0, l, 0, r, 0, l);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= nSamples; i += 8) {
+        const __m128i s =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        const __m128i lo = _mm_srai_epi32(
+                _mm_madd_epi16(_mm_unpacklo_epi16(s, zero), vol),
+                volumeShift);
+        const __m128i hi = _mm_srai_epi32(
+                _mm_madd_epi16(_mm_unpackhi_epi16(s, zero), vol),
+                volumeShift);
+        __m128i* m = reinterpret_cast<__m128i*>(mix + i);
+        _mm_storeu_si128(m, _mm_add_epi32(_mm_loadu_si128(m), lo));
+        _mm_storeu_si128(m + 1, _mm_add_epi32(_mm_loadu_si128(m + 1), hi));
+    }
+#endif
+
+    for (; i < nSamples; ++i) {
+        mix[i] += (in[i] * (i % 2 ? r : l)) >> volumeShift;
+    }
+}
+
+void
+packSamples(boost::int16_t* out, const boost::int32_t* mix,
+        unsigned int nSamples)
+{
+    unsigned int i = 0;
+
+#if defined(__SSE2__)
+    for (; i + 8 <= nSamples; i += 8) {
+        const __m128i a =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(mix + i));
+        const __m128i b =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(mix + i + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                _mm_packs_epi32(a, b));
+    }
+#endif
+
+    for (; i < nSamples; ++i) {
+        out[i] = clamp<boost::int32_t>(mix[i], -32768, 32767);
+    }
+}
+
+} // namespace sound
+} // namespace gnash
@@ -66,6 +66,24 @@ swfToOutSamples(const media::SoundInfo& sinfo, size_t swfSamples,
     return swfSamples * (outRate / sinfo.getSampleRate());
 }
 
+/// Add stereo samples to a mix, at a volume for each channel.
+//
+/// @param mix          The mix to add to, one value per sample.
+/// @param in           The samples to add, left and right in turn.
+/// @param nSamples     The number of samples to add.
+/// @param left         Volume factor for the left channel, up to 2.
+/// @param right        Volume factor for the right channel, up to 2.
+void mixStereo(boost::int32_t* mix, const boost::int16_t* in,
+        unsigned int nSamples, float left, float right);
+
+/// Write a mix as 16-bit samples, clipping where it is too loud.
+//
+/// @param out          The buffer to write to.
+/// @param mix          The mix to write.
+/// @param nSamples     The number of samples to write.
+void packSamples(boost::int16_t* out, const boost::int32_t* mix,
+        unsigned int nSamples);
+
 } // namespace sound
 } // namespace gnash
 
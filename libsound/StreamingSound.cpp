@@ -21,6 +21,7 @@
 #include "StreamingSound.h"
 
 #include <cmath>
+#include <limits>
 
 #include "AudioDecoder.h" 
 #include "log.h" 
@@ -61,7 +62,8 @@ StreamingSound::StreamingSound(StreamingSoundData& sd,
 bool
 StreamingSound::moreData()
 {
-    if (decodingCompleted()) return false;
+    // The sound is stopped when it runs out of data, so this is its end.
+    if (decodingCompleted()) return flushDecoder();
 
     decodeNextBlock();
     return true;
@@ -90,14 +92,6 @@ StreamingSound::decodeNextBlock()
 
         assert(!(decodedDataSize % 2));
 
-        boost::int16_t* samples = 
-            reinterpret_cast<boost::int16_t*>(decodedData);
-        unsigned int nSamples = decodedDataSize / 2;
-
-        if (_soundDef.volume != 100) {
-            adjustVolume(samples, samples + nSamples, _soundDef.volume/100.0);
-        }
-
         // decodedData ownership transferred here
         appendDecodedData(decodedData, decodedDataSize);
     }
@@ -112,6 +106,13 @@ StreamingSound::decodeNextBlock()
 
 }
 
+size_t
+StreamingSound::volume(size_t /*pos*/, float& left, float& right) const
+{
+    left = right = _soundDef.volume / 100.0;
+    return std::numeric_limits<size_t>::max();
+}
+
 bool
 StreamingSound::eof() const
 {
@@ -81,6 +81,11 @@ private:
     /// samples are present for a frame.
     virtual bool moreData();
 
+    /// Get the volume set for the sound.
+    //
+    /// See dox in LiveSound.h
+    virtual size_t volume(size_t pos, float& left, float& right) const;
+
     /// Return true if there's nothing more to decode
     virtual bool decodingCompleted() const {
         return _positionInBlock == 0 && 
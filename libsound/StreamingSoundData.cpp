@@ -21,6 +21,7 @@
 #include "StreamingSoundData.h"
 
 #include <vector>
+#include <algorithm>
 #include <boost/cstdint.hpp> 
 
 #include "SoundInfo.h"
@@ -39,17 +40,36 @@ StreamingSoundData::append(std::auto_ptr<SimpleBuffer> data,
         size_t sampleCount, int seekSamples)
 {
     assert(data.get());
-    _buffers.push_back(data);
-    _blockData.push_back(BlockData(sampleCount, seekSamples));
-    assert(_blockData.size() == _buffers.size());
-    return _buffers.size() - 1;
+
+    const size_t count = _blockCount.load(boost::memory_order_relaxed);
+    Block* blocks = _blocks.load(boost::memory_order_relaxed);
+
+    if (count == _capacity) {
+        _capacity = _capacity ? _capacity * 2 : 64;
+        Block* grown = new Block[_capacity];
+        std::copy(blocks, blocks + count, grown);
+        _arrays.push_back(grown);
+        blocks = grown;
+        _blocks.store(grown, boost::memory_order_release);
+    }
+
+    Block& b = blocks[count];
+    b.data = data.release();
+    b.sampleCount = sampleCount;
+    b.seekSamples = seekSamples;
+
+    _blockCount.store(count + 1, boost::memory_order_release);
+    return count;
 }
 
 StreamingSoundData::StreamingSoundData(const media::SoundInfo& info,
         int nVolume)
     :
     soundinfo(info),
-    volume(nVolume)
+    volume(nVolume),
+    _blocks(0),
+    _blockCount(0),
+    _capacity(0)
 {
 }
 
@@ -90,6 +110,14 @@ StreamingSoundData::createInstance(media::MediaHandler& mh, unsigned long block)
 StreamingSoundData::~StreamingSoundData()
 {
     clearInstances();
+
+    const Block* blocks = _blocks.load(boost::memory_order_relaxed);
+    for (size_t i = 0, e = blockCount(); i != e; ++i) {
+        delete blocks[i].data;
+    }
+    for (size_t i = 0; i < _arrays.size(); ++i) {
+        delete [] _arrays[i];
+    }
 }
 
 void
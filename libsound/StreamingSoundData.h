@@ -27,7 +27,7 @@
 #include <cassert>
 #include <boost/thread/mutex.hpp>
 #include <boost/scoped_ptr.hpp>
-#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/atomic.hpp>
 
 #include "SimpleBuffer.h" 
 #include "SoundInfo.h" 
@@ -66,6 +66,9 @@ public:
 
     /// Append a sound data block
     //
+    /// Blocks may be read by the mixer thread while this is called, but
+    /// only one thread may append.
+    //
     /// @param data          Undecoded sound data. Must be appropriately
     ///                      padded (see MediaHandler::getInputPaddingBytes())
     /// @param sampleCount   The number of samples when decoded.
@@ -75,23 +78,23 @@ public:
 
     /// Do we have any data?
     bool empty() const {
-        return _buffers.empty();
+        return !blockCount();
     }
 
     const SimpleBuffer& getBlock(size_t index) const {
-        return _buffers[index];
+        return *block(index).data;
     }
 
     size_t getSampleCount(size_t index) const {
-        return _blockData[index].sampleCount;
+        return block(index).sampleCount;
     }
 
     size_t getSeekSamples(size_t index) const {
-        return _blockData[index].seekSamples;
+        return block(index).seekSamples;
     }
 
     size_t blockCount() const {
-        return _buffers.size();
+        return _blockCount.load(boost::memory_order_acquire);
     }
 
     size_t playingBlock() const;
@@ -164,18 +167,18 @@ public:
 
 private:
 
-    struct BlockData
+    struct Block
     {
-        BlockData(size_t count, int seek)
-            :
-            sampleCount(count),
-            seekSamples(seek)
-        {}
-
+        const SimpleBuffer* data;
         size_t sampleCount;
         size_t seekSamples;
     };
 
+    const Block& block(size_t index) const {
+        assert(index < blockCount());
+        return _blocks.load(boost::memory_order_acquire)[index];
+    }
+
     /// Playing instances of this sound definition
     //
     /// Multithread access to this member is protected
@@ -185,9 +188,22 @@ private:
     /// Mutex protecting access to _soundInstances
     mutable boost::mutex _soundInstancesMutex;
 
-    boost::ptr_vector<SimpleBuffer> _buffers;
+    /// The blocks appended so far, read without locking.
+    //
+    /// A full array is replaced by a copy twice the size, and the new
+    /// array is stored before the count, so a reader that has seen the
+    /// count also sees an array holding that many blocks. Replaced
+    /// arrays are only freed on destruction, as a reader may still be
+    /// using one.
+    boost::atomic<Block*> _blocks;
+
+    boost::atomic<size_t> _blockCount;
+
+    /// The size of the current array, only used by append().
+    size_t _capacity;
 
-    std::vector<BlockData> _blockData;
+    /// Every array ever allocated, the current one last.
+    std::vector<Block*> _arrays;
 };
 
 } // gnash.sound namespace 
@@ -38,11 +38,6 @@
 // Mixing and decoding debugging
 //#define GNASH_DEBUG_MIXING
 
-/* The volume ranges from 0 - 128 */
-#define MIX_MAXVOLUME 128
-#define ADJUST_VOLUME(s, v)    (s = (s*v)/MIX_MAXVOLUME)
-#define ADJUST_VOLUME_U8(s, v)    (s = (((s-128)*v)/MIX_MAXVOLUME)+128)
-
 
 namespace gnash {
 namespace sound {
@@ -229,70 +224,6 @@ Mkit_sound_handler::tell(int soundHandle)
     return sound_handler::tell(soundHandle);
 }
 
-void 
-Mkit_sound_handler::MixAudio (boost::uint8_t *dst, const boost::uint8_t *src, boost::uint32_t len, int volume)
-{
-    //boost::uint16_t format;
-
-    if ( volume == 0 ) 
-    {
-        return;
-    }
-
-    //format = AHIST_S16S;
-
-    /* Actually we have a fixed audio format */
-    //switch (format) 
-    {
-        //case AHIST_S16S:
-        {
-            boost::int16_t src1, src2;
-            int dst_sample;
-            const int max_audioval = ((1<<(16-1))-1);
-            const int min_audioval = -(1<<(16-1));
-
-            len /= 2;
-            while ( len-- ) 
-            {
-                src1 = ((src[0])<<8|src[1]);
-                ADJUST_VOLUME(src1, volume);
-                src2 = ((dst[0])<<8|dst[1]);
-                src += 2;
-                dst_sample = src1+src2;
-                if ( dst_sample > max_audioval ) 
-                {
-                    dst_sample = max_audioval;
-                } 
-                else
-                if ( dst_sample < min_audioval ) 
-                {
-                    dst_sample = min_audioval;
-                }
-                dst[1] = dst_sample & 0xFF;
-                dst_sample >>= 8;
-                dst[0] = dst_sample & 0xFF;
-                dst += 2;
-            }
-        }
-        //break;
-    }
-    
-}
-
-void
-Mkit_sound_handler::mix(boost::int16_t* outSamples, boost::int16_t* inSamples, unsigned int nSamples, float volume)
-{
-    //if (!_closing)
-    {
-        unsigned int nBytes = nSamples*2;
-
-        boost::uint8_t *out = reinterpret_cast<boost::uint8_t*>(outSamples);
-        boost::uint8_t* in = reinterpret_cast<boost::uint8_t*>(inSamples);
-
-        MixAudio(out, in, nBytes, MIX_MAXVOLUME*volume);
-    }
-}
-
 void
 Mkit_sound_handler::plugInputStream(std::auto_ptr<InputStream> newStreamer)
 {
@@ -60,12 +60,6 @@ class Mkit_sound_handler : public sound_handler
     /// Mutex protecting _muted (defined in base class)
     mutable boost::mutex _mutedMutex;
 
-    // See dox in sound_handler.h
-    void mix(boost::int16_t* outSamples, boost::int16_t* inSamples,
-                unsigned int nSamples, float volume);
-
-    void MixAudio (boost::uint8_t *dst, const boost::uint8_t *src, boost::uint32_t len, int volume);
-
 public:
     Mkit_sound_handler(media::MediaHandler* m);
 
@@ -240,7 +240,8 @@ create_sound_handler_sdl(media::MediaHandler* m)
 void
 SDL_sound_handler::fetchSamples(boost::int16_t* to, unsigned int nSamples)
 {
-    boost::mutex::scoped_lock lock(_mutex);
+    // This takes no lock: streams are plugged and unplugged through
+    // the mixer's queues.
     sound_handler::fetchSamples(to, nSamples);
 
     // If nothing is left to play there is no reason to keep polling.
@@ -250,6 +251,10 @@ SDL_sound_handler::fetchSamples(boost::int16_t* to, unsigned int nSamples)
         log_debug("Pausing SDL Audio...");
 #endif
         SDL_PauseAudio(1);
+
+        // If a stream was plugged meanwhile, its unpausing may
+        // have come before our pausing.
+        if (hasInputStreams()) SDL_PauseAudio(0);
     }
 }
 
@@ -283,17 +288,6 @@ SDL_sound_handler::sdl_audio_callback(void *udata, Uint8 *buf, int bufLenIn)
     handler->fetchSamples(samples, nSamples);
 }
 
-void
-SDL_sound_handler::mix(boost::int16_t* outSamples, boost::int16_t* inSamples,
-            unsigned int nSamples, float volume)
-{
-    Uint8* out = reinterpret_cast<Uint8*>(outSamples);
-    Uint8* in = reinterpret_cast<Uint8*>(inSamples);
-    unsigned int nBytes = nSamples*2;
-    
-    SDL_MixAudio(out, in, nBytes, SDL_MIX_MAXVOLUME*volume);
-}
-
 void
 SDL_sound_handler::plugInputStream(std::auto_ptr<InputStream> newStreamer)
 {
@@ -312,27 +306,6 @@ SDL_sound_handler::plugInputStream(std::auto_ptr<InputStream> newStreamer)
     }
 }
 
-void
-SDL_sound_handler::mute()
-{
-    boost::mutex::scoped_lock lock(_mutedMutex);
-    sound_handler::mute();
-}
-
-void
-SDL_sound_handler::unmute()
-{
-    boost::mutex::scoped_lock lock(_mutedMutex);
-    sound_handler::unmute();
-}
-
-bool
-SDL_sound_handler::is_muted() const
-{
-    boost::mutex::scoped_lock lock(_mutedMutex);
-    return sound_handler::is_muted();
-}
-
 void
 SDL_sound_handler::pause() 
 {
@@ -58,23 +58,16 @@ private:
     bool _audioOpened;
     
     /// Mutex for making sure threads doesn't mess things up
+    //
+    /// The audio thread never takes this.
     mutable boost::mutex _mutex;
 
-    /// Mutex protecting _muted (defined in base class)
-    mutable boost::mutex _mutedMutex;
-
-    // See dox in sound_handler.h
-    void mix(boost::int16_t* outSamples, boost::int16_t* inSamples,
-                unsigned int nSamples, float volume);
-
-
     /// Callback invoked by the SDL audio thread.
     //
     /// This is basically a wrapper around fetchSamples
     ///
     /// @param udata
     ///     User data pointer (SDL_sound_handler instance in our case).
-    ///     We'll lock the SDL_sound_handler::_mutex during operations.
     ///
     /// @param stream
     ///     The output stream/buffer to fill
@@ -129,18 +122,6 @@ public:
     // See dox in sound_handler.h
     virtual media::SoundInfo* get_sound_info(int soundHandle) const;
 
-    // See dox in sound_handler.h
-    // overridden to serialize access to the _muted member
-    virtual void mute();
-
-    // See dox in sound_handler.h
-    // overridden to serialize access to the _muted member
-    virtual void unmute();
-
-    // See dox in sound_handler.h
-    // overridden to serialize access to the _muted member
-    virtual bool is_muted() const;
-
     // See dox in sound_handler.h
     // overridden to close audio card
     virtual void pause();
@@ -22,7 +22,8 @@
 #include <boost/cstdint.hpp> // For C99 int types
 #include <vector> 
 #include <cmath> 
-#include <boost/scoped_array.hpp>
+#include <algorithm>
+#include <boost/thread/thread.hpp>
 
 #include "EmbedSound.h" // for use
 #include "InputStream.h" // for use
@@ -31,6 +32,7 @@
 #include "StreamingSound.h"
 #include "StreamingSoundData.h"
 #include "SimpleBuffer.h"
+#include "SoundUtils.h"
 
 // Debug create_sound/delete_sound/playSound/stop_sound, loops
 //#define GNASH_DEBUG_SOUNDS_MANAGEMENT
@@ -318,6 +320,8 @@ sound_handler::stopEmbedSoundInstances(EmbedSound& def)
 void
 sound_handler::unplugInputStream(InputStream* id)
 {
+    unplugCompletedInputStreams();
+
     // WARNING: erasing would break any iteration in the set
     InputStreams::iterator it2=_inputStreams.find(id);
     if (it2 == _inputStreams.end()) {
@@ -327,6 +331,15 @@ sound_handler::unplugInputStream(InputStream* id)
         return; // we won't delete it, as it's likely deleted already
     }
 
+    // The mixer may be playing it, so wait until it lets go.
+    while (!_unplugged.push(id)) waitForMixer();
+    waitForMixer();
+
+    // If it ended meanwhile it is deleted as a completed stream.
+    unplugCompletedInputStreams();
+    it2 = _inputStreams.find(id);
+    if (it2 == _inputStreams.end()) return;
+
     _inputStreams.erase(it2);
 
     // Increment number of sound stop request for the testing framework
@@ -434,6 +447,8 @@ sound_handler::isSoundPlaying(int handle) const
 
     EmbedSound& sounddata = *(_sounds[handle]);
 
+    unplugCompletedInputStreams();
+
     // When this is called from a StreamSoundBlockTag,
     // we only start if this sound isn't already playing.
     return sounddata.isPlaying();
@@ -442,6 +457,8 @@ sound_handler::isSoundPlaying(int handle) const
 void
 sound_handler::playStream(int soundId, StreamBlockId blockId)
 {
+    unplugCompletedInputStreams();
+
     StreamingSoundData& s = *_streamingSounds[soundId];
     if (s.isPlaying() || s.empty()) return;
 
@@ -514,6 +531,8 @@ sound_handler::startSound(int handle, int loops, const SoundEnvelopes* env,
             handle, sounddata.soundinfo.getFormat());
 #endif
 
+    unplugCompletedInputStreams();
+
     // When this is called from a StreamSoundBlockTag,
     // we only start if this sound isn't already playing.
     if (!allowMultiple && sounddata.isPlaying()) {
@@ -550,18 +569,21 @@ sound_handler::startSound(int handle, int loops, const SoundEnvelopes* env,
 void
 sound_handler::plugInputStream(std::auto_ptr<InputStream> newStreamer)
 {
-#ifdef GNASH_DEBUG_SOUNDS_MANAGEMENT
-    InputStream* newStream = newStreamer.get(); // for debugging
-#endif
+    unplugCompletedInputStreams();
+
+    InputStream* newStream = newStreamer.get();
 
     if (!_inputStreams.insert(newStreamer.release()).second) {
         // this should never happen !
         log_error(_("_inputStreams container still has a pointer "
-                    "to deleted InputStream %p!"), newStreamer.get());
+                    "to deleted InputStream %p!"), newStream);
         // FIXME: replace the old element with the new one !
         abort();
     }
 
+    // The mixer takes it before its next buffer.
+    while (!_plugged.push(newStream)) waitForMixer();
+
 #ifdef GNASH_DEBUG_SOUNDS_MANAGEMENT
     log_debug("Plugged InputStream %p", newStream);
 #endif
@@ -573,6 +595,17 @@ sound_handler::plugInputStream(std::auto_ptr<InputStream> newStreamer)
 void
 sound_handler::unplugAllInputStreams()
 {
+    // Keep the mixer while the streams are deleted.
+    while (_mixerBusy.exchange(true, boost::memory_order_acquire)) {
+        boost::this_thread::yield();
+    }
+    takeMixerRequests();
+    _mixing.clear();
+    _mixingCount.store(0, boost::memory_order_release);
+
+    // The streams completed are among those deleted below.
+    while (_completed.front()) _completed.pop();
+
     for (InputStreams::iterator it=_inputStreams.begin(),
                                 itE=_inputStreams.end();
             it != itE; ++it)
@@ -580,6 +613,42 @@ sound_handler::unplugAllInputStreams()
         delete *it;
     }
     _inputStreams.clear();
+
+    _mixerBusy.store(false, boost::memory_order_release);
+}
+
+void
+sound_handler::takeMixerRequests()
+{
+    while (InputStream* const* is = _plugged.front()) {
+        _mixing.push_back(*is);
+        _mixingCount.store(_mixing.size(), boost::memory_order_release);
+        _plugged.pop();
+    }
+
+    while (InputStream* const* is = _unplugged.front()) {
+        MixedStreams::iterator it =
+            std::find(_mixing.begin(), _mixing.end(), *is);
+
+        // It is not there if it completed already.
+        if (it != _mixing.end()) {
+            _mixing.erase(it);
+            _mixingCount.store(_mixing.size(), boost::memory_order_release);
+        }
+        _unplugged.pop();
+    }
+}
+
+void
+sound_handler::waitForMixer()
+{
+    while (!_plugged.empty() || !_unplugged.empty()) {
+        if (!_mixerBusy.exchange(true, boost::memory_order_acquire)) {
+            takeMixerRequests();
+            _mixerBusy.store(false, boost::memory_order_release);
+        }
+        else boost::this_thread::yield();
+    }
 }
 
 void
@@ -587,56 +656,74 @@ sound_handler::fetchSamples(boost::int16_t* to, unsigned int nSamples)
 {
     if (isPaused()) return; // should we write wav file anyway ?
 
-    float finalVolumeFact = getFinalVolume()/100.0;
+    const float finalVolumeFact = getFinalVolume()/100.0;
 
-    std::fill(to, to + nSamples, 0);
+    if (_mix.size() < nSamples) {
+        _mix.resize(nSamples);
+        _scratch.resize(nSamples);
+    }
 
-    // call NetStream or Sound audio callbacks
-    if (!_inputStreams.empty()) {
+    boost::int32_t* mix = &_mix.front();
+    std::fill(mix, mix + nSamples, 0);
 
-        // A buffer to fetch InputStream samples into
-        boost::scoped_array<boost::int16_t> buf(new boost::int16_t[nSamples]);
+    // Another thread only holds the mixer to hand streams over, which is
+    // quick, so a silent buffer is better than waiting for it.
+    const bool mixing = !_mixerBusy.exchange(true, boost::memory_order_acquire);
+
+    if (mixing) takeMixerRequests();
+
+    // call NetStream or Sound audio callbacks
+    if (mixing && !_mixing.empty()) {
 
 #ifdef GNASH_DEBUG_SAMPLES_FETCHING 
-        log_debug("Fetching %d samples from each of %d input streams", nSamples, _inputStreams.size());
+        log_debug("Fetching %d samples from each of %d input streams", nSamples, _mixing.size());
 #endif
 
         // Loop through the aux streamers sounds
-        for (InputStreams::iterator it=_inputStreams.begin(),
-                                    end=_inputStreams.end();
+        for (MixedStreams::iterator it=_mixing.begin(),
+                                    end=_mixing.end();
                                     it != end; ++it)
         {
             InputStream* is = *it;
 
-            unsigned int wrote = is->fetchSamples(buf.get(), nSamples);
-            if (wrote < nSamples) {
-                // fill what wasn't written
-                std::fill(buf.get()+wrote, buf.get()+nSamples, 0);
-            }
+            // Each stream adds its samples to the mix, at the volume
+            // for its sound times the final volume.
+            is->mixSamples(mix, &_scratch.front(), nSamples, finalVolumeFact);
 
 #if GNASH_DEBUG_SAMPLES_FETCHING > 1
-            log_debug("  fetched %d/%d samples from input stream %p"
-                    " (%d samples fetchehd in total)",
-                    wrote, nSamples, is, is->samplesFetched());
+            log_debug("  mixed samples from input stream %p"
+                    " (%d samples fetched in total)",
+                    is, is->samplesFetched());
 #endif
-
-            mix(to, buf.get(), nSamples, finalVolumeFact);
         }
 
-        unplugCompletedInputStreams();
+        // Streams at their end are deleted by the threads calling the
+        // handler. If they don't keep up, the streams stay here, silent.
+        for (MixedStreams::iterator it = _mixing.begin(); it != _mixing.end();) {
+            if ((*it)->eof() && _completed.push(*it)) {
+#ifdef GNASH_DEBUG_SOUNDS_MANAGEMENT
+                log_debug(" Input stream %p reached EOF, unplugging", *it);
+#endif
+                it = _mixing.erase(it);
+            }
+            else ++it;
+        }
+        _mixingCount.store(_mixing.size(), boost::memory_order_release);
     }
 
+    if (mixing) _mixerBusy.store(false, boost::memory_order_release);
+
+    // Clip the mix once, however many streams there are.
+    packSamples(to, mix, nSamples);
+
     // TODO: move this to base class !
     if (_wavWriter.get()) {
         _wavWriter->pushSamples(to, nSamples);
-
-        // now, mute all audio
-        std::fill(to, to+nSamples, 0);
     }
 
-    // Now, after having "consumed" all sounds, blank out
-    // the buffer if muted..
-    if (is_muted()) {
+    // Now, after having "consumed" all sounds, blank out the buffer if
+    // dumping or muted.
+    if (_wavWriter.get() || _muted.load(boost::memory_order_relaxed)) {
         std::fill(to, to+nSamples, 0);
     }
 }
@@ -662,6 +749,8 @@ sound_handler::setAudioDump(const std::string& wavefile)
 bool
 sound_handler::streamingSound() const
 {
+    unplugCompletedInputStreams();
+
     if (_inputStreams.empty()) return false;
 
     for (StreamingSounds::const_iterator it = _streamingSounds.begin(), 
@@ -675,6 +764,7 @@ int
 sound_handler::getStreamBlock(int handle) const
 {
     if (!validHandle(_streamingSounds, handle)) return -1;
+    unplugCompletedInputStreams();
     if (!_streamingSounds[handle]->isPlaying()) return -1;
     InputStream* i = _streamingSounds[handle]->firstPlayingInstance();
     if (!i) return -1;
@@ -682,75 +772,55 @@ sound_handler::getStreamBlock(int handle) const
 }
 
 void
-sound_handler::unplugCompletedInputStreams()
+sound_handler::unplugCompletedInputStreams() const
 {
+    while (InputStream* const* completed = _completed.front()) {
 
-#ifdef GNASH_DEBUG_SOUNDS_MANAGEMENT
-    log_debug("Scanning %d input streams for completion", _inputStreams.size());
-#endif
+        InputStream* is = *completed;
+        _completed.pop();
 
-    for (InputStreams::iterator it = _inputStreams.begin(),
-            end = _inputStreams.end(); it != end;) {
-
-        InputStream* is = *it;
-
-        // On EOF, detach
-        if (is->eof()) {
-            // InputStream EOF, detach
-            InputStreams::iterator it2 = it;
-            ++it2; // before we erase it
-            InputStreams::size_type erased = _inputStreams.erase(is);
-            if ( erased != 1 ) {
-                log_error(_("Expected 1 InputStream element, found %d"), erased);
-                abort();
-            }
-            it = it2;
+        InputStreams::size_type erased = _inputStreams.erase(is);
+        if ( erased != 1 ) {
+            log_error(_("Expected 1 InputStream element, found %d"), erased);
+            abort();
+        }
 
 #ifdef GNASH_DEBUG_SOUNDS_MANAGEMENT
-            log_debug(" Input stream %p reached EOF, unplugging", is);
+        log_debug(" Deleting completed input stream %p", is);
 #endif
 
-            // WARNING! deleting the InputStream here means
-            //          a lot of things will happen from a
-            //          separate thread. Instead, if we
-            //          extend sound_handler interface to
-            //          have an unplugCompletedInputStreams
-            //          we may call it at heart-beating intervals
-            //          and drop any threading paranoia!
-            delete is;
-
-            // Increment number of sound stop request for the testing framework
-            ++_soundsStopped;
-        }
-        else ++it;
+        // The mixer only reports streams it has dropped, so this
+        // thread can delete them and everything they refer to.
+        delete is;
+
+        // Increment number of sound stop request for the testing framework
+        ++_soundsStopped;
     }
 }
 
 bool
 sound_handler::hasInputStreams() const
 {
-    return !_inputStreams.empty();
+    return _mixingCount.load(boost::memory_order_acquire) ||
+        !_plugged.empty();
 }
 
 bool
 sound_handler::is_muted() const
 {
-    // TODO: lock a mutex ?
-    return _muted;
+    return _muted.load(boost::memory_order_relaxed);
 }
 
 void
 sound_handler::mute()
 {
-    // TODO: lock a mutex ?
-    _muted=true;
+    _muted.store(true, boost::memory_order_relaxed);
 }
 
 void
 sound_handler::unmute()
 {
-    // TODO: lock a mutex ?
-    _muted=false;
+    _muted.store(false, boost::memory_order_relaxed);
 }
 
 void
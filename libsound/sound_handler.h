@@ -29,12 +29,14 @@
 #include <limits>
 #include <set>
 #include <boost/scoped_ptr.hpp>
+#include <boost/atomic.hpp>
 
 #include "dsodefs.h" // for DSOEXPORT
 #include "MediaHandler.h" // for inlined ctor
 #include "SoundEnvelope.h" // for SoundEnvelopes typedef
 #include "AuxStream.h" // for aux_streamer_ptr typedef
 #include "WAVWriter.h" // for dtor visibility 
+#include "RingBuffer.h"
 
 namespace gnash {
     namespace media {
@@ -375,6 +377,9 @@ public:
     /// so that audio from the classes no longer will be played through the 
     /// soundhandler.
     //
+    /// This returns once the mixer has stopped using the stream, waiting
+    /// for the buffer being mixed if there is one.
+    //
     /// @param id
     ///     The key identifying the auxiliary streamer, as returned
     ///     by attach_aux_streamer.
@@ -391,12 +396,19 @@ public:
     //
     /// @deprecated Use a TestingSoundHanlder !
     ///
-    size_t numSoundsStopped() const { return _soundsStopped; }
+    size_t numSoundsStopped() const {
+        unplugCompletedInputStreams();
+        return _soundsStopped;
+    }
 
     /// Fetch mixed samples
     //
     /// We run through all the plugged InputStreams fetching decoded
     /// audio blocks and mixing them into the given output stream.
+    /// This is called from the audio thread, so it does not allocate
+    /// memory unless more samples are asked for than ever before, and
+    /// never waits for another thread. If another thread is handing
+    /// streams over to the mixer at that moment the buffer is silent.
     ///
     /// @param to
     ///     The buffer to write mixed samples to.
@@ -415,34 +427,6 @@ public:
     ///
     virtual void fetchSamples(boost::int16_t* to, unsigned int nSamples);
 
-    /// Mix nSamples from inSamples to outSamples, with given volume
-    //
-    /// @param outSamples
-    ///     The output samples buffer, to mix to.
-    ///     Must be big enough to contain nSamples.
-    ///     Can be larger.
-    ///
-    /// @param inSamples
-    ///     The input samples buffer, to mix in.
-    ///     It is non-const as this method *is* allowed
-    ///     to mess with content, for example to apply
-    ///     volume.
-    ///     TODO: why not applying volume upstream ?!
-    ///
-    /// @param nSamples
-    ///     The amount of samples to mix in.
-    ///
-    /// @param volume
-    ///     The volume to apply to input samples, as a fraction (0..1)
-    ///
-    /// TODO: this interface says nothing about how many channels we're
-    ///       going to mix. It should, to be a sane interface.
-    ///       Maybe, a Mixer instance should be created, initialized
-    ///       with number of channels, at each fetching.
-    ///
-    virtual void mix(boost::int16_t* outSamples, boost::int16_t* inSamples,
-                unsigned int nSamples, float volume) = 0;
-
     /// Request to dump audio to the given filename
     //
     /// Every call to this function starts recording
@@ -464,12 +448,22 @@ protected:
         _paused(false),
         _muted(false),
         _volume(100),
-        _mediaHandler(m)
+        _mediaHandler(m),
+        _mixingCount(0),
+        _mixerBusy(false),
+        _plugged(mixerQueueSize),
+        _unplugged(mixerQueueSize),
+        _completed(mixerQueueSize),
+        _mix(mixBufferSize),
+        _scratch(mixBufferSize)
     {
+        _mixing.reserve(mixerQueueSize);
     }
 
     /// Plug an InputStream to the mixer
     //
+    /// The mixer starts playing it before its next buffer.
+    //
     /// @param in
     ///     The InputStream to plug, ownership transferred
     ///
@@ -479,6 +473,8 @@ protected:
     virtual void unplugAllInputStreams();
 
     /// Does the mixer have input streams ?
+    //
+    /// This may be called from any thread.
     bool hasInputStreams() const;
 
     /// Stop and delete all sounds
@@ -492,13 +488,13 @@ private:
     size_t _soundsStarted;
 
     /// Special test-member. Stores count of stopped sounds.
-    size_t _soundsStopped;
+    mutable size_t _soundsStopped;
 
     /// True if sound is paused
     bool _paused;
 
-    /// True if sound is muted
-    bool _muted;
+    /// True if sound is muted, read by the mixer
+    boost::atomic<bool> _muted;
 
     /// Final output volume
     int _volume;
@@ -527,16 +523,70 @@ private:
 
     /// Sound input streams.
     //
-    /// Elements owned by this class.
-    InputStreams _inputStreams;
+    /// Elements owned by this class. These are all the streams plugged
+    /// and not yet deleted, which only the threads calling the
+    /// handler use. The mixer keeps its own list in _mixing.
+    mutable InputStreams _inputStreams;
 
     media::MediaHandler* _mediaHandler;
 
-    /// Unplug any completed input stream
-    void unplugCompletedInputStreams();
+    /// Delete the streams the mixer dropped on reaching their end
+    //
+    /// This is const so that queries can report finished sounds as
+    /// stopped, as they were when the mixer deleted them itself.
+    void unplugCompletedInputStreams() const;
+
+    /// Move plugged and unplugged streams in and out of _mixing
+    //
+    /// The caller must hold _mixerBusy.
+    void takeMixerRequests();
+
+    /// Return once the mixer has taken all plugged and unplugged streams
+    //
+    /// When the mixer is between buffers the calling thread takes the
+    /// streams over itself, so this only waits for a buffer being mixed,
+    /// and never for the audio thread to be called again.
+    void waitForMixer();
+
+    typedef std::vector<InputStream*> MixedStreams;
+
+    /// The streams the mixer plays.
+    //
+    /// Only the thread holding _mixerBusy uses this.
+    MixedStreams _mixing;
+
+    /// The size of _mixing, for any thread.
+    boost::atomic<size_t> _mixingCount;
+
+    /// True while a thread uses _mixing and takes from the queues below.
+    //
+    /// The audio thread never waits for this.
+    boost::atomic<bool> _mixerBusy;
+
+    static const size_t mixerQueueSize = 256;
+
+    /// Streams plugged, waiting for the mixer to play them.
+    RingBuffer<InputStream*> _plugged;
+
+    /// Streams unplugged, waiting for the mixer to let go of them.
+    RingBuffer<InputStream*> _unplugged;
+
+    /// Streams the mixer dropped on reaching their end, to be deleted.
+    mutable RingBuffer<InputStream*> _completed;
 
     boost::scoped_ptr<WAVWriter> _wavWriter;
 
+    /// The samples a mix buffer is first allocated for.
+    //
+    /// This is more than the audio callbacks usually ask for.
+    static const unsigned int mixBufferSize = 8192;
+
+    /// The mix of the input streams, before clipping.
+    std::vector<boost::int32_t> _mix;
+
+    /// A buffer for input streams to fetch their samples into.
+    std::vector<boost::int16_t> _scratch;
+
 };
 
 // TODO: move to appropriate specific sound handlers
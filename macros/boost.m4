@@ -32,8 +32,9 @@ AC_DEFUN([GNASH_PATH_BOOST],
   dirname=""
   libname=""
   dnl this is a list of *required* headers. If any of these are missing, this
-  dnl test will return a failure, and Gnash won't build.
-  boost_headers="detail/lightweight_mutex.hpp thread/thread.hpp multi_index_container.hpp multi_index/key_extractors.hpp thread/mutex.hpp program_options/options_description.hpp iostreams/stream.hpp"
+  dnl test will return a failure, and Gnash won't build. atomic.hpp, used
+  dnl by the lock-free queues between threads, first shipped in Boost 1.53.
+  boost_headers="detail/lightweight_mutex.hpp thread/thread.hpp multi_index_container.hpp multi_index/key_extractors.hpp thread/mutex.hpp program_options/options_description.hpp iostreams/stream.hpp atomic.hpp"
   dnl this is a list of *required* libraries. If any of these are missing, this
   dnl test will return a failure, and Gnash won't build.
   boost_libs="thread program_options iostreams system"
@@ -662,6 +662,15 @@ dest.copyPixels(source, new Rect(0, 0, 100, 100), new Point(200, 50));
  check_equals(dest.getPixel(10, 52), 0xff0000);
  check_equals(dest.getPixel(90, 90), 0xff0000);
 
+// With mergeAlpha, transparent pixels are drawn over the destination.
+source = new flash.display.BitmapData(2, 1, true, 0x80ff0000);
+source.setPixel32(1, 0, 0x00ff0000);
+dest = new flash.display.BitmapData(2, 1, true, 0xff0000ff);
+dest.copyPixels(source, new Rect(0, 0, 2, 1), new Point(0, 0), null, null,
+        true);
+ check_equals(dest.getPixel32(0, 0), -8388481);
+ check_equals(dest.getPixel32(1, 0), -16776961);
+
 // Check self copies!
 
 source = new flash.display.BitmapData(100, 100, false);
@@ -1146,6 +1155,6 @@ flash.display.BitmapData.prototype = e;
 // END OF TEST
 //-------------------------------------------------------------
 
-totals(406);
+totals(408);
 
 #endif // OUTPUT_VERSION >= 8
@@ -0,0 +1,241 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "check.h"
+#include "GC.h"
+#include "rc.h"
+
+#include <vector>
+#include <iostream>
+#include <cstdlib>
+
+using namespace gnash;
+
+namespace {
+
+size_t alive = 0;
+
+class Node : public GcResource
+{
+public:
+    Node(GC& gc, bool barriers = true)
+        :
+        GcResource(gc),
+        _barriers(barriers)
+    {
+        ++alive;
+    }
+
+    ~Node() {
+        --alive;
+    }
+
+    std::vector<Node*> children;
+
+protected:
+
+    void markReachableResources() const {
+        for (size_t i = 0; i < children.size(); ++i) {
+            children[i]->setReachable();
+        }
+    }
+
+    bool hasWriteBarriers() const {
+        return _barriers;
+    }
+
+private:
+
+    const bool _barriers;
+};
+
+class Root : public GcRoot
+{
+public:
+    std::vector<Node*> nodes;
+
+    void markReachableResources() const {
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            nodes[i]->setReachable();
+        }
+    }
+};
+
+/// Make a chain of nodes hanging from a parent and return the last one.
+Node*
+makeChain(GC& gc, Node* parent, size_t length)
+{
+    for (size_t i = 0; i < length; ++i) {
+        Node* n = new Node(gc);
+        parent->children.push_back(n);
+        parent = n;
+    }
+    return parent;
+}
+
+}
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    // The collectors are set up from gnashrc and the environment, so
+    // the test sets all of their parameters.
+    unsetenv("GNASH_GC_TRIGGER_THRESHOLD");
+    RcInitFile& rc = RcInitFile::getDefaultInstance();
+    rc.setGCIncrementalBudget(0);
+    rc.setGCNurserySize(0);
+    rc.setGCPromotionAge(2);
+
+    Root root;
+    GC gc(root);
+
+    // Stop-the-world collection.
+    {
+        Node* a = new Node(gc);
+        root.nodes.push_back(a);
+        makeChain(gc, a, 100);
+        for (size_t i = 0; i < 50; ++i) new Node(gc);
+        check_equals(alive, 151);
+
+        gc.runCycle();
+        check_equals(alive, 101);
+
+        root.nodes.clear();
+        gc.runCycle();
+        check_equals(alive, 0);
+    }
+
+    // Incremental collection while the graph changes.
+    {
+        gc.setIncrementalBudget(1);
+
+        Node* a = new Node(gc);
+        Node* u = new Node(gc, false);
+        root.nodes.push_back(a);
+        root.nodes.push_back(u);
+
+        Node* chain = new Node(gc);
+        a->children.push_back(chain);
+        Node* last = makeChain(gc, chain, 10000);
+        Node* other = makeChain(gc, chain, 1000);
+
+        for (size_t i = 0; i < 1000; ++i) new Node(gc);
+        check_equals(alive, 12003);
+
+        gc.fuzzyCollect();
+
+        // Move the end of a chain to an object that may be black,
+        // once with a write barrier and once without.
+        Node* parent = chain;
+        for (size_t i = 0; i < 9999; ++i) parent = parent->children.front();
+        parent->children.clear();
+        a->children.push_back(last);
+        gc.writeBarrier(a);
+
+        parent = chain;
+        for (size_t i = 0; i < 999; ++i) parent = parent->children.back();
+        parent->children.pop_back();
+        u->children.push_back(other);
+
+        // New resources survive the current cycle.
+        last->children.push_back(new Node(gc));
+        gc.writeBarrier(last);
+        new Node(gc);
+
+        for (size_t i = 0; i < 1000; ++i) gc.fuzzyCollect();
+        check_equals(alive, 11005);
+
+        gc.runCycle();
+        check_equals(alive, 11004);
+
+        GC::CollectablesCount pauses;
+        gc.countPauses(pauses);
+        size_t count = 0;
+        for (GC::CollectablesCount::const_iterator i = pauses.begin(),
+                e = pauses.end(); i != e; ++i) {
+            count += i->second;
+        }
+        check(count > 2);
+    }
+
+    // Minor collections of the young generation.
+    {
+        Root root2;
+        GC gc2(root2);
+        alive = 0;
+
+        Node* o = new Node(gc2);
+        Node* u = new Node(gc2, false);
+        root2.nodes.push_back(o);
+        root2.nodes.push_back(u);
+        gc2.runCycle();
+
+        gc2.setNursery(100, 2);
+
+        // Referenced from an old object with write barriers.
+        Node* y = new Node(gc2);
+        o->children.push_back(y);
+        gc2.writeBarrier(o);
+
+        // Referenced from an old object without write barriers.
+        u->children.push_back(new Node(gc2));
+
+        for (size_t i = 0; i < 98; ++i) new Node(gc2);
+        check_equals(alive, 102);
+        gc2.fuzzyCollect();
+        check_equals(alive, 4);
+
+        // A young object referenced only by a young object that is
+        // promoted first.
+        Node* z = new Node(gc2);
+        o->children.push_back(z);
+        gc2.writeBarrier(o);
+        for (size_t i = 0; i < 99; ++i) new Node(gc2);
+        gc2.fuzzyCollect();
+        check_equals(alive, 5);
+
+        z->children.push_back(new Node(gc2));
+        for (size_t i = 0; i < 99; ++i) new Node(gc2);
+        gc2.fuzzyCollect();
+        check_equals(alive, 6);
+
+        for (size_t i = 0; i < 100; ++i) new Node(gc2);
+        gc2.fuzzyCollect();
+        check_equals(alive, 6);
+
+        for (size_t i = 0; i < 100; ++i) new Node(gc2);
+        gc2.fuzzyCollect();
+        check_equals(alive, 6);
+
+        // Promoted garbage is left to full cycles.
+        o->children.clear();
+        gc2.writeBarrier(o);
+        gc2.runCycle();
+        check_equals(alive, 3);
+
+        root2.nodes.clear();
+        gc2.runCycle();
+        check_equals(alive, 0);
+    }
+
+    return 0;
+}
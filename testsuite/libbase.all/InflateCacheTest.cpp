@@ -0,0 +1,193 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "inflate_cache.h"
+#include "zlib_adapter.h"
+#include "IOChannel.h"
+#include "tu_file.h"
+#include "check.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <memory>
+#include <string>
+#include <iostream>
+#include <unistd.h>
+#include <zlib.h>
+
+using namespace gnash;
+
+namespace {
+
+/// A compressed SWF.
+struct CompressedSWF
+{
+    explicit CompressedSWF(size_t bodySize)
+        :
+        body(bodySize)
+    {
+        boost::uint32_t seed = 1;
+        for (size_t i = 0; i < body.size(); ++i) {
+            seed = seed * 1103515245 + 12345;
+            body[i] = 'a' + ((seed >> 16) & 0xf);
+        }
+
+        length = body.size() + 8;
+        header = 'C' | ('W' << 8) | ('S' << 16) | (10 << 24);
+
+        uLongf compressedSize = compressBound(body.size());
+        data.resize(8 + compressedSize);
+        for (size_t i = 0; i < 4; ++i) data[i] = header >> (8 * i);
+        for (size_t i = 0; i < 4; ++i) data[4 + i] = length >> (8 * i);
+        compress(&data[8], &compressedSize,
+                reinterpret_cast<const Bytef*>(&body[0]), body.size());
+        data.resize(8 + compressedSize);
+    }
+
+    /// Inflate through the cache.
+    //
+    /// @param live     Whether the data can be inflated, or only read
+    ///                 from the cache.
+    std::auto_ptr<IOChannel> inflate(const std::string& dir, bool live) const
+    {
+        FILE* f = std::tmpfile();
+        if (live) std::fwrite(&data[0], 1, data.size(), f);
+        std::rewind(f);
+
+        std::auto_ptr<IOChannel> in = makeFileChannel(f, true);
+        in->seek(live ? 8 : 0);
+        if (live) in = zlib_adapter::make_inflater(in);
+
+        return inflate_cache::inflate(in, header, length, &data[0],
+                data.size(), dir);
+    }
+
+    /// Whether a stream holds the inflated body.
+    bool inflated(IOChannel& in) const
+    {
+        if (in.tell() != 8) return false;
+        std::vector<char> out(body.size() + 1);
+        if (in.read(&out[0], out.size()) !=
+                static_cast<std::streamsize>(body.size())) {
+            return false;
+        }
+        out.resize(body.size());
+        return out == body && in.seek(0) && in.read_byte() == 'F';
+    }
+
+    std::vector<char> body;
+    std::vector<boost::uint8_t> data;
+    boost::uint32_t header;
+    boost::uint32_t length;
+};
+
+long
+fileSize(const std::string& file)
+{
+    FILE* f = std::fopen(file.c_str(), "rb");
+    if (!f) return -1;
+    std::fseek(f, 0, SEEK_END);
+    const long ret = std::ftell(f);
+    std::fclose(f);
+    return ret;
+}
+
+}
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    char dirName[] = "/tmp/InflateCacheTest.XXXXXX";
+    check(mkdtemp(dirName));
+    const std::string dir(dirName);
+
+    const CompressedSWF swf(300000);
+    const std::string entry =
+        inflate_cache::entryName(dir, &swf.data[0], swf.data.size());
+
+    // Without a cache directory, nothing is stored.
+    {
+        std::auto_ptr<IOChannel> in = swf.inflate("", true);
+        check(swf.inflated(*in));
+        check_equals(fileSize(entry), -1);
+    }
+
+    // A miss inflates the SWF and stores it with its compressed copy.
+    {
+        std::auto_ptr<IOChannel> in = swf.inflate(dir, true);
+        check(swf.inflated(*in));
+        check_equals(in->size(), swf.length);
+        check_equals(fileSize(entry),
+                static_cast<long>(swf.length + swf.data.size()));
+    }
+
+    // A hit does not read the compressed input.
+    {
+        std::auto_ptr<IOChannel> in = swf.inflate(dir, false);
+        check(swf.inflated(*in));
+        check_equals(in->size(), swf.length);
+    }
+
+    // An entry for other compressed data with the same name is not used.
+    {
+        FILE* f = std::fopen(entry.c_str(), "r+b");
+        std::fseek(f, -1, SEEK_END);
+        std::fputc(swf.data.back() ^ 1, f);
+        std::fclose(f);
+
+        std::auto_ptr<IOChannel> in = swf.inflate(dir, false);
+        check(!swf.inflated(*in));
+
+        // It is replaced on the next miss.
+        in = swf.inflate(dir, true);
+        check(swf.inflated(*in));
+        in = swf.inflate(dir, false);
+        check(swf.inflated(*in));
+    }
+
+    // Neither is a truncated entry.
+    {
+        check(!truncate(entry.c_str(), swf.length));
+        std::auto_ptr<IOChannel> in = swf.inflate(dir, false);
+        check(!swf.inflated(*in));
+    }
+
+    // A truncated SWF is read, but not stored.
+    {
+        std::remove(entry.c_str());
+
+        CompressedSWF truncated(swf);
+        truncated.data.resize(truncated.data.size() / 2);
+        const std::string name = inflate_cache::entryName(dir,
+                &truncated.data[0], truncated.data.size());
+
+        std::auto_ptr<IOChannel> in = truncated.inflate(dir, true);
+        check(in->seek(8));
+        check(in->read_byte() == truncated.body[0]);
+        check_equals(fileSize(name), -1);
+    }
+
+    std::remove(entry.c_str());
+    check(!rmdir(dirName));
+}
@@ -0,0 +1,132 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "zlib_adapter.h"
+#include "IOChannel.h"
+#include "tu_file.h"
+#include "check.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <zlib.h>
+
+using namespace gnash;
+
+namespace {
+
+/// Counts the bytes read from another IOChannel.
+class CountingChannel : public IOChannel
+{
+public:
+    CountingChannel(std::auto_ptr<IOChannel> in) : _in(in), _read(0) {}
+
+    std::streamsize read(void* dst, std::streamsize num) {
+        const std::streamsize got = _in->read(dst, num);
+        _read += got;
+        return got;
+    }
+    std::streampos tell() const { return _in->tell(); }
+    bool seek(std::streampos p) { return _in->seek(p); }
+    void go_to_end() { _in->go_to_end(); }
+    bool eof() const { return _in->eof(); }
+    bool bad() const { return _in->bad(); }
+
+    size_t bytesRead() const { return _read; }
+
+private:
+    std::auto_ptr<IOChannel> _in;
+    size_t _read;
+};
+
+/// Read and compare the data at a position.
+bool
+readAt(IOChannel& in, const std::vector<char>& data, size_t pos)
+{
+    if (!in.seek(pos)) return false;
+    if (static_cast<size_t>(in.tell()) != pos) return false;
+
+    char buf[1000];
+    const size_t len = std::min(sizeof buf, data.size() - pos);
+    if (in.read(buf, len) != static_cast<std::streamsize>(len)) return false;
+    return !std::memcmp(buf, &data[pos], len);
+}
+
+}
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    // Some compressible data.
+    std::vector<char> data(5 << 20);
+    boost::uint32_t seed = 1;
+    for (size_t i = 0; i < data.size(); ++i) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = 'a' + ((seed >> 16) & 0xf);
+    }
+
+    uLongf compressedSize = compressBound(data.size());
+    std::vector<Bytef> compressed(compressedSize);
+    compress(&compressed[0], &compressedSize,
+            reinterpret_cast<const Bytef*>(&data[0]), data.size());
+
+    FILE* f = std::tmpfile();
+    std::fwrite(&compressed[0], 1, compressedSize, f);
+    std::rewind(f);
+
+    CountingChannel* counter =
+        new CountingChannel(makeFileChannel(f, true));
+    std::auto_ptr<IOChannel> in =
+        zlib_adapter::make_inflater(std::auto_ptr<IOChannel>(counter));
+
+    std::vector<char> out(data.size());
+    check_equals(in->read(&out[0], out.size()),
+            static_cast<std::streamsize>(data.size()));
+    check(out == data);
+    check_equals(counter->bytesRead(), compressedSize);
+
+    // Seeking back restarts from a checkpoint, not from the beginning.
+    const size_t before = counter->bytesRead();
+    check(readAt(*in, data, (7 << 19) + 7));
+    check(counter->bytesRead() - before < compressedSize / 4);
+
+    check(readAt(*in, data, 10));
+    check(readAt(*in, data, 5));
+
+    // So does seeking far forwards.
+    const size_t forwards = counter->bytesRead();
+    check(readAt(*in, data, (9 << 19) + 3));
+    check(counter->bytesRead() - forwards < compressedSize / 4);
+
+    check(readAt(*in, data, (3 << 19) + 100));
+    check(readAt(*in, data, data.size() - 10));
+    check(readAt(*in, data, 0));
+
+    // Exact checkpoint positions are not special.
+    check(readAt(*in, data, 1 << 20));
+    check(readAt(*in, data, (1 << 20) - 1));
+
+    check(!in->seek(data.size() + 1));
+}
+
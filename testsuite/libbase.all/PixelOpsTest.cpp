@@ -0,0 +1,189 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "check.h"
+#include "PixelOps.h"
+#include "WallClockTimer.h"
+
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+using namespace gnash;
+using namespace gnash::image;
+
+namespace {
+
+typedef std::vector<boost::uint8_t> Pixels;
+
+const char* levels[] = { "scalar", "SSE2", "AVX2" };
+
+/// Random premultiplied RGBA pixels.
+Pixels
+randomPixels(size_t count)
+{
+    Pixels p(count * 4);
+    for (size_t i = 0; i < count; ++i) {
+        const boost::uint8_t a = std::rand() & 0xff;
+        for (size_t c = 0; c < 3; ++c) p[i * 4 + c] = std::rand() % (a + 1);
+        p[i * 4 + 3] = a;
+    }
+    return p;
+}
+
+/// The same arithmetic as SWFCxForm::transform().
+boost::uint8_t
+transformed(boost::uint8_t v, boost::int16_t mult, boost::int16_t add)
+{
+    boost::int16_t t = v;
+    t = (t * mult >> 8) + add;
+    return t < 0 ? 0 : t > 255 ? 255 : t;
+}
+
+/// Throughput in millions of pixels per second.
+double
+mpixels(size_t pixels, size_t ms)
+{
+    return ms ? pixels / (ms * 1000.0) : 0;
+}
+
+}
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    const PixelOpsLevel best = pixelOpsLevel();
+    note("Pixel operations use %s", levels[best]);
+
+    const boost::int16_t mults[][4] = {
+        { 256, 256, 256, 256 },
+        { 128, -200, 512, 32767 },
+        { -32768, 0, 1, 300 }
+    };
+    const boost::int16_t adds[][4] = {
+        { 0, 0, 0, 0 },
+        { -100, 40, 255, -255 },
+        { 32767, -32768, 20000, -20000 }
+    };
+
+    for (int l = PIXELOPS_SCALAR; l <= best; ++l) {
+
+        setPixelOpsLevel(static_cast<PixelOpsLevel>(l));
+        const char* name = levels[l];
+
+        // Odd lengths leave a tail for the scalar code.
+        for (size_t count = 1; count < 42; count += 13) {
+
+            const Pixels src = randomPixels(count);
+
+            for (size_t t = 0; t < 3; ++t) {
+                Pixels p = src;
+                transformRGBA(&p[0], count, mults[t], adds[t]);
+                size_t wrong = 0;
+                for (size_t i = 0; i < count * 4; ++i) {
+                    if (p[i] != transformed(src[i], mults[t][i % 4],
+                                adds[t][i % 4])) ++wrong;
+                }
+                check_equals(wrong, 0);
+            }
+
+            // Use the random pixels as RGB data.
+            const size_t rgbCount = count * 4 / 3;
+            Pixels rgba(rgbCount * 4, 0);
+            expandRGB(&src[0], &rgba[0], rgbCount);
+            size_t wrong = 0;
+            for (size_t i = 0; i < rgbCount; ++i) {
+                if (rgba[i * 4] != src[i * 3] ||
+                        rgba[i * 4 + 1] != src[i * 3 + 1] ||
+                        rgba[i * 4 + 2] != src[i * 3 + 2] ||
+                        rgba[i * 4 + 3] != 0xff) ++wrong;
+            }
+            check_equals(wrong, 0);
+        }
+
+        // Unmultiplied pixels, checked against blending in floating point.
+        {
+            Pixels src(256 * 4);
+            Pixels dst(256 * 4);
+            for (size_t i = 0; i < src.size(); ++i) src[i] = std::rand();
+            for (size_t i = 0; i < dst.size(); ++i) dst[i] = std::rand();
+            const Pixels orig = dst;
+            blendOverUnmultiplied(&src[0], &dst[0], 256);
+            size_t wrong = 0;
+            for (size_t i = 0; i < 256; ++i) {
+                const boost::uint8_t* s = &src[i * 4];
+                const boost::uint8_t* d = &orig[i * 4];
+                const double sa = s[3] / 255.0;
+                const double da = d[3] / 255.0 * (1 - sa);
+                const double a = sa + da;
+                for (size_t c = 0; c < 4; ++c) {
+                    const double v = c == 3 ? a * 255 :
+                        a ? (s[c] * sa + d[c] * da) / a : d[c];
+                    if (std::abs(dst[i * 4 + c] - v) > 0.5 + 1e-9) ++wrong;
+                }
+            }
+            check_equals(wrong, 0);
+        }
+
+        // A transparent pixel leaves the destination alone whatever its
+        // colour, which blending premultiplied pixels would not.
+        {
+            const boost::uint8_t red[] = { 0xff, 0, 0, 0 };
+            const boost::uint8_t blue[] = { 0, 0, 0xff, 0xff };
+            Pixels dst(blue, blue + 4);
+            blendOverUnmultiplied(red, &dst[0], 1);
+            check(dst == Pixels(blue, blue + 4));
+
+            const boost::uint8_t halfRed[] = { 0xff, 0, 0, 0x80 };
+            blendOverUnmultiplied(halfRed, &dst[0], 1);
+            check_equals(int(dst[0]), 0x80);
+            check_equals(int(dst[1]), 0);
+            check_equals(int(dst[2]), 0x7f);
+            check_equals(int(dst[3]), 0xff);
+        }
+
+        // Throughput on a 640x480 frame.
+        const size_t count = 640 * 480;
+        const size_t rounds = 50;
+        Pixels frame = randomPixels(count);
+        Pixels out(count * 4);
+
+        WallClockTimer timer;
+        for (size_t i = 0; i < rounds; ++i) {
+            transformRGBA(&frame[0], count, mults[1], adds[1]);
+        }
+        const size_t transformTime = timer.elapsed();
+
+        timer.restart();
+        for (size_t i = 0; i < rounds; ++i) {
+            expandRGB(&frame[0], &out[0], count);
+        }
+        const size_t expandTime = timer.elapsed();
+
+        note("%s: cxform %.0f Mpixels/s, RGB to RGBA %.0f Mpixels/s", name,
+                mpixels(count * rounds, transformTime),
+                mpixels(count * rounds, expandTime));
+    }
+
+    return 0;
+}
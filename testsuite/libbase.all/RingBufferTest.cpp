@@ -0,0 +1,136 @@
+//
+//   Copyright (C) 2012 Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "check.h"
+#include "RingBuffer.h"
+#include "WallClockTimer.h"
+
+#include <deque>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+using namespace gnash;
+
+namespace {
+
+const size_t items = 2000000;
+
+/// Push 1 .. items, spinning while the queue is full.
+void
+produce(RingBuffer<size_t>* queue)
+{
+    for (size_t i = 1; i <= items; ++i) {
+        while (!queue->push(i)) boost::this_thread::yield();
+    }
+}
+
+/// The same with a locked deque, for comparison.
+struct LockedQueue
+{
+    boost::mutex mutex;
+    std::deque<size_t> items;
+};
+
+void
+produceLocked(LockedQueue* queue)
+{
+    for (size_t i = 1; i <= items; ++i) {
+        boost::mutex::scoped_lock lock(queue->mutex);
+        queue->items.push_back(i);
+    }
+}
+
+}
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    RingBuffer<int> q(5);
+    check_equals(q.capacity(), 8u);
+    check(q.empty());
+    check(!q.front());
+
+    int v = 0;
+    check(!q.peekFront(v));
+    check(!q.peekBack(v));
+
+    for (int i = 0; i < 8; ++i) check(q.push(i));
+    check(q.full());
+    check(!q.push(8));
+    check_equals(q.size(), 8u);
+
+    check(q.peekFront(v));
+    check_equals(v, 0);
+    check(q.peekBack(v));
+    check_equals(v, 7);
+
+    // Elements come out in order, also after wrapping around.
+    for (int i = 0; i < 20; ++i) {
+        check_equals(*q.front(), i);
+        q.pop();
+        check(q.push(i + 8));
+        check(q.peekBack(v));
+        check_equals(v, i + 8);
+    }
+    check_equals(q.size(), 8u);
+
+    while (q.front()) q.pop();
+    check(q.empty());
+
+    // One thread pushing, one popping.
+    RingBuffer<size_t> shared(64);
+    size_t expected = 1;
+    size_t outOfOrder = 0;
+
+    WallClockTimer timer;
+    boost::thread producer(boost::bind(produce, &shared));
+    while (expected <= items) {
+        const size_t* front = shared.front();
+        if (!front) {
+            boost::this_thread::yield();
+            continue;
+        }
+        if (*front != expected) ++outOfOrder;
+        shared.pop();
+        ++expected;
+    }
+    producer.join();
+    const boost::uint32_t ringTime = timer.elapsed();
+
+    check_equals(outOfOrder, 0u);
+    check(shared.empty());
+
+    LockedQueue locked;
+    timer.restart();
+    boost::thread lockedProducer(boost::bind(produceLocked, &locked));
+    for (size_t got = 0; got < items; ) {
+        boost::mutex::scoped_lock lock(locked.mutex);
+        if (locked.items.empty()) continue;
+        locked.items.pop_front();
+        ++got;
+    }
+    lockedProducer.join();
+
+    note("%lu items: %u ms through a RingBuffer, %u ms through a locked "
+            "deque", static_cast<unsigned long>(items), ringTime,
+            timer.elapsed());
+}
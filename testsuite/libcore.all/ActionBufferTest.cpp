@@ -0,0 +1,388 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "action_buffer.h"
+#include "SWFStream.h"
+#include "IOChannel.h"
+#include "tu_file.h"
+#include "mmap_adapter.h"
+#include "SWF.h"
+#include "log.h"
+#include "RunResources.h"
+#include "StreamProvider.h"
+#include "WallClockTimer.h"
+#include "DummyMovieDefinition.h"
+#include "ManualClock.h"
+#include "movie_root.h"
+#include "Movie.h"
+#include "VM.h"
+#include "as_environment.h"
+#include "as_object.h"
+#include "ActionExec.h"
+
+#include <cstdio>
+#include <vector>
+#include <memory>
+#include <iostream>
+
+#include "check.h"
+
+using namespace std;
+using namespace gnash;
+
+namespace {
+
+/// Walk the raw buffer the way the interpreter used to.
+size_t
+walkRaw(const action_buffer& code)
+{
+    size_t count = 0;
+    size_t pc = 0;
+    while (pc < code.size()) {
+        const boost::uint8_t id = code[pc];
+        if (id == SWF::ACTION_END) break;
+        if ((id & 0x80) == 0) ++pc;
+        else pc += code.read_uint16(pc + 1) + 3;
+        ++count;
+    }
+    return count;
+}
+
+/// Walk the pre-decoded instruction stream.
+size_t
+walkDecoded(const action_buffer& code)
+{
+    const action_buffer::Instructions& insns = code.instructions();
+    size_t count = 0;
+    for (size_t i = 0; i < insns.size(); ++i) {
+        if (insns[i].id == SWF::ACTION_END) break;
+        ++count;
+    }
+    return count;
+}
+
+/// Append a little-endian 32-bit value.
+void
+put32(std::vector<boost::uint8_t>& v, boost::uint32_t i)
+{
+    for (size_t b = 0; b < 4; ++b) v.push_back((i >> (b * 8)) & 0xff);
+}
+
+/// Code that counts register 0 up to n, then sets x to it.
+std::vector<boost::uint8_t>
+countingLoop(boost::uint32_t n)
+{
+    const boost::uint8_t head[] = {
+        // 0: constant pool "x"
+        SWF::ACTION_CONSTANTPOOL, 0x04, 0x00, 0x01, 0x00, 'x', 0x00,
+        // 7: push int 0; 15: store register 0; 19: pop
+        SWF::ACTION_PUSHDATA, 0x05, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00,
+        SWF::ACTION_SETREGISTER, 0x01, 0x00, 0x00,
+        SWF::ACTION_POP,
+        // 20: push register 0, int n
+        SWF::ACTION_PUSHDATA, 0x07, 0x00, 0x04, 0x00, 0x07
+    };
+    const boost::uint8_t tail[] = {
+        // 30: less than; 31: not; 32: branch if true +21 (to 58)
+        SWF::ACTION_NEWLESSTHAN,
+        SWF::ACTION_LOGICALNOT,
+        SWF::ACTION_BRANCHIFTRUE, 0x02, 0x00, 0x15, 0x00,
+        // 37: push register 0, int 1; 47: add; 48: store register 0
+        SWF::ACTION_PUSHDATA, 0x07, 0x00, 0x04, 0x00, 0x07, 0x01, 0x00,
+        0x00, 0x00,
+        SWF::ACTION_NEWADD,
+        SWF::ACTION_SETREGISTER, 0x01, 0x00, 0x00,
+        // 52: pop; 53: branch always -38 (to 20)
+        SWF::ACTION_POP,
+        SWF::ACTION_BRANCHALWAYS, 0x02, 0x00, 0xda, 0xff,
+        // 58: push constant 0, register 0; 65: set variable; 66: end
+        SWF::ACTION_PUSHDATA, 0x04, 0x00, 0x08, 0x00, 0x04, 0x00,
+        SWF::ACTION_SETVARIABLE,
+        SWF::ACTION_END
+    };
+    std::vector<boost::uint8_t> code(head, head + sizeof(head));
+    put32(code, n);
+    code.insert(code.end(), tail, tail + sizeof(tail));
+    return code;
+}
+
+/// Write a DoAction tag containing the given bytes to a temporary file.
+std::auto_ptr<IOChannel>
+makeDoAction(const std::vector<boost::uint8_t>& actions, bool map = false)
+{
+    FILE* fp = std::tmpfile();
+    assert(fp);
+
+    // Long tag header: DoAction is tag 12.
+    const boost::uint16_t header = (SWF::DOACTION << 6) | 0x3f;
+    std::fputc(header & 0xff, fp);
+    std::fputc(header >> 8, fp);
+    const boost::uint32_t len = actions.size();
+    for (size_t i = 0; i < 4; ++i) std::fputc((len >> (i * 8)) & 0xff, fp);
+    std::fwrite(&actions.front(), 1, actions.size(), fp);
+    std::rewind(fp);
+
+    if (map) {
+        std::fflush(fp);
+        std::auto_ptr<IOChannel> mapped = mmap_adapter::make_stream(fileno(fp));
+        if (mapped.get()) {
+            std::fclose(fp);
+            return mapped;
+        }
+    }
+
+    return makeFileChannel(fp, true);
+}
+
+}
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    gnash::LogFile& dbglogfile = gnash::LogFile::getDefaultInstance();
+    dbglogfile.setVerbosity();
+
+    RunResources ri;
+    const URL url("");
+    ri.setStreamProvider(
+            boost::shared_ptr<StreamProvider>(new StreamProvider(url, url)));
+    boost::intrusive_ptr<movie_definition> md(new DummyMovieDefinition(ri, 6));
+
+    // 0: stop
+    // 1: branch always -6 (back to 0)
+    // 6: play
+    // 7: branch if true +1 (into the middle of the next action)
+    // 12: branch always 0
+    // 17: end
+    const boost::uint8_t prog[] = {
+        SWF::ACTION_STOP,
+        SWF::ACTION_BRANCHALWAYS, 0x02, 0x00, 0xfa, 0xff,
+        SWF::ACTION_PLAY,
+        SWF::ACTION_BRANCHIFTRUE, 0x02, 0x00, 0x01, 0x00,
+        SWF::ACTION_BRANCHALWAYS, 0x02, 0x00, 0x00, 0x00,
+        SWF::ACTION_END
+    };
+    std::vector<boost::uint8_t> actions(prog, prog + sizeof(prog));
+
+    {
+        std::auto_ptr<IOChannel> file(makeDoAction(actions));
+        SWFStream in(file.get());
+        in.open_tag();
+        action_buffer code(*md);
+        code.read(in, in.get_tag_end_position());
+
+        const action_buffer::Instructions& insns = code.instructions();
+        check_equals(insns.size(), 6);
+        check_equals(insns[0].nextPC, 1);
+        check_equals(insns[1].pc, 1);
+        check_equals(insns[1].nextPC, 6);
+        check_equals(insns[1].target, 0);
+        check_equals(insns[3].target, action_buffer::noIndex);
+        check_equals(insns[4].target, 5);
+        check_equals(insns[5].id, SWF::ACTION_END);
+
+        check_equals(code.findInstruction(6), 2);
+        check_equals(code.findInstruction(3), insns.size());
+        check_equals(code.findInstruction(100), insns.size());
+
+        check_equals(walkRaw(code), walkDecoded(code));
+        in.close_tag();
+    }
+
+    // Code read from a mapped file is not copied, and stays valid
+    // after the file is closed.
+    {
+        std::auto_ptr<IOChannel> file(makeDoAction(actions, true));
+        check(file->data());
+
+        SWFStream in(file.get());
+        in.open_tag();
+        action_buffer code(*md);
+        code.read(in, in.get_tag_end_position());
+        check_equals(in.tell(), in.get_tag_end_position());
+        check_equals(code.getFramePointer(0), file->data().get() + 6);
+        in.close_tag();
+
+        file.reset();
+        check_equals(code.size(), actions.size());
+        check_equals(code.instructions().size(), 6);
+    }
+
+    // Code without an END is copied and terminated.
+    {
+        // The last two actions end with a zero byte, so stop after play.
+        std::vector<boost::uint8_t> noEnd(actions.begin(), actions.begin() + 7);
+        std::auto_ptr<IOChannel> file(makeDoAction(noEnd, true));
+        SWFStream in(file.get());
+        in.open_tag();
+        action_buffer code(*md);
+        code.read(in, in.get_tag_end_position());
+        check_equals(code.size(), noEnd.size() + 1);
+        check_equals(code[code.size() - 1], SWF::ACTION_END);
+        check(code.getFramePointer(0) != file->data().get() + 6);
+        in.close_tag();
+    }
+
+    // A truncated action is left to the slow path.
+    {
+        std::vector<boost::uint8_t> bad(actions.begin(), actions.begin() + 10);
+        std::auto_ptr<IOChannel> file(makeDoAction(bad));
+        SWFStream in(file.get());
+        in.open_tag();
+        action_buffer code(*md);
+        code.read(in, in.get_tag_end_position());
+        check_equals(code.instructions().size(), 3);
+        in.close_tag();
+    }
+
+    // Push operands are decoded once.
+    {
+        const boost::uint8_t push[] = {
+            SWF::ACTION_PUSHDATA, 0x22, 0x00,
+            0x00, 'a', 'b', 0x00,           // string
+            0x01, 0x00, 0x00, 0xc0, 0x3f,   // float 1.5
+            0x02,                           // null
+            0x03,                           // undefined
+            0x04, 0x01,                     // register 1
+            0x05, 0x01,                     // true
+            0x06, 0x00, 0x00, 0x04, 0x40,   // double 2.5, high word first
+            0x00, 0x00, 0x00, 0x00,
+            0x07, 0x07, 0x00, 0x00, 0x00,   // int 7
+            0x08, 0x03,                     // constant 3
+            0x09, 0x02, 0x01,               // constant 0x102
+            SWF::ACTION_PUSHDATA, 0x02, 0x00, 0x0b, 0x00,   // bad type
+            SWF::ACTION_PUSHDATA, 0x03, 0x00, 0x00, 'a', 'b', // no NUL
+            SWF::ACTION_END
+        };
+        std::vector<boost::uint8_t> bytes(push, push + sizeof(push));
+        std::auto_ptr<IOChannel> file(makeDoAction(bytes));
+        SWFStream in(file.get());
+        in.open_tag();
+        action_buffer code(*md);
+        code.read(in, in.get_tag_end_position());
+
+        const action_buffer::Instructions& insns = code.instructions();
+        check_equals(insns.size(), 4);
+        check_equals(insns[0].operandCount, 10);
+
+        typedef action_buffer::PushOperand Op;
+        const size_t o = insns[0].operands;
+        check(code.pushOperand(o).value.strictly_equals(as_value("ab")));
+        check(code.pushOperand(o + 1).value.strictly_equals(as_value(1.5)));
+        check(code.pushOperand(o + 2).value.is_null());
+        check(code.pushOperand(o + 3).value.is_undefined());
+        check_equals(code.pushOperand(o + 4).kind, Op::REGISTER);
+        check_equals(code.pushOperand(o + 4).index, 1);
+        check(code.pushOperand(o + 5).value.strictly_equals(as_value(true)));
+        check(code.pushOperand(o + 6).value.strictly_equals(as_value(2.5)));
+        check(code.pushOperand(o + 7).value.strictly_equals(as_value(7.0)));
+        check_equals(code.pushOperand(o + 8).kind, Op::CONSTANT);
+        check_equals(code.pushOperand(o + 8).index, 3);
+        check_equals(code.pushOperand(o + 9).kind, Op::CONSTANT);
+        check_equals(code.pushOperand(o + 9).index, 0x102);
+
+        // Malformed operands are left to the slow path.
+        check_equals(insns[1].operands, action_buffer::noIndex);
+        check_equals(insns[2].operands, action_buffer::noIndex);
+        in.close_tag();
+    }
+
+    // Run the interpreter over decoded code, and report its speed.
+    {
+        ManualClock clock;
+        movie_root root(clock, ri);
+        root.init(md.get(), MovieClip::MovieVariables());
+        VM& vm = root.getVM();
+        as_object* target = getObject(&root.getRootMovie());
+
+        const boost::uint32_t n = 100000;
+        std::auto_ptr<IOChannel> file(makeDoAction(countingLoop(n)));
+        SWFStream in(file.get());
+        in.open_tag();
+        action_buffer code(*md);
+        code.read(in, in.get_tag_end_position());
+        in.close_tag();
+
+        const action_buffer::Instructions& insns = code.instructions();
+        check_equals(insns.size(), 16);
+        check_equals(insns[7].target, 13);
+        check_equals(insns[12].target, 4);
+        check_equals(insns[13].operandCount, 2);
+
+        const size_t runs = 5;
+        WallClockTimer timer;
+        for (size_t i = 0; i < runs; ++i) {
+            as_environment env(vm);
+            env.set_target(&root.getRootMovie());
+            ActionExec exec(code, env);
+            exec();
+            check_equals(env.stack_size(), 0);
+        }
+        const boost::uint32_t time = timer.elapsed();
+
+        const as_value* reg = vm.getRegister(0);
+        check(reg && reg->strictly_equals(as_value(double(n))));
+        check(getMember(*target, getURI(vm, "x")).strictly_equals(
+                    as_value(double(n))));
+
+        note("interpreter: %u loop iterations of 9 actions in %u ms",
+                static_cast<unsigned>(n * runs), time);
+    }
+
+    // Compare the cost of walking a large buffer.
+    {
+        std::vector<boost::uint8_t> big;
+        for (size_t i = 0; i < 20000; ++i) {
+            big.push_back(SWF::ACTION_PLAY);
+            big.push_back(SWF::ACTION_BRANCHALWAYS);
+            big.push_back(0x02);
+            big.push_back(0x00);
+            big.push_back(0x00);
+            big.push_back(0x00);
+        }
+        big.push_back(SWF::ACTION_END);
+
+        std::auto_ptr<IOChannel> file(makeDoAction(big));
+        SWFStream in(file.get());
+        in.open_tag();
+        action_buffer code(*md);
+        code.read(in, in.get_tag_end_position());
+
+        const size_t runs = 200;
+        size_t raw = 0, decoded = 0;
+
+        WallClockTimer timer;
+        for (size_t i = 0; i < runs; ++i) raw += walkRaw(code);
+        const boost::uint32_t rawTime = timer.elapsed();
+
+        timer.restart();
+        for (size_t i = 0; i < runs; ++i) decoded += walkDecoded(code);
+        const boost::uint32_t decodedTime = timer.elapsed();
+
+        check_equals(raw, decoded);
+        note("%lu actions: raw walk %u ms, decoded walk %u ms",
+                static_cast<unsigned long>(raw), rawTime, decodedTime);
+        in.close_tag();
+    }
+
+    return 0;
+}
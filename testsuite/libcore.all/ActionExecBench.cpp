@@ -0,0 +1,226 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// Runs a set of SWFs with and without pre-decoded action buffers, checks
+// that they trace the same and reports the time each takes.
+//
+// Usage: ActionExecBench [file.swf ...]
+//
+// Without arguments the actionscript.all movies are used, if they have
+// been built, and the sample SWFs in the testsuite.
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "action_buffer.h"
+#include "MovieFactory.h"
+#include "movie_definition.h"
+#include "movie_root.h"
+#include "MovieClip.h"
+#include "RunResources.h"
+#include "StreamProvider.h"
+#include "TagLoadersTable.h"
+#include "DefaultTagLoaders.h"
+#include "ManualClock.h"
+#include "WallClockTimer.h"
+#include "IOChannel.h"
+#include "tu_file.h"
+#include "URL.h"
+#include "GnashException.h"
+#include "log.h"
+#include "check.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <iostream>
+#include <dirent.h>
+#include <boost/intrusive_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+#ifndef SRCDIR
+# define SRCDIR "."
+#endif
+
+#ifndef BUILDDIR
+# define BUILDDIR "."
+#endif
+
+using namespace gnash;
+
+namespace {
+
+/// The most frames run of each movie.
+const size_t maxFrames = 200;
+
+/// Return the traces in logged output.
+//
+/// Other messages are left out: some are only logged once in a process,
+/// so they depend on what ran before.
+std::string
+traces(const std::string& logged)
+{
+    const std::string prefix("FUNCTION: ");
+    std::istringstream in(logged);
+    std::string ret, line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, prefix.size(), prefix)) continue;
+        ret += line;
+        ret += '\n';
+    }
+    return ret;
+}
+
+/// Run a movie and return the time its frames took, in milliseconds.
+//
+/// @param output   Set to what the movie traced, if verbose is true.
+boost::uint32_t
+runMovie(const std::string& file, const RunResources& r, bool verbose,
+        std::string& output)
+{
+    LogFile& log = LogFile::getDefaultInstance();
+    log.setVerbosity(verbose ? 1 : 0);
+
+    // Traces go to stdout.
+    std::ostringstream logged;
+    std::streambuf* out = std::cout.rdbuf(logged.rdbuf());
+
+    boost::uint32_t time = 0;
+    try {
+        std::auto_ptr<IOChannel> in = makeFileChannel(file.c_str(), "rb");
+        if (!in.get()) throw GnashException("can't open " + file);
+
+        boost::intrusive_ptr<movie_definition> md =
+            MovieFactory::makeMovie(in, file, r, false);
+        if (!md) throw GnashException("can't load " + file);
+        md->completeLoad();
+
+        ManualClock clock;
+        movie_root root(clock, r);
+
+        const size_t frames =
+            std::min<size_t>(md->get_frame_count() + 1, maxFrames);
+        const unsigned long interval = 1000 / md->get_frame_rate();
+
+        WallClockTimer timer;
+        root.init(md.get(), MovieClip::MovieVariables());
+        for (size_t i = 0; i < frames; ++i) {
+            clock.advance(interval);
+            root.advance();
+        }
+        time = timer.elapsed();
+    }
+    catch (...) {
+        std::cout.rdbuf(out);
+        log.setVerbosity(0);
+        throw;
+    }
+
+    std::cout.rdbuf(out);
+    log.setVerbosity(0);
+    MovieFactory::clear();
+
+    output = traces(logged.str());
+    return time;
+}
+
+void
+addCorpus(const std::string& dir, std::vector<std::string>& files)
+{
+    DIR* d = opendir(dir.c_str());
+    if (!d) return;
+    while (const struct dirent* e = readdir(d)) {
+        const std::string name(e->d_name);
+        if (name.size() > 4 && name.substr(name.size() - 4) == ".swf") {
+            files.push_back(dir + "/" + name);
+        }
+    }
+    closedir(d);
+}
+
+}
+
+int
+main(int argc, char** argv)
+{
+    std::vector<std::string> files(argv + 1, argv + argc);
+    if (files.empty()) {
+        addCorpus(BUILDDIR "/actionscript.all", files);
+        addCorpus(SRCDIR "/samples", files);
+    }
+
+    LogFile& log = LogFile::getDefaultInstance();
+    log.setStamp(false);
+
+    boost::shared_ptr<SWF::TagLoadersTable> loaders(
+            new SWF::TagLoadersTable());
+    addDefaultLoaders(*loaders);
+
+    RunResources r;
+    r.setTagLoaders(loaders);
+    const URL url("");
+    r.setStreamProvider(
+            boost::shared_ptr<StreamProvider>(new StreamProvider(url, url)));
+
+    // Runs of each movie in each mode, after a first one that checks
+    // the output.
+    const size_t runs = 5;
+    boost::uint32_t rawTime = 0;
+    boost::uint32_t decodedTime = 0;
+    size_t movies = 0;
+
+    for (size_t i = 0; i < files.size(); ++i) {
+
+        std::string rawOutput, decodedOutput, ignored;
+        boost::uint32_t raw = 0, decoded = 0;
+        try {
+            action_buffer::setDecoding(false);
+            runMovie(files[i], r, true, rawOutput);
+            for (size_t j = 0; j < runs; ++j) {
+                raw += runMovie(files[i], r, false, ignored);
+            }
+
+            action_buffer::setDecoding(true);
+            runMovie(files[i], r, true, decodedOutput);
+            for (size_t j = 0; j < runs; ++j) {
+                decoded += runMovie(files[i], r, false, ignored);
+            }
+        }
+        catch (const GnashException& e) {
+            note("%s: %s", files[i].c_str(), e.what());
+            continue;
+        }
+
+        check(decodedOutput == rawOutput);
+        rawTime += raw;
+        decodedTime += decoded;
+        ++movies;
+
+        std::cout << files[i] << ": raw " << raw << " ms, decoded "
+            << decoded << " ms" << std::endl;
+    }
+
+    note("%lu movies run %lu times: raw loop %u ms, decoded %u ms",
+            static_cast<unsigned long>(movies),
+            static_cast<unsigned long>(runs), rawTime, decodedTime);
+
+    return 0;
+}
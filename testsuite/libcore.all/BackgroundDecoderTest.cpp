@@ -0,0 +1,102 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "BackgroundDecoder.h"
+#include "GnashSleep.h"
+#include "check.h"
+
+#include <vector>
+#include <stdexcept>
+#include <iostream>
+#include <boost/bind.hpp>
+
+using namespace gnash;
+
+namespace {
+
+void
+append(std::vector<int>* out, int value)
+{
+    out->push_back(value);
+}
+
+/// Sleeps longer for earlier jobs, so that they finish last.
+BackgroundDecoder::Publisher
+decode(std::vector<int>* out, int value, int jobs)
+{
+    gnashSleep((jobs - value) * 1000);
+    return boost::bind(append, out, value * 10);
+}
+
+BackgroundDecoder::Publisher
+fail()
+{
+    throw std::runtime_error("bad tag");
+}
+
+void
+runJobs(size_t threads)
+{
+    std::vector<int> out;
+    BackgroundDecoder decoder(threads);
+
+    const int jobs = 8;
+    for (int i = 0; i < jobs; ++i) {
+        decoder.add(boost::bind(decode, &out, i, jobs));
+    }
+    decoder.add(fail);
+    check_equals(decoder.pending(), jobs + 1u);
+
+    // Nothing is published until asked.
+    check(out.empty());
+
+    decoder.publish();
+    check_equals(decoder.pending(), 0u);
+    check_equals(out.size(), static_cast<size_t>(jobs));
+
+    bool ordered = true;
+    for (int i = 0; i < jobs; ++i) ordered &= (out[i] == i * 10);
+    check(ordered);
+
+    // Later jobs are published separately.
+    decoder.add(boost::bind(decode, &out, jobs, jobs));
+    decoder.publish();
+    check_equals(out.size(), jobs + 1u);
+    check_equals(out.back(), jobs * 10);
+
+    // Nothing happens with nothing to publish.
+    decoder.publish();
+    check_equals(out.size(), jobs + 1u);
+
+    // Unpublished jobs are discarded.
+    decoder.add(boost::bind(decode, &out, 0, jobs));
+}
+
+}
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    runJobs(0);
+    runJobs(1);
+    runJobs(4);
+}
@@ -24,6 +24,7 @@
 #include "as_object.h"
 #include "Property.h"
 #include "PropertyList.h"
+#include "FlatPropertyContainer.h"
 #include "MovieClip.h"
 #include "DisplayObject.h"
 #include "RGBA.h"
@@ -77,7 +78,7 @@ using namespace gnash::SWF;
 (rgba) (SWFMatrix) (SWFRect) (LineStyle) (FillStyle) (SWFCxForm) \
 (as_value) \
 (DynamicShape)(ShapeRecord)(TextRecord) \
-(Property) (PropertyList) \
+(Property) (PropertyList) (FlatPropertyContainer) \
 (DefinitionTag) (DefineTextTag) (DefineFontTag) (DefineMorphShapeTag) \
 (as_object) \
 (DisplayObject) (StaticText) (MorphShape) (Shape) \
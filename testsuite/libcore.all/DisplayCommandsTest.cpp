@@ -0,0 +1,208 @@
+// 
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+// 
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "DisplayCommands.h"
+#include "DummyMovieDefinition.h"
+#include "RunResources.h"
+#include "CachedBitmap.h"
+#include "ShapeRecord.h"
+#include "FillStyle.h"
+#include "SWFMatrix.h"
+#include "SWFRect.h"
+#include "check.h"
+
+#include <vector>
+#include <cstdlib>
+#include <iostream>
+#include <boost/intrusive_ptr.hpp>
+
+using namespace gnash;
+
+namespace {
+
+/// Records calls and keeps the polygons it is asked to draw.
+class PolygonRenderer : public RecordingRenderer
+{
+public:
+    PolygonRenderer(DisplayCommands& c) : RecordingRenderer(c) {}
+
+    virtual void draw_poly(const std::vector<point>& corners,
+            const rgba& fill, const rgba& outline, const SWFMatrix& mat,
+            bool masked) {
+        polygons.push_back(corners);
+        RecordingRenderer::draw_poly(corners, fill, outline, mat, masked);
+    }
+
+    std::vector<std::vector<point> > polygons;
+};
+
+/// Draws recorded frames itself, like AGG with several threads.
+class FrameRenderer : public RecordingRenderer
+{
+public:
+    FrameRenderer(DisplayCommands& c) : RecordingRenderer(c), frames(0) {}
+
+    virtual bool drawRecording(const DisplayCommands& frame) {
+        ++frames;
+        background = frame.background();
+        return true;
+    }
+
+    size_t frames;
+    rgba background;
+};
+
+class TestBitmap : public CachedBitmap
+{
+public:
+    image::GnashImage& image() { std::abort(); }
+    void dispose() {}
+    bool disposed() const { return false; }
+};
+
+/// Counts the bitmaps looked up.
+class BitmapMovie : public DummyMovieDefinition
+{
+public:
+    BitmapMovie(const RunResources& ri, CachedBitmap* bitmap)
+        :
+        DummyMovieDefinition(ri),
+        lookups(0),
+        _bitmap(bitmap)
+    {}
+
+    virtual CachedBitmap* getBitmap(int /*id*/) const {
+        ++lookups;
+        return _bitmap;
+    }
+
+    mutable size_t lookups;
+
+private:
+    CachedBitmap* _bitmap;
+};
+
+}
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    DisplayCommands frame;
+    check(frame.empty());
+
+    RecordingRenderer recorder(frame);
+
+    std::vector<point> line;
+    line.push_back(point(0, 0));
+    line.push_back(point(20, 20));
+
+    std::vector<point> square;
+    square.push_back(point(0, 0));
+    square.push_back(point(100, 0));
+    square.push_back(point(100, 100));
+    square.push_back(point(0, 100));
+
+    std::vector<point> triangle;
+    triangle.push_back(point(0, 0));
+    triangle.push_back(point(50, 0));
+    triangle.push_back(point(25, 40));
+
+    {
+        Renderer::External ex(recorder, rgba(10, 20, 30, 255), 100, 50,
+                0, 2000, 0, 1000);
+
+        recorder.drawLine(line, rgba(), SWFMatrix());
+        recorder.begin_submit_mask();
+        recorder.draw_poly(square, rgba(), rgba(), SWFMatrix(), false);
+        recorder.end_submit_mask();
+        recorder.draw_poly(triangle, rgba(), rgba(), SWFMatrix(), true);
+        recorder.disable_mask();
+    }
+
+    check_equals(frame.size(), 6);
+
+    // Without a target Renderer nothing is clipped.
+    const geometry::Range2d<int> pixel(0, 0, 1, 1);
+    check(recorder.bounds_in_clipping_area(pixel));
+    check_equals(recorder.world_to_pixel(SWFRect(0, 0, 20, 40)),
+            geometry::Range2d<int>(0, 0, 20, 40));
+
+    // The same frame can be drawn any number of times.
+    DisplayCommands copy;
+    PolygonRenderer polys(copy);
+
+    for (size_t i = 0; i < 2; ++i) {
+        polys.polygons.clear();
+        frame.render(polys);
+
+        check_equals(copy.size(), 6);
+        check_equals(polys.polygons.size(), 2);
+        if (polys.polygons.size() != 2) continue;
+
+        check_equals(polys.polygons[0].size(), 4);
+        check_equals(polys.polygons[1].size(), 3);
+        check_equals(polys.polygons[0][2], point(100, 100));
+        check_equals(polys.polygons[1][2], point(25, 40));
+    }
+    check_equals(frame.size(), 6);
+
+    // A Renderer that takes the recording isn't replayed to.
+    DisplayCommands unused;
+    FrameRenderer taker(unused);
+    frame.render(taker);
+    check_equals(taker.frames, 1u);
+    check_equals(taker.background, rgba(10, 20, 30, 255));
+    check(unused.empty());
+
+    frame.clear();
+    check(frame.empty());
+
+    // Recording a shape looks up its bitmaps, so that replaying it from
+    // several threads only reads them.
+    {
+        RunResources ri;
+        boost::intrusive_ptr<CachedBitmap> bitmap(new TestBitmap);
+        boost::intrusive_ptr<BitmapMovie> md(new BitmapMovie(ri,
+                    bitmap.get()));
+
+        SWF::ShapeRecord shape;
+        const FillStyle fill(BitmapFill(SWF::FILL_TILED_BITMAP, md.get(), 1,
+                    SWFMatrix()));
+        shape.addFillStyle(fill);
+
+        DisplayCommands shapes;
+        shapes.drawShape(shape, Transform());
+        check_equals(md->lookups, 1u);
+
+        DisplayCommands replayed;
+        RecordingRenderer replayer(replayed);
+        shapes.replay(replayer);
+        check_equals(md->lookups, 1u);
+
+        const BitmapFill& f =
+            boost::get<BitmapFill>(shape.fillStyles().front().fill);
+        check_equals(f.bitmap(), bitmap.get());
+        check_equals(md->lookups, 1u);
+    }
+
+    return 0;
+}
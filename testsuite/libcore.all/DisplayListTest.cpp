@@ -32,11 +32,13 @@
 #include "ManualClock.h"
 #include "RunResources.h"
 #include "StreamProvider.h"
+#include "WallClockTimer.h"
 
 #include <iostream>
 #include <sstream>
 #include <cassert>
 #include <string>
+#include <vector>
 
 #include "check.h"
 
@@ -91,6 +93,80 @@ main(int /*argc*/, char** /*argv*/)
     dlist2.placeDisplayObject(ch2, 1);
     dlist2.placeDisplayObject(ch1, 2);
     
-    
-}
+    // Depth operations on a larger list, placed out of order.
+    {
+        DisplayList dlist;
+        std::vector<DisplayObject*> chars;
+        const int count = 100;
+        for (int i = 0; i < count; ++i) {
+            as_object* ob = createObject(getGlobal(*getObject(root)));
+            DisplayObject* ch = new DummyCharacter(ob, root);
+            chars.push_back(ch);
+            dlist.placeDisplayObject(ch, (i * 37) % count);
+        }
+        check_equals(dlist.size(), static_cast<size_t>(count));
+        check_equals(dlist.getNextHighestDepth(), count);
+        check_equals(dlist.getDisplayObjectAtDepth(37), chars[1]);
+        check_equals(dlist.getDisplayObjectAtDepth(count), (DisplayObject*)0);
+
+        // Swap with an occupied depth.
+        dlist.swapDepths(chars[1], 74);
+        check_equals(dlist.getDisplayObjectAtDepth(74), chars[1]);
+        check_equals(dlist.getDisplayObjectAtDepth(37), chars[2]);
+
+        // Move down to a free depth, then up past the end.
+        dlist.swapDepths(chars[0], -5);
+        check_equals(dlist.getDisplayObjectAtDepth(-5), chars[0]);
+        check_equals(dlist.getDisplayObjectAtDepth(0), (DisplayObject*)0);
+        dlist.swapDepths(chars[0], 500);
+        check_equals(dlist.getDisplayObjectAtDepth(500), chars[0]);
+        check_equals(dlist.getNextHighestDepth(), 501);
+
+        // Inserting shifts occupied depths up.
+        as_object* ob = createObject(getGlobal(*getObject(root)));
+        DisplayObject* ins = new DummyCharacter(ob, root);
+        dlist.insertDisplayObject(ins, 10);
+        check_equals(dlist.getDisplayObjectAtDepth(10), ins);
+        check_equals(dlist.getDisplayObjectAtDepth(11), chars[30]);
+        check_equals(dlist.size(), static_cast<size_t>(count + 1));
+
+        dlist.destroy();
+        check(dlist.empty());
+    }
 
+    // Scaling of depth operations.
+    for (int count = 1000; count <= 16000; count *= 4) {
+        DisplayList dlist;
+        std::vector<DisplayObject*> chars;
+        for (int i = 0; i < count; ++i) {
+            as_object* ob = createObject(getGlobal(*getObject(root)));
+            chars.push_back(new DummyCharacter(ob, root));
+        }
+
+        WallClockTimer timer;
+        for (int i = 0; i < count; ++i) {
+            dlist.placeDisplayObject(chars[i], (i * 7919) % count);
+        }
+        const boost::uint32_t placeTime = timer.elapsed();
+
+        timer.restart();
+        size_t found = 0;
+        for (int i = 0; i < count; ++i) {
+            if (dlist.getDisplayObjectAtDepth(i)) ++found;
+        }
+        const boost::uint32_t findTime = timer.elapsed();
+
+        timer.restart();
+        for (int i = 0; i < count; ++i) {
+            dlist.swapDepths(chars[i], count + i);
+        }
+        const boost::uint32_t swapTime = timer.elapsed();
+
+        check_equals(found, static_cast<size_t>(count));
+        check_equals(dlist.getNextHighestDepth(), count * 2);
+        note("%d DisplayObjects: place %u ms, find %u ms, swapDepths %u ms",
+                count, placeTime, findTime, swapTime);
+
+        dlist.destroy();
+    }
+}
@@ -0,0 +1,221 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "LazyBitmap.h"
+#include "DisplayCommands.h"
+#include "GnashImage.h"
+#include "check.h"
+
+#include <memory>
+#include <iostream>
+#include <boost/bind.hpp>
+#include <boost/intrusive_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+using namespace gnash;
+
+namespace {
+
+class TestBitmap : public CachedBitmap
+{
+public:
+    TestBitmap(std::auto_ptr<image::GnashImage> im) : _image(im.release()) {}
+    image::GnashImage& image() { return *_image; }
+    void dispose() { _image.reset(); }
+    bool disposed() const { return !_image.get(); }
+private:
+    boost::scoped_ptr<image::GnashImage> _image;
+};
+
+/// A renderer that only creates bitmaps.
+class BitmapRenderer : public RecordingRenderer
+{
+public:
+    BitmapRenderer(DisplayCommands& c) : RecordingRenderer(c) {}
+
+    virtual CachedBitmap* createCachedBitmap(
+            std::auto_ptr<image::GnashImage> im) {
+        return new TestBitmap(im);
+    }
+};
+
+std::auto_ptr<image::GnashImage>
+decode(size_t* calls, size_t width)
+{
+    ++*calls;
+    std::auto_ptr<image::GnashImage> im;
+    if (width) im.reset(new image::ImageRGBA(width, 1));
+    return im;
+}
+
+/// Lets one decoder wait for another to run.
+struct Gate
+{
+    Gate() : started(false), open(false), sawOpen(false) {}
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    bool started;
+    bool open;
+    bool sawOpen;
+};
+
+/// Decode after another decoder has opened the gate, or after a timeout.
+std::auto_ptr<image::GnashImage>
+decodeAfterGate(Gate* g, size_t* calls)
+{
+    boost::mutex::scoped_lock lock(g->mutex);
+    g->started = true;
+    g->cond.notify_all();
+    const boost::system_time timeout =
+        boost::get_system_time() + boost::posix_time::seconds(10);
+    while (!g->open) {
+        if (!g->cond.timed_wait(lock, timeout)) break;
+    }
+    g->sawOpen = g->open;
+    ++*calls;
+    return std::auto_ptr<image::GnashImage>(new image::ImageRGBA(4, 1));
+}
+
+std::auto_ptr<image::GnashImage>
+decodeOpeningGate(Gate* g)
+{
+    boost::mutex::scoped_lock lock(g->mutex);
+    g->open = true;
+    g->cond.notify_all();
+    return std::auto_ptr<image::GnashImage>(new image::ImageRGBA(4, 1));
+}
+
+void
+draw(const LazyBitmap* bm, const CachedBitmap** result)
+{
+    *result = bm->materialize();
+}
+
+}
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    DisplayCommands commands;
+    BitmapRenderer renderer(commands);
+
+    size_t callsA = 0;
+    size_t callsB = 0;
+    boost::intrusive_ptr<LazyBitmap> a(
+            new LazyBitmap(boost::bind(decode, &callsA, 10), renderer));
+    boost::intrusive_ptr<LazyBitmap> b(
+            new LazyBitmap(boost::bind(decode, &callsB, 20), renderer));
+
+    // Nothing is decoded until needed.
+    check(!a->decoded());
+    check_equals(callsA, 0u);
+    check_equals(LazyBitmap::decodedBytes(), 0u);
+
+    const CachedBitmap* bm = a->materialize();
+    check(bm);
+    check(bm != a.get());
+    check(a->decoded());
+    check_equals(callsA, 1u);
+    check_equals(LazyBitmap::decodedBytes(), 40u);
+
+    // Drawing again uses the decoded bitmap.
+    check_equals(a->materialize(), bm);
+    check_equals(callsA, 1u);
+    check_equals(a->image().width(), 10u);
+
+    check(b->materialize());
+    check_equals(LazyBitmap::decodedBytes(), 120u);
+
+    // Bitmaps used since the last eviction are kept.
+    LazyBitmap::evict(0);
+    check(a->decoded());
+    check(b->decoded());
+
+    // Only b is used in this frame, so a goes.
+    b->materialize();
+    LazyBitmap::evict(0);
+    check(!a->decoded());
+    check(b->decoded());
+    check_equals(LazyBitmap::decodedBytes(), 80u);
+
+    // Nothing goes if the limit is not reached.
+    LazyBitmap::evict(80);
+    check(b->decoded());
+
+    // Then the least recently used goes first.
+    a->materialize();
+    check_equals(callsA, 2u);
+    LazyBitmap::evict(1000);
+    LazyBitmap::evict(50);
+    check(!b->decoded());
+    check(a->decoded());
+
+    // Destroying a decoded bitmap frees it.
+    a.reset();
+    check_equals(LazyBitmap::decodedBytes(), 0u);
+
+    b->dispose();
+    check(b->disposed());
+    check(!b->decoded());
+    check_equals(b->materialize(), b.get());
+    check_equals(callsB, 1u);
+
+    // Failures are not tried again.
+    size_t callsC = 0;
+    LazyBitmap c(boost::bind(decode, &callsC, 0), renderer);
+    check(!c.materialize());
+    check(!c.materialize());
+    check_equals(callsC, 1u);
+    check_equals(LazyBitmap::decodedBytes(), 0u);
+
+    // Decoding one bitmap doesn't hold up others, and a bitmap drawn
+    // by two threads at once is only decoded once.
+    {
+        Gate gate;
+        size_t callsD = 0;
+        LazyBitmap d(boost::bind(decodeAfterGate, &gate, &callsD), renderer);
+        LazyBitmap e(boost::bind(decodeOpeningGate, &gate), renderer);
+
+        const CachedBitmap* first = 0;
+        const CachedBitmap* second = 0;
+        boost::thread t1(boost::bind(draw, &d, &first));
+        {
+            boost::mutex::scoped_lock lock(gate.mutex);
+            while (!gate.started) gate.cond.wait(lock);
+        }
+        boost::thread t2(boost::bind(draw, &d, &second));
+
+        check(e.materialize());
+        t1.join();
+        t2.join();
+
+        check(gate.sawOpen);
+        check_equals(callsD, 1u);
+        check(first);
+        check(first == second);
+        check_equals(LazyBitmap::decodedBytes(), 32u);
+    }
+    check_equals(LazyBitmap::decodedBytes(), 0u);
+}
@@ -31,12 +31,19 @@
 #include "ManualClock.h"
 #include "RunResources.h"
 #include "StreamProvider.h"
+#include "MemberCache.h"
+#include "namedStrings.h"
+#include "FlatPropertyContainer.h"
 
 #include <iostream>
 #include <sstream>
 #include <cassert>
 #include <string>
 #include <utility> // for make_pair
+#include <vector>
+#ifdef HAVE_MALLINFO
+# include <malloc.h>
+#endif
 
 #include "check.h"
 
@@ -202,5 +209,222 @@ main(int /*argc*/, char** /*argv*/)
 		check_equals(props.size(), 3);
 
 	}
-}
 
+    // The stamp follows the layout, not the values.
+    {
+        PropertyList p(*obj);
+        const boost::uint64_t s0 = p.stamp();
+        p.setValue(getURI(vm, "a"), val);
+        const boost::uint64_t s1 = p.stamp();
+        check(s1 != s0);
+        p.setValue(getURI(vm, "a"), val2);
+        check_equals(p.stamp(), s1);
+        p.setFlags(getURI(vm, "a"), PropFlags::dontEnum, 0);
+        check(p.stamp() != s1);
+        const boost::uint64_t s2 = p.stamp();
+        p.delProperty(getURI(vm, "a"));
+        check(p.stamp() != s2);
+        PropertyList p2(*obj);
+        check(p2.stamp() != p.stamp());
+    }
+
+    // Lists that had the same members added in the same order share a
+    // stamp, unless their __proto__ differs.
+    {
+        as_object* proto = new as_object(getGlobal(vm));
+        as_object* proto2 = new as_object(getGlobal(vm));
+
+        PropertyList a(*obj);
+        PropertyList b(*obj);
+        PropertyList c(*obj);
+        a.setValue(NSV::PROP_uuPROTOuu, proto, as_object::DefaultFlags);
+        b.setValue(NSV::PROP_uuPROTOuu, proto, as_object::DefaultFlags);
+        c.setValue(NSV::PROP_uuPROTOuu, proto2, as_object::DefaultFlags);
+        check_equals(a.stamp(), b.stamp());
+        check(a.stamp() != c.stamp());
+
+        a.setValue(getURI(vm, "x"), val);
+        b.setValue(getURI(vm, "x"), val2);
+        check_equals(a.stamp(), b.stamp());
+        a.setValue(getURI(vm, "y"), val);
+        b.setValue(getURI(vm, "z"), val);
+        check(a.stamp() != b.stamp());
+
+        // Changing __proto__ makes the stamp unique.
+        const boost::uint64_t s = c.stamp();
+        c.setValue(NSV::PROP_uuPROTOuu, proto, as_object::DefaultFlags);
+        check(c.stamp() != s);
+        check(c.stamp() != a.stamp());
+    }
+
+    // Cached lookups follow changes to the inheritance chain.
+    {
+        MemberCache cache;
+        const ObjectURI& k = getURI(vm, "inherited");
+
+        as_object* proto = new as_object(getGlobal(vm));
+        as_object* o = new as_object(getGlobal(vm));
+        o->set_prototype(proto);
+        proto->set_member(k, val);
+
+        check(cache.get(*o, k, &ret));
+        check_strictly_equals(ret, val);
+        check(cache.get(*o, k, &ret));
+        check_strictly_equals(ret, val);
+
+        // Shadow the inherited member.
+        o->set_member(k, val2);
+        check(cache.get(*o, k, &ret));
+        check_strictly_equals(ret, val2);
+
+        o->delProperty(k);
+        check(cache.get(*o, k, &ret));
+        check_strictly_equals(ret, val);
+
+        // Replace the prototype.
+        as_object* proto2 = new as_object(getGlobal(vm));
+        proto2->set_member(k, val3);
+        o->set_prototype(proto2);
+        check(cache.get(*o, k, &ret));
+        check_strictly_equals(ret, val3);
+
+        // Another object with the same prototype.
+        as_object* o2 = new as_object(getGlobal(vm));
+        o2->set_prototype(proto2);
+        check(cache.get(*o2, k, &ret));
+        check_strictly_equals(ret, val3);
+
+        // Cached sets of own members.
+        cache.set(*o, k, val);
+        cache.set(*o, k, val2);
+        check(o->get_member(k, &ret));
+        check_strictly_equals(ret, val2);
+        check(proto2->get_member(k, &ret));
+        check_strictly_equals(ret, val3);
+
+        o->set_member_flags(k, PropFlags::readOnly, 0);
+        cache.set(*o, k, val3);
+        check(o->get_member(k, &ret));
+        check_strictly_equals(ret, val2);
+
+        check(!cache.get(*o, getURI(vm, "missing"), &ret));
+    }
+
+    // One entry serves all instances of a class.
+    {
+        MemberCache getX;
+        MemberCache getMethod;
+        MemberCache setX;
+        const ObjectURI& x = getURI(vm, "x");
+        const ObjectURI& method = getURI(vm, "method");
+
+        as_object* proto = new as_object(getGlobal(vm));
+        proto->set_member(method, val3);
+
+        std::vector<as_object*> objects;
+        for (size_t i = 0; i < 10; ++i) {
+            as_object* o = new as_object(getGlobal(vm));
+            o->set_prototype(proto);
+            o->set_member(x, double(i));
+            objects.push_back(o);
+        }
+
+        for (size_t i = 0; i < objects.size(); ++i) {
+            check(getX.get(*objects[i], x, &ret));
+            check_strictly_equals(ret, as_value(double(i)));
+            check(getMethod.get(*objects[i], method, &ret));
+            check_strictly_equals(ret, val3);
+            setX.set(*objects[i], x, double(i * 2));
+        }
+
+        for (size_t i = 0; i < objects.size(); ++i) {
+            check(objects[i]->get_member(x, &ret));
+            check_strictly_equals(ret, as_value(double(i * 2)));
+        }
+
+        // An instance that lost the member no longer matches.
+        objects[3]->delProperty(x);
+        check(!getX.get(*objects[3], x, &ret));
+        setX.set(*objects[3], x, val);
+        check(getX.get(*objects[3], x, &ret));
+        check_strictly_equals(ret, val);
+
+        // Shadowing the inherited member changes the instance's stamp.
+        objects[4]->set_member(method, val2);
+        check(getMethod.get(*objects[4], method, &ret));
+        check_strictly_equals(ret, val2);
+        check(getMethod.get(*objects[5], method, &ret));
+        check_strictly_equals(ret, val3);
+
+        // Changes to the prototype are seen by every instance.
+        proto->set_member(method, val);
+        check(getMethod.get(*objects[5], method, &ret));
+        check_strictly_equals(ret, val);
+        proto->delProperty(method);
+        check(!getMethod.get(*objects[6], method, &ret));
+    }
+
+    // The flat container, below and above the hashed size.
+    {
+        FlatPropertyContainer flat(getStringTable(*obj));
+        const size_t count = FlatPropertyContainer::maxLinear * 3;
+
+        for (size_t i = 0; i < count; ++i) {
+            std::ostringstream ss;
+            ss << "Flat" << i;
+            const ObjectURI uri = getURI(vm, ss.str());
+            check(flat.find(uri, false) == flat.end());
+            flat.push_back(Property(uri, as_value(double(i)), PropFlags()));
+        }
+        check_equals(flat.size(), count);
+
+        const Property* p = &*flat.find(getURI(vm, "Flat20"), false);
+        check_strictly_equals(p->getValue(*obj), as_value(20.0));
+        check(flat.find(getURI(vm, "flat20"), false) == flat.end());
+        check(&*flat.find(getURI(vm, "FLAT20"), true) == p);
+
+        // Order is creation order, and addresses survive growth.
+        check_strictly_equals(flat.begin()->getValue(*obj), as_value(0.0));
+        const Property* first = &*flat.begin();
+        flat.erase(flat.find(getURI(vm, "Flat0"), false));
+        check_equals(flat.size(), count - 1);
+        check(flat.find(getURI(vm, "Flat0"), true) == flat.end());
+        check(&*flat.find(getURI(vm, "Flat20"), false) == p);
+
+        // The oldest of two names differing only in case wins. The
+        // new Property goes in the slot of the removed one.
+        flat.push_back(Property(getURI(vm, "flat20"), val, PropFlags()));
+        check(&*flat.find(getURI(vm, "fLaT20"), true) == p);
+        check(&*flat.find(getURI(vm, "flat20"), false) == first);
+
+        flat.clear();
+        check(flat.empty());
+        check(flat.find(getURI(vm, "Flat20"), true) == flat.end());
+    }
+
+#ifdef HAVE_MALLINFO
+    // Heap bytes used by small objects, as typically created by AS2 code.
+    {
+        const size_t count = 10000;
+        std::vector<as_object*> objects;
+        objects.reserve(count);
+
+        const ObjectURI x = getURI(vm, "x");
+        const ObjectURI y = getURI(vm, "y");
+        const ObjectURI name = getURI(vm, "name");
+
+        const int before = mallinfo().uordblks;
+        for (size_t i = 0; i < count; ++i) {
+            as_object* o = new as_object(getGlobal(vm));
+            o->set_member(x, double(i));
+            o->set_member(y, double(i));
+            o->set_member(name, val);
+            objects.push_back(o);
+        }
+        const int after = mallinfo().uordblks;
+
+        note("Object with 3 members: %d bytes",
+                static_cast<int>((after - before) / count));
+    }
+#endif
+}
@@ -0,0 +1,139 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "ShapeRecord.h"
+#include "Geometry.h"
+#include "GnashNumeric.h"
+#include "SWFRect.h"
+#include "check.h"
+
+#include <cstdlib>
+#include <iostream>
+
+using namespace gnash;
+using SWF::ShapeRecord;
+
+namespace {
+
+/// Make a shape with paths of the given numbers of edges.
+ShapeRecord
+makeShape(const size_t* sizes, size_t paths)
+{
+    ShapeRecord s;
+    s.setBounds(SWFRect(-20000, -20000, 20000, 20000));
+    for (size_t i = 0; i < paths; ++i) {
+        Path p(std::rand() % 2000 - 1000, std::rand() % 2000 - 1000,
+                i, i + 1, 0, false);
+        for (size_t j = 0; j < sizes[i]; ++j) {
+            p.drawCurveTo(std::rand() % 20000 - 10000,
+                    std::rand() % 20000 - 10000,
+                    std::rand() % 20000 - 10000,
+                    std::rand() % 20000 - 10000);
+        }
+        s.addPath(p);
+    }
+    return s;
+}
+
+/// Whether r has the edges of a and b lerped one at a time.
+bool
+sameEdges(const ShapeRecord& a, const ShapeRecord& b, const ShapeRecord& r,
+        double ratio)
+{
+    const Path empty_path;
+    const Edge empty_edge;
+
+    const ShapeRecord::Paths& paths1 = a.paths();
+    const ShapeRecord::Paths& paths2 = b.paths();
+    for (size_t i = 0, k = 0, n = 0; i < r.paths().size(); ++i) {
+        const Path& p = r.paths()[i];
+        const Path& p1 = i < paths1.size() ? paths1[i] : empty_path;
+        const Path& p2 = n < paths2.size() ? paths2[n] : empty_path;
+
+        if (p.size() != p1.size()) return false;
+
+        for (size_t j = 0; j < p.size(); ++j) {
+            const Edge& e = p[j];
+            const Edge& e1 = p1[j];
+            const Edge& e2 = k < p2.size() ? p2[k] : empty_edge;
+
+            if (e.cp.x != static_cast<int>(lerp<float>(e1.cp.x, e2.cp.x, ratio)) ||
+                e.cp.y != static_cast<int>(lerp<float>(e1.cp.y, e2.cp.y, ratio)) ||
+                e.ap.x != static_cast<int>(lerp<float>(e1.ap.x, e2.ap.x, ratio)) ||
+                e.ap.y != static_cast<int>(lerp<float>(e1.ap.y, e2.ap.y, ratio))) {
+                return false;
+            }
+            ++k;
+            if (p2.size() <= k) {
+                k = 0;
+                ++n;
+            }
+        }
+    }
+    return true;
+}
+
+}
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    std::srand(3);
+
+    // Same layout in both shapes.
+    const size_t same[] = { 7, 1, 33 };
+    const ShapeRecord a1 = makeShape(same, 3);
+    const ShapeRecord b1 = makeShape(same, 3);
+
+    ShapeRecord r(a1);
+    const double ratios[] = { 0, 0.25, 1 / 3.0, 0.5, 0.999, 1 };
+    for (size_t i = 0; i < 6; ++i) {
+        r.setLerp(a1, b1, ratios[i]);
+        check(sameEdges(a1, b1, r, ratios[i]));
+    }
+    check_equals(r.paths()[2][32].ap.x, b1.paths()[2][32].ap.x);
+
+    // Different paths, so that edges of the second shape wrap round and
+    // some are missing.
+    const size_t sizes1[] = { 5, 0, 13, 2, 9 };
+    const size_t sizes2[] = { 3, 6, 0 };
+    const ShapeRecord a2 = makeShape(sizes1, 5);
+    const ShapeRecord b2 = makeShape(sizes2, 3);
+
+    ShapeRecord r2(a2);
+    for (size_t i = 0; i < 6; ++i) {
+        r2.setLerp(a2, b2, ratios[i]);
+        check(sameEdges(a2, b2, r2, ratios[i]));
+    }
+
+    // The other way round.
+    ShapeRecord r3(b2);
+    for (size_t i = 0; i < 6; ++i) {
+        r3.setLerp(b2, a2, ratios[i]);
+        check(sameEdges(b2, a2, r3, ratios[i]));
+    }
+
+    // Lerping in place gives a new stamp, so renderers see the change.
+    const boost::uint64_t stamp = r.stamp();
+    r.setLerp(a1, b1, 0.5);
+    check(r.stamp() != stamp);
+}
@@ -0,0 +1,228 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// Parses every shape in a set of SWFs and reports the speed, both from
+// memory and from a plain file.
+//
+// Usage: ShapeParseBench [file.swf ...]
+//
+// Without arguments the SWFs in the testsuite are used.
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "SWFStream.h"
+#include "SWF.h"
+#include "ShapeRecord.h"
+#include "TypesParser.h"
+#include "IOChannel.h"
+#include "tu_file.h"
+#include "zlib_adapter.h"
+#include "mmap_adapter.h"
+#include "GnashException.h"
+#include "WallClockTimer.h"
+#include "RunResources.h"
+#include "DummyMovieDefinition.h"
+#include "log.h"
+#include "check.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <dirent.h>
+#include <boost/intrusive_ptr.hpp>
+
+#ifndef SRCDIR
+# define SRCDIR "."
+#endif
+
+using namespace gnash;
+
+namespace {
+
+/// What was parsed.
+struct Shapes
+{
+    Shapes() : count(0), edges(0), bytes(0) {}
+
+    bool operator==(const Shapes& o) const {
+        return count == o.count && edges == o.edges && bytes == o.bytes;
+    }
+
+    size_t count;
+    size_t edges;
+    size_t bytes;
+};
+
+/// Write an uncompressed copy of an SWF to a temporary file.
+FILE*
+uncompressed(const std::string& path)
+{
+    std::auto_ptr<IOChannel> in = makeFileChannel(path.c_str(), "rb");
+    if (!in.get()) return 0;
+
+    char header[8];
+    if (in->read(header, 8) != 8) return 0;
+    if (header[0] == 'C') in = zlib_adapter::make_inflater(in);
+    else if (header[0] != 'F') return 0;
+
+    FILE* f = std::tmpfile();
+    header[0] = 'F';
+    std::fwrite(header, 1, 8, f);
+
+    char buf[65536];
+    std::streamsize got;
+    while ((got = in->read(buf, sizeof buf)) > 0) {
+        std::fwrite(buf, 1, got, f);
+    }
+    std::fflush(f);
+    return f;
+}
+
+/// Parse the shapes of an uncompressed SWF.
+void
+parseShapes(IOChannel& channel, movie_definition& md, const RunResources& r,
+        Shapes& shapes)
+{
+    SWFStream in(&channel);
+    in.seek(8);
+    readRect(in);
+    in.ensureBytes(4);
+    in.read_u16();
+    in.read_u16();
+
+    for (;;) {
+        const SWF::TagType tag = in.open_tag();
+        if (tag == SWF::END) break;
+
+        if (tag == SWF::DEFINESHAPE || tag == SWF::DEFINESHAPE2 ||
+                tag == SWF::DEFINESHAPE3 || tag == SWF::DEFINESHAPE4 ||
+                tag == SWF::DEFINESHAPE4_) {
+
+            const unsigned long start = in.tell();
+            in.ensureBytes(2);
+            in.read_u16();
+            const SWF::ShapeRecord shape(in, tag, md, r);
+
+            ++shapes.count;
+            shapes.bytes += in.get_tag_end_position() - start;
+            const SWF::ShapeRecord::Paths& paths = shape.paths();
+            for (size_t i = 0; i < paths.size(); ++i) {
+                shapes.edges += paths[i].size();
+            }
+        }
+        in.close_tag();
+    }
+}
+
+/// Parse the shapes repeatedly and return the time taken in ms.
+boost::uint32_t
+timeShapes(IOChannel& channel, movie_definition& md, const RunResources& r,
+        size_t runs, Shapes& shapes)
+{
+    WallClockTimer timer;
+    for (size_t i = 0; i < runs; ++i) {
+        shapes = Shapes();
+        parseShapes(channel, md, r, shapes);
+    }
+    return timer.elapsed();
+}
+
+void
+addCorpus(const std::string& dir, std::vector<std::string>& files)
+{
+    DIR* d = opendir(dir.c_str());
+    if (!d) return;
+    while (const struct dirent* e = readdir(d)) {
+        const std::string name(e->d_name);
+        if (name.size() > 4 && name.substr(name.size() - 4) == ".swf") {
+            files.push_back(dir + "/" + name);
+        }
+    }
+    closedir(d);
+}
+
+double
+rate(size_t bytes, boost::uint32_t ms)
+{
+    return ms ? bytes / 1048.576 / ms : 0;
+}
+
+}
+
+int
+main(int argc, char** argv)
+{
+    std::vector<std::string> files(argv + 1, argv + argc);
+    if (files.empty()) {
+        addCorpus(SRCDIR "/samples", files);
+        addCorpus(SRCDIR "/movies.all", files);
+        addCorpus(SRCDIR "/media", files);
+    }
+
+    RunResources r;
+    boost::intrusive_ptr<movie_definition> md(new DummyMovieDefinition(r, 10));
+
+    const size_t runs = 20;
+    size_t totalBytes = 0;
+    boost::uint32_t mappedTime = 0;
+    boost::uint32_t fileTime = 0;
+
+    for (size_t i = 0; i < files.size(); ++i) {
+
+        FILE* f = uncompressed(files[i]);
+        if (!f) {
+            note("%s: not an SWF", files[i].c_str());
+            continue;
+        }
+
+        std::auto_ptr<IOChannel> mapped = mmap_adapter::make_stream(fileno(f));
+        std::auto_ptr<IOChannel> file = makeFileChannel(f, true);
+
+        Shapes fromMemory;
+        Shapes fromFile;
+        try {
+            if (mapped.get()) {
+                mappedTime += timeShapes(*mapped, *md, r, runs, fromMemory);
+            }
+            fileTime += timeShapes(*file, *md, r, runs, fromFile);
+        }
+        catch (const GnashException& e) {
+            fail("%s: %s", files[i].c_str(), e.what());
+            continue;
+        }
+
+        if (!mapped.get()) fromMemory = fromFile;
+        check(fromMemory == fromFile);
+        totalBytes += fromFile.bytes * runs;
+
+        std::cout << files[i] << ": " << fromFile.count << " shapes, "
+            << fromFile.edges << " edges, " << fromFile.bytes << " bytes"
+            << std::endl;
+    }
+
+    note("%lu bytes of shapes: %.1f MB/s from memory, %.1f MB/s from file",
+            static_cast<unsigned long>(totalBytes),
+            rate(totalBytes, mappedTime), rate(totalBytes, fileTime));
+
+    return 0;
+}
+
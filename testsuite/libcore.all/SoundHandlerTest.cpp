@@ -0,0 +1,230 @@
+//
+//   Copyright (C) 2012 Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// Checks that streams reach the mixer and leave it through its queues,
+// with the mixer running in a thread of its own as the audio thread does.
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "NullSoundHandler.h"
+#include "StreamingSoundData.h"
+#include "SimpleBuffer.h"
+#include "SoundInfo.h"
+#include "check.h"
+
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/thread/thread.hpp>
+
+using namespace gnash;
+using namespace gnash::sound;
+
+namespace {
+
+class TestSoundHandler : public NullSoundHandler
+{
+public:
+    TestSoundHandler() : NullSoundHandler(0) {}
+    using sound_handler::hasInputStreams;
+};
+
+/// An aux streamer, which must not be called once unplugged.
+struct Source
+{
+    Source() : calls(0), callsAfterUnplug(0), unplugged(false), end(0) {}
+
+    boost::atomic<size_t> calls;
+    boost::atomic<size_t> callsAfterUnplug;
+    boost::atomic<bool> unplugged;
+
+    /// End after this many calls, if not 0.
+    size_t end;
+};
+
+unsigned int
+fill(void* udata, boost::int16_t* samples, unsigned int nSamples, bool& eof)
+{
+    Source* s = static_cast<Source*>(udata);
+    if (s->unplugged.load()) ++s->callsAfterUnplug;
+    const size_t calls = ++s->calls;
+    std::fill(samples, samples + nSamples, 1000);
+    eof = s->end && calls >= s->end;
+    return nSamples;
+}
+
+/// Call the mixer until told to stop, as an audio thread would.
+void
+mixer(sound_handler* sh, boost::atomic<bool>* stop,
+        boost::atomic<size_t>* buffers)
+{
+    std::vector<boost::int16_t> out(1024);
+    while (!stop->load()) {
+        sh->fetchSamples(&out.front(), out.size());
+        ++*buffers;
+    }
+}
+
+/// Read the newest block while another thread appends.
+void
+reader(StreamingSoundData* data, boost::atomic<bool>* stop,
+        boost::atomic<size_t>* bad)
+{
+    while (!stop->load()) {
+        const size_t n = data->blockCount();
+        if (!n) continue;
+        const size_t last = n - 1;
+        if (data->getBlock(last).size() != last % 100 + 1 ||
+                data->getSampleCount(last) != last) {
+            ++*bad;
+        }
+    }
+}
+
+}
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    // Streams are played from the mixer's next buffer on.
+    {
+        TestSoundHandler sh;
+        Source s;
+        check(!sh.hasInputStreams());
+
+        InputStream* is = sh.attach_aux_streamer(fill, &s);
+        check(sh.hasInputStreams());
+        check_equals(sh.numSoundsStarted(), 1u);
+
+        boost::int16_t out[64];
+        sh.fetchSamples(out, 64);
+        check_equals(s.calls.load(), 1u);
+        check_equals(out[0], 1000);
+        check_equals(out[63], 1000);
+
+        sh.mute();
+        check(sh.is_muted());
+        sh.fetchSamples(out, 64);
+        check_equals(out[0], 0);
+        sh.unmute();
+
+        sh.unplugInputStream(is);
+        check(!sh.hasInputStreams());
+        check_equals(sh.numSoundsStopped(), 1u);
+        sh.fetchSamples(out, 64);
+        check_equals(s.calls.load(), 2u);
+        check_equals(out[0], 0);
+    }
+
+    // Streams at their end are dropped by the mixer and deleted later.
+    {
+        TestSoundHandler sh;
+        Source s;
+        s.end = 2;
+        InputStream* is = sh.attach_aux_streamer(fill, &s);
+
+        boost::int16_t out[64];
+        sh.fetchSamples(out, 64);
+        check(sh.hasInputStreams());
+        sh.fetchSamples(out, 64);
+        check(!sh.hasInputStreams());
+        check_equals(sh.numSoundsStopped(), 1u);
+        sh.fetchSamples(out, 64);
+        check_equals(s.calls.load(), 2u);
+
+        // It was deleted already.
+        sh.unplugInputStream(is);
+        check_equals(sh.numSoundsStopped(), 1u);
+    }
+
+    // With the mixer in another thread, an unplugged stream is never
+    // called again, and streams ending meanwhile are still deleted once.
+    {
+        TestSoundHandler sh;
+        boost::atomic<bool> stop(false);
+        boost::atomic<size_t> buffers(0);
+        boost::thread t(boost::bind(mixer, &sh, &stop, &buffers));
+
+        const size_t count = 2000;
+        boost::scoped_array<Source> sources(new Source[count]);
+
+        // Those unplugged, and those ending that are not.
+        size_t stopped = 0;
+
+        for (size_t i = 0; i < count; ++i) {
+            Source& s = sources[i];
+            s.end = i % 3;
+            InputStream* is = sh.attach_aux_streamer(fill, &s);
+            if (i % 2) {
+                sh.unplugInputStream(is);
+                s.unplugged.store(true);
+            }
+            if (i % 2 || s.end) ++stopped;
+        }
+
+        // Let the mixer end the streams that end.
+        for (size_t i = 0; i < 1000 && sh.numSoundsStopped() < stopped; ++i) {
+            boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+        }
+
+        stop.store(true);
+        t.join();
+
+        size_t after = 0;
+        for (size_t i = 0; i < count; ++i) {
+            after += sources[i].callsAfterUnplug.load();
+        }
+        check_equals(after, 0u);
+        check_equals(sh.numSoundsStarted(), count);
+        check_equals(sh.numSoundsStopped(), stopped);
+        check(buffers.load() > 0);
+    }
+
+    // Blocks can be read while being appended.
+    {
+        media::SoundInfo sinfo(media::AUDIO_CODEC_RAW, false, 44100, 0, false);
+        StreamingSoundData data(sinfo, 100);
+        check(data.empty());
+
+        boost::atomic<bool> stop(false);
+        boost::atomic<size_t> bad(0);
+        boost::thread t(boost::bind(reader, &data, &stop, &bad));
+
+        const size_t count = 100000;
+        size_t misplaced = 0;
+        for (size_t i = 0; i < count; ++i) {
+            std::auto_ptr<SimpleBuffer> buf(new SimpleBuffer(i % 100 + 1));
+            buf->resize(i % 100 + 1);
+            if (data.append(buf, i, 0) != i) ++misplaced;
+        }
+
+        stop.store(true);
+        t.join();
+
+        check_equals(misplaced, 0u);
+        check_equals(bad.load(), 0u);
+        check_equals(data.blockCount(), count);
+        check_equals(data.getBlock(count - 1).size(), 100u);
+    }
+
+    return 0;
+}
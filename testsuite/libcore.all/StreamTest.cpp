@@ -32,6 +32,8 @@
 
 #include "IOChannel.h"
 #include "SWFStream.h"
+#include "tu_file.h"
+#include "mmap_adapter.h"
 #include "log.h"
 
 #include <cstdio>
@@ -44,6 +46,7 @@
 #include <fcntl.h>
 #include <string.h>
 #include <sstream>
+#include <vector>
 
 
 using namespace std;
@@ -53,6 +56,53 @@ using namespace gnash;
 
 TestState runtest;
 
+/// Reads bits one at a time.
+class BitReference
+{
+public:
+	BitReference(const std::vector<boost::uint8_t>& bytes, size_t pos = 0)
+		:
+		_bytes(&bytes),
+		_bit(pos * 8)
+	{}
+
+	unsigned read_uint(unsigned bits)
+	{
+		unsigned value = 0;
+		for (unsigned i = 0; i < bits; ++i, ++_bit) {
+			const bool set = (*_bytes)[_bit / 8] & (0x80 >> (_bit % 8));
+			value = (value << 1) | set;
+		}
+		return value;
+	}
+
+	int read_sint(unsigned bits)
+	{
+		const unsigned value = read_uint(bits);
+		if (value & (1u << (bits - 1))) return value | (~0u << bits);
+		return value;
+	}
+
+	/// Read little-endian bytes.
+	unsigned read_bytes(unsigned count)
+	{
+		align();
+		unsigned value = 0;
+		for (unsigned i = 0; i < count; ++i) {
+			value |= read_uint(8) << (8 * i);
+		}
+		return value;
+	}
+
+	void align() { _bit = (_bit + 7) / 8 * 8; }
+
+	unsigned long tell() const { return (_bit + 7) / 8; }
+
+private:
+	const std::vector<boost::uint8_t>* _bytes;
+	size_t _bit;
+};
+
 struct ByteReader : public IOChannel
 {
 	unsigned char b;
@@ -128,6 +178,7 @@ main(int /*argc*/, char** /*argv*/)
 //	);
 
 	int ret;
+	boost::uint32_t u32;
 
 	{
 	/// bits: 10101010 (0xAA)
@@ -392,7 +443,7 @@ main(int /*argc*/, char** /*argv*/)
 	check_equals(s.tell(), 32);
 	boost::int32_t s32 = s.read_s32(); check_equals(s32, (boost::int32_t)0x99999999);
 	check_equals(s.tell(), 36);
-	boost::uint32_t u32 = s.read_u32(); check_equals(u32, (boost::uint32_t)0x99999999);
+	u32 = s.read_u32(); check_equals(u32, (boost::uint32_t)0x99999999);
 	check_equals(s.tell(), 40);
 
 	/// bits: 10011001 10011001 10011001 10011001 (0x99999999)
@@ -481,6 +532,167 @@ main(int /*argc*/, char** /*argv*/)
 
 	}
 
+	{
+	// Bits are loaded a word at a time, from memory or from any other
+	// input. Both must read the same as going through the bytes one bit
+	// at a time.
+	FILE* f = std::tmpfile();
+	std::vector<boost::uint8_t> bytes(16384);
+	boost::uint32_t seed = 1;
+	for (size_t i = 0; i < bytes.size(); ++i) {
+		seed = seed * 1103515245 + 12345;
+		bytes[i] = seed >> 16;
+		std::fputc(bytes[i], f);
+	}
+	std::fflush(f);
+
+	std::auto_ptr<IOChannel> mapped = mmap_adapter::make_stream(fileno(f));
+	check(mapped.get());
+	if (mapped.get()) {
+		check(mapped->data());
+
+		std::rewind(f);
+		std::auto_ptr<IOChannel> file = makeFileChannel(f, false);
+
+		SWFStream m(mapped.get());
+		SWFStream s(file.get());
+		BitReference r(bytes);
+
+		int mismatches = 0;
+		for (int i = 0; i < 3000; ++i) {
+			seed = seed * 1103515245 + 12345;
+			const unsigned op = (seed >> 16) % 10;
+			const unsigned bits = (seed >> 20) % 33;
+			switch (op) {
+				case 0:
+				{
+					const int expected = r.read_sint(bits % 31 + 1);
+					mismatches += m.read_sint(bits % 31 + 1) != expected;
+					mismatches += s.read_sint(bits % 31 + 1) != expected;
+					break;
+				}
+				case 1:
+				{
+					const bool expected = r.read_uint(1);
+					mismatches += m.read_bit() != expected;
+					mismatches += s.read_bit() != expected;
+					break;
+				}
+				case 2:
+					m.align();
+					s.align();
+					r.align();
+					break;
+				case 3:
+				{
+					const unsigned expected = r.read_bytes(1);
+					mismatches += m.read_u8() != expected;
+					mismatches += s.read_u8() != expected;
+					break;
+				}
+				case 4:
+				{
+					const unsigned expected = r.read_bytes(4);
+					mismatches += m.read_u32() != expected;
+					mismatches += s.read_u32() != expected;
+					break;
+				}
+				case 5:
+				{
+					char mb[3], sb[3];
+					m.read(mb, 3);
+					s.read(sb, 3);
+					r.align();
+					mismatches += std::memcmp(mb, &bytes[r.tell()], 3) != 0;
+					mismatches += std::memcmp(sb, &bytes[r.tell()], 3) != 0;
+					r.read_bytes(3);
+					break;
+				}
+				default:
+				{
+					const unsigned expected = r.read_uint(bits);
+					mismatches += m.read_uint(bits) != expected;
+					mismatches += s.read_uint(bits) != expected;
+					break;
+				}
+			}
+			mismatches += m.tell() != r.tell();
+			mismatches += s.tell() != r.tell();
+		}
+		check_equals(mismatches, 0);
+
+		m.seek(16378);
+		s.seek(16378);
+		r = BitReference(bytes, 16378);
+		u32 = m.read_uint(32);
+		boost::uint32_t expected = s.read_uint(32);
+		check_equals(u32, expected);
+		expected = r.read_uint(32);
+		check_equals(u32, expected);
+		u32 = m.read_uint(15);
+		expected = s.read_uint(15);
+		check_equals(u32, expected);
+		expected = r.read_uint(15);
+		check_equals(u32, expected);
+		check_equals(m.tell(), 16384);
+		check_equals(s.tell(), 16384);
+
+		bool threw = false;
+		try {
+			m.read_uint(2);
+		}
+		catch (const ParserException&) {
+			threw = true;
+		}
+		check(threw);
+	}
+
+	std::fclose(f);
+	}
+
+	{
+	// Inputs that can't go back are not read past the end of a tag,
+	// which may not have arrived yet.
+	FILE* f = std::tmpfile();
+	const unsigned char tags[] = {
+		10 | (2 << 6), 0,	// tag 2, 10 bytes long
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0 | (1 << 6), 0		// tag 1, empty
+	};
+	std::fwrite(tags, 1, sizeof tags, f);
+	std::rewind(f);
+	std::auto_ptr<IOChannel> file = makeFileChannel(f, true);
+	SWFStream s(file.get());
+
+	check_equals(s.open_tag(), 2);
+	s.ensureBits(80);
+	u32 = s.read_uint(3);
+	check_equals(u32, 7u);
+	check(file->tell() <= 12);
+	u32 = s.read_uint(32);
+	check_equals(u32, 0xffffffffu);
+	u32 = s.read_uint(32);
+	check_equals(u32, 0xffffffffu);
+	check_equals(file->tell(), 12);
+
+	bool threw = false;
+	try {
+		s.ensureBits(14);
+	}
+	catch (const ParserException&) {
+		threw = true;
+	}
+	check(threw);
+	s.ensureBits(13);
+
+	u32 = s.read_u8();
+	check_equals(u32, 0xffu);
+	check_equals(s.tell(), 12);
+	s.close_tag();
+	check_equals(s.open_tag(), 1);
+	s.close_tag();
+	}
+
 	return 0;
 }
 
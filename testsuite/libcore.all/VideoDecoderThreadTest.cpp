@@ -0,0 +1,246 @@
+//
+//   Copyright (C) 2012 Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// Checks the order VideoDecoderThread hands decoded frames back in, that
+// late frames are dropped and that flush() drops the frames pending.
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "NetStream_as.h"
+#include "VideoDecoder.h"
+#include "MediaParser.h"
+#include "GnashImage.h"
+#include "check.h"
+
+#include <memory>
+#include <vector>
+#include <iostream>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+using namespace gnash;
+
+namespace {
+
+/// Decodes a frame to a 1x1 image whose red value is the frame number.
+//
+/// The video is as wide as the number of frames decoded. Decoding can be
+/// held up at a frame until it is released.
+class StubDecoder : public media::VideoDecoder
+{
+public:
+
+    StubDecoder() : _holdAt(-1), _held(false) {}
+
+    void push(const media::EncodedVideoFrame& frame) {
+        boost::mutex::scoped_lock lock(_mutex);
+        _decoded.push_back(frame.frameNum());
+        _pending.reset(new unsigned int(frame.frameNum()));
+        if (static_cast<int>(frame.frameNum()) == _holdAt) {
+            _held = true;
+            _changed.notify_all();
+            while (_holdAt >= 0) _changed.wait(lock);
+        }
+    }
+
+    std::auto_ptr<image::GnashImage> pop() {
+        boost::mutex::scoped_lock lock(_mutex);
+        std::auto_ptr<image::GnashImage> im(new image::ImageRGB(1, 1));
+        *im->begin() = *_pending;
+        _pending.reset();
+        return im;
+    }
+
+    bool peek() {
+        boost::mutex::scoped_lock lock(_mutex);
+        return _pending.get();
+    }
+
+    int width() const {
+        boost::mutex::scoped_lock lock(_mutex);
+        return _decoded.size();
+    }
+
+    int height() const { return 1; }
+
+    /// Hold up decoding when frame n is pushed.
+    void holdAt(int n) {
+        boost::mutex::scoped_lock lock(_mutex);
+        _holdAt = n;
+    }
+
+    /// Wait for decoding to be held up.
+    void waitHeld() {
+        boost::mutex::scoped_lock lock(_mutex);
+        while (!_held) _changed.wait(lock);
+    }
+
+    void release() {
+        boost::mutex::scoped_lock lock(_mutex);
+        _holdAt = -1;
+        _changed.notify_all();
+    }
+
+    /// The frame numbers decoded, in order.
+    std::vector<unsigned int> decoded() const {
+        boost::mutex::scoped_lock lock(_mutex);
+        return _decoded;
+    }
+
+private:
+    mutable boost::mutex _mutex;
+    boost::condition_variable _changed;
+    std::vector<unsigned int> _decoded;
+    std::auto_ptr<unsigned int> _pending;
+    int _holdAt;
+    bool _held;
+};
+
+std::auto_ptr<media::EncodedVideoFrame>
+frame(unsigned int num, boost::uint64_t ts)
+{
+    return std::auto_ptr<media::EncodedVideoFrame>(
+            new media::EncodedVideoFrame(new boost::uint8_t[1], 1, num, ts));
+}
+
+/// The frame number of a decoded image, or -1 for none.
+int
+number(const std::auto_ptr<image::GnashImage>& im)
+{
+    return im.get() ? *im->begin() : -1;
+}
+
+}
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    // Frames come out in order, when due.
+    {
+        StubDecoder dec;
+        VideoDecoderThread t(dec);
+        check_equals(t.width(), 0);
+
+        check(t.push(frame(0, 0)));
+        check(t.push(frame(1, 40)));
+        check(t.push(frame(2, 80)));
+        check_equals(t.pending(), 3u);
+
+        check_equals(number(t.pop(0, true)), 0);
+        check_equals(number(t.pop(40, true)), 1);
+        check_equals(number(t.pop(79, true)), -1);
+        check_equals(t.pending(), 1u);
+        check_equals(number(t.pop(80, true)), 2);
+        check_equals(t.pending(), 0u);
+
+        check_equals(t.width(), 3);
+        check_equals(t.height(), 1);
+    }
+
+    // Only so many frames are decoded ahead.
+    {
+        StubDecoder dec;
+        VideoDecoderThread t(dec);
+
+        size_t pushed = 0;
+        while (t.push(frame(pushed, pushed * 40))) ++pushed;
+        check(pushed > 1);
+        check(t.full());
+        check_equals(t.pending(), pushed);
+
+        // Dropped frames are deleted.
+        check(!t.push(frame(pushed, pushed * 40)));
+
+        check_equals(number(t.pop(0, true)), 0);
+        check(!t.full());
+    }
+
+    // Late frames are dropped, keeping the newest one due.
+    {
+        StubDecoder dec;
+        VideoDecoderThread t(dec);
+
+        check(t.push(frame(0, 0)));
+        check(t.push(frame(1, 40)));
+        check(t.push(frame(2, 80)));
+        check(t.push(frame(3, 120)));
+
+        check_equals(number(t.pop(100, true)), 2);
+        check_equals(t.pending(), 1u);
+        check_equals(number(t.pop(120, true)), 3);
+
+        // All of them were decoded, as they were pushed before.
+        check_equals(dec.decoded().size(), 4u);
+    }
+
+    // Without waiting, frames still being decoded are left for later.
+    {
+        StubDecoder dec;
+        dec.holdAt(0);
+        VideoDecoderThread t(dec);
+
+        check(t.push(frame(0, 0)));
+        dec.waitHeld();
+        check_equals(number(t.pop(0, false)), -1);
+        check_equals(t.pending(), 1u);
+
+        dec.release();
+        check_equals(number(t.pop(0, true)), 0);
+    }
+
+    // After a seek, the frames pending are dropped whatever their
+    // timestamp, and those not yet decoded are not decoded at all.
+    {
+        StubDecoder dec;
+        dec.holdAt(0);
+        VideoDecoderThread t(dec);
+
+        check(t.push(frame(0, 0)));
+        check(t.push(frame(1, 40)));
+        check(t.push(frame(2, 80)));
+        dec.waitHeld();
+
+        t.flush();
+        dec.release();
+
+        check(t.push(frame(10, 1000)));
+        check_equals(number(t.pop(1000, true)), 10);
+        check_equals(t.pending(), 0u);
+
+        const std::vector<unsigned int> decoded = dec.decoded();
+        check_equals(decoded.size(), 2u);
+        check_equals(decoded.front(), 0u);
+        check_equals(decoded.back(), 10u);
+    }
+
+    // A seek back plays frames earlier than those dropped.
+    {
+        StubDecoder dec;
+        VideoDecoderThread t(dec);
+
+        check(t.push(frame(5, 200)));
+        check(t.push(frame(6, 240)));
+        t.flush();
+        check(t.push(frame(0, 0)));
+        check_equals(number(t.pop(0, true)), 0);
+        check_equals(t.pending(), 0u);
+    }
+
+    return 0;
+}
@@ -0,0 +1,288 @@
+//
+//   Copyright (C) 2012 Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// Checks the ImageYUV plane layout for odd sizes, and the colors
+// YUVSpanGenerator draws against a floating point BT.601 conversion.
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "Renderer_agg_yuv.h"
+#include "GnashImage.h"
+#include "SWFCxForm.h"
+#include "check.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+using namespace gnash;
+
+namespace {
+
+/// Maps span pixels to frame pixels scaled by a factor, in the subpixel
+/// coordinates agg::span_interpolator_linear gives.
+class ScaleInterpolator
+{
+public:
+    explicit ScaleInterpolator(double scale) : _scale(scale) {}
+
+    void begin(double x, double y, unsigned /*len*/) {
+        _x = x;
+        _y = y;
+    }
+
+    void operator++() { _x += 1; }
+
+    void coordinates(int* x, int* y) const {
+        *x = static_cast<int>(std::floor(_x * _scale *
+                    agg::image_subpixel_scale + 0.5));
+        *y = static_cast<int>(std::floor(_y * _scale *
+                    agg::image_subpixel_scale + 0.5));
+    }
+
+private:
+    const double _scale;
+    double _x;
+    double _y;
+};
+
+int
+clip(double d)
+{
+    return std::max(0, std::min(255, static_cast<int>(std::floor(d + 0.5))));
+}
+
+/// Limited range BT.601, in floating point.
+void
+reference(double y, double u, double v, int& r, int& g, int& b)
+{
+    const double c = 1.164 * (y - 16);
+    r = clip(c + 1.596 * (v - 128));
+    g = clip(c - 0.392 * (u - 128) - 0.813 * (v - 128));
+    b = clip(c + 2.017 * (u - 128));
+}
+
+/// Whether a drawn color is within 2 of the expected one.
+bool
+close(const agg::rgba8& p, int r, int g, int b, int a)
+{
+    return std::abs(p.r - r) <= 2 && std::abs(p.g - g) <= 2 &&
+        std::abs(p.b - b) <= 2 && std::abs(p.a - a) <= 2;
+}
+
+std::string
+describe(const agg::rgba8& p)
+{
+    std::ostringstream ss;
+    ss << int(p.r) << "," << int(p.g) << "," << int(p.b) << "," << int(p.a);
+    return ss.str();
+}
+
+/// Fill a frame with values that differ from pixel to pixel.
+void
+fillFrame(image::ImageYUV& im)
+{
+    for (size_t p = 0; p < 3; ++p) {
+        const size_t w = p ? im.chromaWidth() : im.width();
+        const size_t h = p ? im.chromaHeight() : im.height();
+        for (size_t y = 0; y < h; ++y) {
+            for (size_t x = 0; x < w; ++x) {
+                im.plane(p)[y * im.planeStride(p) + x] =
+                    16 + (37 * x + 53 * y + 71 * p) % 220;
+            }
+        }
+    }
+}
+
+/// Draw a frame with nearest sampling at its own size, checking each
+/// pixel against the reference, transformed by cx.
+size_t
+mismatches(const image::ImageYUV& im, const SWFCxForm& cx)
+{
+    ScaleInterpolator interpolator(1);
+    YUVSpanGenerator<ScaleInterpolator> gen(im, interpolator, cx, false);
+
+    std::vector<agg::rgba8> span(im.width());
+    size_t bad = 0;
+
+    for (size_t y = 0; y < im.height(); ++y) {
+        gen.generate(&span.front(), 0, y, span.size());
+
+        for (size_t x = 0; x < im.width(); ++x) {
+            const size_t c = (y / 2) * im.planeStride(1) + x / 2;
+            int r, g, b;
+            reference(im.plane(0)[y * im.planeStride(0) + x],
+                    im.plane(1)[c], im.plane(2)[c], r, g, b);
+
+            boost::uint8_t r8 = r, g8 = g, b8 = b, a8 = 255;
+            cx.transform(r8, g8, b8, a8);
+            const int a = a8;
+            r = r8 * a / 255.0 + 0.5;
+            g = g8 * a / 255.0 + 0.5;
+            b = b8 * a / 255.0 + 0.5;
+
+            if (!close(span[x], r, g, b, a)) {
+                if (!bad) {
+                    std::cerr << "pixel " << x << "," << y << " is "
+                        << describe(span[x]) << ", expected " << r << ","
+                        << g << "," << b << "," << a << std::endl;
+                }
+                ++bad;
+            }
+        }
+    }
+    return bad;
+}
+
+}
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    // Chroma planes cover odd edges with a sample of their own, and
+    // the planes neither overlap nor leave gaps.
+    const size_t sizes[][2] = {
+        { 1, 1 }, { 2, 2 }, { 3, 5 }, { 5, 3 }, { 7, 7 }, { 321, 241 }
+    };
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); ++i) {
+        const size_t w = sizes[i][0];
+        const size_t h = sizes[i][1];
+        const size_t cw = (w + 1) / 2;
+        const size_t ch = (h + 1) / 2;
+
+        image::ImageYUV im(w, h);
+        check_equals(im.chromaWidth(), cw);
+        check_equals(im.chromaHeight(), ch);
+        check_equals(im.planeStride(0), w);
+        check_equals(im.planeStride(1), cw);
+        check_equals(im.planeStride(2), cw);
+        check_equals(im.plane(0) - im.begin(), 0);
+        check_equals(im.plane(1) - im.begin(), static_cast<int>(w * h));
+        check_equals(im.plane(2) - im.plane(1), static_cast<int>(cw * ch));
+        check_equals(im.size(), w * h + 2 * cw * ch);
+        check_equals(im.end() - im.plane(2), static_cast<int>(cw * ch));
+
+        // Writing each plane in full leaves the others alone.
+        std::fill(im.plane(0), im.plane(0) + w * h, 1);
+        std::fill(im.plane(1), im.plane(1) + cw * ch, 2);
+        std::fill(im.plane(2), im.plane(2) + cw * ch, 3);
+        check_equals(std::count(im.begin(), im.end(), 1),
+                static_cast<int>(w * h));
+        check_equals(std::count(im.begin(), im.end(), 2),
+                static_cast<int>(cw * ch));
+        check_equals(std::count(im.begin(), im.end(), 3),
+                static_cast<int>(cw * ch));
+    }
+
+    // Nearest sampling converts each pixel like the reference, including
+    // the last row and column of odd sized frames.
+    {
+        image::ImageYUV im(7, 5);
+        fillFrame(im);
+        check_equals(mismatches(im, SWFCxForm()), 0u);
+    }
+
+    // Extreme values are clipped.
+    {
+        image::ImageYUV im(2, 2);
+        std::fill(im.plane(0), im.plane(0) + 4, 235);
+        *im.plane(1) = 16;
+        *im.plane(2) = 240;
+        check_equals(mismatches(im, SWFCxForm()), 0u);
+
+        std::fill(im.plane(0), im.plane(0) + 4, 0);
+        *im.plane(1) = 255;
+        *im.plane(2) = 0;
+        check_equals(mismatches(im, SWFCxForm()), 0u);
+    }
+
+    // The color transform is applied after conversion, then the color
+    // premultiplied as AGG expects.
+    {
+        image::ImageYUV im(5, 3);
+        fillFrame(im);
+
+        SWFCxForm cx;
+        cx.ra = 128;
+        cx.gb = 40;
+        cx.ba = 300;
+        cx.bb = -20;
+        cx.aa = 192;
+        check_equals(mismatches(im, cx), 0u);
+
+        // Fully transparent.
+        SWFCxForm clear;
+        clear.aa = 0;
+        check_equals(mismatches(im, clear), 0u);
+    }
+
+    // Bilinear sampling at the frame's size takes luma samples as they
+    // are, and chroma from between the samples each pixel is nearest.
+    {
+        image::ImageYUV im(4, 1);
+        std::fill(im.plane(0), im.plane(0) + 4, 128);
+        im.plane(1)[0] = 100;
+        im.plane(1)[1] = 200;
+        std::fill(im.plane(2), im.plane(2) + 2, 128);
+
+        ScaleInterpolator interpolator(1);
+        YUVSpanGenerator<ScaleInterpolator> gen(im, interpolator,
+                SWFCxForm(), true);
+        agg::rgba8 span[4];
+        gen.generate(span, 0, 0, 4);
+
+        // Chroma sits between the two pixels it covers.
+        const double u[] = { 100, 125, 175, 200 };
+        for (size_t x = 0; x < 4; ++x) {
+            int r, g, b;
+            reference(128, u[x], 128, r, g, b);
+            check(close(span[x], r, g, b, 255));
+        }
+    }
+
+    // Magnified twice, bilinear sampling blends neighbouring luma.
+    {
+        image::ImageYUV im(2, 2);
+        im.plane(0)[0] = 50;
+        im.plane(0)[1] = 150;
+        im.plane(0)[2] = 50;
+        im.plane(0)[3] = 150;
+        *im.plane(1) = 128;
+        *im.plane(2) = 128;
+
+        ScaleInterpolator interpolator(0.5);
+        YUVSpanGenerator<ScaleInterpolator> gen(im, interpolator,
+                SWFCxForm(), true);
+        agg::rgba8 span[4];
+        gen.generate(span, 0, 1, 4);
+
+        const double y[] = { 50, 75, 125, 150 };
+        for (size_t x = 0; x < 4; ++x) {
+            int r, g, b;
+            reference(y[x], 128, 128, r, g, b);
+            check(close(span[x], r, g, b, 255));
+        }
+    }
+
+    return 0;
+}
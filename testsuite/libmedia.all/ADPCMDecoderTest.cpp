@@ -0,0 +1,239 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// Checks ADPCMDecoder against a decoder that reads one code at a time,
+// and AudioDecoderSimple's 8-bit conversion, and reports their speed.
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "ADPCMDecoder.h"
+#include "AudioDecoderSimple.h"
+#include "SoundInfo.h"
+#include "GnashNumeric.h"
+#include "WallClockTimer.h"
+#include "check.h"
+
+#include <cstdlib>
+#include <vector>
+#include <iostream>
+#include <boost/scoped_array.hpp>
+
+using namespace gnash;
+using namespace gnash::media;
+
+namespace {
+
+typedef std::vector<boost::int16_t> Samples;
+
+const int stepSize[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+const int indexUpdate[4][16] = {
+    { -1, 2 },
+    { -1, -1, 2, 4 },
+    { -1, -1, -1, -1, 2, 4, 6, 8 },
+    { -1, -1, -1, -1, -1, -1, -1, -1, 1, 2, 4, 6, 8, 10, 13, 16 }
+};
+
+void
+referenceSample(unsigned int bits, int& sample, int& index, int code)
+{
+    const int hiBit = 1 << (bits - 1);
+    const int mag = code & (hiBit - 1);
+    int delta = (stepSize[index] * ((mag << 1) + 1)) >> (bits - 1);
+    if (code & hiBit) delta = -delta;
+    sample = clamp<int>(sample + delta, -32768, 32767);
+    index = clamp<int>(index + indexUpdate[bits - 2][mag], 0, 88);
+}
+
+/// Reads a bit at a time.
+class Reader
+{
+public:
+    Reader(const boost::uint8_t* data, size_t size)
+        : _data(data), _bits(0), _size(size * 8) {}
+
+    bool atLeast(size_t n) const { return _size - _bits >= n; }
+
+    unsigned int read(unsigned int n) {
+        unsigned int v = 0;
+        for (unsigned int i = 0; i < n; ++i, ++_bits) {
+            v = (v << 1) | ((_data[_bits / 8] >> (7 - _bits % 8)) & 1);
+        }
+        return v;
+    }
+
+private:
+    const boost::uint8_t* _data;
+    size_t _bits;
+    const size_t _size;
+};
+
+/// Decode a code at a time, as AudioDecoderSimple used to.
+//
+/// It used to drop the last code when there were just enough bits for it,
+/// and the last code of each stereo block; this doesn't.
+Samples
+reference(const boost::uint8_t* data, size_t size, bool stereo)
+{
+    Samples out;
+    Reader in(data, size);
+    if (!in.atLeast(2)) return out;
+
+    const unsigned int bits = in.read(2) + 2;
+    const unsigned int channels = stereo ? 2 : 1;
+
+    while (in.atLeast(22 * channels)) {
+        int sample[2];
+        int index[2];
+        for (unsigned int c = 0; c < channels; ++c) {
+            sample[c] = static_cast<boost::int16_t>(in.read(16));
+            index[c] = in.read(6);
+            out.push_back(sample[c]);
+        }
+        for (size_t i = 1; i < 4096 && in.atLeast(bits * channels); ++i) {
+            for (unsigned int c = 0; c < channels; ++c) {
+                referenceSample(bits, sample[c], index[c], in.read(bits));
+                out.push_back(sample[c]);
+            }
+        }
+    }
+    return out;
+}
+
+Samples
+decode(const boost::uint8_t* data, size_t size, bool stereo)
+{
+    Samples out(ADPCMDecoder::maxSamples(size));
+    if (out.empty()) return out;
+    out.resize(ADPCMDecoder::decode(data, size, stereo, &out[0]) *
+            (stereo ? 2 : 1));
+    return out;
+}
+
+std::vector<boost::uint8_t>
+randomData(size_t size, unsigned int bits)
+{
+    std::vector<boost::uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = std::rand();
+    }
+    if (size) data[0] = (data[0] & 0x3f) | ((bits - 2) << 6);
+    return data;
+}
+
+double
+rate(size_t bytes, boost::uint32_t ms)
+{
+    return ms ? bytes / 1048.576 / ms : 0;
+}
+
+}
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    std::srand(3);
+
+    // Random data is valid ADPCM. Sizes that end part way through a
+    // block, a header and a code are all covered.
+    const size_t sizes[] = { 0, 1, 2, 3, 5, 6, 100, 1025, 2049, 4097,
+        5000, 20000 };
+
+    for (unsigned int bits = 2; bits <= 5; ++bits) {
+        for (int stereo = 0; stereo < 2; ++stereo) {
+            for (size_t i = 0; i < sizeof sizes / sizeof *sizes; ++i) {
+                const std::vector<boost::uint8_t> data =
+                    randomData(sizes[i], bits);
+                const boost::uint8_t* p = data.empty() ? 0 : &data[0];
+                const Samples expected = reference(p, data.size(), stereo);
+                const Samples got = decode(p, data.size(), stereo);
+                check_equals(got.size(), expected.size());
+                check(got == expected);
+            }
+        }
+    }
+
+    // A stereo block has 4096 samples for each channel.
+    {
+        // Headers and 4095 2-bit codes for each channel, then a header.
+        std::vector<boost::uint8_t> data(1 + (44 + 4095 * 4 + 44) / 8, 0);
+        const Samples got = decode(&data[0], data.size(), true);
+        check_equals(got.size(), 4097u * 2);
+    }
+
+    // 8-bit sounds are converted to 16 bits without changing the size.
+    {
+        std::vector<boost::uint8_t> data(1000);
+        for (size_t i = 0; i < data.size(); ++i) data[i] = i;
+
+        AudioDecoderSimple dec(SoundInfo(AUDIO_CODEC_UNCOMPRESSED, true,
+                    44100, 0, false));
+        boost::uint32_t size = 0;
+        boost::uint32_t used = 0;
+        boost::scoped_array<boost::uint8_t> out(
+                dec.decode(&data[0], data.size(), size, used));
+        check_equals(size, 2000u);
+        check_equals(used, 1000u);
+
+        const boost::int16_t* s =
+            reinterpret_cast<const boost::int16_t*>(out.get());
+        bool same = true;
+        for (size_t i = 0; i < data.size(); ++i) {
+            if (s[i] != (static_cast<boost::uint8_t>(i) - 128) * 256) {
+                same = false;
+            }
+        }
+        check(same);
+    }
+
+    // Speed.
+    for (unsigned int bits = 2; bits <= 5; bits += 2) {
+        const std::vector<boost::uint8_t> data = randomData(1 << 20, bits);
+        const size_t runs = 10;
+
+        WallClockTimer timer;
+        for (size_t i = 0; i < runs; ++i) {
+            reference(&data[0], data.size(), false);
+        }
+        const boost::uint32_t before = timer.elapsed();
+
+        timer.restart();
+        for (size_t i = 0; i < runs; ++i) {
+            decode(&data[0], data.size(), false);
+        }
+        const boost::uint32_t after = timer.elapsed();
+
+        note("%u-bit ADPCM: %.1f MB/s a code at a time, %.1f MB/s by block",
+                bits, rate(data.size() * runs, before),
+                rate(data.size() * runs, after));
+    }
+
+    return 0;
+}
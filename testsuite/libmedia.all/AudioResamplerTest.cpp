@@ -0,0 +1,257 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// Checks the quality of AudioResampler by resampling sine waves and
+// measuring what is left once the sine wave is taken out (THD+N), and
+// reports its speed.
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "AudioResampler.h"
+#include "AudioDecoderSimple.h"
+#include "SoundInfo.h"
+#include "WallClockTimer.h"
+#include "check.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <iostream>
+
+using namespace gnash;
+using media::AudioResampler;
+
+namespace {
+
+typedef std::vector<boost::int16_t> Samples;
+
+/// A sine wave in each channel, the right one a quarter turn later.
+Samples
+sine(double cycles, size_t frames, unsigned int channels, double amplitude)
+{
+    Samples s(frames * channels);
+    for (size_t i = 0; i < frames; ++i) {
+        for (unsigned int c = 0; c < channels; ++c) {
+            const double v = amplitude *
+                std::sin(2 * M_PI * cycles * i + c * M_PI / 2);
+            s[i * channels + c] = static_cast<boost::int16_t>(std::floor(v + 0.5));
+        }
+    }
+    return s;
+}
+
+/// Resample in chunks of random size, flushing at the end.
+Samples
+resample(AudioResampler& r, const Samples& in, unsigned int channels,
+        size_t maxChunk)
+{
+    const size_t frames = in.size() / channels;
+    Samples out;
+    size_t done = 0;
+    while (done < frames) {
+        const size_t n = std::min<size_t>(frames - done,
+                std::rand() % maxChunk + 1);
+        const size_t old = out.size();
+        out.resize(old + r.maxOutput(n) * 2);
+        const size_t wrote = r.process(&in[done * channels], n, &out[old]);
+        out.resize(old + wrote * 2);
+        done += n;
+    }
+    const size_t old = out.size();
+    out.resize(old + r.maxOutput(AudioResampler::taps / 2) * 2);
+    out.resize(old + r.flush(&out[old]) * 2);
+    return out;
+}
+
+/// Fit a sine wave of a known frequency to one channel.
+//
+/// @return the noise and distortion left relative to the sine wave, in dB.
+double
+thdn(const Samples& s, unsigned int channel, double cycles, size_t skip,
+        double& amplitude)
+{
+    const size_t frames = s.size() / 2;
+    double ss = 0, cc = 0, sc = 0, ys = 0, yc = 0;
+    for (size_t i = skip; i < frames - skip; ++i) {
+        const double a = std::sin(2 * M_PI * cycles * i);
+        const double b = std::cos(2 * M_PI * cycles * i);
+        const double y = s[i * 2 + channel];
+        ss += a * a; cc += b * b; sc += a * b;
+        ys += y * a; yc += y * b;
+    }
+    const double det = ss * cc - sc * sc;
+    const double A = (ys * cc - yc * sc) / det;
+    const double B = (yc * ss - ys * sc) / det;
+    amplitude = std::sqrt(A * A + B * B);
+
+    double noise = 0;
+    double signal = 0;
+    for (size_t i = skip; i < frames - skip; ++i) {
+        const double fit = A * std::sin(2 * M_PI * cycles * i) +
+            B * std::cos(2 * M_PI * cycles * i);
+        const double e = s[i * 2 + channel] - fit;
+        noise += e * e;
+        signal += fit * fit;
+    }
+    return 10 * std::log10(noise / signal);
+}
+
+}
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    std::srand(7);
+
+    const unsigned int rates[] = { 5512, 5500, 11000, 11025, 16000, 22050 };
+    const double amplitude = 16000;
+
+    for (size_t i = 0; i < sizeof rates / sizeof *rates; ++i) {
+        for (unsigned int channels = 1; channels <= 2; ++channels) {
+
+            // The SWF 5.5 kHz rate is really an eighth of 44100.
+            const double rate = rates[i] == 5512 ? 5512.5 : rates[i];
+            const size_t frames = rates[i];
+
+            // Tones well inside the passband.
+            const double tones[] = { 441, 0.3 * rate, 0.4 * rate };
+            for (size_t t = 0; t < 3; ++t) {
+                const Samples in = sine(tones[t] / rate, frames, channels,
+                        amplitude);
+
+                AudioResampler whole(rates[i], channels);
+                Samples once(whole.maxOutput(frames) * 2);
+                once.resize(whole.process(&in[0], frames, &once[0]) * 2);
+                const size_t old = once.size();
+                once.resize(old + whole.maxOutput(AudioResampler::taps / 2) * 2);
+                once.resize(old + whole.flush(&once[old]) * 2);
+
+                AudioResampler chunked(rates[i], channels);
+                const Samples out = resample(chunked, in, channels, 700);
+
+                // Chunks make no difference.
+                check(out == once);
+
+                // All of the input comes out.
+                const double expected = frames * 44100 / rate;
+                check(std::abs(out.size() / 2 - expected) <= 2);
+
+                double left, right;
+                const double dbLeft = thdn(out, 0, tones[t] / 44100, 2000,
+                        left);
+                const double dbRight = thdn(out, 1, tones[t] / 44100, 2000,
+                        right);
+
+                note("%u Hz %s, %.0f Hz tone: THD+N %.1f dB, %.1f dB",
+                        rates[i], channels == 2 ? "stereo" : "mono",
+                        tones[t], dbLeft, dbRight);
+
+                check(dbLeft < -75);
+                check(dbRight < -75);
+
+                // The passband is flat.
+                check(std::abs(20 * std::log10(left / amplitude)) < 0.1);
+                check(std::abs(20 * std::log10(right / amplitude)) < 0.1);
+            }
+        }
+    }
+
+    // Mono at 44100 Hz is only made stereo.
+    {
+        const Samples in = sine(0.01, 1000, 1, amplitude);
+        AudioResampler r(44100, 1);
+        check_equals(r.maxOutput(1000), 1000u);
+        Samples out(2000);
+        check_equals(r.process(&in[0], 1000, &out[0]), 1000u);
+        check_equals(out[0], in[0]);
+        check_equals(out[1], in[0]);
+        check_equals(out[1999], in[999]);
+        check_equals(r.flush(&out[0]), 0u);
+    }
+
+    // A decoder gives back the whole sound once flushed, and starts
+    // afresh afterwards.
+    {
+        media::AudioDecoderSimple dec(media::SoundInfo(
+                media::AUDIO_CODEC_UNCOMPRESSED, false, 11025, 0, false));
+        std::vector<boost::uint8_t> data(1000, 0x80);
+
+        size_t first = 0;
+        for (size_t pass = 0; pass < 2; ++pass) {
+            size_t frames = 0;
+            for (size_t i = 0; i < data.size(); i += 100) {
+                boost::uint32_t size = 0;
+                boost::uint32_t used = 0;
+                boost::uint8_t* out = dec.decode(&data[i], 100, size, used);
+                if (!i && !pass) first = size;
+                if (!i) check_equals(size, first);
+                frames += size / 4;
+                delete [] out;
+            }
+            check(frames < 4000 - AudioResampler::taps);
+
+            boost::uint32_t size = 0;
+            boost::uint8_t* out = dec.flush(size);
+            check(out);
+            frames += size / 4;
+            delete [] out;
+            check(frames >= 3999 && frames <= 4001);
+
+            check(!dec.flush(size));
+            check_equals(size, 0u);
+        }
+    }
+
+    // Full scale input clips rather than wraps round.
+    {
+        Samples in(4000);
+        for (size_t i = 0; i < in.size(); ++i) {
+            in[i] = i % 2 ? 32767 : -32768;
+        }
+        AudioResampler r(22050, 1);
+        Samples out(r.maxOutput(in.size()) * 2);
+        out.resize(r.process(&in[0], in.size(), &out[0]) * 2);
+        bool wrapped = false;
+        for (size_t i = 1; i < out.size(); ++i) {
+            if (std::abs(out[i] - out[i - 1]) > 60000) wrapped = true;
+        }
+        check(!wrapped);
+    }
+
+    // Speed, in seconds of sound per second.
+    const unsigned int benchRates[] = { 5512, 11025, 22050 };
+    for (size_t i = 0; i < 3; ++i) {
+        const size_t frames = benchRates[i] * 20;
+        const Samples in = sine(0.01, frames, 2, amplitude);
+        AudioResampler r(benchRates[i], 2);
+        Samples out(r.maxOutput(4096 + AudioResampler::taps) * 2);
+
+        WallClockTimer timer;
+        for (size_t done = 0; done < frames; done += 4096) {
+            const size_t n = std::min<size_t>(4096, frames - done);
+            r.process(&in[done * 2], n, &out[0]);
+        }
+        const boost::uint32_t ms = timer.elapsed();
+        note("%u Hz stereo: %.0f times real time", benchRates[i],
+                ms ? 20000.0 / ms : 0.0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+//
+//   Copyright (C) 2012 Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// Checks that BufferPool hands buffers out again, and that decoding
+// with a pool stops allocating once playback is steady.
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "BufferPool.h"
+#include "AudioDecoderSimple.h"
+#include "SoundInfo.h"
+#include "GnashImage.h"
+#include "check.h"
+
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <boost/shared_ptr.hpp>
+
+using namespace gnash;
+using namespace gnash::media;
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    // Released buffers are reused for sizes in the same class.
+    {
+        BufferPool pool;
+
+        boost::uint8_t* a = pool.allocate(1000);
+        check(a);
+        check_equals(pool.stats().allocations, 1u);
+        check_equals(pool.stats().outstanding, 1u);
+
+        pool.release(a);
+        check_equals(pool.stats().outstanding, 0u);
+        check_equals(pool.stats().pooledBytes, 1024u);
+
+        boost::uint8_t* b = pool.allocate(1024);
+        check(b == a);
+        check_equals(pool.stats().allocations, 1u);
+        check_equals(pool.stats().reuses, 1u);
+        check_equals(pool.stats().pooledBytes, 0u);
+
+        // A different class needs a new buffer.
+        boost::uint8_t* c = pool.allocate(1025);
+        check(c != b);
+        check_equals(pool.stats().allocations, 2u);
+
+        pool.release(b);
+        pool.release(c);
+        pool.release(0);
+        check_equals(pool.stats().outstanding, 0u);
+    }
+
+    // Buffers too large to pool are freed on release.
+    {
+        BufferPool pool;
+        boost::uint8_t* big = pool.allocate(100 << 20);
+        big[(100 << 20) - 1] = 1;
+        pool.release(big);
+        check_equals(pool.stats().pooledBytes, 0u);
+        check_equals(pool.stats().outstanding, 0u);
+    }
+
+    // Only a limited number of buffers of a size is kept.
+    {
+        BufferPool pool;
+        std::vector<boost::uint8_t*> bufs;
+        for (size_t i = 0; i < 100; ++i) bufs.push_back(pool.allocate(4096));
+        for (size_t i = 0; i < bufs.size(); ++i) pool.release(bufs[i]);
+        check(pool.stats().pooledBytes < 100 * 4096);
+        check(pool.stats().pooledBytes > 0);
+    }
+
+    // Images give their data back when destroyed.
+    {
+        boost::shared_ptr<BufferPool> pool(new BufferPool);
+        for (size_t i = 0; i < 10; ++i) {
+            std::auto_ptr<image::GnashImage> rgb(
+                    new PooledImage<image::ImageRGB>(pool, 320, 240));
+            check_equals(rgb->size(), 320u * 240 * 3);
+            std::fill(rgb->begin(), rgb->end(), 0x80);
+            check_equals(rgb->end() - rgb->begin(), 320 * 240 * 3);
+
+            std::auto_ptr<image::ImageYUV> yuv(
+                    new PooledImage<image::ImageYUV>(pool, 321, 241));
+            check_equals(yuv->plane(1) - yuv->plane(0), 321 * 241);
+            std::fill(yuv->begin(), yuv->end(), 0x10);
+            check_equals(pool->stats().outstanding, 2u);
+        }
+        check_equals(pool->stats().outstanding, 0u);
+        check_equals(pool->stats().allocations, 2u);
+        check_equals(pool->stats().reuses, 18u);
+    }
+
+    // Steady decoding doesn't allocate, even when resampling.
+    {
+        boost::shared_ptr<BufferPool> pool(new BufferPool);
+        AudioDecoderSimple dec(SoundInfo(AUDIO_CODEC_UNCOMPRESSED, false,
+                    22050, 0, false));
+        dec.setBufferPool(pool);
+
+        std::vector<boost::uint8_t> data(1000);
+        for (size_t i = 0; i < data.size(); ++i) data[i] = i;
+
+        size_t allocations = 0;
+        for (size_t i = 0; i < 50; ++i) {
+            boost::uint32_t size = 0;
+            boost::uint32_t used = 0;
+            boost::uint8_t* out = dec.decode(&data[0], data.size(), size,
+                    used);
+            check_equals(used, 1000u);
+            check(size >= 4 * 1000 - 16);
+            check_equals(pool->stats().outstanding, 1u);
+            pool->release(out);
+            if (i == 1) allocations = pool->stats().allocations;
+        }
+        check_equals(pool->stats().allocations, allocations);
+        note("%u allocations and %u reuses decoding 50 blocks",
+                unsigned(pool->stats().allocations),
+                unsigned(pool->stats().reuses));
+    }
+
+    return 0;
+}
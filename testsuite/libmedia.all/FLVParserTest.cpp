@@ -0,0 +1,338 @@
+//
+//   Copyright (C) 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012
+//   Free Software Foundation, Inc
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+// Checks seeking in FLVs through their onMetaData keyframes, the tag
+// headers and the index cache, and reports how long the first seek takes.
+
+#ifdef HAVE_CONFIG_H
+#include "gnashconfig.h"
+#endif
+
+#include "FLVParser.h"
+#include "IOChannel.h"
+#include "tu_file.h"
+#include "SimpleBuffer.h"
+#include "AMF.h"
+#include "rc.h"
+#include "WallClockTimer.h"
+#include "GnashSleep.h"
+#include "check.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <memory>
+#include <iostream>
+#include <dirent.h>
+#include <unistd.h>
+
+using namespace gnash;
+using namespace gnash::media;
+
+namespace {
+
+/// Each video tag is this long apart.
+const boost::uint32_t frameTime = 40;
+
+/// Every this many video tags is a keyframe.
+const size_t keyframeInterval = 10;
+
+void
+putUInt24(SimpleBuffer& buf, boost::uint32_t v)
+{
+    buf.appendByte(v >> 16);
+    buf.appendByte(v >> 8);
+    buf.appendByte(v);
+}
+
+void
+putUInt32(SimpleBuffer& buf, boost::uint32_t v)
+{
+    buf.appendByte(v >> 24);
+    putUInt24(buf, v);
+}
+
+void
+putTag(SimpleBuffer& flv, boost::uint8_t type, boost::uint32_t timestamp,
+        const SimpleBuffer& body)
+{
+    flv.appendByte(type);
+    putUInt24(flv, body.size());
+    putUInt24(flv, timestamp & 0xffffff);
+    flv.appendByte(timestamp >> 24);
+    putUInt24(flv, 0);
+    flv.append(body.data(), body.size());
+    putUInt32(flv, body.size() + 11);
+}
+
+/// Write an FLV of video frames, with or without an onMetaData tag.
+//
+/// @param shift    Moves the keyframe positions in onMetaData.
+FILE*
+makeFLV(size_t frames, bool metadata, long shift = 0)
+{
+    SimpleBuffer flv;
+    flv.append("FLV", 3);
+    flv.appendByte(1);
+    flv.appendByte(1);
+    putUInt32(flv, 9);
+    putUInt32(flv, 0);
+
+    const size_t frameBody = 100;
+    const size_t keyframes = (frames + keyframeInterval - 1) / keyframeInterval;
+
+    if (metadata) {
+        // The tags follow onMetaData, whose size depends only on the
+        // number of keyframes.
+        SimpleBuffer meta;
+        amf::write(meta, "onMetaData");
+        meta.appendByte(amf::ECMA_ARRAY_AMF0);
+        putUInt32(meta, 2);
+        amf::writePlainString(meta, "duration", amf::STRING_AMF0);
+        amf::write(meta, frames * frameTime / 1000.0);
+        amf::writePlainString(meta, "keyframes", amf::STRING_AMF0);
+        meta.appendByte(amf::OBJECT_AMF0);
+
+        const size_t metaSize = meta.size() + 2 * (2 + 5 + 9 * keyframes) +
+            std::string("times").size() +
+            std::string("filepositions").size() + 6;
+        const size_t firstTag = flv.size() + 11 + metaSize + 4;
+
+        amf::writePlainString(meta, "times", amf::STRING_AMF0);
+        meta.appendByte(amf::STRICT_ARRAY_AMF0);
+        putUInt32(meta, keyframes);
+        for (size_t i = 0; i < keyframes; ++i) {
+            amf::write(meta, i * keyframeInterval * frameTime / 1000.0);
+        }
+        amf::writePlainString(meta, "filepositions", amf::STRING_AMF0);
+        meta.appendByte(amf::STRICT_ARRAY_AMF0);
+        putUInt32(meta, keyframes);
+        for (size_t i = 0; i < keyframes; ++i) {
+            amf::write(meta, static_cast<double>(firstTag + shift +
+                        i * keyframeInterval * (15 + frameBody)));
+        }
+        amf::writePlainString(meta, "", amf::STRING_AMF0);
+        meta.appendByte(amf::OBJECT_END_AMF0);
+        amf::writePlainString(meta, "", amf::STRING_AMF0);
+        meta.appendByte(amf::OBJECT_END_AMF0);
+
+        check_equals(meta.size(), metaSize);
+        putTag(flv, 0x12, 0, meta);
+    }
+
+    SimpleBuffer frame(frameBody);
+    frame.resize(frameBody);
+    for (size_t i = 0; i < frames; ++i) {
+        // Sorenson H.263, key or inter frame.
+        frame.data()[0] = (i % keyframeInterval ? 0x20 : 0x10) | 0x02;
+        putTag(flv, 0x09, i * frameTime, frame);
+    }
+
+    FILE* f = std::tmpfile();
+    std::fwrite(flv.data(), 1, flv.size(), f);
+    std::fflush(f);
+    return f;
+}
+
+/// The files in a directory.
+size_t
+countFiles(const std::string& dir)
+{
+    size_t n = 0;
+    DIR* d = opendir(dir.c_str());
+    if (!d) return 0;
+    while (const struct dirent* e = readdir(d)) {
+        if (e->d_name[0] != '.') ++n;
+    }
+    closedir(d);
+    return n;
+}
+
+/// Seek in a new parser for an FLV and return the time found.
+//
+/// @param ms   Set to the time the seek took.
+boost::uint32_t
+seekTo(FILE* f, boost::uint32_t time, boost::uint32_t& ms, bool& found)
+{
+    std::rewind(f);
+    FLVParser parser(makeFileChannel(fdopen(dup(fileno(f)), "rb"), true));
+
+    WallClockTimer timer;
+    found = parser.seek(time);
+    ms = timer.elapsed();
+    return time;
+}
+
+boost::uint32_t
+seekTo(FILE* f, boost::uint32_t time)
+{
+    boost::uint32_t ms;
+    bool found;
+    const boost::uint32_t t = seekTo(f, time, ms, found);
+    return found ? t : static_cast<boost::uint32_t>(-1);
+}
+
+}
+
+int
+main(int /*argc*/, char** /*argv*/)
+{
+    RcInitFile& rc = RcInitFile::getDefaultInstance();
+    const boost::uint32_t keyframeTime = keyframeInterval * frameTime;
+
+    // Seeking goes to the next keyframe, with or without onMetaData.
+    for (int metadata = 0; metadata < 2; ++metadata) {
+        FILE* f = makeFLV(1000, metadata);
+        check_equals(seekTo(f, 0), 0u);
+        check_equals(seekTo(f, 1), keyframeTime);
+        check_equals(seekTo(f, 20 * keyframeTime), 20 * keyframeTime);
+        check_equals(seekTo(f, 20 * keyframeTime + 1), 21 * keyframeTime);
+        check_equals(seekTo(f, 99 * keyframeTime), 99 * keyframeTime);
+        check_equals(seekTo(f, 99 * keyframeTime + 1),
+                static_cast<boost::uint32_t>(-1));
+        std::fclose(f);
+    }
+
+    // Wrong keyframe positions in onMetaData are noticed.
+    {
+        FILE* f = makeFLV(1000, true, 7);
+        check_equals(seekTo(f, 50 * keyframeTime - 1), 50 * keyframeTime);
+        std::fclose(f);
+    }
+
+    // Frames reach the main thread in order, also after a seek.
+    {
+        FILE* f = makeFLV(1000, false);
+        std::rewind(f);
+        FLVParser parser(makeFileChannel(fdopen(dup(fileno(f)), "rb"), true));
+        parser.setBufferTime(200);
+
+        gnashSleep(100000);
+        check(parser.getBufferLength() <= 200 + frameTime);
+
+        size_t frames = 0;
+        size_t wrong = 0;
+        boost::uint64_t next = 0;
+        bool seeked = false;
+        for (;;) {
+            std::auto_ptr<EncodedVideoFrame> frame = parser.nextVideoFrame();
+            if (!frame.get()) {
+                if (parser.parsingCompleted() && parser.isBufferEmpty()) {
+                    if (seeked) break;
+
+                    // Play the second half again.
+                    boost::uint32_t time = 50 * keyframeTime;
+                    check(parser.seek(time));
+                    check_equals(time, 50 * keyframeTime);
+                    next = time;
+                    seeked = true;
+                }
+                gnashSleep(1000);
+                continue;
+            }
+            if (frame->timestamp() != next) ++wrong;
+            next = frame->timestamp() + frameTime;
+            ++frames;
+        }
+        check_equals(frames, 1500u);
+        check_equals(wrong, 0u);
+        std::fclose(f);
+    }
+
+    // The index cache.
+    char dirName[] = "/tmp/FLVParserTestXXXXXX";
+    const std::string dir = mkdtemp(dirName);
+    rc.setFLVIndexDir(dir);
+    {
+        FILE* f = makeFLV(1000, false);
+
+        // The index is stored when the end of the FLV is reached.
+        check_equals(seekTo(f, 100 * keyframeTime),
+                static_cast<boost::uint32_t>(-1));
+        check_equals(countFiles(dir), 1u);
+
+        check_equals(seekTo(f, 30 * keyframeTime + 1), 31 * keyframeTime);
+
+        // A wrong index is dropped and found again.
+        DIR* d = opendir(dir.c_str());
+        std::string file;
+        while (const struct dirent* e = readdir(d)) {
+            if (e->d_name[0] != '.') file = dir + "/" + e->d_name;
+        }
+        closedir(d);
+
+        FILE* idx = std::fopen(file.c_str(), "w");
+        std::fprintf(idx, "FLVIndex 1\n0 13\n%u 1234\n",
+                static_cast<unsigned int>(60 * keyframeTime));
+        std::fclose(idx);
+
+        check_equals(seekTo(f, 60 * keyframeTime), 60 * keyframeTime);
+        check_equals(countFiles(dir), 0u);
+        std::fclose(f);
+    }
+
+    // Nothing is stored for a truncated FLV.
+    {
+        FILE* f = makeFLV(1000, false);
+        std::fseek(f, 0, SEEK_END);
+        check(!ftruncate(fileno(f), std::ftell(f) / 2 + 3));
+
+        check_equals(seekTo(f, 100 * keyframeTime),
+                static_cast<boost::uint32_t>(-1));
+        check_equals(countFiles(dir), 0u);
+        std::fclose(f);
+    }
+
+    // How long the first seek to the end of a long FLV takes.
+    {
+        const size_t frames = 200000;
+        const boost::uint32_t end = (frames / keyframeInterval - 1) *
+            keyframeTime;
+        boost::uint32_t skim, cached, meta;
+        bool found;
+
+        FILE* f = makeFLV(frames, false);
+        check_equals(seekTo(f, end, skim, found), end);
+        check_equals(seekTo(f, end + 1, skim, found), end + 1);
+        check(!found);
+        check_equals(seekTo(f, end, cached, found), end);
+        check(found);
+        std::fclose(f);
+
+        f = makeFLV(frames, true);
+        check_equals(seekTo(f, end, meta, found), end);
+        check(found);
+        std::fclose(f);
+
+        note("First seek in %lu tags: %u ms from tag headers, %u ms from "
+                "the index cache, %u ms from onMetaData",
+                static_cast<unsigned long>(frames), skim, cached, meta);
+    }
+
+    for (DIR* d = opendir(dir.c_str()); d; closedir(d), d = 0) {
+        while (const struct dirent* e = readdir(d)) {
+            if (e->d_name[0] != '.') {
+                std::remove((dir + "/" + e->d_name).c_str());
+            }
+        }
+    }
+    rmdir(dir.c_str());
+    rc.setFLVIndexDir(std::string());
+
+    return 0;
+}